@@ -8,6 +8,8 @@ goto end
 )
 
 set BuildShaderPreprocessor=false
+set BuildGLReplay=false
+set BuildOcclusionTest=false
 set BuildResourceLoader=true
 
 set ObjOutDir=build\obj\
@@ -36,6 +38,16 @@ echo Building shader preprocessor...
 cl /W3 /wd4530 /Gm- /GR- /Od /Zi /MTd /nologo /diagnostics:classic /WX /std:c++17 /Fo%ObjOutDir% /D_CRT_SECURE_NO_WARNINGS /DWIN32_LEAN_AND_MEAN  src/tools/shader_preprocessor.cpp /link /INCREMENTAL:NO /OPT:REF /MACHINE:X64 /OUT:%BinOutDir%\shader_preprocessor.exe /PDB:%BinOutDir%\shader_preprocessor.pdb
 )
 
+if %BuildGLReplay% equ true (
+echo Building GL replay...
+cl /W3 /wd4530 /Gm- /GR- /O2 /Zi /MT /nologo /diagnostics:classic /WX /std:c++17 /Fo%ObjOutDir% /D_CRT_SECURE_NO_WARNINGS /DWIN32_LEAN_AND_MEAN  src/tools/gl_replay.cpp /link /INCREMENTAL:NO /OPT:REF /MACHINE:X64 user32.lib gdi32.lib opengl32.lib /OUT:%BinOutDir%\gl_replay.exe /PDB:%BinOutDir%\gl_replay.pdb
+)
+
+if %BuildOcclusionTest% equ true (
+echo Building occlusion test...
+cl /W3 /wd4530 /Gm- /GR- /O2 /Zi /MT /nologo /diagnostics:classic /WX /std:c++17 /Fo%ObjOutDir% /D_CRT_SECURE_NO_WARNINGS /DWIN32_LEAN_AND_MEAN  src/tools/occlusion_test.cpp /link /INCREMENTAL:NO /OPT:REF /MACHINE:X64 /OUT:%BinOutDir%\occlusion_test.exe /PDB:%BinOutDir%\occlusion_test.pdb
+)
+
 echo Preprocessing shaders...
 build\shader_preprocessor.exe src/flux_shader_config.txt
 COPY shader_preprocessor_output.h src\flux_shaders_generated.h
@@ -6,6 +6,10 @@ u32 AtomicCompareExchange(u32 volatile* dest, u32 comp, u32 newValue) {
     return (u32)_InterlockedCompareExchange((LONG volatile*)dest, (LONG)newValue, (LONG)comp);
 }
 
+u64 AtomicCompareExchange(u64 volatile* dest, u64 comp, u64 newValue) {
+    return (u64)_InterlockedCompareExchange64((__int64 volatile*)dest, (__int64)newValue, (__int64)comp);
+}
+
 u32 AtomicExchange(u32 volatile* dest, u32 value) {
     return (u32)_InterlockedExchange((LONG volatile*)dest, (LONG)value);
 }
@@ -26,6 +30,10 @@ u32 AtomicLoad(u32 volatile* value) {
     return *value;
 }
 
+void SpinPause() {
+    _mm_pause();
+}
+
 u64 GetTimeStamp() {
     LARGE_INTEGER count;
     auto result = QueryPerformanceCounter(&count);
@@ -1,6 +1,7 @@
 #pragma once
 
 u32 AtomicCompareExchange(u32 volatile* dest, u32 comp, u32 newValue);
+u64 AtomicCompareExchange(u64 volatile* dest, u64 comp, u64 newValue);
 u32 AtomicExchange(u32 volatile* dest, u32 value);
 u64 AtomicExchange(u64 volatile* dest, u64 value);
 
@@ -13,6 +14,9 @@ u32 AtomicLoad(u32 volatile* value);
 
 u32 ThreadSleep(u32 ms);
 
+// NOTE: Hint for the body of a spin wait loop
+void SpinPause();
+
 u64 GetTimeStamp();
 u64 GetTicksPerSecond();
 
@@ -28,11 +32,28 @@ constexpr u32 NextPowerOfTwo(u32 v) {
     return v;
 }
 
+// NOTE: FNV-1a. Not a cryptographic hash, only used for cache keys
+u64 Hash64(const void* data, uptr size, u64 hash = 0xcbf29ce484222325) {
+    auto at = (const byte*)data;
+    for (uptr i = 0; i < size; i++) {
+        hash ^= at[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
 constexpr bool IsPowerOfTwo(u32 n) {
     bool result = ((n & (n - 1)) == 0);
     return result;
 }
 
+// NOTE: https://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
+constexpr u32 CountSetBits(u32 v) {
+    v = v - ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    return (((v + (v >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+}
+
 bool IsNegative(f32 value) {
     bool result;
     auto sign = signbit(value);
@@ -116,6 +137,10 @@ f32 Sqrt(f32 v) {
     return sqrtf(v);
 }
 
+f32 Log(f32 v) {
+    return logf(v);
+}
+
 f32 Floor(f32 v) {
     return floorf(v);
 }
@@ -0,0 +1,530 @@
+#include "NullOpenGL.h"
+
+// NOTE: The backend is platform independent, it only needs Allocate/Deallocate and AtomicIncrement from the platform layer
+
+struct NullOpenGLBuffer {
+    uptr size;
+    void* memory;
+};
+
+struct NullOpenGLState {
+    static constexpr u32 MaxBuffers = 1 << 16;
+
+    NullOpenGLStats stats;
+    // NOTE: GL has a separate namespace for every object type, but a single counter for everything except buffers is enough
+    u32 volatile objectHandle;
+    u32 volatile bufferHandle;
+    // NOTE: Indexed by the buffer handle. Memory is allocated on the first map
+    NullOpenGLBuffer buffers[MaxBuffers];
+    GLuint pixelUnpackBuffer;
+};
+
+static NullOpenGLState* GlobalNullGL;
+
+#define null_gl_record(func) (GlobalNullGL->stats.callCount++, GlobalNullGL->stats.functionCalls[opengl_function_index(func)]++)
+
+// NOTE: Every function without a specialized stub gets its own instantiation of this one, so calls are counted per function
+// even though the stub knows nothing about the signature. Returning u64 in rax covers every integer and pointer return
+// type and arguments are ignored, which is fine for both x64 calling conventions
+template <u32 Index>
+static u64 KHRONOS_APIENTRY NullGLStub() {
+    GlobalNullGL->stats.callCount++;
+    GlobalNullGL->stats.functionCalls[Index]++;
+    return 0;
+}
+
+template <u32 Begin, u32 End>
+static void NullGLInstallStubs(void** table) {
+    if constexpr (Begin + 1 == End) {
+        table[Begin] = (void*)NullGLStub<Begin>;
+    } else {
+        constexpr u32 Mid = Begin + (End - Begin) / 2;
+        NullGLInstallStubs<Begin, Mid>(table);
+        NullGLInstallStubs<Mid, End>(table);
+    }
+}
+
+static void NullGLRecordTexelUpload(const void* pixels, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type) {
+    // NOTE: With a pixel unpack buffer bound pixels is an offset which may be zero, the transfer happens anyway
+    if (pixels || GlobalNullGL->pixelUnpackBuffer) {
+        GlobalNullGL->stats.bytesUploaded += (u64)width * (u64)height * (u64)depth * OpenGLPixelSize(format, type);
+    }
+}
+
+static void NullGLGenHandles(u32 volatile* counter, GLsizei n, GLuint* handles) {
+    for (GLsizei i = 0; i < n; i++) {
+        handles[i] = AtomicIncrement(counter);
+    }
+}
+
+// NOTE: Objects
+
+static void KHRONOS_APIENTRY NullGLGenBuffers(GLsizei n, GLuint* buffers) {
+    null_gl_record(glGenBuffers);
+    NullGLGenHandles(&GlobalNullGL->bufferHandle, n, buffers);
+}
+
+static void KHRONOS_APIENTRY NullGLCreateBuffers(GLsizei n, GLuint* buffers) {
+    null_gl_record(glCreateBuffers);
+    NullGLGenHandles(&GlobalNullGL->bufferHandle, n, buffers);
+}
+
+static void KHRONOS_APIENTRY NullGLDeleteBuffers(GLsizei n, const GLuint* buffers) {
+    null_gl_record(glDeleteBuffers);
+    for (GLsizei i = 0; i < n; i++) {
+        if (buffers[i] && buffers[i] < NullOpenGLState::MaxBuffers) {
+            auto buffer = GlobalNullGL->buffers + buffers[i];
+            if (buffer->memory) {
+                Deallocate(buffer->memory, nullptr);
+            }
+            *buffer = {};
+        }
+    }
+}
+
+#define null_gl_gen_objects(func, name) \
+static void KHRONOS_APIENTRY name(GLsizei n, GLuint* handles) { \
+    null_gl_record(func); \
+    NullGLGenHandles(&GlobalNullGL->objectHandle, n, handles); \
+}
+
+null_gl_gen_objects(glGenTextures, NullGLGenTextures)
+null_gl_gen_objects(glGenFramebuffers, NullGLGenFramebuffers)
+null_gl_gen_objects(glCreateFramebuffers, NullGLCreateFramebuffers)
+null_gl_gen_objects(glGenRenderbuffers, NullGLGenRenderbuffers)
+null_gl_gen_objects(glCreateRenderbuffers, NullGLCreateRenderbuffers)
+null_gl_gen_objects(glGenVertexArrays, NullGLGenVertexArrays)
+null_gl_gen_objects(glCreateVertexArrays, NullGLCreateVertexArrays)
+null_gl_gen_objects(glGenSamplers, NullGLGenSamplers)
+null_gl_gen_objects(glCreateSamplers, NullGLCreateSamplers)
+null_gl_gen_objects(glGenQueries, NullGLGenQueries)
+
+#undef null_gl_gen_objects
+
+static void KHRONOS_APIENTRY NullGLCreateTextures(GLenum target, GLsizei n, GLuint* textures) {
+    null_gl_record(glCreateTextures);
+    NullGLGenHandles(&GlobalNullGL->objectHandle, n, textures);
+}
+
+static void KHRONOS_APIENTRY NullGLCreateQueries(GLenum target, GLsizei n, GLuint* ids) {
+    null_gl_record(glCreateQueries);
+    NullGLGenHandles(&GlobalNullGL->objectHandle, n, ids);
+}
+
+static GLuint KHRONOS_APIENTRY NullGLCreateShader(GLenum type) {
+    null_gl_record(glCreateShader);
+    return AtomicIncrement(&GlobalNullGL->objectHandle);
+}
+
+static GLuint KHRONOS_APIENTRY NullGLCreateProgram() {
+    null_gl_record(glCreateProgram);
+    return AtomicIncrement(&GlobalNullGL->objectHandle);
+}
+
+// NOTE: Queries
+
+static void KHRONOS_APIENTRY NullGLGetIntegerv(GLenum pname, GLint* data) {
+    null_gl_record(glGetIntegerv);
+    switch (pname) {
+    case GL_MAJOR_VERSION: { data[0] = 4; } break;
+    case GL_MINOR_VERSION: { data[0] = 6; } break;
+    case GL_MAX_SAMPLES: { data[0] = 8; } break;
+    case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: { data[0] = 256; } break;
+    case GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT: { data[0] = 16; } break;
+    case GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS: { data[0] = 16; } break;
+    case GL_POLYGON_MODE: { data[0] = GL_FILL; data[1] = GL_FILL; } break;
+    case GL_VIEWPORT: case GL_SCISSOR_BOX: { data[0] = 0; data[1] = 0; data[2] = 0; data[3] = 0; } break;
+    default: { data[0] = 0; } break;
+    }
+}
+
+static void KHRONOS_APIENTRY NullGLGetFloatv(GLenum pname, GLfloat* data) {
+    null_gl_record(glGetFloatv);
+    switch (pname) {
+    case GL_MAX_TEXTURE_MAX_ANISOTROPY_ARB: { data[0] = 16.0f; } break;
+    default: { data[0] = 0.0f; } break;
+    }
+}
+
+static const GLubyte* KHRONOS_APIENTRY NullGLGetString(GLenum name) {
+    null_gl_record(glGetString);
+    return (const GLubyte*)"Null";
+}
+
+static const GLubyte* KHRONOS_APIENTRY NullGLGetStringi(GLenum name, GLuint index) {
+    null_gl_record(glGetStringi);
+    return (const GLubyte*)"";
+}
+
+static void KHRONOS_APIENTRY NullGLGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+    null_gl_record(glGetShaderiv);
+    params[0] = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+static void KHRONOS_APIENTRY NullGLGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+    null_gl_record(glGetProgramiv);
+    params[0] = (pname == GL_LINK_STATUS || pname == GL_COMPLETION_STATUS_KHR) ? GL_TRUE : 0;
+}
+
+static GLenum KHRONOS_APIENTRY NullGLCheckFramebufferStatus(GLenum target) {
+    null_gl_record(glCheckFramebufferStatus);
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static GLenum KHRONOS_APIENTRY NullGLCheckNamedFramebufferStatus(GLuint framebuffer, GLenum target) {
+    null_gl_record(glCheckNamedFramebufferStatus);
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static GLsync KHRONOS_APIENTRY NullGLFenceSync(GLenum condition, GLbitfield flags) {
+    null_gl_record(glFenceSync);
+    // NOTE: Callers treat null as a failure
+    return (GLsync)(uptr)AtomicIncrement(&GlobalNullGL->objectHandle);
+}
+
+static GLenum KHRONOS_APIENTRY NullGLClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+    null_gl_record(glClientWaitSync);
+    return GL_ALREADY_SIGNALED;
+}
+
+static void KHRONOS_APIENTRY NullGLGetQueryObjectiv(GLuint id, GLenum pname, GLint* params) {
+    null_gl_record(glGetQueryObjectiv);
+    params[0] = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void KHRONOS_APIENTRY NullGLGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params) {
+    null_gl_record(glGetQueryObjectui64v);
+    params[0] = 0;
+}
+
+// NOTE: Buffers
+
+static void NullGLSetBufferSize(GLuint handle, GLsizeiptr size) {
+    if (handle && handle < NullOpenGLState::MaxBuffers) {
+        auto buffer = GlobalNullGL->buffers + handle;
+        if (buffer->memory) {
+            Deallocate(buffer->memory, nullptr);
+            buffer->memory = nullptr;
+        }
+        buffer->size = (uptr)size;
+    }
+}
+
+static void KHRONOS_APIENTRY NullGLNamedBufferStorage(GLuint buffer, GLsizeiptr size, const void* data, GLbitfield flags) {
+    null_gl_record(glNamedBufferStorage);
+    NullGLSetBufferSize(buffer, size);
+    if (data) GlobalNullGL->stats.bytesUploaded += (u64)size;
+}
+
+static void KHRONOS_APIENTRY NullGLNamedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) {
+    null_gl_record(glNamedBufferData);
+    NullGLSetBufferSize(buffer, size);
+    if (data) GlobalNullGL->stats.bytesUploaded += (u64)size;
+}
+
+// NOTE: Bind points are not tracked, so non-DSA allocations are only counted. Nothing maps them in the renderer
+static void KHRONOS_APIENTRY NullGLBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) {
+    null_gl_record(glBufferStorage);
+    if (data) GlobalNullGL->stats.bytesUploaded += (u64)size;
+}
+
+static void KHRONOS_APIENTRY NullGLBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    null_gl_record(glBufferData);
+    if (data) GlobalNullGL->stats.bytesUploaded += (u64)size;
+}
+
+static void KHRONOS_APIENTRY NullGLBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    null_gl_record(glBufferSubData);
+    GlobalNullGL->stats.bytesUploaded += (u64)size;
+}
+
+static void KHRONOS_APIENTRY NullGLNamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) {
+    null_gl_record(glNamedBufferSubData);
+    GlobalNullGL->stats.bytesUploaded += (u64)size;
+}
+
+static void* KHRONOS_APIENTRY NullGLMapNamedBufferRange(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    null_gl_record(glMapNamedBufferRange);
+    void* result = nullptr;
+    if (buffer && buffer < NullOpenGLState::MaxBuffers) {
+        auto entry = GlobalNullGL->buffers + buffer;
+        assert((uptr)(offset + length) <= entry->size);
+        if (!entry->memory && entry->size) {
+            entry->memory = Allocate(entry->size, 0, nullptr);
+        }
+        if (entry->memory) {
+            result = (byte*)entry->memory + offset;
+        }
+    }
+    return result;
+}
+
+static GLboolean KHRONOS_APIENTRY NullGLUnmapNamedBuffer(GLuint buffer) {
+    null_gl_record(glUnmapNamedBuffer);
+    return GL_TRUE;
+}
+
+// NOTE: Textures
+
+static void KHRONOS_APIENTRY NullGLTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) {
+    null_gl_record(glTexImage2D);
+    NullGLRecordTexelUpload(pixels, width, height, 1, format, type);
+}
+
+static void KHRONOS_APIENTRY NullGLTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels) {
+    null_gl_record(glTexImage3D);
+    NullGLRecordTexelUpload(pixels, width, height, depth, format, type);
+}
+
+static void KHRONOS_APIENTRY NullGLTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) {
+    null_gl_record(glTexSubImage2D);
+    NullGLRecordTexelUpload(pixels, width, height, 1, format, type);
+}
+
+static void KHRONOS_APIENTRY NullGLTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) {
+    null_gl_record(glTexSubImage3D);
+    NullGLRecordTexelUpload(pixels, width, height, depth, format, type);
+}
+
+static void KHRONOS_APIENTRY NullGLTextureSubImage2D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) {
+    null_gl_record(glTextureSubImage2D);
+    NullGLRecordTexelUpload(pixels, width, height, 1, format, type);
+}
+
+static void KHRONOS_APIENTRY NullGLTextureSubImage3D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) {
+    null_gl_record(glTextureSubImage3D);
+    NullGLRecordTexelUpload(pixels, width, height, depth, format, type);
+}
+
+// NOTE: Draws
+
+static void KHRONOS_APIENTRY NullGLDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    null_gl_record(glDrawArrays);
+    GlobalNullGL->stats.drawCallCount++;
+    GlobalNullGL->stats.drawCount++;
+}
+
+static void KHRONOS_APIENTRY NullGLDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+    null_gl_record(glDrawArraysInstanced);
+    GlobalNullGL->stats.drawCallCount++;
+    GlobalNullGL->stats.drawCount++;
+}
+
+static void KHRONOS_APIENTRY NullGLDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    null_gl_record(glDrawElements);
+    GlobalNullGL->stats.drawCallCount++;
+    GlobalNullGL->stats.drawCount++;
+}
+
+static void KHRONOS_APIENTRY NullGLDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount) {
+    null_gl_record(glDrawElementsInstanced);
+    GlobalNullGL->stats.drawCallCount++;
+    GlobalNullGL->stats.drawCount++;
+}
+
+static void KHRONOS_APIENTRY NullGLDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex) {
+    null_gl_record(glDrawElementsBaseVertex);
+    GlobalNullGL->stats.drawCallCount++;
+    GlobalNullGL->stats.drawCount++;
+}
+
+static void KHRONOS_APIENTRY NullGLMultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride) {
+    null_gl_record(glMultiDrawElementsIndirect);
+    GlobalNullGL->stats.drawCallCount++;
+    GlobalNullGL->stats.drawCount += (u64)drawcount;
+}
+
+static void KHRONOS_APIENTRY NullGLDispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z) {
+    null_gl_record(glDispatchCompute);
+    GlobalNullGL->stats.dispatchCount++;
+}
+
+// NOTE: State
+
+static void KHRONOS_APIENTRY NullGLUseProgram(GLuint program) {
+    null_gl_record(glUseProgram);
+    GlobalNullGL->stats.programBinds++;
+}
+
+static void KHRONOS_APIENTRY NullGLBindFramebuffer(GLenum target, GLuint framebuffer) {
+    null_gl_record(glBindFramebuffer);
+    GlobalNullGL->stats.framebufferBinds++;
+}
+
+static void KHRONOS_APIENTRY NullGLBindTexture(GLenum target, GLuint texture) {
+    null_gl_record(glBindTexture);
+    GlobalNullGL->stats.textureBinds++;
+}
+
+static void KHRONOS_APIENTRY NullGLBindTextureUnit(GLuint unit, GLuint texture) {
+    null_gl_record(glBindTextureUnit);
+    GlobalNullGL->stats.textureBinds++;
+}
+
+static void KHRONOS_APIENTRY NullGLBindImageTexture(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format) {
+    null_gl_record(glBindImageTexture);
+    GlobalNullGL->stats.textureBinds++;
+}
+
+static void KHRONOS_APIENTRY NullGLBindBuffer(GLenum target, GLuint buffer) {
+    null_gl_record(glBindBuffer);
+    GlobalNullGL->stats.bufferBinds++;
+    if (target == GL_PIXEL_UNPACK_BUFFER) {
+        GlobalNullGL->pixelUnpackBuffer = buffer;
+    }
+}
+
+static void KHRONOS_APIENTRY NullGLBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    null_gl_record(glBindBufferBase);
+    GlobalNullGL->stats.bufferBinds++;
+}
+
+static void KHRONOS_APIENTRY NullGLBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    null_gl_record(glBindBufferRange);
+    GlobalNullGL->stats.bufferBinds++;
+}
+
+static void KHRONOS_APIENTRY NullGLBindSampler(GLuint unit, GLuint sampler) {
+    null_gl_record(glBindSampler);
+    GlobalNullGL->stats.samplerBinds++;
+}
+
+static void KHRONOS_APIENTRY NullGLBindVertexArray(GLuint array) {
+    null_gl_record(glBindVertexArray);
+    GlobalNullGL->stats.vertexArrayBinds++;
+}
+
+static void KHRONOS_APIENTRY NullGLEnable(GLenum cap) {
+    null_gl_record(glEnable);
+    GlobalNullGL->stats.capabilityChanges++;
+}
+
+static void KHRONOS_APIENTRY NullGLDisable(GLenum cap) {
+    null_gl_record(glDisable);
+    GlobalNullGL->stats.capabilityChanges++;
+}
+
+// NOTE: Only uniform setters the renderer and imgui actually use. The rest are still counted as calls
+static void KHRONOS_APIENTRY NullGLUniform1i(GLint location, GLint v0) {
+    null_gl_record(glUniform1i);
+    GlobalNullGL->stats.uniformUpdates++;
+}
+
+static void KHRONOS_APIENTRY NullGLUniform1ui(GLint location, GLuint v0) {
+    null_gl_record(glUniform1ui);
+    GlobalNullGL->stats.uniformUpdates++;
+}
+
+static void KHRONOS_APIENTRY NullGLUniform1f(GLint location, GLfloat v0) {
+    null_gl_record(glUniform1f);
+    GlobalNullGL->stats.uniformUpdates++;
+}
+
+static void KHRONOS_APIENTRY NullGLUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+    null_gl_record(glUniform2f);
+    GlobalNullGL->stats.uniformUpdates++;
+}
+
+static void KHRONOS_APIENTRY NullGLUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    null_gl_record(glUniformMatrix4fv);
+    GlobalNullGL->stats.uniformUpdates++;
+}
+
+static void KHRONOS_APIENTRY NullGLUniformSubroutinesuiv(GLenum shadertype, GLsizei count, const GLuint* indices) {
+    null_gl_record(glUniformSubroutinesuiv);
+    GlobalNullGL->stats.uniformUpdates++;
+}
+
+OpenGL* CreateNullOpenGL() {
+    OpenGL* context = (OpenGL*)Allocate(sizeof(OpenGL), 0, nullptr);
+    panic(context);
+    memset(context, 0, sizeof(OpenGL));
+
+    GlobalNullGL = (NullOpenGLState*)Allocate(sizeof(NullOpenGLState), 0, nullptr);
+    panic(GlobalNullGL);
+    memset(GlobalNullGL, 0, sizeof(NullOpenGLState));
+
+    log_print("[Info] Using null OpenGL backend. Nothing will be rendered\n");
+
+    NullGLInstallStubs<0, OpenGL::FunctionCount>(context->functions.raw);
+
+    auto fn = &context->functions.fn;
+    fn->glGenBuffers = NullGLGenBuffers;
+    fn->glCreateBuffers = NullGLCreateBuffers;
+    fn->glDeleteBuffers = NullGLDeleteBuffers;
+    fn->glGenTextures = NullGLGenTextures;
+    fn->glCreateTextures = NullGLCreateTextures;
+    fn->glGenFramebuffers = NullGLGenFramebuffers;
+    fn->glCreateFramebuffers = NullGLCreateFramebuffers;
+    fn->glGenRenderbuffers = NullGLGenRenderbuffers;
+    fn->glCreateRenderbuffers = NullGLCreateRenderbuffers;
+    fn->glGenVertexArrays = NullGLGenVertexArrays;
+    fn->glCreateVertexArrays = NullGLCreateVertexArrays;
+    fn->glGenSamplers = NullGLGenSamplers;
+    fn->glCreateSamplers = NullGLCreateSamplers;
+    fn->glGenQueries = NullGLGenQueries;
+    fn->glCreateQueries = NullGLCreateQueries;
+    fn->glCreateShader = NullGLCreateShader;
+    fn->glCreateProgram = NullGLCreateProgram;
+
+    fn->glGetIntegerv = NullGLGetIntegerv;
+    fn->glGetFloatv = NullGLGetFloatv;
+    fn->glGetString = NullGLGetString;
+    fn->glGetStringi = NullGLGetStringi;
+    fn->glGetShaderiv = NullGLGetShaderiv;
+    fn->glGetProgramiv = NullGLGetProgramiv;
+    fn->glCheckFramebufferStatus = NullGLCheckFramebufferStatus;
+    fn->glCheckNamedFramebufferStatus = NullGLCheckNamedFramebufferStatus;
+    fn->glFenceSync = NullGLFenceSync;
+    fn->glClientWaitSync = NullGLClientWaitSync;
+    fn->glGetQueryObjectiv = NullGLGetQueryObjectiv;
+    fn->glGetQueryObjectui64v = NullGLGetQueryObjectui64v;
+
+    fn->glNamedBufferStorage = NullGLNamedBufferStorage;
+    fn->glNamedBufferData = NullGLNamedBufferData;
+    fn->glBufferStorage = NullGLBufferStorage;
+    fn->glBufferData = NullGLBufferData;
+    fn->glBufferSubData = NullGLBufferSubData;
+    fn->glNamedBufferSubData = NullGLNamedBufferSubData;
+    fn->glMapNamedBufferRange = NullGLMapNamedBufferRange;
+    fn->glUnmapNamedBuffer = NullGLUnmapNamedBuffer;
+
+    fn->glTexImage2D = NullGLTexImage2D;
+    fn->glTexImage3D = NullGLTexImage3D;
+    fn->glTexSubImage2D = NullGLTexSubImage2D;
+    fn->glTexSubImage3D = NullGLTexSubImage3D;
+    fn->glTextureSubImage2D = NullGLTextureSubImage2D;
+    fn->glTextureSubImage3D = NullGLTextureSubImage3D;
+
+    fn->glDrawArrays = NullGLDrawArrays;
+    fn->glDrawArraysInstanced = NullGLDrawArraysInstanced;
+    fn->glDrawElements = NullGLDrawElements;
+    fn->glDrawElementsInstanced = NullGLDrawElementsInstanced;
+    fn->glDrawElementsBaseVertex = NullGLDrawElementsBaseVertex;
+    fn->glMultiDrawElementsIndirect = NullGLMultiDrawElementsIndirect;
+    fn->glDispatchCompute = NullGLDispatchCompute;
+
+    fn->glUseProgram = NullGLUseProgram;
+    fn->glBindFramebuffer = NullGLBindFramebuffer;
+    fn->glBindTexture = NullGLBindTexture;
+    fn->glBindTextureUnit = NullGLBindTextureUnit;
+    fn->glBindImageTexture = NullGLBindImageTexture;
+    fn->glBindBuffer = NullGLBindBuffer;
+    fn->glBindBufferBase = NullGLBindBufferBase;
+    fn->glBindBufferRange = NullGLBindBufferRange;
+    fn->glBindSampler = NullGLBindSampler;
+    fn->glBindVertexArray = NullGLBindVertexArray;
+    fn->glEnable = NullGLEnable;
+    fn->glDisable = NullGLDisable;
+    fn->glUniform1i = NullGLUniform1i;
+    fn->glUniform1ui = NullGLUniform1ui;
+    fn->glUniform1f = NullGLUniform1f;
+    fn->glUniform2f = NullGLUniform2f;
+    fn->glUniformMatrix4fv = NullGLUniformMatrix4fv;
+    fn->glUniformSubroutinesuiv = NullGLUniformSubroutinesuiv;
+
+    context->nullStats = &GlobalNullGL->stats;
+    return context;
+}
+
+#undef null_gl_record
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "OpenGL.h"
+
+// NOTE: Statistics recorded by the null backend. Counters are plain increments, so they are exact only while
+// GL is used from a single thread, which is the case for the render thread benchmark
+struct NullOpenGLStats
+{
+    u64 callCount;
+    u64 drawCallCount;
+    // NOTE: Multi-draw calls count every draw they issue
+    u64 drawCount;
+    u64 dispatchCount;
+    // NOTE: Bytes passed through BufferData/BufferSubData/TexImage/TexSubImage. Writes to mapped memory are not visible
+    u64 bytesUploaded;
+    // NOTE: State changes. Binds are counted even if the same object is bound again, since the renderer
+    // does not track GL state and the driver pays for validation regardless
+    u64 programBinds;
+    u64 framebufferBinds;
+    u64 textureBinds;
+    u64 bufferBinds;
+    u64 samplerBinds;
+    u64 vertexArrayBinds;
+    u64 capabilityChanges;
+    u64 uniformUpdates;
+    u64 functionCalls[OpenGL::FunctionCount];
+};
+
+// NOTE: Fills the function table with stubs which do nothing but record the calls. Objects get unique handles,
+// framebuffers and shaders always report success and mapped buffers are backed by CPU memory, so the renderer
+// runs unmodified without a GPU. Returned context owns its stats, see OpenGL::nullStats
+OpenGL* CreateNullOpenGL();
@@ -24,11 +24,21 @@ extern "C"
 #define GL_SPIR_V_EXTENSIONS_ARB  0x9553
 #define GL_NUM_SPIR_V_EXTENSIONS_ARB 0x9554
 
+// KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+extern "C"
+{
+    typedef void(APIENTRY* PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+}
+
 // NOTE: It was defined in soko_glcorearb.h
 #if defined(APIENTRY_DEFINED)
 #undef APIENTRY
 #endif
 
+struct NullOpenGLStats;
+
 struct OpenGL
 {
     union Functions
@@ -717,13 +727,22 @@ struct OpenGL
         bool ARB_texture_filter_anisotropic;
         bool ARB_framebuffer_sRGB;
         bool ARB_spirv_extensions;
+        bool ARB_shader_viewport_layer_array;
         struct _ARB_gl_spirv
         {
             bool supported;
             PFNGLSPECIALIZESHADERARBPROC glSpecializeShaderARB;
         } ARB_gl_spirv;
+        struct _KHR_parallel_shader_compile
+        {
+            bool supported;
+            PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR;
+        } KHR_parallel_shader_compile;
     } extensions;
 
+    // NOTE: Set only by the null backend (NullOpenGL.h)
+    NullOpenGLStats* nullStats;
+
     static const uint32_t FunctionCount = sizeof(Functions::_Functions) / sizeof(void*);
 
     static const inline  char* FunctionNames[] =
@@ -1400,3 +1419,28 @@ struct OpenGL
         "glTextureBarrier"
     };
 };
+
+// NOTE: Index of the function in OpenGL::Functions::raw and OpenGL::FunctionNames
+#define opengl_function_index(func) (u32)(offsetof(OpenGL::Functions::_Functions, func) / sizeof(void*))
+
+// NOTE: Size of a pixel of client side image data
+inline u64 OpenGLPixelSize(GLenum format, GLenum type) {
+    u64 components;
+    switch (format) {
+    case GL_RED: case GL_GREEN: case GL_BLUE: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX: { components = 1; } break;
+    case GL_RG: case GL_RG_INTEGER: case GL_DEPTH_STENCIL: { components = 2; } break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: { components = 3; } break;
+    default: { components = 4; } break;
+    }
+
+    u64 result;
+    switch (type) {
+    case GL_UNSIGNED_BYTE: case GL_BYTE: { result = components; } break;
+    case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: { result = components * 2; } break;
+    case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: { result = components * 4; } break;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV: { result = 8; } break;
+    // NOTE: Packed formats
+    default: { result = 4; } break;
+    }
+    return result;
+}
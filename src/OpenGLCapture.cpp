@@ -0,0 +1,748 @@
+#include "OpenGLCapture.h"
+
+#include <stdio.h>
+
+// NOTE: Like the null backend, the capture is platform independent. It needs Allocate/Reallocate/Deallocate and atomics
+
+struct GLCaptureStream {
+    byte* data;
+    u64 size;
+    u64 capacity;
+};
+
+struct GLCaptureMapping {
+    GLuint buffer;
+    u64 offset;
+    u64 size;
+    byte* pointer;
+    // NOTE: Contents at the last comparison
+    byte* shadow;
+    // NOTE: Where writes made since the last comparison are inserted into the frame stream
+    u64 streamPosition;
+};
+
+// NOTE: Names of live objects, which are restored by the snapshot
+struct GLCaptureNames {
+    GLuint* names;
+    u32 count;
+    u32 capacity;
+};
+
+// NOTE: Range of the write stream which goes to the given position of the frame stream
+struct GLCaptureWriteRange {
+    u64 streamPosition;
+    u64 begin;
+    u64 end;
+};
+
+struct GLCapture {
+    static constexpr u32 MaxMappings = 64;
+    static constexpr u32 MaxWriteRanges = 1024;
+    // NOTE: Granularity of mapped memory comparison
+    static constexpr u64 CompareBlockSize = 64;
+    static constexpr i32 MaxTextureLevels = 16;
+
+    // NOTE: Driver functions
+    OpenGL real;
+    // NOTE: Table with the wrappers given to the caller
+    OpenGL table;
+
+    FILE* file;
+    GLCaptureHeader header;
+    u32 firstFrame;
+    u32 endFrame;
+    u32 frameIndex;
+    b32 recording;
+    u32 volatile lock;
+
+    GLCaptureStream frame;
+    GLCaptureStream writes;
+    GLCaptureWriteRange writeRanges[MaxWriteRanges];
+    u32 writeRangeCount;
+
+    GLCaptureMapping mappings[MaxMappings];
+    u32 mappingCount;
+
+    GLCaptureNames buffers;
+    GLCaptureNames textures;
+
+    // NOTE: Client side pixel data layout
+    GLuint pixelPackBuffer;
+    GLuint pixelUnpackBuffer;
+    u64 unpackAlignment;
+    u64 unpackRowLength;
+};
+
+static GLCapture* GlobalGLCapture;
+
+static void LockGLCapture(GLCapture* capture) {
+    while (AtomicCompareExchange(&capture->lock, 0, 1) != 0) {}
+}
+
+static void UnlockGLCapture(GLCapture* capture) {
+    AtomicExchange(&capture->lock, 0);
+}
+
+static void* GLCaptureReserve(GLCaptureStream* stream, u64 size) {
+    if (stream->size + size > stream->capacity) {
+        u64 capacity = Max(stream->capacity * 2, stream->size + size);
+        capacity = Max(capacity, (u64)Megabytes(1));
+        stream->data = (byte*)Reallocate(stream->data, capacity);
+        panic(stream->data, "[Capture] Out of memory");
+        stream->capacity = capacity;
+    }
+    void* result = stream->data + stream->size;
+    stream->size += size;
+    return result;
+}
+
+static void GLCaptureWrite(GLCaptureStream* stream, const void* data, u64 size) {
+    if (size) {
+        memcpy(GLCaptureReserve(stream, size), data, size);
+    }
+}
+
+template <typename T>
+static void GLCaptureWrite(GLCaptureStream* stream, T value) {
+    GLCaptureWrite(stream, &value, sizeof(T));
+}
+
+static void AddGLCaptureNames(GLCaptureNames* names, const GLuint* added, u32 count) {
+    if (names->count + count > names->capacity) {
+        u32 capacity = Max(Max(names->capacity * 2, names->count + count), 256u);
+        names->names = (GLuint*)Reallocate(names->names, capacity * sizeof(GLuint));
+        panic(names->names, "[Capture] Out of memory");
+        names->capacity = capacity;
+    }
+    memcpy(names->names + names->count, added, count * sizeof(GLuint));
+    names->count += count;
+}
+
+static void RemoveGLCaptureNames(GLCaptureNames* names, const GLuint* removed, u32 count) {
+    for (u32 r = 0; r < count; r++) {
+        for (u32 i = 0; i < names->count; i++) {
+            if (names->names[i] == removed[r]) {
+                names->names[i] = names->names[--names->count];
+                break;
+            }
+        }
+    }
+}
+
+static bool IsGLCaptureSetupFrame(GLCapture* capture) {
+    return capture->frameIndex < capture->firstFrame;
+}
+
+struct GLCapturePointerDesc {
+    GLCapturePointer kind;
+    u64 size;
+};
+
+static u64 GLCaptureImageSize(GLCapture* capture, u64 width, u64 height, u64 depth, GLenum format, GLenum type) {
+    u64 pixelSize = OpenGLPixelSize(format, type);
+    u64 rowLength = capture->unpackRowLength ? capture->unpackRowLength : width;
+    u64 alignment = capture->unpackAlignment;
+    u64 rowPitch = (rowLength * pixelSize + alignment - 1) / alignment * alignment;
+    u64 rows = height * depth;
+    // NOTE: Last row is not padded
+    return rows ? rowPitch * (rows - 1) + width * pixelSize : 0;
+}
+
+static GLCapturePointerDesc GLCaptureImage(GLCapture* capture, u64 pixels, u64 width, u64 height, u64 depth, u64 format, u64 type) {
+    GLCapturePointerDesc result;
+    if (capture->pixelUnpackBuffer) {
+        result = { GLCapturePointer::Offset, 0 };
+    } else {
+        result = { GLCapturePointer::Input, GLCaptureImageSize(capture, width, height, depth, (GLenum)format, (GLenum)type) };
+    }
+    return result;
+}
+
+#define gl_case(func) case opengl_function_index(func)
+
+static GLCapturePointerDesc GLCaptureDescribePointer(GLCapture* capture, u32 function, u32 arg, const u64* slots) {
+    GLCapturePointerDesc result = { GLCapturePointer::Skip, 0 };
+    auto i32Slot = [slots](u32 index) { return (u64)Max(GLCaptureFromSlot<i32>(slots[index]), 0); };
+    switch (function) {
+    gl_case(glBufferData): gl_case(glBufferStorage): gl_case(glNamedBufferData): gl_case(glNamedBufferStorage): {
+        result = { GLCapturePointer::Input, slots[1] };
+    } break;
+    gl_case(glBufferSubData): gl_case(glNamedBufferSubData): {
+        result = { GLCapturePointer::Input, slots[2] };
+    } break;
+    gl_case(glProgramBinary): {
+        result = { GLCapturePointer::Input, i32Slot(3) };
+    } break;
+    gl_case(glGenBuffers): gl_case(glGenFramebuffers): gl_case(glGenQueries): gl_case(glGenTextures): gl_case(glGenVertexArrays):
+    gl_case(glCreateBuffers): gl_case(glCreateFramebuffers): gl_case(glCreateSamplers): {
+        result = { GLCapturePointer::Names, i32Slot(0) };
+    } break;
+    gl_case(glCreateTextures): {
+        result = { GLCapturePointer::Names, i32Slot(1) };
+    } break;
+    gl_case(glDeleteBuffers): gl_case(glDeleteFramebuffers): gl_case(glDeleteTextures): gl_case(glDeleteVertexArrays): {
+        result = { GLCapturePointer::Input, i32Slot(0) * sizeof(GLuint) };
+    } break;
+    gl_case(glDebugMessageControl): {
+        result = { GLCapturePointer::Input, i32Slot(3) * sizeof(GLuint) };
+    } break;
+    gl_case(glInvalidateNamedFramebufferData): {
+        result = { GLCapturePointer::Input, i32Slot(1) * sizeof(GLenum) };
+    } break;
+    gl_case(glUniformSubroutinesuiv): {
+        result = { GLCapturePointer::Input, i32Slot(1) * sizeof(GLuint) };
+    } break;
+    gl_case(glUniform2fv): { result = { GLCapturePointer::Input, i32Slot(1) * sizeof(f32) * 2 }; } break;
+    gl_case(glUniform3fv): { result = { GLCapturePointer::Input, i32Slot(1) * sizeof(f32) * 3 }; } break;
+    gl_case(glUniform4fv): { result = { GLCapturePointer::Input, i32Slot(1) * sizeof(f32) * 4 }; } break;
+    gl_case(glUniformMatrix3fv): { result = { GLCapturePointer::Input, i32Slot(1) * sizeof(f32) * 9 }; } break;
+    gl_case(glUniformMatrix4fv): { result = { GLCapturePointer::Input, i32Slot(1) * sizeof(f32) * 16 }; } break;
+    // NOTE: At most a border color
+    gl_case(glTexParameterfv): { result = { GLCapturePointer::Input, sizeof(f32) * 4 }; } break;
+    gl_case(glGetAttribLocation): gl_case(glGetUniformBlockIndex): gl_case(glGetUniformLocation): gl_case(glGetSubroutineIndex): {
+        result = { GLCapturePointer::Input, strlen((const char*)slots[arg]) + 1 };
+    } break;
+    gl_case(glShaderSource): {
+        result = { arg == 2 ? GLCapturePointer::StringArray : GLCapturePointer::Null, i32Slot(1) };
+    } break;
+    // NOTE: Element, indirect and vertex buffers are always bound in the core profile
+    gl_case(glDrawElements): gl_case(glDrawElementsBaseVertex): gl_case(glDrawElementsInstanced): gl_case(glMultiDrawElementsIndirect):
+    gl_case(glVertexAttribPointer): gl_case(glVertexAttribIPointer): {
+        result = { GLCapturePointer::Offset, 0 };
+    } break;
+    // NOTE: Queried values are not used by the replayer, outputs are big enough for any of the queries made by the game
+    gl_case(glGetIntegerv): gl_case(glGetFloatv): gl_case(glGetProgramiv): gl_case(glGetShaderiv):
+    gl_case(glGetQueryObjectiv): gl_case(glGetQueryObjectui64v): {
+        result = { GLCapturePointer::Output, 64 };
+    } break;
+    gl_case(glGetProgramInfoLog): gl_case(glGetShaderInfoLog): {
+        result = { GLCapturePointer::Output, arg == 3 ? i32Slot(1) : sizeof(GLsizei) };
+    } break;
+    gl_case(glGetProgramBinary): {
+        result = { GLCapturePointer::Output, arg == 4 ? i32Slot(1) : sizeof(GLsizei) };
+    } break;
+    gl_case(glGetTextureImage): {
+        result = { capture->pixelPackBuffer ? GLCapturePointer::Offset : GLCapturePointer::Output, i32Slot(4) };
+    } break;
+    gl_case(glTexImage1D): { result = GLCaptureImage(capture, slots[arg], slots[3], 1, 1, slots[5], slots[6]); } break;
+    gl_case(glTexImage2D): { result = GLCaptureImage(capture, slots[arg], slots[3], slots[4], 1, slots[6], slots[7]); } break;
+    gl_case(glTexImage3D): { result = GLCaptureImage(capture, slots[arg], slots[3], slots[4], slots[5], slots[7], slots[8]); } break;
+    gl_case(glTexSubImage3D): { result = GLCaptureImage(capture, slots[arg], slots[5], slots[6], slots[7], slots[8], slots[9]); } break;
+    gl_case(glTextureSubImage1D): { result = GLCaptureImage(capture, slots[arg], slots[3], 1, 1, slots[4], slots[5]); } break;
+    gl_case(glTextureSubImage2D): { result = GLCaptureImage(capture, slots[arg], slots[4], slots[5], 1, slots[6], slots[7]); } break;
+    gl_case(glTextureSubImage3D): { result = GLCaptureImage(capture, slots[arg], slots[5], slots[6], slots[7], slots[8], slots[9]); } break;
+    // NOTE: glDebugMessageCallback and readbacks to memory of unknown size (glGetTexImage) are skipped
+    default: {} break;
+    }
+    // NOTE: Null data is valid for the most of the calls
+    if (!slots[arg] && result.kind != GLCapturePointer::Offset && result.kind != GLCapturePointer::Skip) {
+        result.kind = GLCapturePointer::Null;
+    }
+    // NOTE: Setup frames define storage only, contents come with the snapshot
+    if (result.kind == GLCapturePointer::Input && IsGLCaptureSetupFrame(capture)) {
+        switch (function) {
+        gl_case(glBufferData): gl_case(glBufferStorage): gl_case(glNamedBufferData): gl_case(glNamedBufferStorage):
+        gl_case(glTexImage1D): gl_case(glTexImage2D): gl_case(glTexImage3D): {
+            result.kind = GLCapturePointer::Null;
+        } break;
+        default: {} break;
+        }
+    }
+    return result;
+}
+
+// NOTE: Calls which only change contents of buffers and textures, or read them back. They are not recorded in setup frames
+static bool IsGLCaptureContentsCall(u32 function) {
+    bool result;
+    switch (function) {
+    gl_case(glDrawArrays): gl_case(glDrawArraysInstanced): gl_case(glDrawElements): gl_case(glDrawElementsBaseVertex):
+    gl_case(glDrawElementsInstanced): gl_case(glMultiDrawElementsIndirect): gl_case(glDispatchCompute): gl_case(glMemoryBarrier):
+    gl_case(glClear): gl_case(glBlitFramebuffer): gl_case(glCopyImageSubData): gl_case(glCopyNamedBufferSubData):
+    gl_case(glInvalidateNamedFramebufferData): gl_case(glInvalidateTexImage):
+    gl_case(glBufferSubData): gl_case(glNamedBufferSubData): gl_case(glTexSubImage3D): gl_case(glTextureSubImage1D):
+    gl_case(glTextureSubImage2D): gl_case(glTextureSubImage3D):
+    gl_case(glGetTexImage): gl_case(glGetTextureImage): gl_case(glGetProgramBinary): {
+        result = true;
+    } break;
+    default: { result = false; } break;
+    }
+    return result;
+}
+
+static void GLCaptureRecordCall(GLCapture* capture, u32 function, const u64* slots, const u8* sizes, u32 argCount, u64 result, u32 resultSize) {
+    auto stream = &capture->frame;
+    GLCaptureWrite(stream, (u16)function);
+    for (u32 i = 0; i < argCount; i++) {
+        if (sizes[i]) {
+            GLCaptureWrite(stream, slots + i, sizes[i]);
+            continue;
+        }
+        auto desc = GLCaptureDescribePointer(capture, function, i, slots);
+        GLCaptureWrite(stream, desc.kind);
+        switch (desc.kind) {
+        case GLCapturePointer::Input: {
+            GLCaptureWrite(stream, (u32)desc.size);
+            GLCaptureWrite(stream, (const void*)slots[i], desc.size);
+        } break;
+        case GLCapturePointer::Offset: {
+            GLCaptureWrite(stream, slots[i]);
+        } break;
+        case GLCapturePointer::Output: {
+            GLCaptureWrite(stream, (u32)desc.size);
+        } break;
+        case GLCapturePointer::Names: {
+            GLCaptureWrite(stream, (u32)desc.size);
+            GLCaptureWrite(stream, (const void*)slots[i], desc.size * sizeof(GLuint));
+        } break;
+        case GLCapturePointer::StringArray: {
+            auto strings = (const GLchar* const*)slots[i];
+            // NOTE: Lengths always follow the strings
+            auto lengths = (const GLint*)slots[i + 1];
+            GLCaptureWrite(stream, (u32)desc.size);
+            for (u32 s = 0; s < desc.size; s++) {
+                u32 length = (lengths && lengths[s] >= 0) ? (u32)lengths[s] : (u32)strlen(strings[s]);
+                GLCaptureWrite(stream, length + 1);
+                GLCaptureWrite(stream, strings[s], length);
+                GLCaptureWrite(stream, (char)0);
+            }
+        } break;
+        case GLCapturePointer::Null: case GLCapturePointer::Skip: {} break;
+        invalid_default();
+        }
+    }
+    GLCaptureWrite(stream, &result, resultSize);
+}
+
+static GLCaptureMapping* FindGLCaptureMapping(GLCapture* capture, GLuint buffer) {
+    GLCaptureMapping* result = nullptr;
+    for (u32 i = 0; i < capture->mappingCount; i++) {
+        if (capture->mappings[i].buffer == buffer) {
+            result = capture->mappings + i;
+            break;
+        }
+    }
+    return result;
+}
+
+static void GLCaptureWriteMapped(GLCaptureStream* stream, GLCaptureMapping* mapping, u64 offset, u64 size) {
+    GLCaptureWrite(stream, GLCaptureMappedWrite);
+    GLCaptureWrite(stream, mapping->buffer);
+    GLCaptureWrite(stream, mapping->offset + offset);
+    GLCaptureWrite(stream, (u32)size);
+    GLCaptureWrite(stream, mapping->shadow + offset, size);
+}
+
+// NOTE: Writes changed ranges of the mapping and brings its copy up to date
+static void GLCaptureMappedWrites(GLCapture* capture, GLCaptureMapping* mapping) {
+    auto stream = &capture->writes;
+    u64 begin = stream->size;
+    u64 at = 0;
+    while (at < mapping->size) {
+        u64 blockSize = Min(GLCapture::CompareBlockSize, mapping->size - at);
+        if (memcmp(mapping->pointer + at, mapping->shadow + at, blockSize) == 0) {
+            at += blockSize;
+            continue;
+        }
+        u64 runBegin = at;
+        while (at < mapping->size) {
+            blockSize = Min(GLCapture::CompareBlockSize, mapping->size - at);
+            if (memcmp(mapping->pointer + at, mapping->shadow + at, blockSize) == 0) break;
+            at += blockSize;
+        }
+        u64 runSize = at - runBegin;
+        memcpy(mapping->shadow + runBegin, mapping->pointer + runBegin, runSize);
+        GLCaptureWriteMapped(stream, mapping, runBegin, runSize);
+    }
+    if (stream->size != begin) {
+        panic(capture->writeRangeCount < GLCapture::MaxWriteRanges, "[Capture] Too many mapped writes in a frame");
+        capture->writeRanges[capture->writeRangeCount++] = { mapping->streamPosition, begin, stream->size };
+    }
+}
+
+// NOTE: Memory which the GPU is done with is written after waits and memory for the submitted commands is written before
+// fences, so at syncs all mappings are compared and later writes go after the sync call. Setup frames are not compared,
+// the snapshot has the whole mapped memory
+static void GLCaptureSyncMappings(GLCapture* capture) {
+    if (!IsGLCaptureSetupFrame(capture)) {
+        for (u32 i = 0; i < capture->mappingCount; i++) {
+            auto mapping = capture->mappings + i;
+            GLCaptureMappedWrites(capture, mapping);
+            mapping->streamPosition = capture->frame.size;
+        }
+    }
+}
+
+static void RemoveGLCaptureMapping(GLCapture* capture, GLCaptureMapping* mapping) {
+    if (!IsGLCaptureSetupFrame(capture)) {
+        GLCaptureMappedWrites(capture, mapping);
+    }
+    Deallocate(mapping->shadow, nullptr);
+    *mapping = capture->mappings[--capture->mappingCount];
+}
+
+// NOTE: Mapped memory is gone after these, so it is compared before the driver is called
+static void GLCaptureBeforeCall(GLCapture* capture, u32 function, const u64* slots) {
+    switch (function) {
+    gl_case(glUnmapNamedBuffer): {
+        auto mapping = FindGLCaptureMapping(capture, (GLuint)slots[0]);
+        if (mapping) RemoveGLCaptureMapping(capture, mapping);
+    } break;
+    gl_case(glDeleteBuffers): {
+        auto buffers = (const GLuint*)slots[1];
+        for (i32 i = 0; i < GLCaptureFromSlot<i32>(slots[0]); i++) {
+            auto mapping = FindGLCaptureMapping(capture, buffers[i]);
+            if (mapping) RemoveGLCaptureMapping(capture, mapping);
+        }
+    } break;
+    default: {} break;
+    }
+}
+
+static void GLCaptureAfterCall(GLCapture* capture, u32 function, const u64* slots, u64 result) {
+    switch (function) {
+    gl_case(glBindBuffer): {
+        if (slots[0] == GL_PIXEL_UNPACK_BUFFER) {
+            capture->pixelUnpackBuffer = (GLuint)slots[1];
+        }
+        if (slots[0] == GL_PIXEL_PACK_BUFFER) {
+            capture->pixelPackBuffer = (GLuint)slots[1];
+        }
+    } break;
+    gl_case(glPixelStorei): {
+        if (slots[0] == GL_UNPACK_ALIGNMENT) capture->unpackAlignment = (u64)Max(GLCaptureFromSlot<i32>(slots[1]), 1);
+        if (slots[0] == GL_UNPACK_ROW_LENGTH) capture->unpackRowLength = (u64)Max(GLCaptureFromSlot<i32>(slots[1]), 0);
+    } break;
+    gl_case(glMapNamedBufferRange): {
+        // NOTE: Read only mappings are written by the GPU, there is nothing to replay
+        if (result && (slots[3] & GL_MAP_WRITE_BIT)) {
+            panic(capture->mappingCount < GLCapture::MaxMappings, "[Capture] Too many mapped buffers");
+            auto mapping = capture->mappings + capture->mappingCount++;
+            mapping->buffer = (GLuint)slots[0];
+            mapping->offset = slots[1];
+            mapping->size = slots[2];
+            mapping->pointer = (byte*)result;
+            mapping->shadow = (byte*)Allocate(mapping->size, 0, nullptr);
+            memcpy(mapping->shadow, mapping->pointer, mapping->size);
+            mapping->streamPosition = capture->frame.size;
+        }
+    } break;
+    gl_case(glFenceSync): gl_case(glClientWaitSync): {
+        GLCaptureSyncMappings(capture);
+    } break;
+    gl_case(glGenBuffers): gl_case(glCreateBuffers): {
+        AddGLCaptureNames(&capture->buffers, (const GLuint*)slots[1], GLCaptureFromSlot<u32>(slots[0]));
+    } break;
+    gl_case(glDeleteBuffers): {
+        RemoveGLCaptureNames(&capture->buffers, (const GLuint*)slots[1], GLCaptureFromSlot<u32>(slots[0]));
+    } break;
+    gl_case(glGenTextures): {
+        AddGLCaptureNames(&capture->textures, (const GLuint*)slots[1], GLCaptureFromSlot<u32>(slots[0]));
+    } break;
+    gl_case(glCreateTextures): {
+        AddGLCaptureNames(&capture->textures, (const GLuint*)slots[2], GLCaptureFromSlot<u32>(slots[1]));
+    } break;
+    gl_case(glDeleteTextures): {
+        RemoveGLCaptureNames(&capture->textures, (const GLuint*)slots[1], GLCaptureFromSlot<u32>(slots[0]));
+    } break;
+    default: {} break;
+    }
+}
+
+#undef gl_case
+
+template <u32 Index, typename Fn> struct GLCaptureStub;
+
+template <u32 Index, typename R, typename... Args>
+struct GLCaptureStub<Index, R (KHRONOS_APIENTRY*)(Args...)> {
+    // NOTE: Calls the driver and records the call. The lock must be held
+    static R Record(GLCapture* capture, Args... args) {
+        auto fn = (R (KHRONOS_APIENTRY*)(Args...))capture->real.functions.raw[Index];
+
+        // NOTE: Extra slot keeps the arrays valid for functions without arguments
+        u64 slots[sizeof...(Args) + 1] = { GLCaptureToSlot(args)... };
+        u8 sizes[sizeof...(Args) + 1] = { GLCaptureArgSize<Args>::Value... };
+
+        GLCaptureBeforeCall(capture, Index, slots);
+        if constexpr (GLCaptureIsVoid<R>::Value) {
+            fn(args...);
+            GLCaptureRecordCall(capture, Index, slots, sizes, sizeof...(Args), 0, 0);
+            GLCaptureAfterCall(capture, Index, slots, 0);
+        } else {
+            R result = fn(args...);
+            u64 resultSlot = GLCaptureToSlot(result);
+            GLCaptureRecordCall(capture, Index, slots, sizes, sizeof...(Args), resultSlot, sizeof(R));
+            GLCaptureAfterCall(capture, Index, slots, resultSlot);
+            return result;
+        }
+    }
+
+    static R KHRONOS_APIENTRY Call(Args... args) {
+        auto capture = GlobalGLCapture;
+        auto fn = (R (KHRONOS_APIENTRY*)(Args...))capture->real.functions.raw[Index];
+        if (!capture->recording || (IsGLCaptureSetupFrame(capture) && IsGLCaptureContentsCall(Index))) {
+            return fn(args...);
+        }
+
+        // NOTE: The lock is held during the call, so the stream has the order in which the driver got the calls
+        LockGLCapture(capture);
+        if constexpr (GLCaptureIsVoid<R>::Value) {
+            Record(capture, args...);
+            UnlockGLCapture(capture);
+        } else {
+            R result = Record(capture, args...);
+            UnlockGLCapture(capture);
+            return result;
+        }
+    }
+};
+
+// NOTE: Calls made by the capture itself. They go to the driver and to the stream like the calls of the game
+#define gl_capture_call(func, ...) GLCaptureStub<opengl_function_index(func), decltype(OpenGL::Functions::_Functions::func)>::Record(capture, __VA_ARGS__)
+
+template <u32 Index>
+static u64 KHRONOS_APIENTRY GLCaptureMissingStub() {
+    panic(false, "[Capture] %s is called but not captured. Add it to GL_CAPTURE_FUNCTIONS", OpenGL::FunctionNames[Index]);
+    return 0;
+}
+
+template <u32 Begin, u32 End>
+static void GLCaptureInstallMissingStubs(void** table) {
+    if constexpr (Begin + 1 == End) {
+        table[Begin] = (void*)GLCaptureMissingStub<Begin>;
+    } else {
+        constexpr u32 Mid = Begin + (End - Begin) / 2;
+        GLCaptureInstallMissingStubs<Begin, Mid>(table);
+        GLCaptureInstallMissingStubs<Mid, End>(table);
+    }
+}
+
+static void WriteGLCaptureChunk(GLCapture* capture, b32 captured) {
+    u64 size = capture->frame.size + capture->writes.size;
+    GLCaptureChunk chunk = { size, capture->frameIndex, captured };
+    fwrite(&chunk, sizeof(chunk), 1, capture->file);
+
+    // NOTE: Ranges are added in the order of comparison, so they are sorted by stream position here
+    auto ranges = capture->writeRanges;
+    for (u32 i = 1; i < capture->writeRangeCount; i++) {
+        auto range = ranges[i];
+        u32 j = i;
+        while (j > 0 && ranges[j - 1].streamPosition > range.streamPosition) {
+            ranges[j] = ranges[j - 1];
+            j--;
+        }
+        ranges[j] = range;
+    }
+
+    u64 at = 0;
+    for (u32 i = 0; i < capture->writeRangeCount; i++) {
+        auto range = ranges + i;
+        fwrite(capture->frame.data + at, 1, range->streamPosition - at, capture->file);
+        fwrite(capture->writes.data + range->begin, 1, range->end - range->begin, capture->file);
+        at = range->streamPosition;
+    }
+    fwrite(capture->frame.data + at, 1, capture->frame.size - at, capture->file);
+
+    // NOTE: Header is kept valid, so the file can be replayed even if the game is closed before the capture is done
+    capture->header.chunkCount++;
+    fseek(capture->file, 0, SEEK_SET);
+    fwrite(&capture->header, sizeof(capture->header), 1, capture->file);
+    fseek(capture->file, 0, SEEK_END);
+
+    capture->frame.size = 0;
+    capture->writes.size = 0;
+    capture->writeRangeCount = 0;
+    for (u32 i = 0; i < capture->mappingCount; i++) {
+        capture->mappings[i].streamPosition = 0;
+    }
+}
+
+// NOTE: Writes contents of all buffers and textures to the frame stream, so the first requested frame starts with
+// the state the setup frames left. Contents are read back with the driver functions and uploaded with recorded calls.
+// Buffers go through a staging buffer, since most of them have immutable storage
+static void WriteGLCaptureSnapshot(GLCapture* capture) {
+    auto gl = &capture->real.functions.fn;
+    u32 restoredCount = 0;
+    u32 skippedCount = 0;
+    byte* data = nullptr;
+    u64 dataSize = 0;
+    auto reserve = [&data, &dataSize](u64 size) {
+        if (size > dataSize) {
+            data = (byte*)Reallocate(data, size);
+            panic(data, "[Capture] Out of memory");
+            dataSize = size;
+        }
+    };
+
+    // NOTE: Mapped buffers are restored from mapped memory, which is not visible to the GPU for incoherent mappings
+    for (u32 i = 0; i < capture->mappingCount; i++) {
+        auto mapping = capture->mappings + i;
+        memcpy(mapping->shadow, mapping->pointer, mapping->size);
+        GLCaptureWriteMapped(&capture->frame, mapping, 0, mapping->size);
+    }
+
+    // NOTE: Names created by the snapshot are appended, so they are not visited
+    u32 bufferCount = capture->buffers.count;
+    u64 stagingSize = 0;
+    for (u32 i = 0; i < bufferCount; i++) {
+        GLuint buffer = capture->buffers.names[i];
+        GLint size = 0;
+        if (gl->glIsBuffer(buffer) && !FindGLCaptureMapping(capture, buffer)) {
+            gl->glGetNamedBufferParameteriv(buffer, GL_BUFFER_SIZE, &size);
+        }
+        stagingSize = Max(stagingSize, (u64)size);
+    }
+    if (stagingSize) {
+        reserve(stagingSize);
+        GLuint staging;
+        gl_capture_call(glCreateBuffers, 1, &staging);
+        gl_capture_call(glNamedBufferStorage, staging, (GLsizeiptr)stagingSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        for (u32 i = 0; i < bufferCount; i++) {
+            GLuint buffer = capture->buffers.names[i];
+            GLint size = 0;
+            if (gl->glIsBuffer(buffer) && !FindGLCaptureMapping(capture, buffer)) {
+                gl->glGetNamedBufferParameteriv(buffer, GL_BUFFER_SIZE, &size);
+            }
+            if (size) {
+                gl->glGetNamedBufferSubData(buffer, 0, size, data);
+                gl_capture_call(glNamedBufferSubData, staging, 0, size, data);
+                gl_capture_call(glCopyNamedBufferSubData, staging, buffer, 0, 0, size);
+                restoredCount++;
+            }
+        }
+        gl_capture_call(glDeleteBuffers, 1, &staging);
+    }
+
+    GLint packAlignment;
+    gl->glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+    gl->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    GLuint unpackBuffer = capture->pixelUnpackBuffer;
+    u64 unpackAlignment = capture->unpackAlignment;
+    u64 unpackRowLength = capture->unpackRowLength;
+    gl_capture_call(glBindBuffer, GL_PIXEL_UNPACK_BUFFER, 0);
+    gl_capture_call(glPixelStorei, GL_UNPACK_ALIGNMENT, 1);
+    gl_capture_call(glPixelStorei, GL_UNPACK_ROW_LENGTH, 0);
+
+    for (u32 i = 0; i < capture->textures.count; i++) {
+        GLuint texture = capture->textures.names[i];
+        // NOTE: Generated names are not textures until they are bound
+        if (!gl->glIsTexture(texture)) continue;
+        GLint target, compressed;
+        gl->glGetTextureParameteriv(texture, GL_TEXTURE_TARGET, &target);
+        gl->glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_COMPRESSED, &compressed);
+        // NOTE: Multisample textures can not be read back. They are render targets which are drawn before they are read.
+        // The game has no compressed textures
+        if (compressed || target == GL_TEXTURE_2D_MULTISAMPLE || target == GL_TEXTURE_2D_MULTISAMPLE_ARRAY || target == GL_TEXTURE_BUFFER) {
+            skippedCount++;
+            continue;
+        }
+        for (GLint level = 0; level < GLCapture::MaxTextureLevels; level++) {
+            GLint width, height, depth, internalFormat, format, type;
+            gl->glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_WIDTH, &width);
+            if (!width) break;
+            gl->glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_HEIGHT, &height);
+            gl->glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_DEPTH, &depth);
+            gl->glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+            if (target == GL_TEXTURE_CUBE_MAP) depth = 6;
+            gl->glGetInternalformativ(target, internalFormat, GL_TEXTURE_IMAGE_FORMAT, 1, &format);
+            gl->glGetInternalformativ(target, internalFormat, GL_TEXTURE_IMAGE_TYPE, 1, &type);
+            u64 size = (u64)width * (u64)height * (u64)depth * OpenGLPixelSize((GLenum)format, (GLenum)type);
+            reserve(size);
+            gl->glGetTextureImage(texture, level, (GLenum)format, (GLenum)type, (GLsizei)size, data);
+            switch (target) {
+            case GL_TEXTURE_1D: {
+                gl_capture_call(glTextureSubImage1D, texture, level, 0, width, (GLenum)format, (GLenum)type, data);
+            } break;
+            case GL_TEXTURE_2D: case GL_TEXTURE_1D_ARRAY: case GL_TEXTURE_RECTANGLE: {
+                gl_capture_call(glTextureSubImage2D, texture, level, 0, 0, width, height, (GLenum)format, (GLenum)type, data);
+            } break;
+            default: {
+                gl_capture_call(glTextureSubImage3D, texture, level, 0, 0, 0, width, height, depth, (GLenum)format, (GLenum)type, data);
+            } break;
+            }
+        }
+        restoredCount++;
+    }
+
+    gl_capture_call(glPixelStorei, GL_UNPACK_ALIGNMENT, (GLint)unpackAlignment);
+    gl_capture_call(glPixelStorei, GL_UNPACK_ROW_LENGTH, (GLint)unpackRowLength);
+    gl_capture_call(glBindBuffer, GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+    gl->glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->pixelPackBuffer);
+
+    Deallocate(data, nullptr);
+    log_print("[Capture] Snapshot of %u buffers and textures written, %u textures skipped\n", restoredCount, skippedCount);
+}
+
+OpenGL* CreateGLCapture(OpenGL* gl, const char* filename, u32 firstFrame, u32 frameCount, u32 windowWidth, u32 windowHeight) {
+    auto capture = (GLCapture*)Allocate(sizeof(GLCapture), 0, nullptr);
+    panic(capture);
+    memset(capture, 0, sizeof(GLCapture));
+
+    capture->file = fopen(filename, "wb");
+    if (!capture->file) {
+        log_print("[Capture] Failed to open %s. GL calls are not captured\n", filename);
+        Deallocate(capture, nullptr);
+        return gl;
+    }
+
+    capture->real = *gl;
+    capture->table = *gl;
+    capture->firstFrame = firstFrame;
+    capture->endFrame = firstFrame + Max(frameCount, 1u);
+    capture->recording = true;
+    capture->unpackAlignment = 4;
+
+    capture->header.magic = GLCaptureHeader::MagicValue;
+    capture->header.version = GLCaptureHeader::CurrentVersion;
+    capture->header.functionCount = OpenGL::FunctionCount;
+    capture->header.windowWidth = windowWidth;
+    capture->header.windowHeight = windowHeight;
+    fwrite(&capture->header, sizeof(capture->header), 1, capture->file);
+
+    auto fn = &capture->table.functions.fn;
+    GLCaptureInstallMissingStubs<0, OpenGL::FunctionCount>(capture->table.functions.raw);
+#define gl_capture_install(func) fn->func = GLCaptureStub<opengl_function_index(func), decltype(OpenGL::Functions::_Functions::func)>::Call;
+    GL_CAPTURE_FUNCTIONS(gl_capture_install)
+#undef gl_capture_install
+
+    GlobalGLCapture = capture;
+    log_print("[Capture] Capturing GL calls to %s, frames %u-%u\n", filename, capture->firstFrame, capture->endFrame - 1);
+    return &capture->table;
+}
+
+void EndGLCaptureFrame() {
+    auto capture = GlobalGLCapture;
+    if (capture && capture->recording) {
+        LockGLCapture(capture);
+        GLCaptureSyncMappings(capture);
+        WriteGLCaptureChunk(capture, capture->frameIndex >= capture->firstFrame);
+        capture->frameIndex++;
+
+        // NOTE: Snapshot goes to the last setup chunk
+        if (capture->frameIndex == capture->firstFrame) {
+            WriteGLCaptureSnapshot(capture);
+            WriteGLCaptureChunk(capture, false);
+        }
+
+        if (capture->frameIndex == capture->endFrame) {
+            capture->recording = false;
+            fclose(capture->file);
+            capture->file = nullptr;
+            for (u32 i = 0; i < capture->mappingCount; i++) {
+                Deallocate(capture->mappings[i].shadow, nullptr);
+            }
+            capture->mappingCount = 0;
+            Deallocate(capture->buffers.names, nullptr);
+            Deallocate(capture->textures.names, nullptr);
+            capture->buffers = {};
+            capture->textures = {};
+            Deallocate(capture->frame.data, nullptr);
+            Deallocate(capture->writes.data, nullptr);
+            capture->frame = {};
+            capture->writes = {};
+            log_print("[Capture] Done. %u chunks written\n", capture->header.chunkCount);
+        }
+        UnlockGLCapture(capture);
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "OpenGL.h"
+
+// NOTE: GL command stream capture. The capture layer wraps the functions of an OpenGL table: every call goes to the
+// driver and is then serialized together with the data it reads, so the stream does not depend on the game code.
+// Capture starts with the context, since the requested frames use resources created long before them. Frames before
+// the requested ones are stored as setup chunks which are replayed once, requested frames are replayed as many times
+// as needed by tools/gl_replay.cpp.
+//
+// Setup chunks are kept small: they have the calls which create objects and set state, but not draws, dispatches,
+// copies and uploads, and mapped memory is not compared during them. Storage is defined without data. Instead, the
+// last setup chunk is a snapshot: contents of every buffer, mapped memory and every texture level as they were at the
+// start of the first requested frame. Multisample textures are not in the snapshot.
+//
+// The file is GLCaptureHeader followed by chunks, one per frame. A chunk is GLCaptureChunk followed by records.
+// A record is a u16 function index in OpenGL::Functions and the arguments of the call. Scalars are stored with their
+// own size. Pointers are stored as GLCapturePointer followed by its data. The return value, if any, goes last.
+// Object names are replayed as captured and the replayer checks that the driver generates the same names.
+//
+// Writes to mapped buffers are not calls, so at every fence, sync wait and frame end mapped memory is compared with
+// its copy and changed ranges are stored as GLCaptureMappedWrite records. They go right after the previous comparison
+// point, or the map call for buffers mapped since, so writes to a per frame region are replayed after the wait on its
+// fence. Memory which is written twice between two syncs is replayed with its last contents. Ring buffers of the
+// renderer do not wrap between syncs, so it holds for them.
+
+struct GLCaptureHeader {
+    static constexpr u32 MagicValue = 0x43474c46; // FLGC
+    static constexpr u32 CurrentVersion = 2;
+
+    u32 magic;
+    u32 version;
+    // NOTE: Records store indices in OpenGL::Functions, so the replayer must be built with the same table
+    u32 functionCount;
+    u32 windowWidth;
+    u32 windowHeight;
+    u32 chunkCount;
+};
+
+struct GLCaptureChunk {
+    u64 size;
+    u32 frameIndex;
+    // NOTE: Requested frame. Other chunks only set up the state
+    b32 captured;
+};
+
+enum struct GLCapturePointer : u8 {
+    // NOTE: Replayed as null
+    Null = 0,
+    // NOTE: u32 size and the data read by the call
+    Input,
+    // NOTE: u64 offset into a bound buffer
+    Offset,
+    // NOTE: u32 size of the data written by the call. Replayed with scratch memory
+    Output,
+    // NOTE: u32 count and the names generated by the call
+    Names,
+    // NOTE: u32 count, then u32 size and null terminated data of every string. Lengths argument is replayed as null
+    StringArray,
+    // NOTE: Meaningless outside of the captured process. Calls with such arguments are not replayed
+    Skip,
+};
+
+// NOTE: Record which is not a call: u32 buffer, u64 offset from the buffer start, u32 size and data
+constexpr u16 GLCaptureMappedWrite = 0xffff;
+static_assert(OpenGL::FunctionCount < GLCaptureMappedWrite);
+
+// NOTE: Functions which are captured. Everything the platform, the game and imgui call must be here,
+// other functions panic when called during a capture
+#define GL_CAPTURE_FUNCTIONS(X) \
+    X(glActiveTexture) X(glAttachShader) X(glBeginQuery) X(glBindBuffer) \
+    X(glBindBufferBase) X(glBindBufferRange) X(glBindFramebuffer) X(glBindImageTexture) \
+    X(glBindSampler) X(glBindTexture) X(glBindTextureUnit) X(glBindVertexArray) \
+    X(glBlendEquation) X(glBlendEquationSeparate) X(glBlendFunc) X(glBlendFuncSeparate) \
+    X(glBlitFramebuffer) X(glBufferData) X(glBufferStorage) X(glBufferSubData) \
+    X(glCheckFramebufferStatus) X(glCheckNamedFramebufferStatus) X(glClear) X(glClearColor) \
+    X(glClearDepth) X(glClientWaitSync) X(glClipControl) X(glColorMask) \
+    X(glCompileShader) X(glCopyImageSubData) X(glCopyNamedBufferSubData) X(glCreateBuffers) \
+    X(glCreateFramebuffers) X(glCreateProgram) X(glCreateSamplers) X(glCreateShader) \
+    X(glCreateTextures) X(glCullFace) X(glDebugMessageCallback) X(glDebugMessageControl) \
+    X(glDeleteBuffers) X(glDeleteFramebuffers) X(glDeleteProgram) X(glDeleteShader) \
+    X(glDeleteSync) X(glDeleteTextures) X(glDeleteVertexArrays) X(glDepthFunc) \
+    X(glDepthMask) X(glDetachShader) X(glDisable) X(glDisableVertexAttribArray) \
+    X(glDispatchCompute) X(glDrawArrays) X(glDrawArraysInstanced) X(glDrawBuffer) \
+    X(glDrawElements) X(glDrawElementsBaseVertex) X(glDrawElementsInstanced) X(glEnable) \
+    X(glEnableVertexAttribArray) X(glEndQuery) X(glFenceSync) X(glFinish) \
+    X(glFlush) X(glFramebufferTexture) X(glFramebufferTexture2D) X(glFramebufferTextureLayer) \
+    X(glFrontFace) X(glGenBuffers) X(glGenFramebuffers) X(glGenQueries) \
+    X(glGenTextures) X(glGenVertexArrays) X(glGenerateMipmap) X(glGenerateTextureMipmap) \
+    X(glGetAttribLocation) X(glGetFloatv) X(glGetIntegerv) X(glGetProgramBinary) \
+    X(glGetProgramInfoLog) X(glGetProgramiv) X(glGetQueryObjectiv) X(glGetQueryObjectui64v) \
+    X(glGetShaderInfoLog) X(glGetShaderiv) X(glGetString) X(glGetSubroutineIndex) \
+    X(glGetTexImage) X(glGetTextureImage) X(glGetUniformBlockIndex) X(glGetUniformLocation) \
+    X(glInvalidateNamedFramebufferData) X(glInvalidateTexImage) X(glIsEnabled) X(glLineWidth) \
+    X(glLinkProgram) X(glMapBuffer) X(glMapBufferRange) X(glMapNamedBuffer) \
+    X(glMapNamedBufferRange) X(glMemoryBarrier) X(glMultiDrawElementsIndirect) X(glNamedBufferData) \
+    X(glNamedBufferStorage) X(glNamedBufferSubData) X(glNamedFramebufferDrawBuffer) X(glNamedFramebufferReadBuffer) \
+    X(glNamedFramebufferTexture) X(glNamedFramebufferTextureLayer) X(glPixelStorei) X(glPolygonMode) \
+    X(glPolygonOffset) X(glProgramBinary) X(glProgramParameteri) X(glQueryCounter) \
+    X(glReadBuffer) X(glSamplerParameteri) X(glScissor) X(glShaderSource) \
+    X(glTexImage1D) X(glTexImage2D) X(glTexImage2DMultisample) X(glTexImage3D) \
+    X(glTexParameterf) X(glTexParameterfv) X(glTexParameteri) X(glTexStorage3D) \
+    X(glTexSubImage3D) X(glTextureParameterf) X(glTextureParameteri) X(glTextureStorage2D) \
+    X(glTextureStorage2DMultisample) X(glTextureStorage3D) X(glTextureSubImage1D) X(glTextureSubImage2D) \
+    X(glTextureSubImage3D) X(glUniform1f) X(glUniform1i) X(glUniform1ui) \
+    X(glUniform2f) X(glUniform2fv) X(glUniform3fv) X(glUniform4fv) \
+    X(glUniformBlockBinding) X(glUniformMatrix3fv) X(glUniformMatrix4fv) X(glUniformSubroutinesuiv) \
+    X(glUnmapBuffer) X(glUnmapNamedBuffer) X(glUseProgram) X(glVertexAttribDivisor) \
+    X(glVertexAttribIPointer) X(glVertexAttribPointer) X(glViewport)
+
+// NOTE: Arguments are passed around as u64 slots holding the bytes of the value
+template <typename T>
+inline u64 GLCaptureToSlot(T value) {
+    u64 slot = 0;
+    memcpy(&slot, &value, sizeof(T));
+    return slot;
+}
+
+template <typename T>
+inline T GLCaptureFromSlot(u64 slot) {
+    T value;
+    memcpy(&value, &slot, sizeof(T));
+    return value;
+}
+
+// NOTE: Stored size of a scalar argument. Zero for pointers, which are described by GLCapturePointer
+template <typename T> struct GLCaptureArgSize { static constexpr u8 Value = sizeof(T); };
+template <typename T> struct GLCaptureArgSize<T*> { static constexpr u8 Value = 0; };
+// NOTE: Syncs are handles, the replayer maps them to its own
+template <> struct GLCaptureArgSize<GLsync> { static constexpr u8 Value = sizeof(GLsync); };
+
+template <typename T> struct GLCaptureIsSync { static constexpr bool Value = false; };
+template <> struct GLCaptureIsSync<GLsync> { static constexpr bool Value = true; };
+
+template <typename T> struct GLCaptureIsVoid { static constexpr bool Value = false; };
+template <> struct GLCaptureIsVoid<void> { static constexpr bool Value = true; };
+
+// NOTE: Returns the table which should be used instead of the given one. Capture starts immediately and frames are
+// counted by EndGLCaptureFrame. The file is finished after the last requested frame, later calls go straight to the driver
+OpenGL* CreateGLCapture(OpenGL* gl, const char* filename, u32 firstFrame, u32 frameCount, u32 windowWidth, u32 windowHeight);
+// NOTE: Call after the last GL call of a frame, before the swap. Does nothing when there is no capture
+void EndGLCaptureFrame();
@@ -90,6 +90,11 @@ typedef void(WorkFn)(void* data0, void* data1, void* data2, u32 threadIndex);
 typedef b32(PushWorkFn)(WorkQueue* queue, WorkFn* fn, void* data0, void* data1, void* data2);
 typedef void(CompleteAllWorkFn)(WorkQueue* queue);
 
+// NOTE: Blocks until the render thread is done with the frame in flight. Does nothing on the render thread itself
+typedef void(WaitForRenderFn)();
+// NOTE: Ends the main loop after the current frame, the process exits with the code. Callable from any thread
+typedef void(QuitFn)(i32 exitCode);
+
 typedef void(SaveThreadWorkFn)(void* data);
 typedef void(SetSaveThreadWorkFn)(SaveThreadWorkFn* func, void* data, u32 timeoutMs);
 
@@ -119,6 +124,8 @@ struct Mesh {
     BBoxAligned aabb;
     u32 gpuVertexBufferHandle;
     u32 gpuIndexBufferHandle;
+    // NOTE: One-based slot in the renderer geometry pool used by GPU-driven passes. Zero if not pooled yet
+    u32 gpuDrawSlot;
 };
 
 static_assert(sizeof(Mesh) % 8 == 0);
@@ -185,6 +192,9 @@ struct PlatformCalls
     PushWorkFn* PushWork;
     CompleteAllWorkFn* CompleteAllWork;
 
+    WaitForRenderFn* WaitForRender;
+    QuitFn* Quit;
+
     ResourceLoaderLoadImageFn* ResourceLoaderLoadImage;
     ResourceLoaderValidateImageFileFn* ResourceLoaderValidateImageFile;
 
@@ -274,10 +284,15 @@ struct PlatformState
     volatile b32 supportsAsyncGPUTransfer;
     WorkQueue* lowPriorityQueue;
     WorkQueue* highPriorityQueue;
+    // NOTE: Jobs kicked by the render thread. Separate queue, since queues have a single producer
+    WorkQueue* renderQueue;
     ImGuiContext* imguiContext;
     InputMode inputMode;
     InputState input;
     u64 tickCount;
+    // NOTE: Tick of the frame the render thread is drawing. Lags behind tickCount by renderLatency
+    u64 renderTickCount;
+    u32 renderLatency;
     i32 fps;
     i32 ups;
     f32 gameSpeed;
@@ -288,4 +303,6 @@ struct PlatformState
     DateTime localTime;
     GLDebugCallbackFn* glDebugCallback;
     wchar_t* executablePath;
+    // NOTE: Whole command line. Game options (automated runs) are parsed by the game
+    const char* commandLine;
 };
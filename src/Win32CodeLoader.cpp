@@ -13,6 +13,21 @@ void UnloadGameCode(LibraryData* lib)
     DeleteFile(LibraryData::TempDllName);
 }
 
+b32 GameCodeChanged(LibraryData* lib)
+{
+    b32 changed = false;
+    WIN32_FIND_DATA findData;
+    HANDLE findHandle = FindFirstFile(LibraryData::DllName, &findData);
+    if (findHandle != INVALID_HANDLE_VALUE)
+    {
+        FindClose(findHandle);
+        FILETIME fileTime = findData.ftLastWriteTime;
+        u64 writeTime = ((u64)0 | fileTime.dwLowDateTime) | ((u64)0 | fileTime.dwHighDateTime) << 32;
+        changed = writeTime != lib->lastChangeTime;
+    }
+    return changed;
+}
+
 b32 UpdateGameCode(LibraryData* lib)
 {
     b32 updated = false;
@@ -18,5 +18,7 @@ struct LibraryData
     HMODULE handle;
 };
 
+// NOTE: Only checks the timestamp. Used to stop the render thread before the library is unloaded
+b32 GameCodeChanged(LibraryData* lib);
 b32 UpdateGameCode(LibraryData* lib);
 void UnloadGameCode(LibraryData* lib);
@@ -27,7 +27,8 @@ extern "C" { __declspec(dllexport) DWORD AmdPowerXpressRequestHighPerformance =
 #endif
 
 static Win32Context GlobalContext = {};
-static bool GlobalRunning = true;
+static volatile bool GlobalRunning = true;
+static volatile i32 GlobalExitCode = 0;
 static LARGE_INTEGER GlobalPerformanceFrequency = {};
 static void* GlobalGameData = 0;
 
@@ -119,6 +120,15 @@ OpenGLLoadResult LoadOpenGL() {
                 context->extensions.ARB_gl_spirv.supported = true;
             }
         }
+        if (strcmp((const char*)extensionString, "GL_KHR_parallel_shader_compile") == 0) {
+            context->extensions.KHR_parallel_shader_compile.glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)OpenGLGetProcAddress("glMaxShaderCompilerThreadsKHR");
+            if (context->extensions.KHR_parallel_shader_compile.glMaxShaderCompilerThreadsKHR) {
+                context->extensions.KHR_parallel_shader_compile.supported = true;
+            }
+        }
+        if (strcmp((const char*)extensionString, "GL_ARB_shader_viewport_layer_array") == 0) {
+            context->extensions.ARB_shader_viewport_layer_array = true;
+        }
         if (strcmp((const char*)extensionString, "GL_ARB_spirv_extensions") == 0) {
             context->extensions.ARB_spirv_extensions = true;
         }
@@ -133,6 +143,12 @@ OpenGLLoadResult LoadOpenGL() {
     if (!context->extensions.ARB_gl_spirv.supported) {
         log_print("[Info] ARB_gl_spirv is not supported\n");
     }
+    if (!context->extensions.KHR_parallel_shader_compile.supported) {
+        log_print("[Info] KHR_parallel_shader_compile is not supported\n");
+    }
+    if (!context->extensions.ARB_shader_viewport_layer_array) {
+        log_print("[Info] ARB_shader_viewport_layer_array is not supported\n");
+    }
     if (!context->extensions.ARB_spirv_extensions) {
         log_print("[Info] ARB_spirv_extensions is not supported\n");
     }
@@ -1116,6 +1132,11 @@ void* Reallocate(void* ptr, uptr newSize)
     return realloc(ptr, newSize);
 }
 
+// NOTE: Null backend and the capture use atomics and Allocate, so they go after them and before the GL function macros below
+#include "Intrinsics.cpp"
+#include "NullOpenGL.cpp"
+#include "OpenGLCapture.cpp"
+
 void LoadResourceLoader(Win32Context* context)
 {
     auto handle = LoadLibrary(L"flux_resource_loader.dll");
@@ -1281,6 +1302,7 @@ DWORD WINAPI Win32ThreadProc(void* param) {
     auto threadInfo = (Win32ThreadInfo*)param;
     auto lowPriorityQueue = threadInfo->lowPriorityQueue;
     auto highPriorityQueue = threadInfo->highPriorityQueue;
+    auto renderQueue = threadInfo->renderQueue;
 
     // NOTE: This way of initializaing shared contexts appears to be working.
     // Multiple context support for working threads in OpenGL seems to be super inconsistent
@@ -1298,11 +1320,92 @@ DWORD WINAPI Win32ThreadProc(void* param) {
     while (true) {
         auto didHighPriorityWork = Win32DoWorkerWork(highPriorityQueue, threadInfo->index);
         if (!didHighPriorityWork) {
-            //WaitForSingleObjectEx(highPriorityQueue->semaphore, 0, FALSE);
-            auto didLowPriorityWork = Win32DoWorkerWork(lowPriorityQueue, threadInfo->index);
-            if (!didLowPriorityWork) {
-                WaitForSingleObjectEx(GlobalContext.workQueueSemaphore, INFINITE, FALSE);
+            auto didRenderWork = Win32DoWorkerWork(renderQueue, threadInfo->index);
+            if (!didRenderWork) {
+                //WaitForSingleObjectEx(highPriorityQueue->semaphore, 0, FALSE);
+                auto didLowPriorityWork = Win32DoWorkerWork(lowPriorityQueue, threadInfo->index);
+                if (!didLowPriorityWork) {
+                    WaitForSingleObjectEx(GlobalContext.workQueueSemaphore, INFINITE, FALSE);
+                }
+            }
+        }
+    }
+}
+
+// NOTE: ImGui draw lists are owned by the context and rebuilt by the next NewFrame(), so the main thread
+// hands a copy of them to the render thread. There are two of them, one per frame in flight
+struct Win32ImGuiFrame {
+    ImDrawData drawData;
+    ImVector<ImDrawList*> drawLists;
+    u32 windowWidth;
+    u32 windowHeight;
+};
+
+static Win32ImGuiFrame GlobalImGuiFrames[2];
+
+void Win32CopyImGuiFrame(Win32ImGuiFrame* frame, ImDrawData* drawData, u32 windowWidth, u32 windowHeight) {
+    for (int i = 0; i < frame->drawLists.Size; i++) {
+        IM_DELETE(frame->drawLists[i]);
+    }
+    frame->drawLists.resize(0);
+    for (int i = 0; i < drawData->CmdListsCount; i++) {
+        frame->drawLists.push_back(drawData->CmdLists[i]->CloneOutput());
+    }
+    frame->drawData = *drawData;
+    frame->drawData.CmdLists = frame->drawLists.Data;
+    frame->windowWidth = windowWidth;
+    frame->windowHeight = windowHeight;
+}
+
+DWORD WINAPI Win32RenderThreadProc(void* param) {
+    auto app = &GlobalContext;
+    if (!app->headless) {
+        auto result = wglMakeCurrent(app->windowDC, app->openGLRC);
+        panic(result, "[Error] Win32: failed to make OpenGL context current for render thread (%lu)", HRESULT_CODE(GetLastError()));
+    }
+
+    while (true) {
+        WaitForSingleObjectEx(app->renderKickEvent, INFINITE, FALSE);
+        switch (app->renderRequest) {
+        case Win32RenderRequest::Render: {
+            app->gameLib.GameUpdateAndRender(&app->state, GameInvoke::Render, &GlobalGameData);
+
+            auto frame = GlobalImGuiFrames + (app->state.renderTickCount % array_count(GlobalImGuiFrames));
+            glViewport(0, 0, frame->windowWidth, frame->windowHeight);
+            ImGui_ImplOpenGL3_RenderDrawData(&frame->drawData);
+
+            EndGLCaptureFrame();
+            if (!app->headless) {
+                SwapBuffers(app->windowDC);
             }
+        } break;
+        case Win32RenderRequest::Reload: {
+            app->gameLib.GameUpdateAndRender(&app->state, GameInvoke::Reload, &GlobalGameData);
+        } break;
+        invalid_default();
+        }
+        SetEvent(app->renderDoneEvent);
+    }
+}
+
+void Win32Quit(i32 exitCode) {
+    GlobalExitCode = exitCode;
+    GlobalRunning = false;
+}
+
+void Win32KickRender(Win32Context* app, Win32RenderRequest request) {
+    assert(!app->renderInFlight);
+    app->renderRequest = request;
+    app->renderInFlight = true;
+    SetEvent(app->renderKickEvent);
+}
+
+void Win32WaitForRender() {
+    auto app = &GlobalContext;
+    if (GetCurrentThreadId() != app->renderThreadId) {
+        if (app->renderInFlight) {
+            WaitForSingleObjectEx(app->renderDoneEvent, INFINITE, FALSE);
+            app->renderInFlight = false;
         }
     }
 }
@@ -1360,8 +1463,14 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
     _tcscpy(app->windowTitle, TEXT("PBR Demo"));
     app->state.windowWidth = 1280;
     app->state.windowHeight = 720;
+    app->state.commandLine = cmdLine;
 
-    Win32Init(app);
+    // NOTE: -nullgl replaces the driver with the null backend for CPU side renderer benchmarks. Nothing reaches
+    // the driver, so the window and the context are not created either
+    app->headless = strstr(cmdLine, "-nullgl") != nullptr;
+    if (!app->headless) {
+        Win32Init(app);
+    }
 
     // TODO: BUFFER TO SMALL
     wchar_t* executablePath = (wchar_t*)Allocate(sizeof(wchar_t) * 2048, 0, nullptr);
@@ -1375,7 +1484,9 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
     NormalizePath(executablePath);
     app->state.executablePath = executablePath;
 
-    app->wglSwapIntervalEXT(1);
+    if (!app->headless) {
+        app->wglSwapIntervalEXT(1);
+    }
 
     auto lowQueue = &app->lowPriorityQueue;
     auto highQueue = &app->highPriorityQueue;
@@ -1392,6 +1503,7 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
         info->index = GetThreadId(threadHandle);
         info->lowPriorityQueue = lowQueue;
         info->highPriorityQueue = highQueue;
+        info->renderQueue = &app->renderQueue;
         info->glrc = app->workersGLRC[i];
         ResumeThread(threadHandle);
         CloseHandle(threadHandle);
@@ -1399,10 +1511,25 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
 
     Win32CompleteAllWork(lowQueue);
     Win32CompleteAllWork(highQueue);
+    Win32CompleteAllWork(&app->renderQueue);
+
+    if (app->headless) {
+        app->state.gl = CreateNullOpenGL();
+    } else {
+        OpenGLLoadResult glResult = LoadOpenGL();
+        panic(glResult.success, "Failed to load OpenGL functions");
+        app->state.gl = glResult.context;
+    }
 
-    OpenGLLoadResult glResult = LoadOpenGL();
-    panic(glResult.success, "Failed to load OpenGL functions");
-    app->state.gl = glResult.context;
+    // NOTE: -glcapture <first frame> <frame count> writes GL calls to gl_capture.fglc for tools/gl_replay. Calls are
+    // recorded from the start, since the captured frames need the resources created before them
+    auto captureArg = strstr(cmdLine, "-glcapture");
+    if (captureArg) {
+        u32 firstFrame = 0;
+        u32 frameCount = 1;
+        sscanf(captureArg, "-glcapture %u %u", &firstFrame, &frameCount);
+        app->state.gl = CreateGLCapture(app->state.gl, "gl_capture.fglc", firstFrame, frameCount, app->state.windowWidth, app->state.windowHeight);
+    }
 
     LoadResourceLoader(app);
 
@@ -1427,12 +1554,16 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
 
     app->state.functions.PushWork = Win32PushWork;
     app->state.functions.CompleteAllWork = Win32CompleteAllWork;
+    app->state.functions.WaitForRender = Win32WaitForRender;
+    app->state.functions.Quit = Win32Quit;
 
     app->state.functions.ForEachFile = Win32ForEachFile;
     app->state.functions.ShowOpenFileDialog = Win32ShowOpenFileDialog;
 
     app->state.lowPriorityQueue = lowQueue;
     app->state.highPriorityQueue = highQueue;
+    app->state.renderQueue = &app->renderQueue;
+    app->state.renderLatency = DefaultRenderLatency;
 
     //SetupDirs(&app->gameLib);
 
@@ -1456,7 +1587,9 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
     style.WindowRounding = 0.0f;
     style.Colors[ImGuiCol_WindowBg].w = 1.0f;
 
-    ImGui_ImplWin32_Init(app->windowHandle);
+    if (!app->headless) {
+        ImGui_ImplWin32_Init(app->windowHandle);
+    }
     auto imResult = ImGui_ImplOpenGL3_Init("#version 330 core");
     panic(imResult);
 
@@ -1467,6 +1600,16 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
 
     app->gameLib.GameUpdateAndRender(&app->state, GameInvoke::Init, &GlobalGameData);
 
+    // NOTE: Creates ImGui device objects while the context is still current on this thread. Everything after
+    // that is drawn by the render thread
+    ImGui_ImplOpenGL3_NewFrame();
+    wglMakeCurrent(0, 0);
+
+    app->renderKickEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    app->renderDoneEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    app->renderThread = CreateThread(0, 0, Win32RenderThreadProc, nullptr, 0, &app->renderThreadId);
+    panic(app->renderThread, "[Error] Win32: failed to create render thread");
+
     while (GlobalRunning)
     {
         app->state.tickCount++;
@@ -1474,8 +1617,12 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
 
         WindowPollEvents(app);
 
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplWin32_NewFrame();
+        if (app->headless) {
+            io.DisplaySize = ImVec2((f32)app->state.windowWidth, (f32)app->state.windowHeight);
+            io.DeltaTime = (f32)SECONDS_PER_TICK;
+        } else {
+            ImGui_ImplWin32_NewFrame();
+        }
         ImGui::NewFrame();
 
         if (tickTimer <= 0)
@@ -1487,23 +1634,36 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
 
         app->state.localTime = GetLocalTime();
 
-        bool codeReloaded = UpdateGameCode(&app->gameLib);
-        if (codeReloaded)
+        // NOTE: Render thread runs the library code, so it must be idle while the library is swapped.
+        // Reload is invoked on the render thread since it touches GL
+        if (GameCodeChanged(&app->gameLib))
         {
-            app->gameLib.GameUpdateAndRender(&app->state, GameInvoke::Reload, &GlobalGameData);
+            Win32WaitForRender();
+            bool codeReloaded = UpdateGameCode(&app->gameLib);
+            if (codeReloaded)
+            {
+                Win32KickRender(app, Win32RenderRequest::Reload);
+                Win32WaitForRender();
+            }
         }
 
         updatesSinceLastTick++;
         app->gameLib.GameUpdateAndRender(&app->state, GameInvoke::Update, &GlobalGameData);
 
-        app->gameLib.GameUpdateAndRender(&app->state, GameInvoke::Render, &GlobalGameData);
-
         ImGui::Render();
 
-        glViewport(0, 0, app->state.windowWidth, app->state.windowHeight);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        // NOTE: Frame slots are reused every other frame. The render thread is done with this one, since it
+        // is waited below before each kick
+        auto imguiFrame = GlobalImGuiFrames + (app->state.tickCount % array_count(GlobalImGuiFrames));
+        Win32CopyImGuiFrame(imguiFrame, ImGui::GetDrawData(), app->state.windowWidth, app->state.windowHeight);
 
-        SwapBuffers(app->windowDC);
+        Win32WaitForRender();
+        app->state.renderTickCount = app->state.tickCount;
+        Win32KickRender(app, Win32RenderRequest::Render);
+        if (app->state.renderLatency == 0)
+        {
+            Win32WaitForRender();
+        }
 
         for (u32 keyIndex = 0; keyIndex < InputState::KeyCount; keyIndex ++)
         {
@@ -1540,6 +1700,9 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
         app->state.fps = (i32)(1.0f / app->state.absDeltaTime);
         app->state.gameDeltaTime = app->state.absDeltaTime * app->state.gameSpeed;
     }
+
+    Win32WaitForRender();
+    return GlobalExitCode;
 }
 
 #include "Win32CodeLoader.cpp"
@@ -14,6 +14,10 @@ constexpr f64 SECONDS_PER_TICK = 1.0 / 60.0;
 
 const u32 NumOfWorkerThreads = 4;
 
+// NOTE: Frames the render thread is allowed to lag behind the update. Zero waits for every frame to be drawn
+// before the next update starts, one lets the update of the next frame overlap the draw of the previous one
+const u32 DefaultRenderLatency = 1;
+
 //#define OPENGL_WORKER_CONTEXTS
 
 // Macros from windowsx.h
@@ -85,14 +89,21 @@ struct Win32ThreadInfo {
     u32 index;
     WorkQueue* lowPriorityQueue;
     WorkQueue* highPriorityQueue;
+    WorkQueue* renderQueue;
     HGLRC glrc;
 };
 
+enum struct Win32RenderRequest : u32 {
+    Render, Reload
+};
+
 struct Win32Context
 {
     HANDLE consoleHandle = GetStdHandle(STD_OUTPUT_HANDLE);
     WINDOWPLACEMENT wpPrev;
     b32 fullscreen;
+    // NOTE: No window and OpenGL context. Set by -nullgl, so automated CPU benchmarks run without a display and a GPU
+    b32 headless;
     HWND windowHandle;
     HDC windowDC;
     HGLRC openGLRC;
@@ -103,8 +114,16 @@ struct Win32Context
     LibraryData gameLib;
     WorkQueue lowPriorityQueue;
     WorkQueue highPriorityQueue;
+    WorkQueue renderQueue;
     HGLRC workersGLRC[NumOfWorkerThreads];
     HANDLE workQueueSemaphore;
+    // NOTE: Render thread owns the OpenGL context after init. Kicked by the main thread once per frame
+    HANDLE renderThread;
+    DWORD renderThreadId;
+    HANDLE renderKickEvent;
+    HANDLE renderDoneEvent;
+    Win32RenderRequest renderRequest;
+    b32 renderInFlight;
     i32 mousePosX;
     i32 mousePosY;
 
@@ -5,6 +5,7 @@
 
 void FluxInit(Context* context) {
     AssetManager::Init(&context->assetManager, context->renderer);
+    context->renderSampleCount = GetRenderSampleCount(context->renderer);
 
     context->tempArena = PlatformAllocateArena(Megabytes(32));
     context->tempArena->isTemporary = true;
@@ -54,20 +55,59 @@ void FluxInit(Context* context) {
     }
 
 
-    context->hdrMap = LoadCubemapHDR("../res/desert_sky/nz.hdr", "../res/desert_sky/ny.hdr", "../res/desert_sky/pz.hdr", "../res/desert_sky/nx.hdr", "../res/desert_sky/px.hdr", "../res/desert_sky/py.hdr");
-    UploadToGPU(&context->hdrMap);
-    context->irradanceMap = MakeEmptyCubemap(64, 64, TextureFormat::RGB16F, TextureFilter::Bilinear, TextureWrapMode::ClampToEdge, false);
-    UploadToGPU(&context->irradanceMap);
+    // NOTE: Diffuse irradiance SH and prefiltered enviroment map are cached on disk.
+    // Cache keys cover source images, parameters and convolution shaders
+    const char* skyboxFaces[] = { "../res/desert_sky/nz.hdr", "../res/desert_sky/ny.hdr", "../res/desert_sky/pz.hdr", "../res/desert_sky/nx.hdr", "../res/desert_sky/px.hdr", "../res/desert_sky/py.hdr" };
+    const u32 enviromentMapMipLevels = 6;
+    const wchar_t* irradianceSHCacheFile = L"irradiance_sh.cache";
+    const wchar_t* enviromentMapCacheFile = L"enviroment_map.cache";
+
     context->enviromentMap = MakeEmptyCubemap(256, 256, TextureFormat::RGB16F, TextureFilter::Trilinear, TextureWrapMode::ClampToEdge, true);
-    UploadToGPU(&context->enviromentMap);
 
-    context->renderGroup.drawSkybox = true;
-    context->renderGroup.skyboxHandle = context->enviromentMap.gpuHandle;
-    context->renderGroup.irradanceMapHandle = context->irradanceMap.gpuHandle;
-    context->renderGroup.envMapHandle = context->enviromentMap.gpuHandle;
+    u64 sourceCacheKey = Hash64(skyboxFaces[0], strlen(skyboxFaces[0]));
+    for (u32 i = 0; i < array_count(skyboxFaces); i++) {
+        sourceCacheKey = HashFile(skyboxFaces[i], sourceCacheKey);
+    }
+    u64 enviromentMapCacheKey = Hash64(&enviromentMapMipLevels, sizeof(enviromentMapMipLevels), sourceCacheKey);
+    enviromentMapCacheKey = HashShaderSource("EnvMapPrefilter", enviromentMapCacheKey);
+
+    SH9 irradianceSH = {};
+    bool shCached = LoadSH9FromCache(&irradianceSH, irradianceSHCacheFile, sourceCacheKey);
+    bool enviromentMapCached = LoadFromCache(&context->enviromentMap, enviromentMapCacheFile, enviromentMapCacheKey, enviromentMapMipLevels);
+
+    if (!shCached || !enviromentMapCached) {
+        context->hdrMap = LoadCubemapHDR(skyboxFaces[0], skyboxFaces[1], skyboxFaces[2], skyboxFaces[3], skyboxFaces[4], skyboxFaces[5]);
+
+        if (!shCached) {
+            auto begin = GetTimeStamp();
+            auto radiance = ProjectCubemapSH9(&context->hdrMap);
+            irradianceSH = IrradianceSH9(radiance);
+            auto end = GetTimeStamp();
+            printf("[Flux] Projected irradiance SH9: %f ms\n", (f32)(end - begin) / (f32)GetTicksPerSecond() * 1000.0f);
+            SaveSH9ToCache(&irradianceSH, irradianceSHCacheFile, sourceCacheKey);
+        }
+
+        if (!enviromentMapCached) {
+            UploadToGPU(&context->hdrMap);
+            UploadToGPU(&context->enviromentMap);
+            GenEnvPrefiliteredMap(context->renderer, &context->enviromentMap, context->hdrMap.gpuHandle, enviromentMapMipLevels);
+            SaveToCache(&context->enviromentMap, enviromentMapCacheFile, enviromentMapCacheKey, enviromentMapMipLevels);
+
+            // NOTE: Source cubemap is needed only for convolution
+            FreeGPUTexture(context->hdrMap.gpuHandle);
+            context->hdrMap.gpuHandle = 0;
+        }
+
+        FreeCubemap(&context->hdrMap);
+    }
 
-    GenIrradanceMap(context->renderer, &context->irradanceMap, context->hdrMap.gpuHandle);
-    GenEnvPrefiliteredMap(context->renderer, &context->enviromentMap, context->hdrMap.gpuHandle, 6);
+    for (u32 i = 0; i < array_count(context->framePackets); i++) {
+        auto group = &context->framePackets[i].group;
+        group->irradianceSH = irradianceSH;
+        group->drawSkybox = true;
+        group->skyboxHandle = context->enviromentMap.gpuHandle;
+        group->envMapHandle = context->enviromentMap.gpuHandle;
+    }
 
     auto defaultWorld = LoadWorldFromDisc(&context->assetManager, DefaultWorldW);
     if (defaultWorld) {
@@ -122,11 +162,145 @@ void FluxInit(Context* context) {
         assert(sphereEntity->mesh);
         sphereEntity->material = oldMetal;
     }
+
+    // NOTE: Automated runs. -benchmark_renderer [frames] runs the renderer benchmark once the mesh is loaded and quits.
+    // -golden_images [record] runs the golden image tests and quits, they need a real GL context.
+    // -gpu_cull_test runs the GPU cull test and quits, it needs a real GL context too
+    auto commandLine = GlobalPlatform.commandLine;
+    auto benchmarkArg = commandLine ? strstr(commandLine, "-benchmark_renderer") : nullptr;
+    if (benchmarkArg) {
+        u32 frameCount = 0;
+        sscanf(benchmarkArg, "-benchmark_renderer %u", &frameCount);
+        if (!RequestRendererBenchmark(context, frameCount, true)) {
+            printf("[Benchmark] Failed to load the benchmark mesh\n");
+            PlatformQuit(1);
+        }
+    }
+
+    auto goldenImagesArg = commandLine ? strstr(commandLine, "-golden_images") : nullptr;
+    if (goldenImagesArg) {
+        if (GlobalPlatform.gl->nullStats) {
+            printf("[Golden] Golden images can not be rendered by the null GL backend\n");
+            PlatformQuit(1);
+        } else {
+            bool record = strncmp(goldenImagesArg, "-golden_images record", sizeof("-golden_images record") - 1) == 0;
+            StartGoldenImages(context, record, true);
+        }
+    }
+
+    if (commandLine && strstr(commandLine, "-gpu_cull_test")) {
+        if (GlobalPlatform.gl->nullStats) {
+            printf("[GPUCull] GPU cull test can not run on the null GL backend\n");
+            PlatformQuit(1);
+        } else {
+            context->gpuCullTest.active = true;
+            context->gpuCullTest.quitWhenDone = true;
+        }
+    }
 }
 
 void FluxReload(Context* context) {
 }
 
+World* SwapWorld(Context* context, World* world) {
+    auto oldWorld = context->world;
+    context->ui.selectedEntity = 0;
+    context->world = world;
+    // NOTE: Render objects of the old world are dropped on the next frame
+    context->renderSceneValid = false;
+    return oldWorld;
+}
+
+// TODO: Loading and unloading levels
+// TODO: Get rid if this random deallocation confusion
+void ReplaceWorld(Context* context, World* world) {
+    auto oldWorld = SwapWorld(context, world);
+    Drop(&oldWorld->entityTable);
+    PlatformFree(oldWorld, nullptr);
+}
+
+RenderCommandDrawMesh MakeDrawCommand(const Entity* entity) {
+    RenderCommandDrawMesh command = {};
+    command.transform = entity->transform;
+    command.meshID = entity->mesh;
+    command.material = entity->material;
+    command.dynamic = entity->dynamic;
+    command.occluder = entity->occluder;
+    return command;
+}
+
+void SyncRenderObject(RenderScene* scene, Entity* entity) {
+    UpdateTransform(entity);
+    auto command = MakeDrawCommand(entity);
+    if (entity->renderObject) {
+        UpdateRenderObject(scene, entity->renderObject, &command);
+    } else {
+        entity->renderObject = CreateRenderObject(scene, &command);
+    }
+}
+
+// NOTE: Recreates render objects of all entities
+void SyncRenderScene(RenderScene* scene, World* world) {
+    Clear(scene);
+    for (Entity& entity : world->entityTable) {
+        entity.renderObject = 0;
+        SyncRenderObject(scene, &entity);
+    }
+}
+
+// NOTE: Slice of the entity table buckets
+struct EntityRecordJob {
+    World* world;
+    RenderCommandRecorder* recorder;
+    u32 begin;
+    u32 end;
+};
+
+void RecordEntitiesWork(void* data0, void* data1, void* data2, u32 threadIndex) {
+    auto job = (EntityRecordJob*)data0;
+    auto table = &job->world->entityTable;
+    for (u32 i = job->begin; i < job->end; i++) {
+        auto bucket = table->table + i;
+        if (bucket->used) {
+            auto entity = &bucket->value;
+            assert(entity->id);
+            UpdateTransform(entity);
+            // NOTE: Meshes are not resolved here since GetMesh may queue a load and is not thread safe.
+            // The renderer skips draws of meshes which are not loaded yet
+            auto command = MakeDrawCommand(entity);
+            Push(job->recorder, &command);
+        }
+    }
+}
+
+// NOTE: Updates entity transforms and records their draws on the worker threads. Visibility is not tested here, every
+// entity is recorded. The renderer culls draws later: GPU-driven frames run frustum and occlusion culling in the GPU cull
+// pass, other frames only run the software occlusion test on the render thread and have no frustum culling.
+// Entities have no LODs and materials are copied by value
+void RecordEntities(RenderGroup* group, World* world) {
+    constexpr u32 JobCount = 16;
+    static_assert(JobCount <= RenderGroup::MaxRecorders);
+    EntityRecordJob jobs[JobCount];
+    u32 bucketCount = world->entityTable.size;
+    u32 bucketsPerJob = (bucketCount + JobCount - 1) / JobCount;
+    for (u32 i = 0; i < JobCount; i++) {
+        jobs[i].world = world;
+        jobs[i].recorder = GetRecorder(group, i);
+        jobs[i].begin = Min(i * bucketsPerJob, bucketCount);
+        jobs[i].end = Min(jobs[i].begin + bucketsPerJob, bucketCount);
+    }
+
+    for (u32 i = 0; i < JobCount; i++) {
+        if (jobs[i].begin < jobs[i].end) {
+            // TODO: Spin-locking here for now. We should handle the case when platform queue is full propperly
+            while (!PlatformPushWork(GlobalHighPriorityWorkQueue, RecordEntitiesWork, jobs + i, nullptr, nullptr)) {}
+        }
+    }
+    PlatformCompleteAllWork(GlobalHighPriorityWorkQueue);
+
+    MergeRecorders(group);
+}
+
 void FluxUpdate(Context* context) {
     if (context->showConsole) {
         DrawConsole(&context->console);
@@ -137,29 +311,39 @@ void FluxUpdate(Context* context) {
     auto renderer = context->renderer;
     auto assetManager = &context->assetManager;
 
+    // NOTE: Render thread is drawing the other packet. This one was drawn two frames ago
+    auto packet = context->framePackets + (GlobalPlatform.tickCount % array_count(context->framePackets));
+    DrawDebugOverlayRecorder(&packet->overlay);
+
     if (KeyPressed(Key::Tilde)) {
         context->showConsole = !context->showConsole;
     }
 
-    i32 rendererSampleCount = GetRenderSampleCount(renderer);
+    // NOTE: Render targets are changed on the render thread
+    i32 rendererSampleCount = context->renderSampleCount;
     DEBUG_OVERLAY_SLIDER(rendererSampleCount, 0, GetRenderMaxSampleCount(renderer));
-    if (rendererSampleCount != GetRenderSampleCount(renderer)) {
-        ChangeRenderResolution(renderer, GetRenderResolution(renderer), rendererSampleCount);
+    context->renderSampleCount = rendererSampleCount;
+    packet->sampleCount = rendererSampleCount;
+    packet->renderResolution = UV2(GlobalPlatform.windowWidth, GlobalPlatform.windowHeight);
+
+    packet->recompileShaders = context->recompileShaders;
+    context->recompileShaders = false;
+    // NOTE: Held until the benchmark mesh is loaded
+    auto benchmarkRequest = &context->benchmarkRequest;
+    packet->benchmarkRequest = {};
+    if (benchmarkRequest->meshID && (GetMesh(assetManager, benchmarkRequest->meshID) || !HasPendingLoads(assetManager))) {
+        packet->benchmarkRequest = *benchmarkRequest;
+        *benchmarkRequest = {};
     }
+    packet->occlusionTest = context->occlusionTest;
+    context->occlusionTest = {};
+    packet->gpuCullTest = context->gpuCullTest;
+    context->gpuCullTest = {};
 
     DEBUG_OVERLAY_TRACE(assetManager->assetQueueUsage);
-    CompletePendingLoads(assetManager);
-
-    auto renderRes = GetRenderResolution(renderer);
-    if (renderRes.x != GlobalPlatform.windowWidth ||
-        renderRes.y != GlobalPlatform.windowHeight) {
-        ChangeRenderResolution(renderer, UV2(GlobalPlatform.windowWidth, GlobalPlatform.windowHeight), GetRenderSampleCount(renderer));
-    }
-
+    DEBUG_OVERLAY_TRACE(GlobalPlatform.renderLatency);
 
     Update(&context->camera, 1.0f / 60.0f);
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     //DrawDebugPerformanceCounters();
 
     UpdateUi(context);
@@ -167,12 +351,7 @@ void FluxUpdate(Context* context) {
     if (ui->wantsLoadLoadFrom) {
         auto newWorld = LoadWorldFrom(ui, assetManager);
         if (newWorld) {
-            // TODO: Loading and unloading levels
-            // TODO: Get rid if this random deallocation confusion
-            Drop(&context->world->entityTable);
-            PlatformFree(context->world, nullptr);
-            ui->selectedEntity = 0;
-            context->world = newWorld;
+            ReplaceWorld(context, newWorld);
             world = newWorld;
         }
     }
@@ -187,6 +366,7 @@ void FluxUpdate(Context* context) {
         entity->mesh = GetID(&assetManager->nameTable, "../res/meshes/sphere.aab");
         // TODO: Assign material
         entity->material = {};
+        SyncRenderObject(&context->renderScene, entity);
     }
 
     // TODO: Factor this out
@@ -211,19 +391,51 @@ void FluxUpdate(Context* context) {
     }
 
     auto entity = GetEntity(world, 11);
-    if (entity) {
+    if (entity && !GoldenImagesRunning(context)) {
         entity->rotationAngles.y += GlobalGameDeltaTime * 50.0f;
         if (entity->rotationAngles.y >= 360.0f) {
             entity->rotationAngles.y = 0.0f;
         }
     }
 
-    Update(world);
+    auto group = &packet->group;
+    auto scene = &context->renderScene;
+
+    // NOTE: Entities live in the retained render scene, only the animated one and the one open in the editor
+    // are synced every frame. Immediate mode records all of them from scratch on the worker threads
+    bool immediateEntities = context->immediateEntities;
+    DEBUG_OVERLAY_TOGGLE(immediateEntities);
+    if (immediateEntities != (bool)context->immediateEntities) {
+        context->immediateEntities = immediateEntities;
+        context->renderSceneValid = false;
+    }
+
+    if (context->immediateEntities) {
+        RecordEntities(group, world);
+    } else {
+        if (!context->renderSceneValid) {
+            SyncRenderScene(scene, world);
+            context->renderSceneValid = true;
+        } else {
+            if (entity) {
+                SyncRenderObject(scene, entity);
+            }
+            if (ui->selectedEntity) {
+                auto selected = GetEntity(world, ui->selectedEntity);
+                if (selected) {
+                    SyncRenderObject(scene, selected);
+                }
+            }
+        }
+        SubmitRenderScene(group, scene);
+        DEBUG_OVERLAY_TRACE(scene->liveCount);
+    }
 
-    auto group = &context->renderGroup;
+    packet->camera = context->camera;
+    group->camera = &packet->camera;
 
-    group->camera = &context->camera;
-    auto camera = &context->camera;
+    // NOTE: May replace the world. The render scene is rebuilt on the next frame
+    UpdateGoldenImages(context, packet);
 
     DirectionalLight light = {};
     light.dir = Normalize(V3(0.3f, -1.0f, -0.95f));
@@ -234,15 +446,24 @@ void FluxUpdate(Context* context) {
     RenderCommandSetDirLight lightCommand = { light };
     Push(group, &lightCommand);
 
+    // NOTE: Grid of randomly colored point lights for testing clustered shading
+    static i32 testPointLightCount = 0;
+    DEBUG_OVERLAY_SLIDER(testPointLightCount, 0, (i32)RenderGroup::MaxLocalLights);
+    for (i32 i = 0; i < testPointLightCount; i++) {
+        u32 hash = (u32)Hash64(&i, sizeof(i));
+        RenderCommandPushPointLight pointLightCommand = {};
+        pointLightCommand.light.position = V3((f32)(i % 32) * 2.0f - 31.0f, 1.0f, (f32)(i / 32) * 2.0f - 15.0f);
+        pointLightCommand.light.radius = 3.0f;
+        pointLightCommand.light.color = V3((f32)(hash & 0xff), (f32)((hash >> 8) & 0xff), (f32)((hash >> 16) & 0xff)) * (4.0f / 255.0f);
+        Push(group, &pointLightCommand);
+    }
+
     if (ui->selectedEntity) {
         auto entity = Get(&world->entityTable, &ui->selectedEntity);
         assert(entity);
         auto mesh = GetMesh(assetManager, entity->mesh);
         if (mesh) {
-            auto aabb = mesh->aabb;
-            aabb.min = (entity->transform * V4(aabb.min, 1.0f)).xyz;
-            aabb.max = (entity->transform * V4(aabb.max, 1.0f)).xyz;
-            DrawAlignedBoxOutline(&context->renderGroup, aabb.min, aabb.max, V3(0.0f, 0.0f, 1.0f), 2.0f);
+            DrawDebugAABB(group, &entity->transform, mesh->aabb, V3(0.0f, 0.0f, 1.0f), 2.0f);
         }
     }
 
@@ -254,33 +475,77 @@ void FluxUpdate(Context* context) {
     Push(group, &gizmosCommand);
 #endif
 
-    for (Entity& entity : context->world->entityTable) {
-        assert(entity.id);
-        if (entity.id) {
+    if (context->ui.showBoundingVolumes) {
+        for (Entity& entity : context->world->entityTable) {
             auto mesh = GetMesh(assetManager, entity.mesh);
             if (mesh) {
-                RenderCommandDrawMesh command = {};
-                command.transform = entity.transform;
-                command.meshID = entity.mesh;
-                command.material = entity.material;
-                Push(group, &command);
-                if (context->ui.showBoundingVolumes) {
-                    auto aabb = mesh->aabb;
-                    aabb.min = (entity.transform * V4(aabb.min, 1.0f)).xyz;
-                    aabb.max = (entity.transform * V4(aabb.max, 1.0f)).xyz;
-                    DrawAlignedBoxOutline(&context->renderGroup, aabb.min, aabb.max, V3(1.0f, 0.0f, 0.0f), 2.0f);
-                }
+                DrawDebugAABB(group, &entity.transform, mesh->aabb, V3(1.0f, 0.0f, 0.0f), 2.0f);
             }
         }
     }
 
-    Begin(renderer, group);
+    // Alpha
+    //ImGui::PopStyleVar();
+}
+
+void FluxRender(Context* context) {
+    auto renderer = context->renderer;
+    auto assetManager = &context->assetManager;
+    auto packet = context->framePackets + (GlobalPlatform.renderTickCount % array_count(context->framePackets));
+    auto group = &packet->group;
+
+    BeginDebugOverlayRecorder(&packet->overlay);
+
+    if (packet->recompileShaders) {
+        RecompileShaders(renderer);
+    }
+
+    auto renderRes = GetRenderResolution(renderer);
+    if (renderRes.x != packet->renderResolution.x ||
+        renderRes.y != packet->renderResolution.y ||
+        packet->sampleCount != GetRenderSampleCount(renderer)) {
+        ChangeRenderResolution(renderer, packet->renderResolution, packet->sampleCount);
+    }
+
+    CompletePendingLoads(assetManager);
+
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    auto goldenImageRequest = &packet->goldenImageRequest;
+    if (goldenImageRequest->active) {
+        BeginGoldenImageFrame(context->goldenImages, renderer, goldenImageRequest);
+    }
+
+    Begin(renderer, group, assetManager);
     ShadowPass(renderer, group, assetManager);
     MainPass(renderer, group, assetManager);
     End(renderer);
 
-    // Alpha
-    //ImGui::PopStyleVar();
-}
+    if (goldenImageRequest->active) {
+        EndGoldenImageFrame(context->goldenImages, renderer, goldenImageRequest);
+    }
+
+    EndDebugOverlayRecorder(&packet->overlay);
+
+    if (packet->benchmarkRequest.meshID) {
+        if (!context->benchmark) {
+            context->benchmark = CreateRendererBenchmark();
+        }
+        bool succeeded = RunRendererBenchmark(context->benchmark, renderer, assetManager, &packet->benchmarkRequest);
+        if (packet->benchmarkRequest.quitWhenDone) {
+            PlatformQuit(succeeded ? 0 : 1);
+        }
+    }
+
+    if (packet->occlusionTest.active) {
+        RunOcclusionTest();
+    }
 
-void FluxRender(Context* context) {}
+    if (packet->gpuCullTest.active) {
+        bool succeeded = RunGPUCullTest(renderer);
+        if (packet->gpuCullTest.quitWhenDone) {
+            PlatformQuit(succeeded ? 0 : 1);
+        }
+    }
+}
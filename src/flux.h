@@ -2,10 +2,32 @@
 #include "flux_camera.h"
 #include "flux_renderer.h"
 #include "flux_render_group.h"
+#include "flux_render_scene.h"
 #include "flux_world.h"
 #include "flux_ui.h"
 #include "flux_resource_manager.h"
 #include "flux_console.h"
+#include "flux_debug_overlay.h"
+#include "flux_renderer_benchmark.h"
+#include "flux_golden_images.h"
+#include "flux_occlusion.h"
+#include "flux_gpu_cull_test.h"
+
+// NOTE: Everything the render thread needs to draw a frame. The update fills one packet while the render thread
+// draws the other one, so nothing in it is shared between the threads
+struct FramePacket {
+    RenderGroup group;
+    CameraBase camera;
+    uv2 renderResolution;
+    u32 sampleCount;
+    b32 recompileShaders;
+    RendererBenchmarkRequest benchmarkRequest;
+    GoldenImageRequest goldenImageRequest;
+    OcclusionTestRequest occlusionTest;
+    GPUCullTestRequest gpuCullTest;
+    // NOTE: Overlay items of the render thread. Drawn by the update two frames later when it gets the packet again
+    DebugOverlayRecorder overlay;
+};
 
 struct Context {
     Logger logger;
@@ -18,15 +40,33 @@ struct Context {
     GLuint vbo;
     Camera camera;
     Renderer* renderer;
-    RenderGroup renderGroup;
+    // NOTE: Indexed by tick count
+    FramePacket framePackets[2];
+    // NOTE: Requested by the update, applied by the render thread
+    u32 renderSampleCount;
+    b32 recompileShaders;
+    RendererBenchmarkRequest benchmarkRequest;
+    // NOTE: Created by the render thread on the first benchmark run
+    RendererBenchmark* benchmark;
+    // NOTE: Created by the golden_images command
+    GoldenImageHarness* goldenImages;
+    OcclusionTestRequest occlusionTest;
+    GPUCullTestRequest gpuCullTest;
+    RenderScene renderScene;
+    // NOTE: Render objects are recreated for all entities when false
+    b32 renderSceneValid;
+    b32 immediateEntities;
     CubeTexture skybox;
     CubeTexture hdrMap;
-    CubeTexture irradanceMap;
     CubeTexture enviromentMap;
     b32 showConsole;
 };
 
 void FluxInit(Context* context);
 void FluxReload(Context* context);
+// NOTE: Returns the current world, caller owns it
+World* SwapWorld(Context* context, World* world);
+// NOTE: Frees the current world
+void ReplaceWorld(Context* context, World* world);
 void FluxUpdate(Context* context);
 void FluxRender(Context* context);
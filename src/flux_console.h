@@ -50,7 +50,11 @@ static const ConsoleCommand GlobalConsoleCommands[] = {
 
     { "recompile_shaders",  RecompileShadersCommand },
     { "toggle_dbg_overlay", ToggleDebugOverlayCommand },
-    { "load", LoadCommand }
+    { "load", LoadCommand },
+    { "benchmark_renderer", RendererBenchmarkCommand, "[frames] - draws synthetic scenes of 1k-100k meshes, run with -nullgl to measure the renderer alone" },
+    { "golden_images", GoldenImagesCommand, "[record] - renders the golden image tests and compares them with the references, record overwrites the references" },
+    { "occlusion_test", OcclusionTestCommand, "rasterizes fixed occluders and checks the software occlusion results" },
+    { "gpu_cull_test", GPUCullTestCommand, "culls fixed boxes with the GPU-driven cull pass and checks the results" }
 };
 
 struct ConsoleCommandRecord {
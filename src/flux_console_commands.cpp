@@ -93,7 +93,8 @@ void ConsoleEchoCommand(Console* console, Context* context, ConsoleCommandArgs*
 }
 
 void RecompileShadersCommand(Console* console, Context* context, ConsoleCommandArgs* args) {
-    RecompileShaders(context->renderer);
+    // NOTE: Deferred to the render thread
+    context->recompileShaders = true;
 }
 
 void ToggleDebugOverlayCommand(Console* console, Context* context, ConsoleCommandArgs* args) {
@@ -113,10 +114,55 @@ void LoadCommand(Console* console, Context* context, ConsoleCommandArgs* args) {
         if (world) {
             // TODO: World names
             strcpy_s(world->name, array_count(world->name), args->args);
-            Drop(&context->world->entityTable);
-            PlatformFree(context->world, nullptr);
-            context->ui.selectedEntity = 0;
-            context->world = world;
+            ReplaceWorld(context, world);
         }
     }
 }
+
+void RendererBenchmarkCommand(Console* console, Context* context, ConsoleCommandArgs* args) {
+    u32 frameCount = 0;
+    const char* frameArg = PullCommandArg(args);
+    if (frameArg) {
+        auto parseResult = StringToInt(frameArg);
+        if (!parseResult.succeed || parseResult.value <= 0) {
+            LogMessage(console->logger, "Failed to parse a frame count\n");
+            return;
+        }
+        frameCount = (u32)parseResult.value;
+    }
+
+    // NOTE: Deferred to the render thread. Results are printed to stdout
+    if (!RequestRendererBenchmark(context, frameCount, false)) {
+        LogMessage(console->logger, "Failed to load the benchmark mesh\n");
+    }
+}
+
+void GoldenImagesCommand(Console* console, Context* context, ConsoleCommandArgs* args) {
+    bool record = false;
+    const char* modeArg = PullCommandArg(args);
+    if (modeArg) {
+        if (!StringsAreEqual(modeArg, "record")) {
+            LogMessage(console->logger, "Unknown mode %s\n", modeArg);
+            return;
+        }
+        record = true;
+    }
+
+    if (GoldenImagesRunning(context)) {
+        LogMessage(console->logger, "Golden images are already running\n");
+        return;
+    }
+
+    // NOTE: Results are printed to stdout and written to golden_images.csv
+    StartGoldenImages(context, record, false);
+}
+
+void OcclusionTestCommand(Console* console, Context* context, ConsoleCommandArgs* args) {
+    // NOTE: Deferred to the render thread. Results are printed to stdout
+    context->occlusionTest.active = true;
+}
+
+void GPUCullTestCommand(Console* console, Context* context, ConsoleCommandArgs* args) {
+    // NOTE: Deferred to the render thread. Results are printed to stdout
+    context->gpuCullTest.active = true;
+}
@@ -12,3 +12,7 @@ void ConsoleEchoCommand(Console* console, Context* context, ConsoleCommandArgs*
 void RecompileShadersCommand(Console* console, Context* context, ConsoleCommandArgs* args);
 void ToggleDebugOverlayCommand(Console* console, Context* context, ConsoleCommandArgs* args);
 void LoadCommand(Console* console, Context* context, ConsoleCommandArgs* args);
+void RendererBenchmarkCommand(Console* console, Context* context, ConsoleCommandArgs* args);
+void GoldenImagesCommand(Console* console, Context* context, ConsoleCommandArgs* args);
+void OcclusionTestCommand(Console* console, Context* context, ConsoleCommandArgs* args);
+void GPUCullTestCommand(Console* console, Context* context, ConsoleCommandArgs* args);
@@ -0,0 +1,123 @@
+#include "flux_debug_draw.h"
+
+f32 GetDebugLineBucketWidth(u32 bucket) {
+    return (f32)(1 << bucket);
+}
+
+u32 GetDebugLineBucket(f32 width) {
+    u32 result = 0;
+    if (width > 3.0f) {
+        result = 2;
+    } else if (width > 1.5f) {
+        result = 1;
+    }
+    return result;
+}
+
+u32 PackDebugLineColor(v3 color) {
+    u32 r = (u32)(Clamp(color.r, 0.0f, 1.0f) * 255.0f + 0.5f);
+    u32 g = (u32)(Clamp(color.g, 0.0f, 1.0f) * 255.0f + 0.5f);
+    u32 b = (u32)(Clamp(color.b, 0.0f, 1.0f) * 255.0f + 0.5f);
+    return r | (g << 8) | (b << 16) | (0xffu << 24);
+}
+
+// NOTE: Returns null if the bucket is full
+DebugLineVertex* PushDebugLineVertices(RenderGroup* group, f32 width, u32 count) {
+    DebugLineVertex* result = nullptr;
+    auto batch = &group->debugLines;
+    u32 bucket = GetDebugLineBucket(width);
+    if (batch->vertexCount[bucket] + count <= DebugLineBatch::MaxBucketVertices) {
+        result = batch->vertices[bucket] + batch->vertexCount[bucket];
+        batch->vertexCount[bucket] += count;
+    } else {
+        batch->overflow = true;
+    }
+    return result;
+}
+
+void DrawDebugLine(RenderGroup* group, v3 begin, v3 end, v3 color, f32 width) {
+    auto vertices = PushDebugLineVertices(group, width, 2);
+    if (vertices) {
+        u32 packed = PackDebugLineColor(color);
+        vertices[0] = { begin, packed };
+        vertices[1] = { end, packed };
+    }
+}
+
+// NOTE: Corner index bits are x, y, z. Bit set means max
+void DrawDebugBoxCorners(RenderGroup* group, const v3* corners, v3 color, f32 width) {
+    static const u8 edges[] = {
+        0, 1, 1, 5, 5, 4, 4, 0,
+        2, 3, 3, 7, 7, 6, 6, 2,
+        0, 2, 1, 3, 5, 7, 4, 6,
+    };
+    auto vertices = PushDebugLineVertices(group, width, array_count(edges));
+    if (vertices) {
+        u32 packed = PackDebugLineColor(color);
+        for (u32x i = 0; i < array_count(edges); i++) {
+            vertices[i] = { corners[edges[i]], packed };
+        }
+    }
+}
+
+void DrawDebugBox(RenderGroup* group, v3 min, v3 max, v3 color, f32 width) {
+    v3 corners[8];
+    for (u32x i = 0; i < 8; i++) {
+        corners[i] = V3((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+    }
+    DrawDebugBoxCorners(group, corners, color, width);
+}
+
+void DrawDebugBox(RenderGroup* group, const m4x4* transform, BBoxAligned box, v3 color, f32 width) {
+    v3 corners[8];
+    for (u32x i = 0; i < 8; i++) {
+        v3 p = V3((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+        corners[i] = (*transform * V4(p, 1.0f)).xyz;
+    }
+    DrawDebugBoxCorners(group, corners, color, width);
+}
+
+void DrawDebugAABB(RenderGroup* group, const m4x4* transform, BBoxAligned box, v3 color, f32 width) {
+    v3 min = V3(F32::Max);
+    v3 max = V3(-F32::Max);
+    for (u32x i = 0; i < 8; i++) {
+        v3 p = V3((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+        v3 w = (*transform * V4(p, 1.0f)).xyz;
+        min = V3(Min(min.x, w.x), Min(min.y, w.y), Min(min.z, w.z));
+        max = V3(Max(max.x, w.x), Max(max.y, w.y), Max(max.z, w.z));
+    }
+    DrawDebugBox(group, min, max, color, width);
+}
+
+void DrawDebugSphere(RenderGroup* group, v3 center, f32 radius, v3 color, f32 width) {
+    // NOTE: Three great circles
+    constexpr u32 SegmentCount = 32;
+    auto vertices = PushDebugLineVertices(group, width, SegmentCount * 2 * 3);
+    if (vertices) {
+        u32 packed = PackDebugLineColor(color);
+        f32 step = 2.0f * F32::Pi / (f32)SegmentCount;
+        u32 at = 0;
+        for (u32x i = 0; i < SegmentCount; i++) {
+            f32 s0 = Sin(step * i) * radius;
+            f32 c0 = Cos(step * i) * radius;
+            f32 s1 = Sin(step * (i + 1)) * radius;
+            f32 c1 = Cos(step * (i + 1)) * radius;
+            vertices[at++] = { center + V3(c0, s0, 0.0f), packed };
+            vertices[at++] = { center + V3(c1, s1, 0.0f), packed };
+            vertices[at++] = { center + V3(c0, 0.0f, s0), packed };
+            vertices[at++] = { center + V3(c1, 0.0f, s1), packed };
+            vertices[at++] = { center + V3(0.0f, c0, s0), packed };
+            vertices[at++] = { center + V3(0.0f, c1, s1), packed };
+        }
+    }
+}
+
+void DrawDebugFrustum(RenderGroup* group, const m4x4* invViewProj, v3 color, f32 width) {
+    v3 corners[8];
+    for (u32x i = 0; i < 8; i++) {
+        v4 ndc = V4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+        v4 p = *invViewProj * ndc;
+        corners[i] = p.xyz / p.w;
+    }
+    DrawDebugBoxCorners(group, corners, color, width);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+struct RenderGroup;
+
+struct DebugLineVertex {
+    v3 position;
+    // NOTE: RGBA8
+    u32 color;
+};
+
+// NOTE: Immediate mode debug lines. Segments are accumulated by the render group in buckets by width, since
+// line width is not a per vertex attribute, and the renderer uploads them to a single streaming buffer and
+// draws every bucket with one call after the scene
+struct DebugLineBatch {
+    static constexpr u32 WidthBucketCount = 3;
+    static constexpr u32 MaxBucketVertices = 65536;
+
+    DebugLineVertex* vertices[WidthBucketCount];
+    u32 vertexCount[WidthBucketCount];
+    b32 overflow;
+};
+
+// NOTE: Widths are snapped to the closest of 1, 2 and 4 pixels
+f32 GetDebugLineBucketWidth(u32 bucket);
+
+void DrawDebugLine(RenderGroup* group, v3 begin, v3 end, v3 color, f32 width = 1.0f);
+void DrawDebugBox(RenderGroup* group, v3 min, v3 max, v3 color, f32 width = 1.0f);
+// NOTE: Oriented box. Box corners are transformed
+void DrawDebugBox(RenderGroup* group, const m4x4* transform, BBoxAligned box, v3 color, f32 width = 1.0f);
+// NOTE: World space aligned box enclosing the transformed box
+void DrawDebugAABB(RenderGroup* group, const m4x4* transform, BBoxAligned box, v3 color, f32 width = 1.0f);
+void DrawDebugSphere(RenderGroup* group, v3 center, f32 radius, v3 color, f32 width = 1.0f);
+// NOTE: Draws the volume which maps to NDC cube by the inverse of this matrix
+void DrawDebugFrustum(RenderGroup* group, const m4x4* invViewProj, v3 color, f32 width = 1.0f);
@@ -47,16 +47,98 @@ void DebugOverlayEndCustom() {
     }
 }
 
-void DebugOverlayPushInternal(const char* string) {
-    if (GlobalDrawDebugOverlay) {
+void BeginDebugOverlayRecorder(DebugOverlayRecorder* recorder) {
+    assert(!GlobalDebugOverlayRecorder);
+    recorder->itemAt = 0;
+    GlobalDebugOverlayRecorder = recorder;
+}
+
+void EndDebugOverlayRecorder(DebugOverlayRecorder* recorder) {
+    assert(GlobalDebugOverlayRecorder == recorder);
+    recorder->itemCount = recorder->itemAt;
+    // NOTE: Edits of items which were not pushed this frame are dropped
+    recorder->editCount = 0;
+    GlobalDebugOverlayRecorder = nullptr;
+}
+
+void DrawDebugOverlayRecorder(DebugOverlayRecorder* recorder) {
+    if (GlobalDrawDebugOverlay && recorder->itemCount) {
         if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
-            ImGui::Separator();
-            ImGui::Text("%s", string);
+            for (u32 i = 0; i < recorder->itemCount; i++) {
+                auto item = recorder->items + i;
+                bool edited = false;
+                ImGui::Separator();
+                switch (item->type) {
+                case DebugOverlayRecorder::ItemType::String: { ImGui::Text("%s", item->text); } break;
+                case DebugOverlayRecorder::ItemType::SliderF32: { edited = ImGui::SliderFloat(item->text, item->f, item->min, item->max); } break;
+                case DebugOverlayRecorder::ItemType::SliderI32: { edited = ImGui::SliderInt(item->text, &item->i, (i32)item->min, (i32)item->max); } break;
+                case DebugOverlayRecorder::ItemType::SliderV3: { edited = ImGui::SliderFloat3(item->text, item->f, item->min, item->max); } break;
+                case DebugOverlayRecorder::ItemType::SliderV4: { edited = ImGui::SliderFloat4(item->text, item->f, item->min, item->max); } break;
+                case DebugOverlayRecorder::ItemType::Toggle: {
+                    bool value = item->b;
+                    edited = ImGui::Checkbox(item->text, &value);
+                    item->b = value;
+                } break;
+                invalid_default();
+                }
+                if (edited && (recorder->editCount < DebugOverlayRecorder::MaxEdits)) {
+                    recorder->edits[recorder->editCount++] = *item;
+                }
+            }
         }
         ImGui::End();
     }
 }
 
+DebugOverlayRecorder::Item* DebugOverlayRecordItem(DebugOverlayRecorder* recorder, DebugOverlayRecorder::ItemType type, const char* text) {
+    DebugOverlayRecorder::Item* result = nullptr;
+    if (recorder->itemAt < DebugOverlayRecorder::MaxItems) {
+        result = recorder->items + recorder->itemAt++;
+        result->type = type;
+        strncpy_s(result->text, array_count(result->text), text, array_count(result->text) - 1);
+    }
+    return result;
+}
+
+const DebugOverlayRecorder::Item* DebugOverlayFindEdit(DebugOverlayRecorder* recorder, DebugOverlayRecorder::ItemType type, const char* title) {
+    const DebugOverlayRecorder::Item* result = nullptr;
+    for (u32 i = 0; i < recorder->editCount; i++) {
+        auto edit = recorder->edits + i;
+        if ((edit->type == type) && (strcmp(edit->text, title) == 0)) {
+            result = edit;
+            break;
+        }
+    }
+    return result;
+}
+
+void DebugOverlayRecordSlider(DebugOverlayRecorder* recorder, DebugOverlayRecorder::ItemType type, const char* title, f32* values, u32 count, f32 min, f32 max) {
+    auto edit = DebugOverlayFindEdit(recorder, type, title);
+    if (edit) {
+        memcpy(values, edit->f, sizeof(f32) * count);
+    }
+    auto item = DebugOverlayRecordItem(recorder, type, title);
+    if (item) {
+        memcpy(item->f, values, sizeof(f32) * count);
+        item->min = min;
+        item->max = max;
+    }
+}
+
+void DebugOverlayPushInternal(const char* string) {
+    if (GlobalDrawDebugOverlay) {
+        if (GlobalDebugOverlayRecorder) {
+            DebugOverlayRecordItem(GlobalDebugOverlayRecorder, DebugOverlayRecorder::ItemType::String, string);
+        } else {
+            if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
+                ImGui::Separator();
+                ImGui::Text("%s", string);
+            }
+            ImGui::End();
+        }
+    }
+}
+
 void DebugOverlayPushString(const char* string) {
     DebugOverlayPushInternal(string);
 }
@@ -101,51 +183,88 @@ void DebugOverlayPushVar(const char* title, f32 var) {
 
 void DebugOverlayPushSlider(const char* title, f32* var, f32 min, f32 max) {
     if (GlobalDrawDebugOverlay) {
-        if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
-            ImGui::Separator();
-            ImGui::SliderFloat(title, var, min, max);
+        if (GlobalDebugOverlayRecorder) {
+            DebugOverlayRecordSlider(GlobalDebugOverlayRecorder, DebugOverlayRecorder::ItemType::SliderF32, title, var, 1, min, max);
+        } else {
+            if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
+                ImGui::Separator();
+                ImGui::SliderFloat(title, var, min, max);
+            }
+            ImGui::End();
         }
-        ImGui::End();
     }
 }
 
 void DebugOverlayPushSlider(const char* title, i32* var, i32 min, i32 max) {
     if (GlobalDrawDebugOverlay) {
-        if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
-            ImGui::Separator();
-            ImGui::SliderInt(title, var, min, max);
+        if (GlobalDebugOverlayRecorder) {
+            auto recorder = GlobalDebugOverlayRecorder;
+            auto edit = DebugOverlayFindEdit(recorder, DebugOverlayRecorder::ItemType::SliderI32, title);
+            if (edit) {
+                *var = edit->i;
+            }
+            auto item = DebugOverlayRecordItem(recorder, DebugOverlayRecorder::ItemType::SliderI32, title);
+            if (item) {
+                item->i = *var;
+                item->min = (f32)min;
+                item->max = (f32)max;
+            }
+        } else {
+            if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
+                ImGui::Separator();
+                ImGui::SliderInt(title, var, min, max);
+            }
+            ImGui::End();
         }
-        ImGui::End();
     }
 }
 
 void DebugOverlayPushSlider(const char* title, v3* var, f32 min, f32 max) {
     if (GlobalDrawDebugOverlay) {
-
-        if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
-            ImGui::Separator();
-            ImGui::SliderFloat3(title, var->data, min, max);
+        if (GlobalDebugOverlayRecorder) {
+            DebugOverlayRecordSlider(GlobalDebugOverlayRecorder, DebugOverlayRecorder::ItemType::SliderV3, title, var->data, 3, min, max);
+        } else {
+            if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
+                ImGui::Separator();
+                ImGui::SliderFloat3(title, var->data, min, max);
+            }
+            ImGui::End();
         }
-        ImGui::End();
     }
 }
 
 void DebugOverlayPushSlider(const char* title, v4* var, f32 min, f32 max) {
     if (GlobalDrawDebugOverlay) {
-        if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
-            ImGui::Separator();
-            ImGui::SliderFloat4(title, var->data, min, max);
+        if (GlobalDebugOverlayRecorder) {
+            DebugOverlayRecordSlider(GlobalDebugOverlayRecorder, DebugOverlayRecorder::ItemType::SliderV4, title, var->data, 4, min, max);
+        } else {
+            if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
+                ImGui::Separator();
+                ImGui::SliderFloat4(title, var->data, min, max);
+            }
+            ImGui::End();
         }
-        ImGui::End();
     }
 }
 
 void DebugOverlayPushToggle(const char* title, bool* var) {
     if (GlobalDrawDebugOverlay) {
-        if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
-            ImGui::Separator();
-            ImGui::Checkbox(title, var);
+        if (GlobalDebugOverlayRecorder) {
+            auto recorder = GlobalDebugOverlayRecorder;
+            auto edit = DebugOverlayFindEdit(recorder, DebugOverlayRecorder::ItemType::Toggle, title);
+            if (edit) {
+                *var = edit->b;
+            }
+            auto item = DebugOverlayRecordItem(recorder, DebugOverlayRecorder::ItemType::Toggle, title);
+            if (item) {
+                item->b = *var;
+            }
+        } else {
+            if (ImGui::Begin("Debug overlay", nullptr, DebugOverlayFlags)) {
+                ImGui::Separator();
+                ImGui::Checkbox(title, var);
+            }
+            ImGui::End();
         }
-        ImGui::End();
     }
 }
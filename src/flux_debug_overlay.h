@@ -3,6 +3,46 @@
 
 b32 GlobalDrawDebugOverlay = false;
 
+// NOTE: Overlay items pushed on the render thread. ImGui is used only on the main thread, so the render thread
+// records items with copies of their values and the main thread draws them when it gets the same frame packet
+// again. Values edited there are stored as edits which are applied by the next push with the same title, so
+// variables may live on the stack
+struct DebugOverlayRecorder {
+    static constexpr u32 MaxItems = 128;
+    static constexpr u32 MaxEdits = 16;
+
+    enum struct ItemType : u32 {
+        String, SliderF32, SliderI32, SliderV3, SliderV4, Toggle
+    };
+
+    struct Item {
+        ItemType type;
+        // NOTE: Title for widgets, formatted value for strings
+        char text[128];
+        union {
+            f32 f[4];
+            i32 i;
+            b32 b;
+        };
+        f32 min;
+        f32 max;
+    };
+
+    Item items[MaxItems];
+    u32 itemCount;
+    u32 itemAt;
+    Item edits[MaxEdits];
+    u32 editCount;
+};
+
+// NOTE: Pushes on this thread go to the recorder between begin and end
+thread_local DebugOverlayRecorder* GlobalDebugOverlayRecorder = nullptr;
+
+void BeginDebugOverlayRecorder(DebugOverlayRecorder* recorder);
+void EndDebugOverlayRecorder(DebugOverlayRecorder* recorder);
+// NOTE: Main thread only
+void DrawDebugOverlayRecorder(DebugOverlayRecorder* recorder);
+
 void DrawDebugPerformanceCounters();
 void BeginDebugOverlay();
 bool DebugOverlayBeginCustom();
@@ -10,7 +10,7 @@ struct FluxVector3 {
 struct FluxFileHeader {
     static const u32 MagicValue = 0xffaabbcc;
     u32 magicValue = MagicValue;
-    enum : u32 { Mesh } type;
+    enum : u32 { Mesh, TextureCache, SHCache, ProgramCache } type;
 };
 
 struct FluxMeshEntry {
@@ -40,4 +40,48 @@ struct FluxMeshHeader {
     u32 dataSize;
     char name[128];
 };
+// NOTE: Texture data generated on GPU and cached on disk.
+// Levels are stored one after another starting from the base level,
+// each level contains all the faces of the texture.
+struct FluxTextureCacheHeader {
+    FluxFileHeader header;
+    u32 version = 1;
+    u64 key;
+    u32 format;
+    u32 width;
+    u32 height;
+    u32 faceCount;
+    u32 levelCount;
+    u32 data;
+    u32 dataSize;
+};
+
+struct FluxSHCacheHeader {
+    FluxFileHeader header;
+    u32 version = 1;
+    u64 key;
+    FluxVector3 coeffs[9];
+};
+
+struct FluxProgramCacheEntry {
+    u64 sourceKey;
+    u32 program;
+    u32 permutation;
+    u32 binaryFormat;
+    u32 offset;
+    u32 size;
+};
+
+// NOTE: Linked program binaries. Binaries are only valid for the driver they were
+// produced by, so the whole file is discarded when driverKey does not match.
+// Entry and binary offsets are relative to the beginning of the file.
+struct FluxProgramCacheHeader {
+    FluxFileHeader header;
+    u32 version = 2;
+    u64 driverKey;
+    u32 entryCount;
+    u32 entries;
+    u32 data;
+    u32 dataSize;
+};
 #pragma pack(pop)
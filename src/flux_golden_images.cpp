@@ -0,0 +1,481 @@
+#include "flux_golden_images.h"
+
+// NOTE: Positions are in the units of the worlds, so paths should be revised and references recorded again if a world is rescaled
+static const GoldenImageTest GoldenImageTests[] = {
+    {
+        "sponza", L"../res/sponza/sponza.world", 4,
+        {
+            { V3(-10.0f, 2.0f, 0.0f), V3(10.0f, 3.0f, 0.0f) },
+            { V3(10.0f, 6.0f, -3.0f), V3(-10.0f, 2.0f, 2.0f) },
+            { V3(-8.0f, 1.5f, 4.0f), V3(-8.0f, 2.5f, -4.0f) },
+            { V3(0.0f, 12.0f, 1.0f), V3(0.0f, 0.0f, 0.0f) },
+        }
+    },
+    {
+        "room", L"../res/room/room.world", 3,
+        {
+            { V3(0.0f, 2.0f, 5.0f), V3(0.0f, 1.0f, 0.0f) },
+            { V3(4.0f, 3.0f, -3.0f), V3(0.0f, 1.0f, 0.0f) },
+            { V3(-3.0f, 1.5f, 2.0f), V3(2.0f, 1.0f, -2.0f) },
+        }
+    },
+};
+
+// NOTE: Uncompressed 32 bit TGA with the origin in the lower left corner, so rows are in the GL order
+#pragma pack(push, 1)
+struct GoldenImageFileHeader {
+    u8 idLength;
+    u8 colorMapType;
+    u8 imageType;
+    u8 colorMapSpec[5];
+    u16 originX;
+    u16 originY;
+    u16 width;
+    u16 height;
+    u8 bitsPerPixel;
+    u8 descriptor;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(GoldenImageFileHeader) == 18);
+
+static void ReportGoldenImages(GoldenImageHarness* harness, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    i32 size = vsnprintf(harness->report + harness->reportSize, GoldenImageHarness::MaxReportSize - harness->reportSize, fmt, args);
+    va_end(args);
+    if (size > 0) {
+        harness->reportSize = Min(harness->reportSize + (u32)size, GoldenImageHarness::MaxReportSize - 1);
+    }
+}
+
+static void GetGoldenImagePath(wchar_t* buffer, u32 bufferCount, const char* fmt, const char* testName, u32 shotIndex) {
+    char path[256];
+    snprintf(path, array_count(path), fmt, testName, shotIndex);
+    mbstowcs(buffer, path, bufferCount);
+}
+
+// NOTE: Images are RGBA, files are BGRA
+static bool WriteGoldenImage(const wchar_t* filename, const byte* pixels, u32 width, u32 height) {
+    u32 pixelCount = width * height;
+    u32 fileSize = sizeof(GoldenImageFileHeader) + pixelCount * 4;
+    auto file = (byte*)PlatformAlloc(fileSize, 0, nullptr);
+    defer { PlatformFree(file, nullptr); };
+
+    auto header = (GoldenImageFileHeader*)file;
+    *header = {};
+    header->imageType = 2;
+    header->width = (u16)width;
+    header->height = (u16)height;
+    header->bitsPerPixel = 32;
+    header->descriptor = 8;
+
+    byte* data = file + sizeof(GoldenImageFileHeader);
+    for (u32 i = 0; i < pixelCount; i++) {
+        data[i * 4 + 0] = pixels[i * 4 + 2];
+        data[i * 4 + 1] = pixels[i * 4 + 1];
+        data[i * 4 + 2] = pixels[i * 4 + 0];
+        data[i * 4 + 3] = 255;
+    }
+    return PlatformDebugWriteFile(filename, file, fileSize);
+}
+
+static bool ReadGoldenImage(const wchar_t* filename, byte* pixels, u32 width, u32 height) {
+    bool result = false;
+    u32 pixelCount = width * height;
+    u32 fileSize = PlatformDebugGetFileSize(filename);
+    if (fileSize == sizeof(GoldenImageFileHeader) + pixelCount * 4) {
+        auto file = (byte*)PlatformAlloc(fileSize, 0, nullptr);
+        defer { PlatformFree(file, nullptr); };
+        if (PlatformDebugReadFile(file, fileSize, filename) == fileSize) {
+            auto header = (GoldenImageFileHeader*)file;
+            if (header->imageType == 2 && header->bitsPerPixel == 32 && header->width == width && header->height == height && !(header->descriptor & 0x20)) {
+                byte* data = file + sizeof(GoldenImageFileHeader) + header->idLength;
+                for (u32 i = 0; i < pixelCount; i++) {
+                    pixels[i * 4 + 0] = data[i * 4 + 2];
+                    pixels[i * 4 + 1] = data[i * 4 + 1];
+                    pixels[i * 4 + 2] = data[i * 4 + 0];
+                    pixels[i * 4 + 3] = data[i * 4 + 3];
+                }
+                result = true;
+            }
+        }
+    }
+    return result;
+}
+
+inline f64 GoldenImageLuma(const byte* pixel) {
+    return 0.299 * pixel[0] + 0.587 * pixel[1] + 0.114 * pixel[2];
+}
+
+// NOTE: PSNR of the RGB channels and SSIM of the luma. SSIM is computed over non-overlapping tiles and averaged
+// [ Wang et al., Image Quality Assessment: From Error Visibility to Structural Similarity ]
+// Heatmap is the image in grayscale tinted from green to red by the tile error, where red is the MinTileSSIM limit
+GoldenImageMetrics CompareGoldenImages(const byte* image, const byte* reference, u32 width, u32 height, byte* heatmap) {
+    constexpr f64 MaxPSNR = 100.0;
+    constexpr f64 C1 = (0.01 * 255.0) * (0.01 * 255.0);
+    constexpr f64 C2 = (0.03 * 255.0) * (0.03 * 255.0);
+    constexpr u32 TileSize = GoldenImageHarness::TileSize;
+
+    GoldenImageMetrics metrics = {};
+    metrics.worstTileSSIM = 1.0;
+    f64 squaredError = 0.0;
+    f64 ssimSum = 0.0;
+    u32 tileCount = 0;
+
+    for (u32 tileY = 0; tileY < height; tileY += TileSize) {
+        for (u32 tileX = 0; tileX < width; tileX += TileSize) {
+            u32 endX = Min(tileX + TileSize, width);
+            u32 endY = Min(tileY + TileSize, height);
+            f64 sumA = 0.0, sumB = 0.0, sumAA = 0.0, sumBB = 0.0, sumAB = 0.0;
+            for (u32 y = tileY; y < endY; y++) {
+                for (u32 x = tileX; x < endX; x++) {
+                    const byte* a = image + (y * width + x) * 4;
+                    const byte* b = reference + (y * width + x) * 4;
+                    for (u32 c = 0; c < 3; c++) {
+                        f64 d = (f64)a[c] - (f64)b[c];
+                        squaredError += d * d;
+                    }
+                    f64 lumaA = GoldenImageLuma(a);
+                    f64 lumaB = GoldenImageLuma(b);
+                    sumA += lumaA;
+                    sumB += lumaB;
+                    sumAA += lumaA * lumaA;
+                    sumBB += lumaB * lumaB;
+                    sumAB += lumaA * lumaB;
+                }
+            }
+
+            f64 n = (f64)((endX - tileX) * (endY - tileY));
+            f64 meanA = sumA / n;
+            f64 meanB = sumB / n;
+            f64 varianceA = sumAA / n - meanA * meanA;
+            f64 varianceB = sumBB / n - meanB * meanB;
+            f64 covariance = sumAB / n - meanA * meanB;
+            f64 ssim = ((2.0 * meanA * meanB + C1) * (2.0 * covariance + C2)) / ((meanA * meanA + meanB * meanB + C1) * (varianceA + varianceB + C2));
+
+            ssimSum += ssim;
+            tileCount++;
+            metrics.worstTileSSIM = Min(metrics.worstTileSSIM, ssim);
+            if (ssim < GoldenImageHarness::MinTileSSIM) {
+                metrics.failedTileCount++;
+            }
+
+            if (heatmap) {
+                f64 t = Clamp((1.0 - ssim) / (1.0 - GoldenImageHarness::MinTileSSIM), 0.0, 1.0);
+                for (u32 y = tileY; y < endY; y++) {
+                    for (u32 x = tileX; x < endX; x++) {
+                        u32 at = (y * width + x) * 4;
+                        f64 gray = GoldenImageLuma(image + at) * 0.5;
+                        heatmap[at + 0] = (byte)(gray + t * 127.0);
+                        heatmap[at + 1] = (byte)(gray + (1.0 - t) * 127.0);
+                        heatmap[at + 2] = (byte)gray;
+                        heatmap[at + 3] = 255;
+                    }
+                }
+            }
+        }
+    }
+
+    f64 mse = squaredError / ((f64)width * (f64)height * 3.0);
+    metrics.psnr = mse > 0.0 ? Min(10.0 * log10(255.0 * 255.0 / mse), MaxPSNR) : MaxPSNR;
+    metrics.ssim = tileCount ? ssimSum / (f64)tileCount : 1.0;
+    return metrics;
+}
+
+// NOTE: Test worlds are freed, the world of the game is kept for the end
+static void SetGoldenImageWorld(Context* context, GoldenImageHarness* harness, World* world) {
+    if (context->world == harness->savedWorld) {
+        SwapWorld(context, world);
+    } else {
+        ReplaceWorld(context, world);
+    }
+}
+
+static void FinishGoldenImages(Context* context, GoldenImageHarness* harness) {
+    SetGoldenImageWorld(context, harness, harness->savedWorld);
+    harness->savedWorld = nullptr;
+    harness->state = GoldenImageHarness::State::Idle;
+
+    const wchar_t* reportFile = L"golden_images.csv";
+    bool reportWritten = PlatformDebugWriteFile(reportFile, harness->report, harness->reportSize);
+    if (!reportWritten) {
+        printf("[Golden] Failed to write %ls\n", reportFile);
+    }
+    if (harness->record) {
+        printf("[Golden] Done. %u references recorded, %u failed\n", harness->passCount, harness->failCount);
+    } else {
+        printf("[Golden] Done. %u passed, %u failed, %u skipped without references. Results are in %ls\n", harness->passCount, harness->failCount, harness->missingCount, reportFile);
+    }
+
+    // NOTE: Shots without a reference are skipped until one is recorded, so new shots do not fail the run
+    if (harness->quitWhenDone) {
+        bool passed = reportWritten && !harness->failCount;
+        PlatformQuit(passed ? 0 : 1);
+    }
+}
+
+// NOTE: Loads the current test world or the first one of the following tests which loads
+static void StartGoldenImageTest(Context* context, GoldenImageHarness* harness) {
+    while (harness->testIndex < array_count(GoldenImageTests)) {
+        auto test = GoldenImageTests + harness->testIndex;
+        auto world = LoadWorldFromDisc(&context->assetManager, test->world);
+        if (world) {
+            SetGoldenImageWorld(context, harness, world);
+            harness->state = GoldenImageHarness::State::Holding;
+            harness->shotIndex = 0;
+            harness->stateFrame = 0;
+            harness->settledFrames = 0;
+            harness->testCPUMs = 0.0;
+            harness->testGPUMs = 0.0;
+            printf("[Golden] %s: %u shots\n", test->name, test->shotCount);
+            return;
+        }
+        printf("[Golden] %s: failed to load world %ls\n", test->name, test->world);
+        ReportGoldenImages(harness, "%s,,,,,,,,world not loaded\n", test->name);
+        harness->failCount += test->shotCount;
+        harness->testIndex++;
+    }
+    FinishGoldenImages(context, harness);
+}
+
+static void FinishGoldenImageShot(GoldenImageHarness* harness, const GoldenImageTest* test) {
+    constexpr u32 ImageSize = GoldenImageHarness::Width * GoldenImageHarness::Height * 4;
+    u32 width = GoldenImageHarness::Width;
+    u32 height = GoldenImageHarness::Height;
+    u32 shotIndex = harness->shotIndex;
+    const char* loads = harness->loadsPending ? ", loads were pending" : "";
+
+    harness->testCPUMs += harness->cpuMs;
+    harness->testGPUMs += harness->gpuMs;
+
+    wchar_t referencePath[256];
+    GetGoldenImagePath(referencePath, array_count(referencePath), "../res/golden/%s_%u.tga", test->name, shotIndex);
+
+    if (harness->record) {
+        if (WriteGoldenImage(referencePath, harness->pixels, width, height)) {
+            harness->passCount++;
+            printf("[Golden] %s %u: recorded, cpu %.3f ms, gpu %.3f ms%s\n", test->name, shotIndex, harness->cpuMs, harness->gpuMs, loads);
+            ReportGoldenImages(harness, "%s,%u,,,,,%.3f,%.3f,recorded\n", test->name, shotIndex, harness->cpuMs, harness->gpuMs);
+        } else {
+            harness->failCount++;
+            printf("[Golden] %s %u: failed to write %ls\n", test->name, shotIndex, referencePath);
+            ReportGoldenImages(harness, "%s,%u,,,,,%.3f,%.3f,not written\n", test->name, shotIndex, harness->cpuMs, harness->gpuMs);
+        }
+        return;
+    }
+
+    auto reference = (byte*)PlatformAlloc(ImageSize, 0, nullptr);
+    auto heatmap = (byte*)PlatformAlloc(ImageSize, 0, nullptr);
+    defer { PlatformFree(reference, nullptr); PlatformFree(heatmap, nullptr); };
+
+    wchar_t imagePath[256];
+    GetGoldenImagePath(imagePath, array_count(imagePath), "golden_%s_%u.tga", test->name, shotIndex);
+
+    if (!ReadGoldenImage(referencePath, reference, width, height)) {
+        harness->missingCount++;
+        WriteGoldenImage(imagePath, harness->pixels, width, height);
+        printf("[Golden] %s %u: skipped, no reference, image is written to %ls. cpu %.3f ms, gpu %.3f ms%s\n", test->name, shotIndex, imagePath, harness->cpuMs, harness->gpuMs, loads);
+        ReportGoldenImages(harness, "%s,%u,,,,,%.3f,%.3f,skipped\n", test->name, shotIndex, harness->cpuMs, harness->gpuMs);
+        return;
+    }
+
+    auto metrics = CompareGoldenImages(harness->pixels, reference, width, height, heatmap);
+    bool passed = metrics.psnr >= GoldenImageHarness::MinPSNR && metrics.ssim >= GoldenImageHarness::MinSSIM && !metrics.failedTileCount;
+    if (passed) {
+        harness->passCount++;
+    } else {
+        harness->failCount++;
+        wchar_t heatmapPath[256];
+        GetGoldenImagePath(heatmapPath, array_count(heatmapPath), "golden_%s_%u_heatmap.tga", test->name, shotIndex);
+        WriteGoldenImage(imagePath, harness->pixels, width, height);
+        WriteGoldenImage(heatmapPath, heatmap, width, height);
+    }
+
+    printf("[Golden] %s %u: PSNR %6.2f dB, SSIM %.4f, worst tile %.4f, %u failed tiles, cpu %.3f ms, gpu %.3f ms - %s%s\n",
+           test->name, shotIndex, metrics.psnr, metrics.ssim, metrics.worstTileSSIM, metrics.failedTileCount,
+           harness->cpuMs, harness->gpuMs, passed ? "pass" : "FAIL", loads);
+    ReportGoldenImages(harness, "%s,%u,%.3f,%.5f,%.5f,%u,%.3f,%.3f,%s\n", test->name, shotIndex, metrics.psnr, metrics.ssim,
+                       metrics.worstTileSSIM, metrics.failedTileCount, harness->cpuMs, harness->gpuMs, passed ? "pass" : "fail");
+}
+
+void StartGoldenImages(Context* context, bool record, bool quitWhenDone) {
+    if (!context->goldenImages) {
+        auto harness = (GoldenImageHarness*)PlatformAlloc(sizeof(GoldenImageHarness), 0, nullptr);
+        *harness = {};
+        harness->pixels = (byte*)PlatformAlloc(GoldenImageHarness::Width * GoldenImageHarness::Height * 4, 0, nullptr);
+        context->goldenImages = harness;
+    }
+
+    auto harness = context->goldenImages;
+    harness->record = record;
+    harness->quitWhenDone = quitWhenDone;
+    harness->testIndex = 0;
+    harness->passCount = 0;
+    harness->failCount = 0;
+    harness->missingCount = 0;
+    harness->reportSize = 0;
+    harness->savedWorld = context->world;
+    ReportGoldenImages(harness, "test,shot,psnr,ssim,worst_tile_ssim,failed_tiles,cpu_ms,gpu_ms,result\n");
+
+    printf("[Golden] %s golden images: %ux%u, %u tests\n", record ? "Recording" : "Comparing", GoldenImageHarness::Width, GoldenImageHarness::Height, (u32)array_count(GoldenImageTests));
+    StartGoldenImageTest(context, harness);
+}
+
+bool GoldenImagesRunning(Context* context) {
+    return context->goldenImages && context->goldenImages->state != GoldenImageHarness::State::Idle;
+}
+
+void UpdateGoldenImages(Context* context, FramePacket* packet) {
+    auto harness = context->goldenImages;
+    packet->goldenImageRequest = {};
+    if (!harness || harness->state == GoldenImageHarness::State::Idle) {
+        return;
+    }
+
+    auto test = GoldenImageTests + harness->testIndex;
+    auto shot = test->shots + harness->shotIndex;
+    auto request = &packet->goldenImageRequest;
+    request->active = true;
+
+    v3 position = shot->position;
+    v3 target = shot->target;
+    bool loadsPending = HasPendingLoads(&context->assetManager);
+
+    switch (harness->state) {
+    case GoldenImageHarness::State::Moving: {
+        harness->stateFrame++;
+        f32 t = (f32)harness->stateFrame / (f32)GoldenImageHarness::TransitionFrames;
+        position = Lerp(harness->fromPosition, shot->position, t);
+        target = Lerp(harness->fromTarget, shot->target, t);
+        if (harness->stateFrame == GoldenImageHarness::TransitionFrames) {
+            harness->state = GoldenImageHarness::State::Holding;
+            harness->stateFrame = 0;
+            harness->settledFrames = 0;
+        }
+    } break;
+    case GoldenImageHarness::State::Holding: {
+        harness->stateFrame++;
+        harness->settledFrames = loadsPending ? 0 : harness->settledFrames + 1;
+        if (harness->settledFrames == GoldenImageHarness::SettleFrames || harness->stateFrame == GoldenImageHarness::MaxHoldFrames) {
+            harness->state = GoldenImageHarness::State::Timing;
+            harness->stateFrame = 0;
+            harness->loadsPending = false;
+        }
+    } break;
+    case GoldenImageHarness::State::Timing: {
+        request->timed = true;
+        request->timedFrame = harness->stateFrame;
+        request->capture = harness->stateFrame == GoldenImageHarness::TimedFrames - 1;
+        harness->loadsPending |= loadsPending;
+        harness->stateFrame++;
+        if (request->capture) {
+            harness->state = GoldenImageHarness::State::Waiting;
+        }
+    } break;
+    case GoldenImageHarness::State::Waiting: {
+        if (AtomicLoad(&harness->resultReady)) {
+            AtomicExchange(&harness->resultReady, 0);
+            FinishGoldenImageShot(harness, test);
+
+            harness->fromPosition = shot->position;
+            harness->fromTarget = shot->target;
+            harness->shotIndex++;
+            harness->stateFrame = 0;
+            if (harness->shotIndex < test->shotCount) {
+                harness->state = GoldenImageHarness::State::Moving;
+            } else {
+                printf("[Golden] %s: average cpu %.3f ms, gpu %.3f ms\n", test->name, harness->testCPUMs / (f64)test->shotCount, harness->testGPUMs / (f64)test->shotCount);
+                harness->testIndex++;
+                StartGoldenImageTest(context, harness);
+            }
+        }
+    } break;
+    invalid_default();
+    }
+
+    auto camera = &harness->camera;
+    camera->position = position;
+    camera->front = Normalize(position - target);
+    camera->aspectRatio = (f32)GoldenImageHarness::Width / (f32)GoldenImageHarness::Height;
+    camera->viewMatrix = LookAtGLRH(camera->position, camera->front, V3(0.0f, 1.0f, 0.0f));
+    camera->projectionMatrix = PerspectiveGLRH(camera->nearPlane, camera->farPlane, camera->fovDeg, camera->aspectRatio);
+    camera->invViewMatrix = Inverse(camera->viewMatrix);
+    camera->invProjectionMatrix = Inverse(camera->projectionMatrix);
+
+    packet->camera = *camera;
+    packet->group.camera = &packet->camera;
+    packet->renderResolution = UV2(GoldenImageHarness::Width, GoldenImageHarness::Height);
+    packet->sampleCount = Min(GoldenImageHarness::SampleCount, GetRenderMaxSampleCount(context->renderer));
+}
+
+static void PollGoldenImageReadback(GoldenImageHarness* harness) {
+    constexpr u32 ImageSize = GoldenImageHarness::Width * GoldenImageHarness::Height * 4;
+    if (harness->readbackFence) {
+        GLenum status = glClientWaitSync(harness->readbackFence, 0, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            glDeleteSync(harness->readbackFence);
+            harness->readbackFence = 0;
+
+            void* data = glMapNamedBufferRange(harness->readbackBuffer, 0, ImageSize, GL_MAP_READ_BIT);
+            if (data) {
+                memcpy(harness->pixels, data, ImageSize);
+                glUnmapNamedBuffer(harness->readbackBuffer);
+            } else {
+                memset(harness->pixels, 0, ImageSize);
+            }
+
+            // NOTE: Timestamps were written before the fence, so results are available
+            u64 gpuNanoseconds = 0;
+            for (u32 i = 0; i < GoldenImageHarness::TimedFrames; i++) {
+                GLuint64 begin = 0;
+                GLuint64 end = 0;
+                glGetQueryObjectui64v(harness->timerQueries[i * 2], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(harness->timerQueries[i * 2 + 1], GL_QUERY_RESULT, &end);
+                gpuNanoseconds += end - begin;
+            }
+            harness->gpuMs = (f64)gpuNanoseconds / 1000000.0 / (f64)GoldenImageHarness::TimedFrames;
+
+            AtomicExchange(&harness->resultReady, 1);
+        }
+    }
+}
+
+void BeginGoldenImageFrame(GoldenImageHarness* harness, Renderer* renderer, GoldenImageRequest* request) {
+    if (!harness->outputTarget) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &harness->outputTarget);
+        glTextureStorage2D(harness->outputTarget, 1, GL_RGBA8, GoldenImageHarness::Width, GoldenImageHarness::Height);
+        glCreateBuffers(1, &harness->readbackBuffer);
+        glNamedBufferStorage(harness->readbackBuffer, GoldenImageHarness::Width * GoldenImageHarness::Height * 4, nullptr, GL_MAP_READ_BIT);
+        glGenQueries(array_count(harness->timerQueries), harness->timerQueries);
+    }
+
+    PollGoldenImageReadback(harness);
+    SetOutputTarget(renderer, harness->outputTarget);
+
+    if (request->timed) {
+        if (request->timedFrame == 0) {
+            harness->cpuTicks = 0;
+        }
+        glQueryCounter(harness->timerQueries[request->timedFrame * 2], GL_TIMESTAMP);
+        harness->frameBeginTicks = GetTimeStamp();
+    }
+}
+
+void EndGoldenImageFrame(GoldenImageHarness* harness, Renderer* renderer, GoldenImageRequest* request) {
+    if (request->timed) {
+        harness->cpuTicks += GetTimeStamp() - harness->frameBeginTicks;
+        glQueryCounter(harness->timerQueries[request->timedFrame * 2 + 1], GL_TIMESTAMP);
+    }
+
+    if (request->capture) {
+        harness->cpuMs = (f64)harness->cpuTicks * 1000.0 / (f64)GetTicksPerSecond() / (f64)GoldenImageHarness::TimedFrames;
+        // NOTE: Copy to the pack buffer is queued and the image is picked up by a later frame once the fence is signaled
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, harness->readbackBuffer);
+        glGetTextureImage(harness->outputTarget, 0, GL_RGBA, GL_UNSIGNED_BYTE, GoldenImageHarness::Width * GoldenImageHarness::Height * 4, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        harness->readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    SetOutputTarget(renderer, 0);
+}
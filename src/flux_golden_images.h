@@ -0,0 +1,116 @@
+#pragma once
+#include "flux_camera.h"
+
+struct Context;
+struct Renderer;
+struct World;
+struct FramePacket;
+
+// NOTE: Carried to the render thread by the frame packet. Frames of the harness are drawn offscreen at a fixed resolution
+struct GoldenImageRequest {
+    b32 active;
+    // NOTE: Timed frames of a shot are numbered from zero, the render thread starts over at zero
+    b32 timed;
+    u32 timedFrame;
+    // NOTE: Last timed frame of a shot. Its image is read back
+    b32 capture;
+};
+
+// NOTE: Camera looks from position at target
+struct GoldenImageShot {
+    v3 position;
+    v3 target;
+};
+
+// NOTE: World and the camera path flown through it. Every keyframe of the path is a shot
+struct GoldenImageTest {
+    static constexpr u32 MaxShots = 8;
+    const char* name;
+    const wchar_t* world;
+    u32 shotCount;
+    GoldenImageShot shots[MaxShots];
+};
+
+struct GoldenImageMetrics {
+    f64 psnr;
+    f64 ssim;
+    f64 worstTileSSIM;
+    u32 failedTileCount;
+};
+
+// NOTE: Image regression harness. Loads the test worlds one by one, flies the camera through their paths and at every
+// shot waits until the assets are loaded and the frame is stable, times a few frames and reads the last one back
+// with a pixel pack buffer. Images are compared with the references in ../res/golden by PSNR and SSIM. SSIM is
+// computed per tile and failed shots get a heatmap of the tiles written next to the image. Frame timings of every shot
+// go to the report, so a performance change comes with a quality verdict.
+// References are recorded with the same harness, see golden_images console command
+struct GoldenImageHarness {
+    static constexpr u32 Width = 1280;
+    static constexpr u32 Height = 720;
+    static constexpr u32 SampleCount = 4;
+    // NOTE: Frames of the flight from one shot to the next
+    static constexpr u32 TransitionFrames = 45;
+    // NOTE: Frames without pending loads before timing starts. Covers the depth history and static shadow caches
+    static constexpr u32 SettleFrames = 16;
+    // NOTE: Shot is taken anyway after that many frames. Such shots are marked in the report
+    static constexpr u32 MaxHoldFrames = 600;
+    static constexpr u32 TimedFrames = 16;
+    static constexpr u32 TileSize = 16;
+    static constexpr f64 MinPSNR = 35.0;
+    static constexpr f64 MinSSIM = 0.98;
+    static constexpr f64 MinTileSSIM = 0.8;
+    static constexpr u32 MaxReportSize = 64 * 1024;
+
+    enum struct State : u32 {
+        Idle, Moving, Holding, Timing, Waiting
+    };
+
+    // NOTE: Update thread
+    State state;
+    b32 record;
+    // NOTE: Automated run. The process exits when all tests are done, with nonzero code if any shot failed or had no reference
+    b32 quitWhenDone;
+    u32 testIndex;
+    u32 shotIndex;
+    u32 stateFrame;
+    u32 settledFrames;
+    b32 loadsPending;
+    // NOTE: World of the game. Test worlds replace it while the harness runs
+    World* savedWorld;
+    CameraBase camera;
+    v3 fromPosition;
+    v3 fromTarget;
+    u32 passCount;
+    u32 failCount;
+    u32 missingCount;
+    char report[MaxReportSize];
+    u32 reportSize;
+    f64 testCPUMs;
+    f64 testGPUMs;
+
+    // NOTE: Render thread
+    GLuint outputTarget;
+    GLuint readbackBuffer;
+    GLuint timerQueries[TimedFrames * 2];
+    GLsync readbackFence;
+    u64 frameBeginTicks;
+    u64 cpuTicks;
+
+    // NOTE: Written by the render thread before resultReady is set, read by the update thread after
+    u32 volatile resultReady;
+    byte* pixels;
+    f64 cpuMs;
+    f64 gpuMs;
+};
+
+// NOTE: Update thread. Record overwrites the references
+void StartGoldenImages(Context* context, bool record, bool quitWhenDone);
+bool GoldenImagesRunning(Context* context);
+// NOTE: Called after the packet is filled, overrides its camera, resolution and request
+void UpdateGoldenImages(Context* context, FramePacket* packet);
+
+// NOTE: Render thread, around the frame of the packet with an active request
+void BeginGoldenImageFrame(GoldenImageHarness* harness, Renderer* renderer, GoldenImageRequest* request);
+void EndGoldenImageFrame(GoldenImageHarness* harness, Renderer* renderer, GoldenImageRequest* request);
+
+GoldenImageMetrics CompareGoldenImages(const byte* image, const byte* reference, u32 width, u32 height, byte* heatmap);
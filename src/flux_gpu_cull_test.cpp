@@ -0,0 +1,228 @@
+#include "flux_gpu_cull_test.h"
+
+// NOTE: Boxes of the test. Camera matrix is identity, so clip space is world space and depth is z * 0.5 + 0.5
+struct GPUCullTestBox {
+    v3 position;
+    b32 dynamic;
+    // NOTE: Expected results
+    b32 inFrustum;
+    // NOTE: Behind the depth of the occluder plane
+    b32 behindOccluder;
+};
+
+static const GPUCullTestBox GPUCullTestBoxes[] = {
+    { V3(-0.5f, 0.0f, -0.8f), false, true, false },
+    { V3(0.5f, 0.5f, -0.6f), true, true, false },
+    { V3(0.0f, 0.0f, 0.6f), false, true, true },
+    { V3(-0.5f, -0.5f, 0.8f), true, true, true },
+    { V3(3.0f, 0.0f, 0.0f), false, false, false },
+    { V3(0.0f, -3.0f, 0.0f), true, false, false },
+    { V3(0.0f, 0.0f, 3.0f), false, false, false },
+};
+
+struct GPUCullTest {
+    static constexpr u32 InstanceCount = array_count(GPUCullTestBoxes);
+    static constexpr u32 CommandCount = 3;
+    static constexpr u32 DepthSize = 64;
+    static constexpr f32 BoxExtent = 0.1f;
+    // NOTE: Depth of the occluder plane which covers the whole screen
+    static constexpr f32 OccluderDepth = 0.5f;
+
+    GLuint instanceBuffer;
+    GLuint commandBuffer;
+    GLuint visibleBuffer;
+    GLuint objectBuffer;
+    GLuint occludedBuffer;
+    GLuint depthTarget;
+    GLuint framebuffer;
+    DrawElementsIndirectCommand commands[CommandCount * 2];
+};
+
+void ResetGPUCullTestCommands(GPUCullTest* test) {
+    // NOTE: Instance i goes to command i % CommandCount. Second half is the copy of the second phase
+    u32 instanceOffset = 0;
+    for (u32 i = 0; i < GPUCullTest::CommandCount; i++) {
+        auto command = test->commands + i;
+        *command = {};
+        command->count = 36;
+        command->baseInstance = instanceOffset;
+        instanceOffset += (GPUCullTest::InstanceCount - i + GPUCullTest::CommandCount - 1) / GPUCullTest::CommandCount;
+        test->commands[GPUCullTest::CommandCount + i] = *command;
+        test->commands[GPUCullTest::CommandCount + i].baseInstance += GPUCullTest::InstanceCount;
+    }
+    glNamedBufferSubData(test->commandBuffer, 0, sizeof(test->commands), test->commands);
+}
+
+void ClearGPUCullTestDepth(GPUCullTest* test, f32 depth) {
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, test->framebuffer);
+    glDisable(GL_SCISSOR_TEST);
+    glDepthMask(GL_TRUE);
+    glClearDepth(depth);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glClearDepth(1.0f);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+void DispatchGPUCullTest(Renderer* renderer, GPUCullTest* test, GLuint program, u32 phase, bool hiZEnabled, i32 casters) {
+    m4x4 identity = M4x4(1.0f);
+    glUseProgram(program);
+    glUniform1ui(GPUCullShader::InstanceCountLocation, GPUCullTest::InstanceCount);
+    glUniformMatrix4fv(GPUCullShader::CullViewProjLocation, 1, GL_FALSE, identity.data);
+    glUniformMatrix4fv(GPUCullShader::HiZViewProjLocation, 1, GL_FALSE, identity.data);
+    glUniform1i(GPUCullShader::HiZEnabledLocation, hiZEnabled ? 1 : 0);
+    glUniform1i(GPUCullShader::PhaseLocation, phase);
+    glUniform1ui(GPUCullShader::CommandOffsetLocation, phase == 1 ? 0 : GPUCullTest::CommandCount);
+    glUniform1i(GPUCullShader::CastersLocation, casters);
+    glBindTextureUnit(GPUCullShader::HiZ, renderer->hiZTarget);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPUCullShader::Instances, test->instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPUCullShader::Commands, test->commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPUCullShader::VisibleInstances, test->visibleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPUCullShader::ObjectData, test->objectBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPUCullShader::OccludedInstances, test->occludedBuffer);
+    glDispatchCompute((GPUCullTest::InstanceCount + GPUCullShader::GroupSize - 1) / GPUCullShader::GroupSize, 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+// NOTE: Reads the visible instances of the command set back as a bit mask. Instances appended to a command other
+// than their own fail the test
+bool ReadGPUCullTestVisible(GPUCullTest* test, u32 firstCommand, u32* visibleMask) {
+    DrawElementsIndirectCommand commands[GPUCullTest::CommandCount];
+    u32 visible[GPUCullTest::InstanceCount * 2];
+    glGetNamedBufferSubData(test->commandBuffer, sizeof(DrawElementsIndirectCommand) * firstCommand, sizeof(commands), commands);
+    glGetNamedBufferSubData(test->visibleBuffer, 0, sizeof(visible), visible);
+
+    bool result = true;
+    *visibleMask = 0;
+    for (u32 i = 0; i < GPUCullTest::CommandCount; i++) {
+        auto command = commands + i;
+        for (u32 j = 0; j < command->instanceCount; j++) {
+            u32 at = command->baseInstance + j;
+            u32 index = at < array_count(visible) ? visible[at] : U32::Max;
+            if (index >= GPUCullTest::InstanceCount || index % GPUCullTest::CommandCount != i) {
+                printf("[GPUCull] Command %u got instance %u\n", i, index);
+                result = false;
+            } else {
+                *visibleMask |= 1 << index;
+            }
+        }
+    }
+    return result;
+}
+
+bool CheckGPUCullTestMask(const char* name, u32 mask, u32 expected) {
+    bool result = mask == expected;
+    if (!result) {
+        printf("[GPUCull] %s: got instances 0x%x, expected 0x%x\n", name, mask, expected);
+    }
+    return result;
+}
+
+bool RunGPUCullTest(Renderer* renderer) {
+    bool result = false;
+    if (!renderer->gpuDrivenSupported) {
+        printf("[GPUCull] GPU-driven passes are not supported by the GL context\n");
+    } else {
+        GPUCullTest test = {};
+        GLuint buffers[5];
+        glCreateBuffers(5, buffers);
+        test.instanceBuffer = buffers[0];
+        test.commandBuffer = buffers[1];
+        test.visibleBuffer = buffers[2];
+        test.objectBuffer = buffers[3];
+        test.occludedBuffer = buffers[4];
+        defer { glDeleteBuffers(5, buffers); };
+
+        GPUCullInstance instances[GPUCullTest::InstanceCount] = {};
+        ShaderMeshData objects[GPUCullTest::InstanceCount] = {};
+        u32 expectedFrustum = 0;
+        u32 expectedNear = 0;
+        u32 expectedFar = 0;
+        u32 expectedStatic = 0;
+        u32 expectedDynamic = 0;
+        for (u32 i = 0; i < GPUCullTest::InstanceCount; i++) {
+            auto box = GPUCullTestBoxes + i;
+            auto instance = instances + i;
+            instance->object = i;
+            instance->command = i % GPUCullTest::CommandCount;
+            instance->shadowCommand = instance->command;
+            instance->dynamic = box->dynamic;
+            instance->boundsMin = V4(V3(-GPUCullTest::BoxExtent), 1.0f);
+            instance->boundsMax = V4(V3(GPUCullTest::BoxExtent), 1.0f);
+            objects[i].modelMatrix = Translate(box->position);
+            if (box->inFrustum) {
+                expectedFrustum |= 1 << i;
+                if (box->behindOccluder) {
+                    expectedFar |= 1 << i;
+                } else {
+                    expectedNear |= 1 << i;
+                }
+                if (box->dynamic) {
+                    expectedDynamic |= 1 << i;
+                } else {
+                    expectedStatic |= 1 << i;
+                }
+            }
+        }
+        glNamedBufferStorage(test.instanceBuffer, sizeof(instances), instances, 0);
+        glNamedBufferStorage(test.objectBuffer, sizeof(objects), objects, 0);
+        glNamedBufferStorage(test.commandBuffer, sizeof(test.commands), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glNamedBufferStorage(test.visibleBuffer, sizeof(u32) * GPUCullTest::InstanceCount * 2, nullptr, 0);
+        glNamedBufferStorage(test.occludedBuffer, sizeof(u32) * GPUCullTest::InstanceCount, nullptr, 0);
+
+        // NOTE: Hi-Z is built from a multisampled depth buffer in the renderer, single sample one does the same here
+        glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &test.depthTarget);
+        defer { glDeleteTextures(1, &test.depthTarget); };
+        glTextureStorage2DMultisample(test.depthTarget, 1, GL_DEPTH_COMPONENT24, GPUCullTest::DepthSize, GPUCullTest::DepthSize, GL_FALSE);
+        glCreateFramebuffers(1, &test.framebuffer);
+        defer { glDeleteFramebuffers(1, &test.framebuffer); };
+        glNamedFramebufferTexture(test.framebuffer, GL_DEPTH_ATTACHMENT, test.depthTarget, 0);
+        uv2 depthSize = UV2(GPUCullTest::DepthSize, GPUCullTest::DepthSize);
+
+        GLuint cull = renderer->shaders.GPUCull;
+        GLuint shadowCull = GetShaderPermutation(renderer, ShaderIndex::GPUCull, GPUCullFeature::Shadow);
+        bool ok = cull && shadowCull;
+        u32 mask;
+
+        // NOTE: First phase without the pyramid, like the first frame. Only frustum culling
+        ResetGPUCullTestCommands(&test);
+        DispatchGPUCullTest(renderer, &test, cull, 1, false, 0);
+        ok = ReadGPUCullTestVisible(&test, 0, &mask) && ok;
+        ok = CheckGPUCullTestMask("Frustum", mask, expectedFrustum) && ok;
+
+        // NOTE: First phase against the occluder plane. Boxes behind it are rejected and marked for the second phase
+        ClearGPUCullTestDepth(&test, GPUCullTest::OccluderDepth);
+        BuildHiZ(renderer, test.depthTarget, depthSize, 1);
+        ResetGPUCullTestCommands(&test);
+        DispatchGPUCullTest(renderer, &test, cull, 1, true, 0);
+        ok = ReadGPUCullTestVisible(&test, 0, &mask) && ok;
+        ok = CheckGPUCullTestMask("Occluded first phase", mask, expectedNear) && ok;
+        u32 occluded[GPUCullTest::InstanceCount];
+        glGetNamedBufferSubData(test.occludedBuffer, 0, sizeof(occluded), occluded);
+        u32 occludedMask = 0;
+        for (u32 i = 0; i < GPUCullTest::InstanceCount; i++) {
+            occludedMask |= occluded[i] ? 1 << i : 0;
+        }
+        ok = CheckGPUCullTestMask("Occluded marks", occludedMask, expectedFar) && ok;
+
+        // NOTE: Second phase after the occluder is gone. Exactly the marked boxes are revealed
+        ClearGPUCullTestDepth(&test, 1.0f);
+        BuildHiZ(renderer, test.depthTarget, depthSize, 1);
+        DispatchGPUCullTest(renderer, &test, cull, 2, true, 0);
+        ok = ReadGPUCullTestVisible(&test, GPUCullTest::CommandCount, &mask) && ok;
+        ok = CheckGPUCullTestMask("Revealed second phase", mask, expectedFar) && ok;
+
+        // NOTE: Shadow variant filters the casters and has no occlusion
+        ResetGPUCullTestCommands(&test);
+        DispatchGPUCullTest(renderer, &test, shadowCull, 1, false, (i32)ShadowCasters::Static);
+        ok = ReadGPUCullTestVisible(&test, 0, &mask) && ok;
+        ok = CheckGPUCullTestMask("Static casters", mask, expectedStatic) && ok;
+        ResetGPUCullTestCommands(&test);
+        DispatchGPUCullTest(renderer, &test, shadowCull, 1, false, (i32)ShadowCasters::Dynamic);
+        ok = ReadGPUCullTestVisible(&test, 0, &mask) && ok;
+        ok = CheckGPUCullTestMask("Dynamic casters", mask, expectedDynamic) && ok;
+
+        result = ok;
+        printf("[GPUCull] Test %s\n", result ? "passed" : "failed");
+    }
+    return result;
+}
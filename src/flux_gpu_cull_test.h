@@ -0,0 +1,17 @@
+#pragma once
+
+struct Renderer;
+
+// NOTE: Requested by the gpu_cull_test console command or -gpu_cull_test option and carried to the render thread by
+// the frame packet
+struct GPUCullTestRequest {
+    b32 active;
+    // NOTE: Automated run. The process exits when the test is done, with nonzero code if it failed
+    b32 quitWhenDone;
+};
+
+// NOTE: Runs the cull pass of the GPU-driven renderer on a fixed set of boxes and reads the results back. Checks frustum
+// culling, marking of the instances occluded by the Hi-Z pyramid in the first phase, the retest of the marked ones in
+// the second phase and caster filtering of the shadow variant. Needs a real GL context, a software one (llvmpipe)
+// is enough. Must be called on the render thread between frames. Returns false if the test failed or did not run
+bool RunGPUCullTest(Renderer* renderer);
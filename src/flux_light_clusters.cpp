@@ -0,0 +1,139 @@
+#include "flux_light_clusters.h"
+
+LightClusterGrid* CreateLightClusterGrid() {
+    auto grid = (LightClusterGrid*)PlatformAlloc(sizeof(LightClusterGrid), 0, nullptr);
+    *grid = {};
+    grid->lightBounds = (v4*)PlatformAlloc(sizeof(v4) * LightClusterGrid::MaxLights, 0, nullptr);
+    grid->clusterCounts = (u32*)PlatformAlloc(sizeof(u32) * LightClusterGrid::ClusterCount, 0, nullptr);
+    grid->clusterScratch = (u32*)PlatformAlloc(sizeof(u32) * LightClusterGrid::ClusterCount * LightClusterGrid::MaxLightsPerCluster, 0, nullptr);
+    grid->clusters = (u32*)PlatformAlloc(sizeof(u32) * 2 * LightClusterGrid::ClusterCount, 0, nullptr);
+    grid->lightIndices = (u32*)PlatformAlloc(sizeof(u32) * LightClusterGrid::MaxLightIndices, 0, nullptr);
+    for (u32 slice = 0; slice < LightClusterGrid::CountZ; slice++) {
+        grid->jobs[slice].grid = grid;
+        grid->jobs[slice].slice = slice;
+    }
+    return grid;
+}
+
+void DestroyLightClusterGrid(LightClusterGrid* grid) {
+    FinishLightClusters(grid);
+    PlatformFree(grid->lightBounds, nullptr);
+    PlatformFree(grid->clusterCounts, nullptr);
+    PlatformFree(grid->clusterScratch, nullptr);
+    PlatformFree(grid->clusters, nullptr);
+    PlatformFree(grid->lightIndices, nullptr);
+    PlatformFree(grid, nullptr);
+}
+
+void BuildLightClusterSliceWork(void* data0, void* data1, void* data2, u32 threadIndex) {
+    auto job = (LightClusterGrid::SliceJob*)data0;
+    auto grid = job->grid;
+
+    f32 sliceNear = grid->sliceDepths[job->slice];
+    f32 sliceFar = grid->sliceDepths[job->slice + 1];
+
+    // NOTE: Lights overlapping the slice depth range
+    u16 sliceLights[LightClusterGrid::MaxLights];
+    u32 sliceLightCount = 0;
+    for (u32 i = 0; i < grid->lightCount; i++) {
+        v4 bounds = grid->lightBounds[i];
+        f32 depth = -bounds.z;
+        if ((depth + bounds.w >= sliceNear) && (depth - bounds.w <= sliceFar)) {
+            sliceLights[sliceLightCount++] = (u16)i;
+        }
+    }
+
+    for (u32 y = 0; y < LightClusterGrid::CountY; y++) {
+        for (u32 x = 0; x < LightClusterGrid::CountX; x++) {
+            u32 clusterIndex = (job->slice * LightClusterGrid::CountY + y) * LightClusterGrid::CountX + x;
+            u32* list = grid->clusterScratch + (uptr)clusterIndex * LightClusterGrid::MaxLightsPerCluster;
+            u32 count = 0;
+
+            if (sliceLightCount) {
+                v3 min = V3(F32::Max);
+                v3 max = V3(-F32::Max);
+                for (u32 corner = 0; corner < 4; corner++) {
+                    v3 ray = grid->tileRays[(y + (corner >> 1)) * (LightClusterGrid::CountX + 1) + x + (corner & 1)];
+                    v3 n = ray * sliceNear;
+                    v3 f = ray * sliceFar;
+                    min = V3(Min(min.x, Min(n.x, f.x)), Min(min.y, Min(n.y, f.y)), Min(min.z, Min(n.z, f.z)));
+                    max = V3(Max(max.x, Max(n.x, f.x)), Max(max.y, Max(n.y, f.y)), Max(max.z, Max(n.z, f.z)));
+                }
+
+                for (u32 i = 0; i < sliceLightCount; i++) {
+                    v4 bounds = grid->lightBounds[sliceLights[i]];
+                    // NOTE: Sphere vs box. Spot lights are tested with the bounding sphere of their range
+                    f32 dx = Max(0.0f, Max(min.x - bounds.x, bounds.x - max.x));
+                    f32 dy = Max(0.0f, Max(min.y - bounds.y, bounds.y - max.y));
+                    f32 dz = Max(0.0f, Max(min.z - bounds.z, bounds.z - max.z));
+                    if (dx * dx + dy * dy + dz * dz <= bounds.w * bounds.w) {
+                        if (count < LightClusterGrid::MaxLightsPerCluster) {
+                            list[count++] = sliceLights[i];
+                        }
+                    }
+                }
+            }
+            grid->clusterCounts[clusterIndex] = count;
+        }
+    }
+}
+
+void BuildLightClusters(LightClusterGrid* grid, const CameraBase* camera, const v4* lights, u32 lightCount) {
+    assert(!grid->building);
+    lightCount = Min(lightCount, LightClusterGrid::MaxLights);
+
+    f32 n = camera->nearPlane;
+    f32 f = camera->farPlane;
+    f32 sliceNear = Max(n, Min(LightClusterGrid::MinSliceDepth, f * 0.5f));
+    f32 logRange = Log(f / sliceNear);
+    grid->depthScale = (f32)LightClusterGrid::CountZ / logRange;
+    grid->depthBias = -(f32)LightClusterGrid::CountZ * Log(sliceNear) / logRange;
+    for (u32 slice = 0; slice <= LightClusterGrid::CountZ; slice++) {
+        grid->sliceDepths[slice] = sliceNear * Pow(f / sliceNear, (f32)slice / (f32)LightClusterGrid::CountZ);
+    }
+    grid->sliceDepths[0] = n;
+
+    for (u32 y = 0; y <= LightClusterGrid::CountY; y++) {
+        for (u32 x = 0; x <= LightClusterGrid::CountX; x++) {
+            f32 ndcX = -1.0f + 2.0f * (f32)x / (f32)LightClusterGrid::CountX;
+            f32 ndcY = -1.0f + 2.0f * (f32)y / (f32)LightClusterGrid::CountY;
+            v4 p = camera->invProjectionMatrix * V4(ndcX, ndcY, -1.0f, 1.0f);
+            v3 nearPoint = p.xyz / p.w;
+            grid->tileRays[y * (LightClusterGrid::CountX + 1) + x] = nearPoint / -nearPoint.z;
+        }
+    }
+
+    for (u32 i = 0; i < lightCount; i++) {
+        v4 view = camera->viewMatrix * V4(lights[i].xyz, 1.0f);
+        grid->lightBounds[i] = V4(view.xyz, lights[i].w);
+    }
+    grid->lightCount = lightCount;
+
+    grid->building = true;
+    for (u32 slice = 0; slice < LightClusterGrid::CountZ; slice++) {
+        // TODO: Spin-locking here for now. We should handle the case when platform queue is full propperly
+        while (!PlatformPushWork(GlobalRenderWorkQueue, BuildLightClusterSliceWork, grid->jobs + slice, nullptr, nullptr)) {}
+    }
+}
+
+void FinishLightClusters(LightClusterGrid* grid) {
+    if (grid->building) {
+        PlatformCompleteAllWork(GlobalRenderWorkQueue);
+        grid->building = false;
+
+        u32 offset = 0;
+        grid->overflow = false;
+        for (u32 i = 0; i < LightClusterGrid::ClusterCount; i++) {
+            u32 count = grid->clusterCounts[i];
+            if (offset + count > LightClusterGrid::MaxLightIndices) {
+                count = LightClusterGrid::MaxLightIndices - offset;
+                grid->overflow = true;
+            }
+            memcpy(grid->lightIndices + offset, grid->clusterScratch + (uptr)i * LightClusterGrid::MaxLightsPerCluster, sizeof(u32) * count);
+            grid->clusters[i * 2 + 0] = offset;
+            grid->clusters[i * 2 + 1] = count;
+            offset += count;
+        }
+        grid->lightIndexCount = offset;
+    }
+}
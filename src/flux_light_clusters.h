@@ -0,0 +1,54 @@
+#pragma once
+
+struct CameraBase;
+
+// NOTE: Froxel grid over the camera frustum for clustered forward shading. Slices are distributed exponentially
+// in view depth. Light lists are built on worker threads, one job per depth slice, and then compacted to
+// (offset, count) pairs and a single index list which are uploaded to SSBOs and read by PBRMeshFragment.glsl
+struct LightClusterGrid {
+    // NOTE: Must match CLUSTER_COUNT_* in Lights.glh
+    static constexpr u32 CountX = 16;
+    static constexpr u32 CountY = 9;
+    static constexpr u32 CountZ = 24;
+    static constexpr u32 ClusterCount = CountX * CountY * CountZ;
+    static constexpr u32 MaxLights = 1024;
+    static constexpr u32 MaxLightsPerCluster = 128;
+    static constexpr u32 MaxLightIndices = ClusterCount * 32;
+    // NOTE: Everything closer than that goes to the first slice, otherwise most of the slices are wasted
+    // on the first few centimeters in front of the camera
+    static constexpr f32 MinSliceDepth = 0.25f;
+
+    struct SliceJob {
+        LightClusterGrid* grid;
+        u32 slice;
+    };
+
+    // NOTE: View space position and radius of every light
+    v4* lightBounds;
+    u32 lightCount;
+
+    // NOTE: View space directions through the tile corners, scaled to z = -1
+    v3 tileRays[(CountX + 1) * (CountY + 1)];
+    f32 sliceDepths[CountZ + 1];
+    f32 depthScale;
+    f32 depthBias;
+
+    u32* clusterCounts;
+    u32* clusterScratch;
+    // NOTE: Compacted result. Pairs of (offset, count)
+    u32* clusters;
+    u32* lightIndices;
+    u32 lightIndexCount;
+    b32 overflow;
+
+    SliceJob jobs[CountZ];
+    b32 building;
+};
+
+LightClusterGrid* CreateLightClusterGrid();
+void DestroyLightClusterGrid(LightClusterGrid* grid);
+
+// NOTE: Lights are world space positions and radii. Kicks jobs on the render queue and returns immediately
+void BuildLightClusters(LightClusterGrid* grid, const CameraBase* camera, const v4* lights, u32 lightCount);
+// NOTE: Waits for the jobs and compacts light lists
+void FinishLightClusters(LightClusterGrid* grid);
@@ -29,6 +29,7 @@ static PlatformState* _GlobalPlatform = 0;
 #define GlobalInput GlobalPlatform.input
 #define GlobalLowPriorityWorkQueue GlobalPlatform.lowPriorityQueue
 #define GlobalHighPriorityWorkQueue GlobalPlatform.highPriorityQueue
+#define GlobalRenderWorkQueue GlobalPlatform.renderQueue
 
 LoggerFn* GlobalLogger = LogMessageAPI;
 void* GlobalLoggerData;
@@ -80,6 +81,8 @@ void* PlatformAllocClear(uptr size) {
 
 #define PlatformPushWork platform_call(PushWork)
 #define PlatformCompleteAllWork platform_call(CompleteAllWork)
+#define PlatformWaitForRender platform_call(WaitForRender)
+#define PlatformQuit platform_call(Quit)
 #define PlatformSleep platform_call(Sleep)
 
 #if defined(COMPILER_MSVC)
@@ -117,12 +120,17 @@ void* PlatformAllocClear(uptr size) {
 #define glLinkProgram gl_call(glLinkProgram)
 #define glGetProgramiv gl_call(glGetProgramiv)
 #define glGetProgramInfoLog gl_call(glGetProgramInfoLog)
+#define glGetProgramBinary gl_call(glGetProgramBinary)
+#define glProgramBinary gl_call(glProgramBinary)
+#define glProgramParameteri gl_call(glProgramParameteri)
+#define glGetString gl_call(glGetString)
 #define glViewport gl_call(glViewport)
 #define glDeleteShader gl_call(glDeleteShader)
 #define glGetSubroutineIndex gl_call(glGetSubroutineIndex)
 #define glGetUniformLocation gl_call(glGetUniformLocation)
 #define glTexImage2DMultisample gl_call(glTexImage2DMultisample)
 #define glGenFramebuffers gl_call(glGenFramebuffers)
+#define glDeleteFramebuffers gl_call(glDeleteFramebuffers)
 #define glBindFramebuffer gl_call(glBindFramebuffer)
 #define glCheckFramebufferStatus gl_call(glCheckFramebufferStatus)
 #define glFramebufferTexture2D gl_call(glFramebufferTexture2D)
@@ -176,6 +184,9 @@ void* PlatformAllocClear(uptr size) {
 #define glPolygonOffset gl_call(glPolygonOffset)
 #define glTexImage1D gl_call(glTexImage1D)
 #define glFramebufferTextureLayer gl_call(glFramebufferTextureLayer)
+#define glFramebufferTexture gl_call(glFramebufferTexture)
+#define glUniform1ui gl_call(glUniform1ui)
+#define glCopyImageSubData gl_call(glCopyImageSubData)
 #define glNamedBufferStorage gl_call(glNamedBufferStorage)
 #define glBindBufferRange gl_call(glBindBufferRange)
 #define glNamedBufferSubData gl_call(glNamedBufferSubData)
@@ -188,6 +199,45 @@ void* PlatformAllocClear(uptr size) {
 #define glDeleteBuffers gl_call(glDeleteBuffers)
 #define glMapBufferRange gl_call(glMapBufferRange)
 #define glMapNamedBufferRange gl_call(glMapNamedBufferRange)
+#define glFenceSync gl_call(glFenceSync)
+#define glClientWaitSync gl_call(glClientWaitSync)
+#define glDeleteSync gl_call(glDeleteSync)
+#define glCopyNamedBufferSubData gl_call(glCopyNamedBufferSubData)
+#define glGetNamedBufferSubData gl_call(glGetNamedBufferSubData)
+#define glTextureSubImage2D gl_call(glTextureSubImage2D)
+#define glGenerateTextureMipmap gl_call(glGenerateTextureMipmap)
+#define glCreateTextures gl_call(glCreateTextures)
+#define glTextureStorage2D gl_call(glTextureStorage2D)
+#define glTextureSubImage3D gl_call(glTextureSubImage3D)
+#define glTextureParameteri gl_call(glTextureParameteri)
+#define glTextureParameterf gl_call(glTextureParameterf)
+#define glGetTextureImage gl_call(glGetTextureImage)
+#define glTextureStorage3D gl_call(glTextureStorage3D)
+#define glDispatchCompute gl_call(glDispatchCompute)
+#define glBindImageTexture gl_call(glBindImageTexture)
+#define glMemoryBarrier gl_call(glMemoryBarrier)
+#define glCreateSamplers gl_call(glCreateSamplers)
+#define glSamplerParameteri gl_call(glSamplerParameteri)
+#define glBindSampler gl_call(glBindSampler)
+#define glMultiDrawElementsIndirect gl_call(glMultiDrawElementsIndirect)
+#define glColorMask gl_call(glColorMask)
+#define glGenQueries gl_call(glGenQueries)
+#define glBeginQuery gl_call(glBeginQuery)
+#define glEndQuery gl_call(glEndQuery)
+#define glGetQueryObjectiv gl_call(glGetQueryObjectiv)
+#define glGetQueryObjectui64v gl_call(glGetQueryObjectui64v)
+#define glQueryCounter gl_call(glQueryCounter)
+#define glUniform2f gl_call(glUniform2f)
+#define glInvalidateNamedFramebufferData gl_call(glInvalidateNamedFramebufferData)
+#define glNamedFramebufferDrawBuffer gl_call(glNamedFramebufferDrawBuffer)
+#define glNamedFramebufferReadBuffer gl_call(glNamedFramebufferReadBuffer)
+#define glCreateFramebuffers gl_call(glCreateFramebuffers)
+#define glNamedFramebufferTexture gl_call(glNamedFramebufferTexture)
+#define glNamedFramebufferTextureLayer gl_call(glNamedFramebufferTextureLayer)
+#define glCheckNamedFramebufferStatus gl_call(glCheckNamedFramebufferStatus)
+#define glTextureStorage2DMultisample gl_call(glTextureStorage2DMultisample)
+#define glInvalidateTexImage gl_call(glInvalidateTexImage)
+#define glDisableVertexAttribArray gl_call(glDisableVertexAttribArray)
 
 #include "Memory.h"
 // NOTE: Libs
@@ -229,7 +279,10 @@ extern "C" GAME_CODE_ENTRY void GameUpdateAndRender(PlatformState* platform, Gam
 
         context->renderer = InitializeRenderer(UV2(GlobalPlatform.windowWidth, GlobalPlatform.windowHeight), 8);
         //context->renderer->clearColor = V4(0.8f, 0.8f, 0.8f, 1.0f);
-        context->renderGroup = RenderGroup::Make(Kilobytes(1024), 16384);
+        for (u32 i = 0; i < array_count(context->framePackets); i++) {
+            context->framePackets[i].group = RenderGroup::Make(16384);
+        }
+        context->renderScene = RenderScene::Make();
 
         FluxInit(context);
     } break;
@@ -298,6 +351,8 @@ void OpenglDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
 #include "flux_debug_overlay.cpp"
 #include "flux_camera.cpp"
 #include "flux_render_group.cpp"
+#include "flux_render_scene.cpp"
+#include "flux_debug_draw.cpp"
 #include "flux_renderer.cpp"
 #include "flux_shaders.cpp"
 #include "flux_world.cpp"
@@ -308,6 +363,13 @@ void OpenglDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
 #include "flux_console.cpp"
 #include "flux_console_commands.cpp"
 #include "flux_flat_array.cpp"
+#include "flux_spherical_harmonics.cpp"
+#include "flux_occlusion.cpp"
+#include "flux_light_clusters.cpp"
+#include "flux_render_graph.cpp"
+#include "flux_renderer_benchmark.cpp"
+#include "flux_gpu_cull_test.cpp"
+#include "flux_golden_images.cpp"
 
 // NOTE: Platform specific intrinsics implementation begins here
 #if defined(PLATFORM_WINDOWS)
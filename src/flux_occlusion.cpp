@@ -0,0 +1,463 @@
+#include "flux_occlusion.h"
+
+// NOTE: Triangles are clipped against the near plane before projection. Near plane of GL clip space is z = -w
+constexpr f32 OcclusionNearEpsilon = 0.00001f;
+
+OcclusionBuffer* CreateOcclusionBuffer() {
+    auto buffer = (OcclusionBuffer*)PlatformAlloc(sizeof(OcclusionBuffer), 0, nullptr);
+    *buffer = {};
+    buffer->depth = (f32*)PlatformAlloc(sizeof(f32) * OcclusionBuffer::Width * OcclusionBuffer::Height, 0, nullptr);
+    buffer->occluders = (OcclusionBuffer::Occluder*)PlatformAlloc(sizeof(OcclusionBuffer::Occluder) * OcclusionBuffer::MaxOccluders, 0, nullptr);
+    buffer->bandTriangles = (u16*)PlatformAlloc(sizeof(u16) * OcclusionBuffer::BinJobMaxTriangles * OcclusionBuffer::BinJobCount * OcclusionBuffer::BandCount, 0, nullptr);
+    for (u32 i = 0; i < 3; i++) {
+        buffer->x[i] = (f32*)PlatformAlloc(sizeof(f32) * OcclusionBuffer::MaxTriangles, 0, nullptr);
+        buffer->y[i] = (f32*)PlatformAlloc(sizeof(f32) * OcclusionBuffer::MaxTriangles, 0, nullptr);
+        buffer->z[i] = (f32*)PlatformAlloc(sizeof(f32) * OcclusionBuffer::MaxTriangles, 0, nullptr);
+    }
+    for (u32 job = 0; job < OcclusionBuffer::BinJobCount; job++) {
+        buffer->binJobs[job].buffer = buffer;
+        buffer->binJobs[job].index = job;
+    }
+    for (u32 band = 0; band < OcclusionBuffer::BandCount; band++) {
+        buffer->jobs[band].buffer = buffer;
+        buffer->jobs[band].band = band;
+    }
+    for (u32 i = 0; i < OcclusionBuffer::Width * OcclusionBuffer::Height; i++) {
+        buffer->depth[i] = 1.0f;
+    }
+    return buffer;
+}
+
+void DestroyOcclusionBuffer(OcclusionBuffer* buffer) {
+    FinishOcclusion(buffer);
+    for (u32 i = 0; i < 3; i++) {
+        PlatformFree(buffer->x[i], nullptr);
+        PlatformFree(buffer->y[i], nullptr);
+        PlatformFree(buffer->z[i], nullptr);
+    }
+    PlatformFree(buffer->bandTriangles, nullptr);
+    PlatformFree(buffer->occluders, nullptr);
+    PlatformFree(buffer->depth, nullptr);
+    PlatformFree(buffer, nullptr);
+}
+
+void BeginOcclusionFrame(OcclusionBuffer* buffer, const m4x4* viewProj) {
+    assert(!buffer->rasterizing);
+    buffer->viewProj = *viewProj;
+    buffer->triangleCount = 0;
+    buffer->occluderCount = 0;
+    buffer->overflow = false;
+}
+
+v3 OcclusionClipToScreen(v4 clip) {
+    f32 invW = 1.0f / clip.w;
+    v3 result;
+    result.x = (clip.x * invW * 0.5f + 0.5f) * (f32)OcclusionBuffer::Width;
+    result.y = (clip.y * invW * 0.5f + 0.5f) * (f32)OcclusionBuffer::Height;
+    result.z = clip.z * invW * 0.5f + 0.5f;
+    return result;
+}
+
+bool PushOcclusionTriangle(OcclusionBuffer::BinJob* job, v3 a, v3 b, v3 c) {
+    f32 area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+    // NOTE: Meshes are drawn without face culling, so both windings occlude. Making them all counter-clockwise
+    if (area < 0.0f) {
+        v3 tmp = b;
+        b = c;
+        c = tmp;
+    } else if (area == 0.0f) {
+        return true;
+    }
+
+    f32 minX = Min(a.x, Min(b.x, c.x));
+    f32 maxX = Max(a.x, Max(b.x, c.x));
+    f32 minY = Min(a.y, Min(b.y, c.y));
+    f32 maxY = Max(a.y, Max(b.y, c.y));
+    f32 minZ = Min(a.z, Min(b.z, c.z));
+    if (maxX < 0.0f || maxY < 0.0f || minX > (f32)OcclusionBuffer::Width || minY > (f32)OcclusionBuffer::Height || minZ > 1.0f) {
+        return true;
+    }
+
+    // NOTE: Rows the rasterizer visits for the triangle
+    i32 minRow = (i32)Floor(Clamp(minY, 0.0f, (f32)OcclusionBuffer::Height));
+    i32 maxRow = (i32)Ceil(Clamp(maxY, 0.0f, (f32)OcclusionBuffer::Height));
+    if (minRow >= maxRow) {
+        return true;
+    }
+
+    if (job->triangleCount == OcclusionBuffer::BinJobMaxTriangles) {
+        job->overflow = true;
+        return false;
+    }
+
+    auto buffer = job->buffer;
+    u32 local = job->triangleCount++;
+    u32 index = job->index * OcclusionBuffer::BinJobMaxTriangles + local;
+    buffer->x[0][index] = a.x; buffer->y[0][index] = a.y; buffer->z[0][index] = a.z;
+    buffer->x[1][index] = b.x; buffer->y[1][index] = b.y; buffer->z[1][index] = b.z;
+    buffer->x[2][index] = c.x; buffer->y[2][index] = c.y; buffer->z[2][index] = c.z;
+
+    u32 firstBand = (u32)minRow / OcclusionBuffer::BandHeight;
+    u32 lastBand = (u32)(maxRow - 1) / OcclusionBuffer::BandHeight;
+    for (u32 band = firstBand; band <= lastBand; band++) {
+        u16* list = buffer->bandTriangles + (job->index * OcclusionBuffer::BandCount + band) * OcclusionBuffer::BinJobMaxTriangles;
+        list[job->bandTriangleCounts[band]++] = (u16)local;
+    }
+    return true;
+}
+
+bool AddOccluder(OcclusionBuffer* buffer, const m4x4* transform, const Mesh* mesh) {
+    assert(!buffer->rasterizing);
+    if (buffer->occluderCount == OcclusionBuffer::MaxOccluders) {
+        buffer->overflow = true;
+        return false;
+    }
+
+    if (mesh->vertices && mesh->indices) {
+        auto occluder = buffer->occluders + buffer->occluderCount++;
+        occluder->transform = *transform;
+        occluder->mesh = mesh;
+    }
+    return true;
+}
+
+bool BinOccluder(OcclusionBuffer::BinJob* job, const OcclusionBuffer::Occluder* occluder) {
+    auto mesh = occluder->mesh;
+    m4x4 m = job->buffer->viewProj * occluder->transform;
+
+    for (u32 i = 0; i + 2 < mesh->indexCount; i += 3) {
+        v4 clip[3];
+        f32 d[3];
+        u32 insideCount = 0;
+        for (u32 v = 0; v < 3; v++) {
+            clip[v] = m * V4(mesh->vertices[mesh->indices[i + v]], 1.0f);
+            d[v] = clip[v].z + clip[v].w;
+            if (d[v] > OcclusionNearEpsilon) {
+                insideCount++;
+            }
+        }
+
+        if (insideCount == 0) {
+            continue;
+        }
+
+        if (insideCount == 3) {
+            if (!PushOcclusionTriangle(job, OcclusionClipToScreen(clip[0]), OcclusionClipToScreen(clip[1]), OcclusionClipToScreen(clip[2]))) {
+                return false;
+            }
+            continue;
+        }
+
+        // NOTE: Clipping the triangle against the near plane. Results in one or two triangles
+        v3 polygon[4];
+        u32 polygonCount = 0;
+        for (u32 v = 0; v < 3; v++) {
+            u32 next = (v + 1) % 3;
+            bool inside = d[v] > OcclusionNearEpsilon;
+            bool nextInside = d[next] > OcclusionNearEpsilon;
+            if (inside) {
+                polygon[polygonCount++] = OcclusionClipToScreen(clip[v]);
+            }
+            if (inside != nextInside) {
+                f32 t = (d[v] - OcclusionNearEpsilon) / (d[v] - d[next]);
+                v4 p = clip[v] + (clip[next] - clip[v]) * t;
+                polygon[polygonCount++] = OcclusionClipToScreen(p);
+            }
+        }
+        assert(polygonCount == 3 || polygonCount == 4);
+
+        for (u32 v = 2; v < polygonCount; v++) {
+            if (!PushOcclusionTriangle(job, polygon[0], polygon[v - 1], polygon[v])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void BinOccludersWork(void* data0, void* data1, void* data2, u32 threadIndex) {
+    auto job = (OcclusionBuffer::BinJob*)data0;
+    auto buffer = job->buffer;
+    job->triangleCount = 0;
+    job->overflow = false;
+    for (u32 band = 0; band < OcclusionBuffer::BandCount; band++) {
+        job->bandTriangleCounts[band] = 0;
+    }
+    for (u32 i = job->occluderBegin; i < job->occluderEnd; i++) {
+        if (!BinOccluder(job, buffer->occluders + i)) {
+            break;
+        }
+    }
+    AtomicIncrement(&buffer->binnedJobCount);
+}
+
+void RasterizeOcclusionBandWork(void* data0, void* data1, void* data2, u32 threadIndex) {
+    auto job = (OcclusionBuffer::BandJob*)data0;
+    auto buffer = job->buffer;
+
+    constexpr u32 Width = OcclusionBuffer::Width;
+    i32 bandMinY = (i32)(job->band * OcclusionBuffer::BandHeight);
+    i32 bandMaxY = bandMinY + (i32)OcclusionBuffer::BandHeight;
+
+    f32* bandDepth = buffer->depth + (uptr)bandMinY * Width;
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (u32 i = 0; i < OcclusionBuffer::BandHeight * Width; i += 4) {
+        _mm_storeu_ps(bandDepth + i, one);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+    // NOTE: Jobs are taken from the queue in order and binning jobs are pushed first, so all of them are already
+    // taken by running threads here and the wait is bounded
+    while (AtomicLoad(&buffer->binnedJobCount) != OcclusionBuffer::BinJobCount) {
+        SpinPause();
+    }
+
+    // NOTE: Depth test is min, so the order of triangles does not change the result
+    for (u32 binJob = 0; binJob < OcclusionBuffer::BinJobCount; binJob++) {
+        u32 triangleCount = buffer->binJobs[binJob].bandTriangleCounts[job->band];
+        const u16* triangles = buffer->bandTriangles + (binJob * OcclusionBuffer::BandCount + job->band) * OcclusionBuffer::BinJobMaxTriangles;
+        for (u32 i = 0; i < triangleCount; i++) {
+            u32 t = binJob * OcclusionBuffer::BinJobMaxTriangles + triangles[i];
+            f32 x0 = buffer->x[0][t]; f32 y0 = buffer->y[0][t]; f32 z0 = buffer->z[0][t];
+            f32 x1 = buffer->x[1][t]; f32 y1 = buffer->y[1][t]; f32 z1 = buffer->z[1][t];
+            f32 x2 = buffer->x[2][t]; f32 y2 = buffer->y[2][t]; f32 z2 = buffer->z[2][t];
+
+            i32 minY = (i32)Floor(Clamp(Min(y0, Min(y1, y2)), (f32)bandMinY, (f32)bandMaxY));
+            i32 maxY = (i32)Ceil(Clamp(Max(y0, Max(y1, y2)), (f32)bandMinY, (f32)bandMaxY));
+            if (minY >= maxY) {
+                continue;
+            }
+
+            // NOTE: Starting at 4-pixel aligned column, lanes outside of the triangle are rejected by edge functions
+            i32 minX = (i32)Floor(Clamp(Min(x0, Min(x1, x2)), 0.0f, (f32)Width)) & ~3;
+            i32 maxX = (i32)Ceil(Clamp(Max(x0, Max(x1, x2)), 0.0f, (f32)Width));
+            if (minX >= maxX) {
+                continue;
+            }
+
+            // NOTE: Edge functions E(p) = A * p.x + B * p.y + C, positive inside of a counter-clockwise triangle
+            f32 a01 = y0 - y1; f32 b01 = x1 - x0; f32 c01 = -(a01 * x0 + b01 * y0);
+            f32 a12 = y1 - y2; f32 b12 = x2 - x1; f32 c12 = -(a12 * x1 + b12 * y1);
+            f32 a20 = y2 - y0; f32 b20 = x0 - x2; f32 c20 = -(a20 * x2 + b20 * y2);
+
+            f32 area = a01 * x2 + b01 * y2 + c01;
+            if (area <= 0.0f) {
+                continue;
+            }
+
+            // NOTE: NDC depth is linear in screen space, so it is just a plane
+            f32 invArea = 1.0f / area;
+            f32 za = (z0 * a12 + z1 * a20 + z2 * a01) * invArea;
+            f32 zb = (z0 * b12 + z1 * b20 + z2 * b01) * invArea;
+            f32 zc = (z0 * c12 + z1 * c20 + z2 * c01) * invArea;
+
+            __m128 stepE01 = _mm_set1_ps(a01 * 4.0f);
+            __m128 stepE12 = _mm_set1_ps(a12 * 4.0f);
+            __m128 stepE20 = _mm_set1_ps(a20 * 4.0f);
+            __m128 stepZ = _mm_set1_ps(za * 4.0f);
+
+            __m128 px = _mm_add_ps(_mm_set1_ps((f32)minX), laneOffsets);
+
+            for (i32 y = minY; y < maxY; y++) {
+                f32 py = (f32)y + 0.5f;
+                __m128 e01 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a01), px), _mm_set1_ps(b01 * py + c01));
+                __m128 e12 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a12), px), _mm_set1_ps(b12 * py + c12));
+                __m128 e20 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a20), px), _mm_set1_ps(b20 * py + c20));
+                __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), _mm_set1_ps(zb * py + zc));
+
+                f32* row = buffer->depth + (uptr)y * Width;
+                for (i32 x = minX; x < maxX; x += 4) {
+                    __m128 inside = _mm_cmpge_ps(_mm_min_ps(e01, _mm_min_ps(e12, e20)), zero);
+                    if (_mm_movemask_ps(inside)) {
+                        __m128 depth = _mm_loadu_ps(row + x);
+                        __m128 nearest = _mm_min_ps(depth, z);
+                        _mm_storeu_ps(row + x, _mm_blendv_ps(depth, nearest, inside));
+                    }
+                    e01 = _mm_add_ps(e01, stepE01);
+                    e12 = _mm_add_ps(e12, stepE12);
+                    e20 = _mm_add_ps(e20, stepE20);
+                    z = _mm_add_ps(z, stepZ);
+                }
+            }
+        }
+    }
+}
+
+void RasterizeOccluders(OcclusionBuffer* buffer) {
+    assert(!buffer->rasterizing);
+    buffer->rasterizing = true;
+    buffer->binnedJobCount = 0;
+
+    // NOTE: Occluders are split by index count, so the binning jobs get about the same work and triangle budget
+    u64 totalIndexCount = 0;
+    for (u32 i = 0; i < buffer->occluderCount; i++) {
+        totalIndexCount += buffer->occluders[i].mesh->indexCount;
+    }
+    u32 job = 0;
+    u64 indexCount = 0;
+    buffer->binJobs[0].occluderBegin = 0;
+    for (u32 i = 0; i < buffer->occluderCount; i++) {
+        u32 occluderJob = totalIndexCount ? Min((u32)(indexCount * OcclusionBuffer::BinJobCount / totalIndexCount), OcclusionBuffer::BinJobCount - 1) : 0;
+        while (job < occluderJob) {
+            buffer->binJobs[++job].occluderBegin = i;
+        }
+        indexCount += buffer->occluders[i].mesh->indexCount;
+    }
+    while (job + 1 < OcclusionBuffer::BinJobCount) {
+        buffer->binJobs[++job].occluderBegin = buffer->occluderCount;
+    }
+    for (u32 i = 0; i < OcclusionBuffer::BinJobCount; i++) {
+        buffer->binJobs[i].occluderEnd = (i + 1 < OcclusionBuffer::BinJobCount) ? buffer->binJobs[i + 1].occluderBegin : buffer->occluderCount;
+    }
+
+    for (u32 i = 0; i < OcclusionBuffer::BinJobCount; i++) {
+        while (!PlatformPushWork(GlobalRenderWorkQueue, BinOccludersWork, buffer->binJobs + i, nullptr, nullptr)) {}
+    }
+    for (u32 band = 0; band < OcclusionBuffer::BandCount; band++) {
+        // TODO: Spin-locking here for now. We should handle the case when platform queue is full propperly
+        while (!PlatformPushWork(GlobalRenderWorkQueue, RasterizeOcclusionBandWork, buffer->jobs + band, nullptr, nullptr)) {}
+    }
+}
+
+void FinishOcclusion(OcclusionBuffer* buffer) {
+    if (buffer->rasterizing) {
+        PlatformCompleteAllWork(GlobalRenderWorkQueue);
+        buffer->rasterizing = false;
+        for (u32 i = 0; i < OcclusionBuffer::BinJobCount; i++) {
+            buffer->triangleCount += buffer->binJobs[i].triangleCount;
+            buffer->overflow |= buffer->binJobs[i].overflow;
+        }
+    }
+}
+
+bool IsVisible(const OcclusionBuffer* buffer, const m4x4* transform, BBoxAligned aabb) {
+    assert(!buffer->rasterizing);
+    m4x4 m = buffer->viewProj * *transform;
+
+    f32 minX = F32::Max;
+    f32 minY = F32::Max;
+    f32 maxX = -F32::Max;
+    f32 maxY = -F32::Max;
+    f32 minZ = F32::Max;
+    for (u32 i = 0; i < 8; i++) {
+        v3 corner = V3(i & 1 ? aabb.max.x : aabb.min.x, i & 2 ? aabb.max.y : aabb.min.y, i & 4 ? aabb.max.z : aabb.min.z);
+        v4 clip = m * V4(corner, 1.0f);
+        if (clip.z + clip.w <= OcclusionNearEpsilon) {
+            return true;
+        }
+        v3 p = OcclusionClipToScreen(clip);
+        minX = Min(minX, p.x);
+        minY = Min(minY, p.y);
+        maxX = Max(maxX, p.x);
+        maxY = Max(maxY, p.y);
+        minZ = Min(minZ, p.z);
+    }
+
+    constexpr f32 Width = (f32)OcclusionBuffer::Width;
+    constexpr f32 Height = (f32)OcclusionBuffer::Height;
+    i32 x0 = (i32)Floor(Clamp(minX, 0.0f, Width)) & ~3;
+    i32 x1 = (i32)Ceil(Clamp(maxX, 0.0f, Width));
+    i32 y0 = (i32)Floor(Clamp(minY, 0.0f, Height));
+    i32 y1 = (i32)Ceil(Clamp(maxY, 0.0f, Height));
+    if (x0 >= x1 || y0 >= y1) {
+        // NOTE: Outside of the screen. Frustum culling is not our business but there is nothing to test against
+        return false;
+    }
+
+    __m128 boxDepth = _mm_set1_ps(minZ);
+    for (i32 y = y0; y < y1; y++) {
+        const f32* row = buffer->depth + (uptr)y * OcclusionBuffer::Width;
+        for (i32 x = x0; x < x1; x += 4) {
+            __m128 depth = _mm_loadu_ps(row + x);
+            if (_mm_movemask_ps(_mm_cmpge_ps(depth, boxDepth))) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool RunOcclusionTest() {
+    // NOTE: Camera at the origin looking down -z. A wall at z = -10 covers the middle of the screen and a pillar
+    // on the left is added as a second occluder, so they go to different binning jobs
+    v3 wallVertices[] = { V3(-4.0f, -3.0f, 0.0f), V3(4.0f, -3.0f, 0.0f), V3(4.0f, 3.0f, 0.0f), V3(-4.0f, 3.0f, 0.0f) };
+    v3 pillarVertices[] = { V3(-1.0f, -5.0f, 0.0f), V3(1.0f, -5.0f, 0.0f), V3(1.0f, 5.0f, 0.0f), V3(-1.0f, 5.0f, 0.0f) };
+    // NOTE: Both windings occlude
+    u32 indices[] = { 0, 1, 2, 0, 3, 2 };
+
+    Mesh wall = {};
+    wall.vertexCount = array_count(wallVertices);
+    wall.indexCount = array_count(indices);
+    wall.vertices = wallVertices;
+    wall.indices = indices;
+    Mesh pillar = wall;
+    pillar.vertices = pillarVertices;
+
+    m4x4 wallTransform = Translate(V3(0.0f, 0.0f, -10.0f));
+    m4x4 pillarTransform = Translate(V3(-8.0f, 0.0f, -10.0f));
+    m4x4 viewProj = PerspectiveGLRH(0.1f, 100.0f, 60.0f, (f32)OcclusionBuffer::Width / (f32)OcclusionBuffer::Height);
+    m4x4 identity = M4x4(1.0f);
+
+    struct Case {
+        const char* name;
+        v3 min;
+        v3 max;
+        bool visible;
+    };
+    const Case cases[] = {
+        { "behind the wall",         V3(-1.0f, -1.0f, -21.0f),  V3(1.0f, 1.0f, -19.0f),   false },
+        { "behind the pillar",       V3(-16.5f, -1.0f, -21.0f), V3(-15.5f, 1.0f, -19.0f), false },
+        { "in front of the wall",    V3(-1.0f, -1.0f, -6.0f),   V3(1.0f, 1.0f, -4.0f),    true },
+        { "behind the wall edge",    V3(6.0f, -1.0f, -21.0f),   V3(10.0f, 1.0f, -19.0f),  true },
+        { "next to the wall",        V3(12.0f, -1.0f, -21.0f),  V3(14.0f, 1.0f, -19.0f),  true },
+        { "crossing the near plane", V3(-1.0f, -1.0f, -1.0f),   V3(1.0f, 1.0f, 1.0f),     true },
+    };
+
+    auto buffer = CreateOcclusionBuffer();
+    auto reference = (f32*)PlatformAlloc(sizeof(f32) * OcclusionBuffer::Width * OcclusionBuffer::Height, 0, nullptr);
+    bool passed = true;
+
+    // NOTE: Second run adds the occluders in the other order, so they are binned by other jobs
+    for (u32 run = 0; run < 2; run++) {
+        BeginOcclusionFrame(buffer, &viewProj);
+        if (run == 0) {
+            AddOccluder(buffer, &wallTransform, &wall);
+            AddOccluder(buffer, &pillarTransform, &pillar);
+        } else {
+            AddOccluder(buffer, &pillarTransform, &pillar);
+            AddOccluder(buffer, &wallTransform, &wall);
+        }
+        RasterizeOccluders(buffer);
+        FinishOcclusion(buffer);
+
+        if (buffer->triangleCount != 4 || buffer->overflow) {
+            printf("[Occlusion] Run %u: %u triangles binned, expected 4\n", run, buffer->triangleCount);
+            passed = false;
+        }
+
+        for (u32 i = 0; i < array_count(cases); i++) {
+            BBoxAligned aabb;
+            aabb.min = cases[i].min;
+            aabb.max = cases[i].max;
+            bool visible = IsVisible(buffer, &identity, aabb);
+            if (visible != cases[i].visible) {
+                printf("[Occlusion] Run %u: box %s is %s, expected %s\n", run, cases[i].name, visible ? "visible" : "occluded", cases[i].visible ? "visible" : "occluded");
+                passed = false;
+            }
+        }
+
+        if (run == 0) {
+            memcpy(reference, buffer->depth, sizeof(f32) * OcclusionBuffer::Width * OcclusionBuffer::Height);
+        } else if (memcmp(reference, buffer->depth, sizeof(f32) * OcclusionBuffer::Width * OcclusionBuffer::Height) != 0) {
+            printf("[Occlusion] Depth differs between the runs\n");
+            passed = false;
+        }
+    }
+
+    PlatformFree(reference, nullptr);
+    DestroyOcclusionBuffer(buffer);
+    printf("[Occlusion] Occlusion test %s\n", passed ? "passed" : "failed");
+    return passed;
+}
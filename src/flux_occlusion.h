@@ -0,0 +1,91 @@
+#pragma once
+
+struct Mesh;
+
+// NOTE: Low resolution software depth buffer for occlusion culling. Occluders are only collected on the render thread.
+// Binning jobs transform and near-clip the triangles of their share of occluders and sort them into horizontal bands,
+// then band jobs rasterize them 4 pixels at a time. Every binning job owns a fixed range of occluders and every band
+// is owned by exactly one job, so the result does not depend on the scheduling.
+struct OcclusionBuffer {
+    static constexpr u32 Width = 320;
+    static constexpr u32 Height = 192;
+    static constexpr u32 BandHeight = 16;
+    static constexpr u32 BandCount = Height / BandHeight;
+    static constexpr u32 MaxOccluders = 4096;
+    static constexpr u32 BinJobCount = 8;
+    static constexpr u32 MaxTriangles = 32768;
+    static constexpr u32 BinJobMaxTriangles = MaxTriangles / BinJobCount;
+
+    static_assert(Width % 4 == 0);
+    static_assert(Height % BandHeight == 0);
+    // NOTE: Band lists store triangle indices of a binning job as u16
+    static_assert(BinJobMaxTriangles <= 65536);
+
+    struct Occluder {
+        m4x4 transform;
+        const Mesh* mesh;
+    };
+
+    struct BinJob {
+        OcclusionBuffer* buffer;
+        u32 index;
+        u32 occluderBegin;
+        u32 occluderEnd;
+        u32 triangleCount;
+        u32 bandTriangleCounts[BandCount];
+        b32 overflow;
+    };
+
+    struct BandJob {
+        OcclusionBuffer* buffer;
+        u32 band;
+    };
+
+    m4x4 viewProj;
+    // NOTE: Depth in [0; 1] range, row 0 is the bottom of the screen
+    f32* depth;
+
+    Occluder* occluders;
+    u32 occluderCount;
+
+    // NOTE: Screen space triangles (x, y in pixels, z in [0; 1]) stored as SoA. BinJobMaxTriangles for every binning job
+    f32* x[3];
+    f32* y[3];
+    f32* z[3];
+    // NOTE: Triangles of a binning job which touch a band. BinJobMaxTriangles for every job and band
+    u16* bandTriangles;
+
+    BinJob binJobs[BinJobCount];
+    BandJob jobs[BandCount];
+    // NOTE: Band jobs start when all binning jobs are done
+    u32 volatile binnedJobCount;
+    b32 rasterizing;
+
+    // NOTE: Set by FinishOcclusion
+    u32 triangleCount;
+    b32 overflow;
+};
+
+// NOTE: Requested by the occlusion_test console command, runs on the render thread
+struct OcclusionTestRequest {
+    b32 active;
+};
+
+OcclusionBuffer* CreateOcclusionBuffer();
+void DestroyOcclusionBuffer(OcclusionBuffer* buffer);
+
+void BeginOcclusionFrame(OcclusionBuffer* buffer, const m4x4* viewProj);
+// NOTE: Returns false if the occluder budget is exhausted. Triangles over the budget of a binning job are dropped.
+// The mesh must stay alive until FinishOcclusion
+bool AddOccluder(OcclusionBuffer* buffer, const m4x4* transform, const Mesh* mesh);
+// NOTE: Kicks binning and rasterization jobs on the render queue. Returns immediately
+void RasterizeOccluders(OcclusionBuffer* buffer);
+void FinishOcclusion(OcclusionBuffer* buffer);
+
+// NOTE: Conservative. Boxes crossing the near plane are always visible
+bool IsVisible(const OcclusionBuffer* buffer, const m4x4* transform, BBoxAligned aabb);
+
+// NOTE: Rasterizes a fixed set of occluders twice, checks that the depth is the same and that IsVisible gives
+// the expected results. Does not use GL. Must be called by the thread which owns the render queue. The occlusion_test
+// tool runs it standalone and returns the result as the exit code
+bool RunOcclusionTest();
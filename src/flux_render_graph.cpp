@@ -0,0 +1,416 @@
+#include "flux_render_graph.h"
+
+RenderGraph* CreateRenderGraph() {
+    auto graph = (RenderGraph*)PlatformAlloc(sizeof(RenderGraph), 0, nullptr);
+    *graph = {};
+    return graph;
+}
+
+void DestroyRenderGraph(RenderGraph* graph) {
+    for (u32 i = 0; i < graph->framebufferCount; i++) {
+        glDeleteFramebuffers(1, &graph->framebuffers[i].handle);
+    }
+    for (u32 i = 0; i < graph->poolCount; i++) {
+        glDeleteTextures(1, &graph->pool[i].handle);
+    }
+    PlatformFree(graph, nullptr);
+}
+
+void BeginRenderGraph(RenderGraph* graph) {
+    graph->textureCount = 0;
+    graph->passCount = 0;
+    graph->orderCount = 0;
+    graph->frameIndex++;
+}
+
+RenderGraphTexture CreateTransientTexture(RenderGraph* graph, const char* name, RenderTextureDesc desc) {
+    panic(graph->textureCount < RenderGraph::MaxTextures, "[RenderGraph] Too many textures");
+    RenderGraphTexture result = ++graph->textureCount;
+    auto texture = graph->textures + result;
+    *texture = {};
+    texture->name = name;
+    texture->desc = desc;
+    texture->desc.layers = Max(desc.layers, 1u);
+    texture->desc.samples = Max(desc.samples, 1u);
+    texture->desc.levels = Max(desc.levels, 1u);
+    return result;
+}
+
+RenderGraphTexture ImportTexture(RenderGraph* graph, const char* name, GLuint handle) {
+    panic(graph->textureCount < RenderGraph::MaxTextures, "[RenderGraph] Too many textures");
+    RenderGraphTexture result = ++graph->textureCount;
+    auto texture = graph->textures + result;
+    *texture = {};
+    texture->name = name;
+    texture->handle = handle;
+    texture->imported = true;
+    return result;
+}
+
+u32 AddRenderPass(RenderGraph* graph, const char* name, RenderPassFn* fn, void* data) {
+    panic(graph->passCount < RenderGraph::MaxPasses, "[RenderGraph] Too many passes");
+    u32 result = graph->passCount++;
+    auto pass = graph->passes + result;
+    *pass = {};
+    pass->name = name;
+    pass->fn = fn;
+    pass->data = data;
+    return result;
+}
+
+void ReadTexture(RenderGraph* graph, u32 pass, RenderGraphTexture texture) {
+    auto p = graph->passes + pass;
+    if (texture) {
+        assert(p->readCount < RenderGraph::MaxPassTextures);
+        p->reads[p->readCount++] = texture;
+    }
+}
+
+void WriteTexture(RenderGraph* graph, u32 pass, RenderGraphTexture texture) {
+    auto p = graph->passes + pass;
+    if (texture) {
+        assert(p->writeCount < RenderGraph::MaxPassTextures);
+        p->writes[p->writeCount++] = texture;
+    }
+}
+
+bool PassReads(RenderGraph::Pass* pass, RenderGraphTexture texture) {
+    bool result = false;
+    for (u32 i = 0; i < pass->readCount; i++) {
+        if (pass->reads[i] == texture) {
+            result = true;
+            break;
+        }
+    }
+    return result;
+}
+
+bool PassWrites(RenderGraph::Pass* pass, RenderGraphTexture texture) {
+    bool result = false;
+    for (u32 i = 0; i < pass->writeCount; i++) {
+        if (pass->writes[i] == texture) {
+            result = true;
+            break;
+        }
+    }
+    return result;
+}
+
+void CullRenderPasses(RenderGraph* graph) {
+    for (u32 i = 0; i < graph->passCount; i++) {
+        auto pass = graph->passes + i;
+        for (u32 w = 0; w < pass->writeCount; w++) {
+            if (graph->textures[pass->writes[w]].imported) {
+                pass->alive = true;
+            }
+        }
+    }
+
+    // NOTE: Everything that writes a texture read by a live pass is alive
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (u32 i = 0; i < graph->passCount; i++) {
+            auto pass = graph->passes + i;
+            if (pass->alive) {
+                for (u32 r = 0; r < pass->readCount; r++) {
+                    for (u32 j = 0; j < graph->passCount; j++) {
+                        auto writer = graph->passes + j;
+                        if (!writer->alive && PassWrites(writer, pass->reads[r])) {
+                            writer->alive = true;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void OrderRenderPasses(RenderGraph* graph) {
+    static_assert(RenderGraph::MaxPasses <= 32);
+    u32 aliveMask = 0;
+    for (u32 i = 0; i < graph->passCount; i++) {
+        if (graph->passes[i].alive) {
+            aliveMask |= 1u << i;
+        }
+    }
+
+    // NOTE: Bit j of dependencies[i] means that pass j runs before pass i
+    u32 dependencies[RenderGraph::MaxPasses] = {};
+    for (u32 i = 0; i < graph->passCount; i++) {
+        auto pass = graph->passes + i;
+        for (u32 j = 0; j < graph->passCount; j++) {
+            if (i != j) {
+                auto other = graph->passes + j;
+                for (u32 w = 0; w < other->writeCount; w++) {
+                    RenderGraphTexture texture = other->writes[w];
+                    bool writes = PassWrites(pass, texture);
+                    if ((writes && j < i) || (!writes && PassReads(pass, texture))) {
+                        dependencies[i] |= 1u << j;
+                    }
+                }
+            }
+        }
+        dependencies[i] &= aliveMask;
+    }
+
+    // NOTE: Ready pass declared first goes first, so independent passes keep the declaration order
+    u32 remaining = aliveMask;
+    u32 done = 0;
+    while (remaining) {
+        u32 next = U32::Max;
+        for (u32 i = 0; i < graph->passCount; i++) {
+            if ((remaining & (1u << i)) && !(dependencies[i] & ~done)) {
+                next = i;
+                break;
+            }
+        }
+        if (next == U32::Max) {
+            // NOTE: Cycle. Happens only if two passes read what the other one writes. Running the rest as declared
+            assert(false);
+            for (u32 i = 0; i < graph->passCount; i++) {
+                if (remaining & (1u << i)) {
+                    graph->order[graph->orderCount++] = i;
+                }
+            }
+            break;
+        }
+        graph->order[graph->orderCount++] = next;
+        remaining &= ~(1u << next);
+        done |= 1u << next;
+    }
+}
+
+GLuint CreatePooledTexture(const RenderTextureDesc* desc) {
+    GLuint handle = 0;
+    switch (desc->type) {
+    case RenderTextureType::Texture2D: {
+        glCreateTextures(GL_TEXTURE_2D, 1, &handle);
+        glTextureStorage2D(handle, desc->levels, desc->format, desc->width, desc->height);
+    } break;
+    case RenderTextureType::Texture2DMultisample: {
+        glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &handle);
+        glTextureStorage2DMultisample(handle, desc->samples, desc->format, desc->width, desc->height, GL_FALSE);
+    } break;
+    case RenderTextureType::Texture2DArray: {
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &handle);
+        glTextureStorage3D(handle, desc->levels, desc->format, desc->width, desc->height, desc->layers);
+    } break;
+    invalid_default();
+    }
+    assert(handle);
+
+    if (desc->type != RenderTextureType::Texture2DMultisample) {
+        bool nearest = desc->flags & RenderTextureFlags::Nearest;
+        GLenum minFilter;
+        if (desc->levels > 1) {
+            minFilter = nearest ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR_MIPMAP_LINEAR;
+        } else {
+            minFilter = nearest ? GL_NEAREST : GL_LINEAR;
+        }
+        // NOTE: Clamped since targets could be rendered only partially with dynamic resolution
+        glTextureParameteri(handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(handle, GL_TEXTURE_MIN_FILTER, minFilter);
+        glTextureParameteri(handle, GL_TEXTURE_MAG_FILTER, nearest ? GL_NEAREST : GL_LINEAR);
+        if (desc->flags & RenderTextureFlags::DepthCompare) {
+            glTextureParameteri(handle, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTextureParameteri(handle, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        }
+    }
+    return handle;
+}
+
+GLuint AcquirePooledTexture(RenderGraph* graph, const RenderTextureDesc* desc, bool* aliased) {
+    RenderGraph::PooledTexture* result = nullptr;
+    for (u32 i = 0; i < graph->poolCount; i++) {
+        auto pooled = graph->pool + i;
+        if (!pooled->busy && memcmp(&pooled->desc, desc, sizeof(RenderTextureDesc)) == 0) {
+            result = pooled;
+            break;
+        }
+    }
+    if (!result) {
+        panic(graph->poolCount < RenderGraph::MaxPooledTextures, "[RenderGraph] Texture pool is full");
+        result = graph->pool + graph->poolCount++;
+        *result = {};
+        result->desc = *desc;
+        result->handle = CreatePooledTexture(desc);
+    }
+    // NOTE: Texture was already used by another transient this frame
+    *aliased = result->lastUsedFrame == graph->frameIndex;
+    result->busy = true;
+    result->lastUsedFrame = graph->frameIndex;
+    return result->handle;
+}
+
+void ReturnPooledTexture(RenderGraph* graph, GLuint handle) {
+    for (u32 i = 0; i < graph->poolCount; i++) {
+        if (graph->pool[i].handle == handle) {
+            graph->pool[i].busy = false;
+            break;
+        }
+    }
+}
+
+void AllocateTransientTextures(RenderGraph* graph) {
+    for (u32 i = 1; i <= graph->textureCount; i++) {
+        graph->textures[i].firstUse = U32::Max;
+        graph->textures[i].lastUse = 0;
+    }
+    for (u32 at = 0; at < graph->orderCount; at++) {
+        auto pass = graph->passes + graph->order[at];
+        for (u32 r = 0; r < pass->readCount; r++) {
+            auto texture = graph->textures + pass->reads[r];
+            texture->firstUse = Min(texture->firstUse, at);
+            texture->lastUse = Max(texture->lastUse, at);
+        }
+        for (u32 w = 0; w < pass->writeCount; w++) {
+            auto texture = graph->textures + pass->writes[w];
+            texture->firstUse = Min(texture->firstUse, at);
+            texture->lastUse = Max(texture->lastUse, at);
+        }
+    }
+
+    // NOTE: Walking the passes in order. Textures are returned to the pool after their last use,
+    // so later transients with the same description get them
+    graph->transientTextureCount = 0;
+    graph->aliasedTextureCount = 0;
+    for (u32 at = 0; at < graph->orderCount; at++) {
+        for (u32 i = 1; i <= graph->textureCount; i++) {
+            auto texture = graph->textures + i;
+            if (!texture->imported && texture->firstUse == at) {
+                bool aliased;
+                texture->handle = AcquirePooledTexture(graph, &texture->desc, &aliased);
+                graph->transientTextureCount++;
+                if (aliased) {
+                    graph->aliasedTextureCount++;
+                }
+            }
+        }
+        for (u32 i = 1; i <= graph->textureCount; i++) {
+            auto texture = graph->textures + i;
+            if (!texture->imported && texture->lastUse == at && texture->firstUse <= at) {
+                ReturnPooledTexture(graph, texture->handle);
+            }
+        }
+    }
+}
+
+void ReleaseUnusedPooledTextures(RenderGraph* graph) {
+    u32 at = 0;
+    while (at < graph->poolCount) {
+        auto pooled = graph->pool + at;
+        if (graph->frameIndex - pooled->lastUsedFrame > RenderGraph::PoolReleaseFrames) {
+            ReleaseFramebuffers(graph, pooled->handle);
+            glDeleteTextures(1, &pooled->handle);
+            *pooled = graph->pool[--graph->poolCount];
+        } else {
+            at++;
+        }
+    }
+}
+
+void ExecuteRenderGraph(RenderGraph* graph) {
+    CullRenderPasses(graph);
+    OrderRenderPasses(graph);
+    AllocateTransientTextures(graph);
+    graph->culledPassCount = graph->passCount - graph->orderCount;
+
+    for (u32 at = 0; at < graph->orderCount; at++) {
+        auto pass = graph->passes + graph->order[at];
+        pass->fn(graph, pass->data);
+
+        // NOTE: Contents of transients are not needed after the last use, so the driver could skip storing them
+        for (u32 i = 1; i <= graph->textureCount; i++) {
+            auto texture = graph->textures + i;
+            if (!texture->imported && texture->lastUse == at && texture->firstUse <= at) {
+                for (u32 level = 0; level < texture->desc.levels; level++) {
+                    glInvalidateTexImage(texture->handle, level);
+                }
+            }
+        }
+    }
+
+    ReleaseUnusedPooledTextures(graph);
+}
+
+GLuint GetTextureHandle(RenderGraph* graph, RenderGraphTexture texture) {
+    GLuint result = 0;
+    if (texture) {
+        assert(texture <= graph->textureCount);
+        result = graph->textures[texture].handle;
+    }
+    return result;
+}
+
+GLuint GetFramebuffer(RenderGraph* graph, RenderGraphTexture color, RenderGraphTexture depth, i32 layer) {
+    GLuint result = 0;
+    GLuint colorHandle = GetTextureHandle(graph, color);
+    GLuint depthHandle = GetTextureHandle(graph, depth);
+    if (color && !colorHandle) {
+        // NOTE: Default framebuffer
+        assert(graph->textures[color].imported);
+    } else {
+        RenderGraph::Framebuffer* framebuffer = nullptr;
+        for (u32 i = 0; i < graph->framebufferCount; i++) {
+            auto cached = graph->framebuffers + i;
+            if (cached->color == colorHandle && cached->depth == depthHandle && cached->layer == layer) {
+                framebuffer = cached;
+                break;
+            }
+        }
+
+        if (!framebuffer) {
+            if (graph->framebufferCount == RenderGraph::MaxFramebuffers) {
+                // NOTE: Evicting the least recently used one
+                u32 oldest = 0;
+                for (u32 i = 1; i < graph->framebufferCount; i++) {
+                    if (graph->framebuffers[i].lastUsedFrame < graph->framebuffers[oldest].lastUsedFrame) {
+                        oldest = i;
+                    }
+                }
+                glDeleteFramebuffers(1, &graph->framebuffers[oldest].handle);
+                graph->framebuffers[oldest] = graph->framebuffers[--graph->framebufferCount];
+            }
+
+            framebuffer = graph->framebuffers + graph->framebufferCount++;
+            *framebuffer = {};
+            framebuffer->color = colorHandle;
+            framebuffer->depth = depthHandle;
+            framebuffer->layer = layer;
+            glCreateFramebuffers(1, &framebuffer->handle);
+            assert(framebuffer->handle);
+            GLuint fb = framebuffer->handle;
+            if (layer < 0) {
+                if (colorHandle) glNamedFramebufferTexture(fb, GL_COLOR_ATTACHMENT0, colorHandle, 0);
+                if (depthHandle) glNamedFramebufferTexture(fb, GL_DEPTH_ATTACHMENT, depthHandle, 0);
+            } else {
+                if (colorHandle) glNamedFramebufferTextureLayer(fb, GL_COLOR_ATTACHMENT0, colorHandle, 0, layer);
+                if (depthHandle) glNamedFramebufferTextureLayer(fb, GL_DEPTH_ATTACHMENT, depthHandle, 0, layer);
+            }
+            GLenum colorBuffer = colorHandle ? GL_COLOR_ATTACHMENT0 : GL_NONE;
+            glNamedFramebufferDrawBuffer(fb, colorBuffer);
+            glNamedFramebufferReadBuffer(fb, colorBuffer);
+            assert(glCheckNamedFramebufferStatus(fb, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+        }
+
+        framebuffer->lastUsedFrame = graph->frameIndex;
+        result = framebuffer->handle;
+    }
+    return result;
+}
+
+void ReleaseFramebuffers(RenderGraph* graph, GLuint texture) {
+    u32 at = 0;
+    while (at < graph->framebufferCount) {
+        auto framebuffer = graph->framebuffers + at;
+        if (texture && (framebuffer->color == texture || framebuffer->depth == texture)) {
+            glDeleteFramebuffers(1, &framebuffer->handle);
+            *framebuffer = graph->framebuffers[--graph->framebufferCount];
+        } else {
+            at++;
+        }
+    }
+}
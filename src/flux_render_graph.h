@@ -0,0 +1,125 @@
+#pragma once
+
+struct RenderGraph;
+
+enum struct RenderTextureType : u32 {
+    Texture2D = 0, Texture2DMultisample, Texture2DArray
+};
+
+struct RenderTextureFlags {
+    // NOTE: Comparison sampling for shadow samplers
+    static constexpr u32 DepthCompare = 1 << 0;
+    static constexpr u32 Nearest = 1 << 1;
+};
+
+// NOTE: Transients with equal descriptions may share one GL texture, so everything that makes textures
+// incompatible goes here. Layers are used by array textures and samples by multisampled ones
+struct RenderTextureDesc {
+    RenderTextureType type;
+    GLenum format;
+    u32 width;
+    u32 height;
+    u32 layers;
+    u32 samples;
+    u32 levels;
+    u32 flags;
+};
+
+// NOTE: Index of a texture declared this frame. Zero is null
+typedef u32 RenderGraphTexture;
+
+typedef void(RenderPassFn)(RenderGraph* graph, void* data);
+
+// NOTE: Frame graph. Passes are declared every frame together with the textures they read and write, then the graph
+// culls passes which do not contribute to an imported texture, orders the rest by their dependencies and backs
+// transient textures with pooled GL textures. Transients of the same description share a texture when their
+// lifetimes do not overlap and are invalidated after the last pass which uses them, so an intermediate target
+// costs memory only while something needs it. Imported textures are owned by the caller and outlive the frame,
+// so passes which write them are never culled.
+// A texture has a single version per frame. Writers run in the order they were declared and every other pass
+// which reads the texture runs after all of them
+struct RenderGraph {
+    static constexpr u32 MaxPasses = 32;
+    static constexpr u32 MaxTextures = 32;
+    static constexpr u32 MaxPassTextures = 8;
+    static constexpr u32 MaxPooledTextures = 32;
+    static constexpr u32 MaxFramebuffers = 32;
+    // NOTE: Pooled textures which were not used for that many frames are deleted
+    static constexpr u32 PoolReleaseFrames = 8;
+
+    struct Texture {
+        const char* name;
+        RenderTextureDesc desc;
+        GLuint handle;
+        b32 imported;
+        // NOTE: Positions in the execution order. Unused textures have first > last
+        u32 firstUse;
+        u32 lastUse;
+    };
+
+    struct Pass {
+        const char* name;
+        RenderPassFn* fn;
+        void* data;
+        RenderGraphTexture reads[MaxPassTextures];
+        RenderGraphTexture writes[MaxPassTextures];
+        u32 readCount;
+        u32 writeCount;
+        b32 alive;
+    };
+
+    struct PooledTexture {
+        RenderTextureDesc desc;
+        GLuint handle;
+        u64 lastUsedFrame;
+        b32 busy;
+    };
+
+    struct Framebuffer {
+        GLuint handle;
+        GLuint color;
+        GLuint depth;
+        i32 layer;
+        u64 lastUsedFrame;
+    };
+
+    Texture textures[MaxTextures + 1];
+    u32 textureCount;
+    Pass passes[MaxPasses];
+    u32 passCount;
+    u32 order[MaxPasses];
+    u32 orderCount;
+
+    PooledTexture pool[MaxPooledTextures];
+    u32 poolCount;
+    Framebuffer framebuffers[MaxFramebuffers];
+    u32 framebufferCount;
+    u64 frameIndex;
+
+    // NOTE: Stats of the last frame
+    u32 culledPassCount;
+    u32 transientTextureCount;
+    u32 aliasedTextureCount;
+};
+
+RenderGraph* CreateRenderGraph();
+void DestroyRenderGraph(RenderGraph* graph);
+
+void BeginRenderGraph(RenderGraph* graph);
+RenderGraphTexture CreateTransientTexture(RenderGraph* graph, const char* name, RenderTextureDesc desc);
+// NOTE: Zero handle is the default framebuffer
+RenderGraphTexture ImportTexture(RenderGraph* graph, const char* name, GLuint handle);
+u32 AddRenderPass(RenderGraph* graph, const char* name, RenderPassFn* fn, void* data);
+void ReadTexture(RenderGraph* graph, u32 pass, RenderGraphTexture texture);
+void WriteTexture(RenderGraph* graph, u32 pass, RenderGraphTexture texture);
+// NOTE: Culls and orders the passes, assigns pooled textures to transients and runs the passes
+void ExecuteRenderGraph(RenderGraph* graph);
+
+// NOTE: These are valid only inside of the passes
+GLuint GetTextureHandle(RenderGraph* graph, RenderGraphTexture texture);
+// NOTE: Framebuffers are cached by attachments. Layer -1 attaches all the layers. Null color gives depth only framebuffer
+// and the default framebuffer is returned when color is the imported zero handle
+GLuint GetFramebuffer(RenderGraph* graph, RenderGraphTexture color, RenderGraphTexture depth, i32 layer = -1);
+
+// NOTE: Drops cached framebuffers with the texture attached. Call before deleting or reallocating an imported texture
+void ReleaseFramebuffers(RenderGraph* graph, GLuint texture);
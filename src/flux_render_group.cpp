@@ -1,74 +1,109 @@
 #include "flux_render_group.h"
 #include "Memory.h"
 
-RenderGroup RenderGroup::Make(uptr renderBufferSize, u32 commandQueueCapacity) {
+RenderGroup RenderGroup::Make(u32 commandQueueCapacity) {
     RenderGroup group = {};
     group.commandQueueCapacity = commandQueueCapacity;
     group.commandQueue = (CommandQueueEntry*)PlatformAlloc(sizeof(CommandQueueEntry) * commandQueueCapacity, 0, nullptr);
 
-    group.renderBufferSize = renderBufferSize;
-    group.renderBufferFree = renderBufferSize;
-    group.renderBuffer = (byte*)PlatformAlloc(renderBufferSize, 0, nullptr);
-    group.renderBufferAt = group.renderBuffer;
+    group.pointLights = (PointLight*)PlatformAlloc(sizeof(PointLight) * RenderGroup::MaxLocalLights, 0, nullptr);
+    group.spotLights = (SpotLight*)PlatformAlloc(sizeof(SpotLight) * RenderGroup::MaxLocalLights, 0, nullptr);
+
+    for (u32x i = 0; i < DebugLineBatch::WidthBucketCount; i++) {
+        group.debugLines.vertices[i] = (DebugLineVertex*)PlatformAlloc(sizeof(DebugLineVertex) * DebugLineBatch::MaxBucketVertices, 0, nullptr);
+    }
 
     return group;
 }
 
 void ValidateCommand(RenderGroup* group, RenderCommand type) {
     if ((type == RenderCommand::LinePushVertex) || (type == RenderCommand::LineEnd)) {
-        assert(group->pendingLineBatchCommandHeader);
+        assert(group->lineBlockOpen);
     } else {
-        assert(!group->pendingLineBatchCommandHeader);
+        assert(!group->lineBlockOpen);
     }
 }
 
-void* PushRenderData(RenderGroup* group, u32 size, u32 aligment, void* data) {
-    uptr padding = 0;
-    u32 useAligment = 0;
-    byte* currentAt = group->renderBufferAt;
+byte* ChunkData(RenderChunk* chunk) {
+    return (byte*)chunk + sizeof(RenderChunk);
+}
 
-    if (aligment == 0)  {
-        useAligment = 1;
-    } else {
-        useAligment = aligment;
+void* PushRenderData(RenderChunkList* list, u32 size, u32 aligment, void* data) {
+    uptr useAligment = aligment ? aligment : 1;
+    // NOTE: Worst case padding, so the size check does not depend on the chunk address
+    uptr required = size + useAligment - 1;
+
+    auto chunk = list->current;
+    while (chunk && (chunk->at + required > chunk->size)) {
+        chunk = chunk->next;
+        if (chunk) {
+            chunk->at = 0;
+        }
     }
 
-    if ((uptr)currentAt % useAligment != 0) {
-        padding = CalculatePadding((uptr)currentAt, useAligment);
+    if (!chunk) {
+        uptr chunkSize = Max(RenderChunkList::DefaultChunkSize, required);
+        chunk = (RenderChunk*)PlatformAlloc(sizeof(RenderChunk) + chunkSize, 0, nullptr);
+        chunk->next = nullptr;
+        chunk->size = chunkSize;
+        chunk->at = 0;
+        if (list->current) {
+            // NOTE: Current is the last chunk here. Skipped chunks are too small for this allocation
+            auto last = list->current;
+            while (last->next) last = last->next;
+            last->next = chunk;
+        } else {
+            list->first = chunk;
+        }
     }
+    list->current = chunk;
 
-
-    group->renderBufferAt += size + padding;
-    group->renderBufferFree -= size + padding;
+    byte* currentAt = ChunkData(chunk) + chunk->at;
+    uptr padding = CalculatePadding((uptr)currentAt, useAligment);
     byte* nextAt = currentAt + padding;
+    chunk->at += size + padding;
 
-    assert((uptr)nextAt % (uptr)useAligment == 0);
-    assert(size + padding < group->renderBufferFree);
+    assert((uptr)nextAt % useAligment == 0);
+    assert(chunk->at <= chunk->size);
 
     memcpy(nextAt, data, size);
 
     return (void*)nextAt;
 }
 
-CommandQueueEntry* PushCommandQueueEntry(RenderGroup* renderGroup, CommandQueueEntry cmd)
-{
-    assert(renderGroup->commandQueueAt < renderGroup->commandQueueCapacity);
-    CommandQueueEntry* renderBucketDest = renderGroup->commandQueue + renderGroup->commandQueueAt;
-    memcpy(renderBucketDest, &cmd, sizeof(CommandQueueEntry));
-    renderGroup->commandQueueAt++;
-    return renderBucketDest;
+void Reset(RenderChunkList* list) {
+    list->current = list->first;
+    if (list->current) {
+        list->current->at = 0;
+    }
 }
 
-void Push(RenderGroup* group, RenderCommandDrawMesh* command) {
-    ValidateCommand(group, RenderCommand::DrawMesh);
+// NOTE: Doubles the capacity of the array when it is full
+void PushCommandQueueEntry(CommandQueueEntry** queue, u32* capacity, u32* at, CommandQueueEntry cmd) {
+    if (*at == *capacity) {
+        u32 newCapacity = Max(*capacity * 2, 256u);
+        auto newQueue = (CommandQueueEntry*)PlatformAlloc(sizeof(CommandQueueEntry) * newCapacity, 0, nullptr);
+        if (*queue) {
+            memcpy(newQueue, *queue, sizeof(CommandQueueEntry) * *at);
+            PlatformFree(*queue, nullptr);
+        }
+        *queue = newQueue;
+        *capacity = newCapacity;
+    }
+    (*queue)[*at] = cmd;
+    (*at)++;
+}
 
-    auto renderDataPtr = PushRenderData(group, sizeof(RenderCommandDrawMesh), alignof(RenderCommandDrawMesh), command);
+void PushCommandQueueEntry(RenderGroup* group, CommandQueueEntry cmd) {
+    PushCommandQueueEntry(&group->commandQueue, &group->commandQueueCapacity, &group->commandQueueAt, cmd);
+}
 
-    uptr offset = (uptr)renderDataPtr - (uptr)group->renderBuffer;
+void Push(RenderGroup* group, RenderCommandDrawMesh* command) {
+    ValidateCommand(group, RenderCommand::DrawMesh);
 
     CommandQueueEntry entry = {};
     entry.type = RenderCommand::DrawMesh;
-    entry.rbOffset = offset;
+    entry.data = PushRenderData(&group->renderData, sizeof(RenderCommandDrawMesh), alignof(RenderCommandDrawMesh), command);
 
     PushCommandQueueEntry(group, entry);
 }
@@ -78,132 +113,102 @@ void Push(RenderGroup* group, RenderCommandSetDirLight* command) {
     group->dirLight = command->light;
 }
 
-void Push(RenderGroup* group, RenderCommandLineBegin* command) {
-    ValidateCommand(group, RenderCommand::LineBegin);
+// NOTE: Lights above the limit are dropped
+void Push(RenderGroup* group, RenderCommandPushPointLight* command) {
+    ValidateCommand(group, RenderCommand::PushPointLight);
+    if (group->pointLightCount + group->spotLightCount < RenderGroup::MaxLocalLights) {
+        group->pointLights[group->pointLightCount++] = command->light;
+    }
+}
 
-    auto renderDataPtr = PushRenderData(group,  sizeof(RenderCommandLineBegin), alignof(RenderCommandLineBegin), command);
+void Push(RenderGroup* group, RenderCommandPushSpotLight* command) {
+    ValidateCommand(group, RenderCommand::PushSpotLight);
+    if (group->pointLightCount + group->spotLightCount < RenderGroup::MaxLocalLights) {
+        group->spotLights[group->spotLightCount++] = command->light;
+    }
+}
 
-    CommandQueueEntry entry = {};
-    entry.type = RenderCommand::LineBegin;
-    entry.rbOffset = (uptr)renderDataPtr - (uptr)group->renderBuffer;
-    entry.instanceCount = 0;
-    auto header = PushCommandQueueEntry(group, entry);
-    group->pendingLineBatchCommandHeader = header;
+void Push(RenderGroup* group, RenderCommandLineBegin* command) {
+    ValidateCommand(group, RenderCommand::LineBegin);
+    group->lineBlockOpen = true;
+    group->lineBlock = *command;
+    group->lineBlockVertexCount = 0;
 }
 
 void Push(RenderGroup* group, RenderCommandPushLineVertex* command) {
     ValidateCommand(group, RenderCommand::LinePushVertex);
-
-    PushRenderData(group, sizeof(RenderCommandPushLineVertex), alignof(RenderCommandPushLineVertex), command);
-    group->pendingLineBatchCommandHeader->instanceCount++;
+    auto block = &group->lineBlock;
+    bool closesSegment = (block->type == RenderCommandLineBegin::Strip) ? (group->lineBlockVertexCount > 0) : (group->lineBlockVertexCount % 2 == 1);
+    if (closesSegment) {
+        DrawDebugLine(group, group->lineBlockLastVertex, command->vertex, block->color, block->width);
+    }
+    group->lineBlockLastVertex = command->vertex;
+    group->lineBlockVertexCount++;
 }
 
 void Push(RenderGroup* group, RenderCommandLineEnd* command) {
     ValidateCommand(group, RenderCommand::LineEnd);
-    group->pendingLineBatchCommandHeader = nullptr;
+    group->lineBlockOpen = false;
 }
 
 void Push(RenderGroup* group, RenderCommandDrawWater* command) {
     ValidateCommand(group, RenderCommand::DrawWater);
 
-    auto renderDataPtr = PushRenderData(group, sizeof(RenderCommandDrawWater), alignof(RenderCommandDrawWater), command);
-
-    uptr offset = (uptr)renderDataPtr - (uptr)group->renderBuffer;
-
     CommandQueueEntry entry = {};
     entry.type = RenderCommand::DrawWater;
-    entry.rbOffset = offset;
+    entry.data = PushRenderData(&group->renderData, sizeof(RenderCommandDrawWater), alignof(RenderCommandDrawWater), command);
 
     PushCommandQueueEntry(group, entry);
 }
 
-void Reset(RenderGroup* group) {
-    group->commandQueueAt = 0;
-    group->renderBufferAt = group->renderBuffer;
-    group->renderBufferFree = group->renderBufferSize;
+RenderCommandRecorder* GetRecorder(RenderGroup* group, u32 index) {
+    assert(index < RenderGroup::MaxRecorders);
+    group->recorderCount = Max(group->recorderCount, index + 1);
+    return group->recorders + index;
 }
 
-void DrawAlignedBoxOutline(RenderGroup* renderGroup, v3 min, v3 max, v3 color, f32 lineWidth) {
-    RenderCommandLineBegin beginCommand = {};
-    beginCommand.color = color;
-    beginCommand.width = lineWidth;
-    beginCommand.type = RenderCommandLineBegin::Segments;
-
-    Push(renderGroup, &beginCommand);
-
-    RenderCommandPushLineVertex v0Command = {};
-    v0Command.vertex = min;
-    Push(renderGroup, &v0Command);
-
-    RenderCommandPushLineVertex v1Command = {};
-    v1Command.vertex = V3(max.x, min.y, min.z);
-    Push(renderGroup, &v1Command);
-    Push(renderGroup, &v1Command);
-
-    RenderCommandPushLineVertex v2Command = {};
-    v2Command.vertex = V3(max.x, min.y, max.z);
-    Push(renderGroup, &v2Command);
-    Push(renderGroup, &v2Command);
-
-    RenderCommandPushLineVertex v3Command = {};
-    v3Command.vertex = V3(min.x, min.y, max.z);
-    Push(renderGroup, &v3Command);
-    Push(renderGroup, &v3Command);
-
-    Push(renderGroup, &v0Command);
-
-    RenderCommandPushLineVertex v4Command = {};
-    v4Command.vertex = V3(min.x, max.y, min.z);
-    Push(renderGroup, &v4Command);
-
-    RenderCommandPushLineVertex v5Command = {};
-    v5Command.vertex = V3(max.x, max.y, min.z);
-    Push(renderGroup, &v5Command);
-    Push(renderGroup, &v5Command);
-
-    RenderCommandPushLineVertex v6Command = {};
-    v6Command.vertex = V3(max.x, max.y, max.z);
-    Push(renderGroup, &v6Command);
-    Push(renderGroup, &v6Command);
-
-    RenderCommandPushLineVertex v7Command = {};
-    v7Command.vertex = V3(min.x, max.y, max.z);
-    Push(renderGroup, &v7Command);
-    Push(renderGroup, &v7Command);
-
-    Push(renderGroup, &v4Command);
-
-    Push(renderGroup, &v0Command);
-    Push(renderGroup, &v4Command);
-
-    Push(renderGroup, &v1Command);
-    Push(renderGroup, &v5Command);
-
-    Push(renderGroup, &v2Command);
-    Push(renderGroup, &v6Command);
-
-    Push(renderGroup, &v3Command);
-    Push(renderGroup, &v7Command);
+void Push(RenderCommandRecorder* recorder, RenderCommandDrawMesh* command) {
+    CommandQueueEntry entry = {};
+    entry.type = RenderCommand::DrawMesh;
+    entry.data = PushRenderData(&recorder->data, sizeof(RenderCommandDrawMesh), alignof(RenderCommandDrawMesh), command);
 
-    RenderCommandLineEnd end = {};
-    Push(renderGroup, &end);
+    PushCommandQueueEntry(&recorder->entries, &recorder->entryCapacity, &recorder->entryCount, entry);
 }
 
-void DrawStraightLine(RenderGroup* renderGroup, v3 begin, v3 end, v3 color, f32 lineWidth) {
-    RenderCommandLineBegin beginCommand = {};
-    beginCommand.color = color;
-    beginCommand.width = lineWidth;
-    beginCommand.type = RenderCommandLineBegin::Segments;
-    Push(renderGroup, &beginCommand);
+void Push(RenderCommandRecorder* recorder, RenderCommandDrawWater* command) {
+    CommandQueueEntry entry = {};
+    entry.type = RenderCommand::DrawWater;
+    entry.data = PushRenderData(&recorder->data, sizeof(RenderCommandDrawWater), alignof(RenderCommandDrawWater), command);
 
-    RenderCommandPushLineVertex v0Command = {};
-    v0Command.vertex = begin;
-    Push(renderGroup, &v0Command);
+    PushCommandQueueEntry(&recorder->entries, &recorder->entryCapacity, &recorder->entryCount, entry);
+}
 
-    RenderCommandPushLineVertex v1Command = {};
-    v1Command.vertex = end;
-    Push(renderGroup, &v1Command);
+void MergeRecorders(RenderGroup* group) {
+    assert(!group->lineBlockOpen);
+    for (u32 i = 0; i < group->recorderCount; i++) {
+        auto recorder = group->recorders + i;
+        for (u32 j = 0; j < recorder->entryCount; j++) {
+            PushCommandQueueEntry(group, recorder->entries[j]);
+        }
+        // NOTE: Data stays in the recorder chunks until the group is reset
+        recorder->entryCount = 0;
+    }
+}
 
-    RenderCommandLineEnd endCommand = {};
-    Push(renderGroup, &endCommand);
+void Reset(RenderGroup* group) {
+    group->commandQueueAt = 0;
+    group->scene = nullptr;
+    group->sceneUpdates = nullptr;
+    group->sceneUpdateCount = 0;
+    Reset(&group->renderData);
+    for (u32 i = 0; i < group->recorderCount; i++) {
+        Reset(&group->recorders[i].data);
+        group->recorders[i].entryCount = 0;
+    }
+    group->pointLightCount = 0;
+    group->spotLightCount = 0;
+    for (u32x i = 0; i < DebugLineBatch::WidthBucketCount; i++) {
+        group->debugLines.vertexCount[i] = 0;
+    }
+    group->debugLines.overflow = false;
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include "flux_renderer.h"
+#include "flux_spherical_harmonics.h"
 #include "flux_world.h"
+#include "flux_debug_draw.h"
 
 struct DirectionalLight {
     v3 from;
@@ -10,6 +12,23 @@ struct DirectionalLight {
     v3 specular;
 };
 
+// NOTE: Color is premultiplied by intensity. Lights have no effect beyond the radius
+struct PointLight {
+    v3 position;
+    f32 radius;
+    v3 color;
+};
+
+struct SpotLight {
+    v3 position;
+    f32 radius;
+    v3 direction;
+    // NOTE: Half-angles of the cone in degrees. Falloff happens between them
+    f32 innerAngle;
+    f32 outerAngle;
+    v3 color;
+};
+
 enum struct RenderCommand : u32 {
     DrawMesh = 1,
     SetDirLight,
@@ -17,11 +36,15 @@ enum struct RenderCommand : u32 {
     LinePushVertex,
     LineEnd,
     DrawWater,
+    PushPointLight,
+    PushSpotLight,
 };
 
 struct Mesh;
 struct Material;
 struct Texture;
+struct RenderScene;
+struct RenderSceneUpdate;
 
 struct RenderCommandDrawWater {
     m4x4 transform;
@@ -34,12 +57,30 @@ struct RenderCommandDrawMesh {
     // TODO: Pointer?
     Material material;
     enum DrawMeshFlags : u32 { Highlight, Wireframe } flags;
+    // NOTE: Static meshes are drawn to the cached shadow map layers
+    b32 dynamic;
+    // NOTE: Rasterized to the software occlusion buffer before the main pass
+    b32 occluder;
+    // NOTE: One-based slot in the render scene. Zero for draws pushed this frame
+    u32 objectIndex;
 };
 
 struct RenderCommandSetDirLight {
     DirectionalLight light;
 };
 
+// NOTE: Local lights are not queued. Like the directional light they are collected by the group
+// and used by the whole frame
+struct RenderCommandPushPointLight {
+    PointLight light;
+};
+
+struct RenderCommandPushSpotLight {
+    SpotLight light;
+};
+
+// NOTE: Lines are not queued. Vertices go straight to the debug line batch of the group, strips are split
+// to segments
 struct RenderCommandLineBegin {
     enum RenderLineType : u32 { Segments, Strip } type;
     v3 color;
@@ -53,44 +94,96 @@ struct RenderCommandPushLineVertex {
 struct RenderCommandLineEnd {};
 
 struct CommandQueueEntry {
-    uptr rbOffset;
+    void* data;
     RenderCommand type;
     u32 instanceCount;
 };
 
+// NOTE: Command data storage. Chunks are linked in a list and kept between frames, reset only rewinds them.
+// When the current chunk is full the next one is used or a new one is allocated, so pointers to the data
+// stay valid until reset
+struct RenderChunk {
+    RenderChunk* next;
+    uptr size;
+    uptr at;
+};
+
+struct RenderChunkList {
+    static constexpr uptr DefaultChunkSize = 256 * 1024;
+    RenderChunk* first;
+    RenderChunk* current;
+};
+
+// NOTE: Records draw commands on a worker thread. Every job gets its own recorder, so recording needs
+// no synchronization. Recorded entries are appended to the group queue by MergeRecorders on the main thread.
+// Lights and lines are collected by the group itself and must be pushed from the main thread
+struct RenderCommandRecorder {
+    RenderChunkList data;
+    CommandQueueEntry* entries;
+    u32 entryCapacity;
+    u32 entryCount;
+};
+
 struct RenderGroup {
     const CameraBase* camera;
 
     DirectionalLight dirLight;
 
-    byte* renderBuffer;
-    byte* renderBufferAt;
-    uptr renderBufferSize;
-    uptr renderBufferFree;
+    // NOTE: Shared by point and spot lights
+    static constexpr u32 MaxLocalLights = 1024;
+    PointLight* pointLights;
+    u32 pointLightCount;
+    SpotLight* spotLights;
+    u32 spotLightCount;
+
+    RenderChunkList renderData;
 
-    CommandQueueEntry* pendingLineBatchCommandHeader;
+    DebugLineBatch debugLines;
+    // NOTE: State of the open LineBegin/LineEnd block
+    b32 lineBlockOpen;
+    RenderCommandLineBegin lineBlock;
+    u32 lineBlockVertexCount;
+    v3 lineBlockLastVertex;
 
+    // NOTE: Grows when full
     CommandQueueEntry* commandQueue;
     u32 commandQueueCapacity;
     u32 commandQueueAt;
 
+    static constexpr u32 MaxRecorders = 64;
+    RenderCommandRecorder recorders[MaxRecorders];
+    u32 recorderCount;
+
+    // NOTE: Scene submitted this frame, if any, and its changes since the previous submit
+    RenderScene* scene;
+    RenderSceneUpdate* sceneUpdates;
+    u32 sceneUpdateCount;
+
     b32 drawSkybox;
     u32 skyboxHandle;
 
-    u32 irradanceMapHandle;
+    SH9 irradianceSH;
     u32 envMapHandle;
 
-    static RenderGroup Make(uptr renderBufferSize, u32 commandQueueCapacity);
+    static RenderGroup Make(u32 commandQueueCapacity);
 };
 
 void Push(RenderGroup* group, RenderCommandDrawMesh* command);
 void Push(RenderGroup* group, RenderCommandSetDirLight* command);
+void Push(RenderGroup* group, RenderCommandPushPointLight* command);
+void Push(RenderGroup* group, RenderCommandPushSpotLight* command);
 void Push(RenderGroup* group, RenderCommandLineBegin* command);
 void Push(RenderGroup* group, RenderCommandPushLineVertex* command);
 void Push(RenderGroup* group, RenderCommandLineEnd* command);
 void Push(RenderGroup* group, RenderCommandDrawWater* command);
 
+// NOTE: Recorders are created on demand. Should be called on the main thread before the jobs are kicked
+RenderCommandRecorder* GetRecorder(RenderGroup* group, u32 index);
+void Push(RenderCommandRecorder* recorder, RenderCommandDrawMesh* command);
+void Push(RenderCommandRecorder* recorder, RenderCommandDrawWater* command);
+// NOTE: Appends commands of the recorders to the group queue in recorder order, so the result does not
+// depend on the job scheduling
+void MergeRecorders(RenderGroup* group);
+
 void Reset(RenderGroup* group);
 
-void DrawAlignedBoxOutline(RenderGroup* renderGroup, v3 min, v3 max, v3 color, f32 lineWidth);
-void DrawStraightLine(RenderGroup* renderGroup, v3 begin, v3 end, v3 color, f32 lineWidth);
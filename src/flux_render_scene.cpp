@@ -0,0 +1,151 @@
+#include "flux_render_scene.h"
+
+RenderScene RenderScene::Make() {
+    RenderScene scene = {};
+    scene.objects = (RenderCommandDrawMesh*)PlatformAlloc(sizeof(RenderCommandDrawMesh) * RenderScene::MaxObjects, 0, nullptr);
+    scene.alive = (b32*)PlatformAlloc(sizeof(b32) * RenderScene::MaxObjects, 0, nullptr);
+    scene.freeList = (u32*)PlatformAlloc(sizeof(u32) * RenderScene::MaxObjects, 0, nullptr);
+    scene.entries = (CommandQueueEntry*)PlatformAlloc(sizeof(CommandQueueEntry) * RenderScene::MaxObjects, 0, nullptr);
+    scene.dirtyBegin = RenderScene::MaxObjects;
+    scene.dirtyEnd = 0;
+    return scene;
+}
+
+void MarkObjectDirty(RenderScene* scene, u32 index) {
+    scene->dirtyBegin = Min(scene->dirtyBegin, index);
+    scene->dirtyEnd = Max(scene->dirtyEnd, index + 1);
+}
+
+RenderSceneUpdate* PushRenderSceneUpdate(RenderScene* scene, RenderSceneUpdateType type, u32 handle) {
+    if (scene->updateCount == scene->updateCapacity) {
+        u32 newCapacity = Max(scene->updateCapacity * 2, 256u);
+        auto newUpdates = (RenderSceneUpdate*)PlatformAlloc(sizeof(RenderSceneUpdate) * newCapacity, 0, nullptr);
+        if (scene->updates) {
+            memcpy(newUpdates, scene->updates, sizeof(RenderSceneUpdate) * scene->updateCount);
+            PlatformFree(scene->updates, nullptr);
+        }
+        scene->updates = newUpdates;
+        scene->updateCapacity = newCapacity;
+    }
+    auto update = scene->updates + scene->updateCount++;
+    update->type = type;
+    update->handle = handle;
+    return update;
+}
+
+u32 CreateRenderObject(RenderScene* scene, const RenderCommandDrawMesh* command) {
+    u32 result = 0;
+    u32 index = 0;
+    bool found = false;
+    if (scene->freeCount) {
+        index = scene->freeList[--scene->freeCount];
+        found = true;
+    } else if (scene->objectCount < RenderScene::MaxObjects) {
+        index = scene->objectCount++;
+        found = true;
+    }
+
+    if (found) {
+        scene->alive[index] = true;
+        scene->liveCount++;
+        scene->entriesDirty = true;
+        result = index + 1;
+        auto update = PushRenderSceneUpdate(scene, RenderSceneUpdateType::Set, result);
+        update->command = *command;
+    } else if (!scene->full) {
+        scene->full = true;
+        printf("[Render scene] Scene is full (%u objects). Objects over the limit are not drawn\n", RenderScene::MaxObjects);
+    }
+    return result;
+}
+
+void ValidateRenderObject(RenderScene* scene, u32 handle) {
+    assert(handle && handle <= scene->objectCount);
+    assert(scene->alive[handle - 1]);
+}
+
+void UpdateRenderObject(RenderScene* scene, u32 handle, const RenderCommandDrawMesh* command) {
+    ValidateRenderObject(scene, handle);
+    auto update = PushRenderSceneUpdate(scene, RenderSceneUpdateType::Set, handle);
+    update->command = *command;
+}
+
+void UpdateTransform(RenderScene* scene, u32 handle, const m4x4* transform) {
+    ValidateRenderObject(scene, handle);
+    auto update = PushRenderSceneUpdate(scene, RenderSceneUpdateType::Transform, handle);
+    update->command.transform = *transform;
+}
+
+void DestroyRenderObject(RenderScene* scene, u32 handle) {
+    if (handle) {
+        ValidateRenderObject(scene, handle);
+        scene->alive[handle - 1] = false;
+        scene->freeList[scene->freeCount++] = handle - 1;
+        scene->liveCount--;
+        scene->entriesDirty = true;
+        scene->full = false;
+    }
+}
+
+void Clear(RenderScene* scene) {
+    scene->objectCount = 0;
+    scene->liveCount = 0;
+    scene->freeCount = 0;
+    scene->entryCount = 0;
+    scene->entriesDirty = false;
+    scene->full = false;
+    // NOTE: Pending updates refer to the old handles
+    scene->updateCount = 0;
+}
+
+void SubmitRenderScene(RenderGroup* group, RenderScene* scene) {
+    ValidateCommand(group, RenderCommand::DrawMesh);
+    if (scene->entriesDirty) {
+        scene->entriesDirty = false;
+        scene->entryCount = 0;
+        for (u32 i = 0; i < scene->objectCount; i++) {
+            if (scene->alive[i]) {
+                auto entry = scene->entries + scene->entryCount++;
+                *entry = {};
+                entry->type = RenderCommand::DrawMesh;
+                // NOTE: Only the address is taken here, the object is written by the render thread
+                entry->data = scene->objects + i;
+            }
+        }
+    }
+
+    for (u32 i = 0; i < scene->entryCount; i++) {
+        PushCommandQueueEntry(group, scene->entries[i]);
+    }
+
+    assert(!group->scene);
+    group->scene = scene;
+    if (scene->updateCount) {
+        group->sceneUpdates = (RenderSceneUpdate*)PushRenderData(&group->renderData, sizeof(RenderSceneUpdate) * scene->updateCount, alignof(RenderSceneUpdate), scene->updates);
+        group->sceneUpdateCount = scene->updateCount;
+        scene->updateCount = 0;
+    }
+}
+
+void ApplyRenderSceneUpdates(RenderGroup* group) {
+    auto scene = group->scene;
+    if (scene) {
+        for (u32 i = 0; i < group->sceneUpdateCount; i++) {
+            auto update = group->sceneUpdates + i;
+            u32 index = update->handle - 1;
+            auto object = scene->objects + index;
+            switch (update->type) {
+            case RenderSceneUpdateType::Set: {
+                *object = update->command;
+                object->objectIndex = update->handle;
+            } break;
+            case RenderSceneUpdateType::Transform: {
+                object->transform = update->command.transform;
+            } break;
+            invalid_default();
+            }
+            MarkObjectDirty(scene, index);
+        }
+        group->sceneUpdateCount = 0;
+    }
+}
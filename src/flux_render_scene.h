@@ -0,0 +1,87 @@
+#pragma once
+#include "flux_render_group.h"
+
+// NOTE: Changes made by the update thread. The render thread applies them to the objects before drawing,
+// so the scene can be modified while the previous frame is drawn
+enum struct RenderSceneUpdateType : u32 {
+    Set, Transform
+};
+
+struct ShaderMeshData;
+
+// NOTE: Assets of an object resolved by the renderer, so passes do not look them up every frame. Kept until the object
+// changes or an asset is added, loaded or unloaded
+struct RenderObjectAssets {
+    static constexpr u32 TextureUnits = 16;
+    // NOTE: Generation of the asset manager the assets were resolved at. Zero if the object changed since
+    u32 generation;
+    // NOTE: Null while the mesh is loading
+    Mesh* mesh;
+    b32 pbr;
+    // NOTE: Phong only. Bit 0 is set if the diffuse map is bound, bit 1 for the specular map
+    u32 mapMask;
+    // NOTE: PBR only. Features of the bound maps, HasBitangents is added per submesh
+    u32 pbrFeatures;
+    // NOTE: Texture of every unit the material uses, zero if the unit is not used or the texture is loading
+    u32 textures[TextureUnits];
+};
+
+struct RenderSceneUpdate {
+    RenderSceneUpdateType type;
+    u32 handle;
+    // NOTE: Only transform is valid for Transform updates
+    RenderCommandDrawMesh command;
+};
+
+// NOTE: Retained draw data. Objects live until they are destroyed, so static geometry is not pushed every frame.
+// Objects are stored as the same draw commands the queue uses and the queue references them in place, so passes
+// consume them unchanged. The renderer keeps uniform values and resolved assets of every object, updated only for the
+// objects which changed, and uploads the changed uniform values to the object buffer of the GPU-driven passes
+struct RenderScene {
+    static constexpr u32 MaxObjects = 16384;
+
+    // NOTE: Handles and queue entries are owned by the update thread
+    b32* alive;
+    // NOTE: Number of slots ever used. Freed slots below it are in the free list
+    u32 objectCount;
+    u32 liveCount;
+    u32* freeList;
+    u32 freeCount;
+
+    // NOTE: Queue entries of the live objects. Rebuilt only after objects are created or destroyed
+    CommandQueueEntry* entries;
+    u32 entryCount;
+    b32 entriesDirty;
+
+    // NOTE: Pending until the next submit. Grows when full
+    RenderSceneUpdate* updates;
+    u32 updateCapacity;
+    u32 updateCount;
+
+    // NOTE: Objects and the dirty range are owned by the render thread
+    RenderCommandDrawMesh* objects;
+    // NOTE: Slots changed since the renderer updated them. Empty when begin >= end
+    u32 dirtyBegin;
+    u32 dirtyEnd;
+    // NOTE: Allocated by the renderer on first use. Valid below objectEnd, the number of slots updated so far
+    ShaderMeshData* objectData;
+    RenderObjectAssets* assets;
+    u32 objectEnd;
+    // NOTE: Update thread. Set when an object could not be created, so the error is reported once
+    b32 full;
+
+    static RenderScene Make();
+};
+
+// NOTE: Returns one-based handle or zero if the scene is full, which is reported. Command is copied, objectIndex is assigned by the scene
+u32 CreateRenderObject(RenderScene* scene, const RenderCommandDrawMesh* command);
+void UpdateRenderObject(RenderScene* scene, u32 handle, const RenderCommandDrawMesh* command);
+void UpdateTransform(RenderScene* scene, u32 handle, const m4x4* transform);
+void DestroyRenderObject(RenderScene* scene, u32 handle);
+void Clear(RenderScene* scene);
+
+// NOTE: Appends draws of the live objects to the group queue and moves pending updates to the group.
+// Objects must not be destroyed until the group is reset
+void SubmitRenderScene(RenderGroup* group, RenderScene* scene);
+// NOTE: Render thread. Applies updates submitted with the group
+void ApplyRenderSceneUpdates(RenderGroup* group);
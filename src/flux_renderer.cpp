@@ -2,53 +2,306 @@
 
 #include "flux_std140.h"
 #include "flux_shaders.h"
+#include "flux_file_formats.h"
+#include "flux_occlusion.h"
+#include "flux_light_clusters.h"
+#include "flux_render_scene.h"
+#include "flux_render_graph.h"
+
+// NOTE: How the main depth buffer is filled before shading when the meshes are drawn from the CPU. CPU draws
+// position only meshes with the shadow program in the same order as the main pass
+enum struct DepthPrePass : u32 {
+    None = 0, CPU
+};
+
+enum struct HDRFormat : u32 {
+    R11G11B10F = 0, RGBA16F
+};
+
+struct DrawSortKey {
+    f32 depth;
+    u32 index;
+};
+
+// NOTE: Persistently mapped buffer with a region per frame in flight. CPU writes of the frame go to the region
+// of that frame, frame pacing guarantees that the GPU is done with it
+struct PerFrameBuffer {
+    GLuint handle;
+    byte* memory;
+    u32 regionSize;
+};
+
+struct Renderer;
+
+// NOTE: Inputs of the frame being recorded and textures its passes exchange through the render graph.
+// Passes get it as their data. Zero texture means that the frame does not have it
+struct RenderFrame {
+    Renderer* renderer;
+    RenderGroup* group;
+    AssetManager* manager;
+    RenderGraphTexture backbuffer;
+    RenderGraphTexture hdrColor;
+    RenderGraphTexture sceneDepth;
+    RenderGraphTexture ldrColor;
+    RenderGraphTexture shadowMap;
+    RenderGraphTexture shadowDebugColor;
+    RenderGraphTexture shadowStaticDepth;
+    RenderGraphTexture shadowStaticDebugColor;
+    RenderGraphTexture evsmMoments;
+    RenderGraphTexture evsmBlur;
+    u32 invalidStaticCascades;
+    u32 shadowMapOverlayLayer;
+    b32 fxaa;
+};
 
 struct Renderer {
     union {
         Shaders shaders;
         GLuint shaderHandles[ShaderCount];
     };
+    GLuint shaderPermutations[ShaderPermutationCount];
+    b32 shaderPermutationRequested[ShaderPermutationCount];
+
+    // NOTE: Contents of the program binary cache file
+    FluxProgramCacheHeader* programCache;
+    u64 programCacheDriverKey;
+    b32 programCacheEnabled;
+    b32 programCacheDirty;
+    // NOTE: Permutations are compiled over many frames as materials show up, so the cache is written
+    // once no new program was compiled for ProgramCacheSaveDelay frames instead of after every compile
+    static constexpr u32 ProgramCacheSaveDelay = 120;
+    u32 programCacheIdleFrames;
 
     u32 maxSupportedSampleCount;
 
-    GLuint lineBufferHandle;
+    // NOTE: Frame pacing. At most FramesInFlight frames are queued on the GPU. Every per frame GPU resource
+    // (uniform rings, debug lines, cull and light buffers, staging ring retirement) is split in FramesInFlight
+    // regions and frame N writes region N % FramesInFlight. The only place where the CPU waits for the GPU is
+    // AdvanceFrame at the end of End, which waits for the frame that used the next region last
+    static constexpr u32 FramesInFlight = 3;
+    GLsync frameFences[FramesInFlight];
+    // NOTE: Starts from FramesInFlight so indices of the frames in flight never go below zero
+    u32 frameIndex = FramesInFlight;
+    // NOTE: Every frame before this one is complete on the GPU
+    u32 completedFrameIndex = FramesInFlight;
+    u32 frameRegion;
+    f32 frameWaitMs;
+    u32 storageBufferAlignment;
+
+    static constexpr u32 DebugLineBufferRegionSize = sizeof(DebugLineVertex) * DebugLineBatch::MaxBucketVertices * DebugLineBatch::WidthBucketCount;
+    PerFrameBuffer debugLineBuffer;
     GLuint chunkIndexBuffer;
     v4 clearColor;
 
+    // NOTE: renderRes is the output resolution. Offscreen targets are allocated at targetRes which only grows,
+    // the scene is rendered to the lower left viewportRes part of them and upscaled in the final pass
     uv2 renderRes;
+    uv2 targetRes;
+    uv2 viewportRes;
     u32 sampleCount;
+    // NOTE: Texture of renderRes size the final pass writes instead of the default framebuffer. Zero is the default framebuffer
+    GLuint outputTarget;
+
+    // NOTE: Dynamic resolution. Frame GPU time is measured with a ring of timer queries, so results are read
+    // a few frames late without stalling. Scale applies to both axes
+    static constexpr u32 GPUTimerQueryCount = FramesInFlight + 1;
+    static constexpr f32 MinResolutionScale = 0.5f;
+    static constexpr f32 ResolutionScaleStep = 0.05f;
+    static constexpr u32 ResolutionChangeCooldown = 8;
+    b32 dynamicResolution = true;
+    f32 gpuFrameBudgetMs = 16.0f;
+    f32 resolutionScale = 1.0f;
+    f32 gpuFrameTimeMs;
+    u32 resolutionCooldown;
+    GLuint gpuTimerQueries[GPUTimerQueryCount];
+    u32 gpuTimerQueryAt;
+    u32 gpuTimerQueriesIssued;
     f32 gamma = 2.4f;
     f32 exposure = 1.0f;
 
-    GLuint offscreenBufferHandle;
-    GLuint offscreenColorTarget;
-    GLuint offscreenDepthTarget;
+    // NOTE: Render targets are transients of the render graph, declared every frame by the passes
+    RenderGraph* graph;
+    RenderFrame frame;
 
-    GLuint offscreenDownsampledBuffer;
-    GLuint offscreenDownsampledColorTarget;
+    // NOTE: Alpha of the main target is never read, so packed float format is the default
+    HDRFormat hdrFormat = HDRFormat::R11G11B10F;
 
     static constexpr u32 RandomValuesTextureSize = 1024;
-    // NOTE: Number of cascades is always 3
-    static constexpr u32 NumShadowCascades = 3;
-    GLuint shadowMapFramebuffers[NumShadowCascades];
-    GLuint shadowMapDepthTarget;
-    GLuint shadowMapDebugColorTarget;
+    static constexpr u32 MaxShadowCascades = ShaderFrameData::MaxShadowCascades;
+    u32 shadowCascadeCount = 3;
+    // NOTE: Blends logarithmic (1) and uniform (0) split schemes
+    // [ Zhang et al., Parallel-Split Shadow Maps for Large-scale Virtual Environments ]
+    f32 shadowSplitLambda = 0.75f;
+    // NOTE: Fit cascade near and far planes to the casters instead of the whole view frustum slice
+    b32 tightShadowDepthBounds = true;
+
+    // NOTE: Static casters are rendered to these layers only when cascade projection or
+    // one of the static casters changes. Every frame they are copied to the shadow map
+    // and dynamic casters are drawn on top
+    b32 cacheStaticShadows = true;
+    GLuint shadowMapStaticDepthTarget;
+    GLuint shadowMapStaticDebugColorTarget;
+    m4x4 shadowStaticViewProjMatrices[MaxShadowCascades];
+    u64 shadowStaticCastersHash;
+    u32 shadowStaticValidMask;
+    // NOTE: Color copies of the cascades for the shadow map overlay. Drawn only while it is shown
+    b32 shadowMapDebugColor = false;
     u32 shadowMapRes = 2048;
     GLuint randomValuesTexture;
     b32 stableShadows = true;
     b32 showShadowCascadesBoundaries;
     f32 shadowFilterScale = 1.0f;
 
+    // NOTE: Exponential variance shadow maps. Moments are computed from the shadow map depth, blurred
+    // and mipmapped after the shadow pass, so receivers do a single filtered fetch instead of PCF taps.
+    // The pass is culled by the render graph when PCF is used
+    ShadowFilter shadowFilter = ShadowFilter::PCF;
+    GLuint evsmDepthSampler;
+    // NOTE: Moments are 16 bit float, so exponents should not exceed 5.54
+    f32 evsmPositiveExponent = 5.54f;
+    f32 evsmNegativeExponent = 5.54f;
+    f32 evsmLightBleedingReduction = 0.2f;
+    i32 evsmBlurRadius = 2;
+
     // TODO: Camera should cares about that
-    m4x4 shadowCascadeViewProjMatrices[NumShadowCascades];
-    f32 shadowCascadeBounds[NumShadowCascades];
+    m4x4 shadowCascadeViewProjMatrices[MaxShadowCascades];
+    f32 shadowCascadeBounds[MaxShadowCascades];
 
     f32 shadowConstantBias = 0.004f;
     f32 shadowSlopeBiasScale = 1.2f;
     f32 shadowNormalBiasScale;
 
-    GLuint srgbBufferHandle;
-    GLuint srgbColorTarget;
+    // NOTE: Software occlusion culling of the main pass. Occluders are rasterized on worker threads
+    // while the shadow pass is submitted
+    OcclusionBuffer* occlusionBuffer;
+    b32 occlusionCulling = true;
+    // NOTE: Occluders were rasterized for the frame. GPU-driven frames cull on the GPU instead
+    b32 occlusionActive;
+    // NOTE: Static meshes below the triangle limit are used as occluders in addition to marked ones
+    b32 autoOccluders = true;
+    static constexpr u32 AutoOccluderMaxTriangles = 2048;
+    u32 occlusionCulledCount;
+
+    // NOTE: GPU-driven forward passes. Every submesh gets a slot in the shared vertex and index pool the first time
+    // it is drawn. Begin gathers the draws into instances and indirect commands grouped by program and textures, main and
+    // shadow passes cull the instances on the GPU and draw every batch with a single glMultiDrawElementsIndirect, so the
+    // GL calls per frame do not grow with the number of draws. Main pass tests instances against the frustum and the
+    // Hi-Z pyramid of the previous frame depth and draws the survivors, then retests the rejected ones against the
+    // pyramid of that depth and draws the ones which became visible. Shadow cascades are culled against the cascade
+    // volume. Used when vertex shaders can read storage buffers. Water and draws which do not fit the pool or the
+    // instance buffers go through the CPU path. Buffers are allocated on first use
+    struct GPUDrawSlot {
+        u32 indexCount;
+        u32 firstIndex;
+        i32 baseVertex;
+        u32 vertexCount;
+    };
+    static constexpr u32 MaxGPUDrawSlots = 8192;
+    static constexpr u32 MaxGPUDrawCommands = 8192;
+    static constexpr u32 MaxGPUDrawBatches = 256;
+    static constexpr u32 MaxGPUCullInstances = 128 * 1024;
+    static constexpr u32 GPUPoolVertexCapacity = 1024 * 1024;
+    static constexpr u32 GPUPoolIndexCapacity = 4 * 1024 * 1024;
+    // NOTE: Static and dynamic shadow passes of the frame use their own command sets for every cascade
+    static constexpr u32 GPUShadowCommandSets = MaxShadowCascades * 2;
+    // NOTE: Every batch keeps the texture bound to every unit, zero if the unit is not used
+    static constexpr u32 GPUBatchTextureUnits = RenderObjectAssets::TextureUnits;
+    struct GPUDrawBatch {
+        GLuint program;
+        b32 pbr;
+        u32 mapMask;
+        GLuint textures[GPUBatchTextureUnits];
+        u32 firstCommand;
+        u32 commandCount;
+    };
+    // NOTE: Free ranges of a pool stream sorted by position. Neighbouring free ranges are merged,
+    // so there is at most one more range than there are slots
+    struct GPUPoolRange {
+        u32 begin;
+        u32 count;
+    };
+    struct GPUPoolAllocator {
+        u32 freeRangeCount;
+        GPUPoolRange freeRanges[MaxGPUDrawSlots + 1];
+    };
+    b32 gpuDrivenSupported;
+    b32 gpuDriven = true;
+    // NOTE: Frame being recorded is drawn by the GPU-driven passes
+    b32 gpuDrivenFrame;
+    DepthPrePass depthPrePass = DepthPrePass::None;
+    // NOTE: Reorders mesh draws front to back by view depth of their origin
+    b32 sortFrontToBack = false;
+    DrawSortKey* drawSortKeys;
+    CommandQueueEntry* drawSortEntries;
+    u32 drawSortCapacity;
+    GPUDrawSlot gpuDrawSlots[MaxGPUDrawSlots];
+    // NOTE: Slots below the count which are not in the free list are used
+    u32 gpuDrawSlotCount;
+    u32 gpuFreeDrawSlots[MaxGPUDrawSlots];
+    u32 gpuFreeDrawSlotCount;
+    GPUPoolAllocator gpuPoolVertices;
+    GPUPoolAllocator gpuPoolIndices;
+    b32 gpuPoolFull;
+    // NOTE: Vertex streams of the pool have the layout of the mesh buffers, every stream has room for all pool vertices
+    GLuint gpuPoolVertexBuffer;
+    GLuint gpuPoolIndexBuffer;
+    PerFrameBuffer gpuCullInstanceBuffer;
+    // NOTE: Commands of the first phase followed by their copy for the second phase
+    PerFrameBuffer gpuDrawCommandBuffer;
+    // NOTE: GPUShadowCommandSets sets of shadow commands, every set starts at a multiple of the set size
+    PerFrameBuffer gpuShadowCommandBuffer;
+    u32 gpuShadowCommandSetSize;
+    // NOTE: Second phase instance ranges start at MaxGPUCullInstances
+    GLuint gpuVisibleInstanceBuffer;
+    // NOTE: Set N starts at N * MaxGPUCullInstances
+    GLuint gpuShadowVisibleInstanceBuffer;
+    GLuint gpuOccludedInstanceBuffer;
+    // NOTE: ShaderMeshData of the render scene objects by slot followed by draws pushed this frame.
+    // Scene part is updated only for the slots changed since the last frame
+    GLuint gpuObjectDataBuffer;
+    // NOTE: Staging for object data of the draws pushed this frame
+    ShaderMeshData* gpuObjectData;
+    GPUCullInstance* gpuCullInstances;
+    DrawElementsIndirectCommand* gpuDrawCommands;
+    DrawElementsIndirectCommand* gpuShadowCommands;
+    GPUDrawBatch gpuDrawBatches[MaxGPUDrawBatches];
+    // NOTE: Per frame lookups of the gather. Open addressing, entries hold one-based batch and command indices.
+    // Command keys are batch * MaxGPUDrawSlots + slot
+    static constexpr u32 GPUBatchTableSize = MaxGPUDrawBatches * 2;
+    static constexpr u32 GPUCommandTableSize = MaxGPUDrawCommands * 2;
+    u32 gpuBatchTable[GPUBatchTableSize];
+    u32 gpuCommandTable[GPUCommandTableSize];
+    u32 gpuCommandKeys[MaxGPUDrawCommands];
+    // NOTE: Instance count of the command and then its position in the batch order
+    u32 gpuCommandOrder[MaxGPUDrawCommands];
+    // NOTE: Instance count of the slot and then index of its shadow command
+    u32 gpuSlotShadowCommands[MaxGPUDrawSlots];
+    u32 gpuCullInstanceCount;
+    u32 gpuDrawBatchCount;
+    u32 gpuDrawCommandCount;
+    u32 gpuShadowCommandCount;
+    // NOTE: Queue indices of the draws the GPU-driven frame leaves to the CPU path
+    u32* cpuDraws;
+    u32 cpuDrawCount;
+    u32 cpuDrawCapacity;
+    GLuint hiZTarget;
+    uv2 hiZSize;
+    u32 hiZLevelCount;
+    // NOTE: Main depth buffer of GPU-driven frames. It is imported to the render graph, so it survives until the
+    // next frame and holds the previous frame rendered with prevViewProj. CPU path uses transient depth
+    GLuint depthHistoryTarget;
+    b32 depthHistoryValid;
+    m4x4 prevViewProj;
+
+    // NOTE: Clustered forward shading of point and spot lights. Clusters are built on worker threads
+    // during the shadow pass
+    LightClusterGrid* lightClusters;
+    ShaderLocalLight* localLights;
+    v4* localLightBounds;
+    u32 localLightCount;
+    PerFrameBuffer localLightBuffer;
+    PerFrameBuffer lightClusterBuffer;
+    PerFrameBuffer lightIndexBuffer;
 
     GLfloat maxAnisotropy;
 
@@ -61,10 +314,25 @@ struct Renderer {
     b32 debugG;
     b32 debugNormals;
 
-    static constexpr u32 TextureTransferBufferCount = array_count(typedecl(AssetManager, assetQueue));
-    u32 textureTransferBuffersUsageCount;
-    b32 textureTransferBuffersUsage[TextureTransferBufferCount];
-    GLuint textureTransferBuffers[TextureTransferBufferCount];
+    // NOTE: Staging ring. All CPU->GPU uploads go through one persistently mapped buffer.
+    // Allocation position and allocation count are packed into one u64 (count in high bits)
+    // so workers can allocate with single CAS. Positions are monotonic and wrap around u32.
+    // Released regions are retired in allocation order once the frame they were released in
+    // is complete.
+    static constexpr u32 StagingBufferSize = 1024 * 1024 * 64;
+    static constexpr u32 StagingAlignment = 256;
+    static constexpr u32 StagingMaxAllocations = 1024;
+    struct StagingAllocation {
+        u32 end;
+        u32 frame;
+        b32 released;
+    };
+    GLuint stagingBuffer;
+    byte* stagingMemory;
+    volatile u64 stagingHead;
+    volatile u32 stagingTail;
+    volatile u32 stagingRetiredCount;
+    StagingAllocation stagingAllocations[StagingMaxAllocations];
 
     Material fallbackPhongMaterial;
     Material fallbackMetallicMaterial;
@@ -74,6 +342,8 @@ struct Renderer {
 
     u32 uniformBufferAligment;
 
+    static constexpr u32 FrameUniformBlocksPerFrame = 64;
+    static constexpr u32 MeshUniformBlocksPerFrame = 16384;
     UniformBuffer<ShaderFrameData, ShaderFrameData::Binding> frameUniformBuffer;
     UniformBuffer<ShaderMeshData, ShaderMeshData::Binding> meshUniformBuffer;
 };
@@ -128,43 +398,224 @@ GLTextureFilter ToOpenGL(TextureFilter filter) {
     return result;
 }
 
-TexTransferBufferInfo GetTextureTransferBuffer(Renderer* renderer, u32 size) {
-    TexTransferBufferInfo result = {};
+StagingRegion AllocateStagingRegion(Renderer* renderer, u32 size) {
+    static_assert(IsPowerOfTwo(Renderer::StagingBufferSize));
+    StagingRegion result = {};
     result.renderer = renderer;
-    GLuint bufferHandle = 0;
-    u32 index = 0;
-    if (renderer->textureTransferBuffersUsageCount < Renderer::TextureTransferBufferCount) {
-        for (u32x i = 0; i < Renderer::TextureTransferBufferCount; i++) {
-            if (!renderer->textureTransferBuffersUsage[i]) {
-                renderer->textureTransferBuffersUsage[i] = true;
-                bufferHandle = renderer->textureTransferBuffers[i];
-                index = i;
-                renderer->textureTransferBuffersUsageCount++;
+    if (size <= Renderer::StagingBufferSize) {
+        while (true) {
+            u64 oldHead = renderer->stagingHead;
+            u32 position = (u32)oldHead;
+            u32 count = (u32)(oldHead >> 32);
+            u32 tail = AtomicLoad(&renderer->stagingTail);
+            u32 retiredCount = AtomicLoad(&renderer->stagingRetiredCount);
+            if ((i32)(position - tail) < 0) {
+                // NOTE: Head was read before tail was advanced past it. Reread both
+                continue;
+            }
+            if ((count - retiredCount) >= Renderer::StagingMaxAllocations) {
+                break;
+            }
+            u32 begin = (position + (Renderer::StagingAlignment - 1)) & ~(Renderer::StagingAlignment - 1);
+            u32 offset = begin & (Renderer::StagingBufferSize - 1);
+            if (offset + size > Renderer::StagingBufferSize) {
+                // NOTE: Regions never straddle the end of the ring
+                begin += Renderer::StagingBufferSize - offset;
+                offset = 0;
+            }
+            u32 end = begin + size;
+            if ((end - tail) > Renderer::StagingBufferSize) {
+                break;
+            }
+            u64 newHead = ((u64)(count + 1) << 32) | (u64)end;
+            if (AtomicCompareExchange(&renderer->stagingHead, oldHead, newHead) == oldHead) {
+                auto allocation = renderer->stagingAllocations + (count % Renderer::StagingMaxAllocations);
+                allocation->end = end;
+                allocation->released = false;
+                result.ptr = renderer->stagingMemory + offset;
+                result.offset = offset;
+                result.size = size;
+                result.index = count;
                 break;
             }
         }
     }
-    if (bufferHandle) {
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferHandle);
-        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, 0, GL_STREAM_DRAW);
-        result.ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-        //((byte*)result.ptr)[size - 1] = 5;
-        result.index = index;
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return result;
+}
+
+void ReleaseStagingRegion(StagingRegion* region) {
+    auto renderer = region->renderer;
+    if (region->ptr) {
+        auto allocation = renderer->stagingAllocations + (region->index % Renderer::StagingMaxAllocations);
+        assert(!allocation->released);
+        allocation->frame = renderer->frameIndex;
+        allocation->released = true;
+    }
+    *region = {};
+}
+
+void AllocatePerFrameBuffer(Renderer* renderer, PerFrameBuffer* buffer, uptr regionSize) {
+    // NOTE: Regions are bound as shader storage ranges, so they are aligned to the storage buffer offset alignment
+    u32 alignment = renderer->storageBufferAlignment;
+    buffer->regionSize = (u32)((regionSize + (alignment - 1)) / alignment * alignment);
+    uptr size = (uptr)buffer->regionSize * Renderer::FramesInFlight;
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &buffer->handle);
+    assert(buffer->handle);
+    glNamedBufferStorage(buffer->handle, size, nullptr, flags);
+    buffer->memory = (byte*)glMapNamedBufferRange(buffer->handle, 0, size, flags);
+    panic(buffer->memory, "[Renderer] Failed to map per frame buffer");
+}
+
+u32 GetFrameOffset(Renderer* renderer, PerFrameBuffer* buffer) {
+    return renderer->frameRegion * buffer->regionSize;
+}
+
+void* GetFrameMemory(Renderer* renderer, PerFrameBuffer* buffer) {
+    return buffer->memory + GetFrameOffset(renderer, buffer);
+}
+
+void BindFrameStorageBuffer(Renderer* renderer, u32 binding, PerFrameBuffer* buffer) {
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, buffer->handle, GetFrameOffset(renderer, buffer), buffer->regionSize);
+}
+
+// NOTE: Called once at the end of the frame. Fences the frame, moves to the next region and waits until
+// the frame which used it last is complete
+void AdvanceFrame(Renderer* renderer) {
+    renderer->frameFences[renderer->frameRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    renderer->frameIndex++;
+    renderer->frameRegion = renderer->frameIndex % Renderer::FramesInFlight;
+
+    renderer->frameWaitMs = 0.0f;
+    auto fence = renderer->frameFences + renderer->frameRegion;
+    if (*fence) {
+        auto status = glClientWaitSync(*fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            u64 begin = GetTimeStamp();
+            glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0xffffffffffffffff);
+            u64 end = GetTimeStamp();
+            renderer->frameWaitMs = (f32)(end - begin) / (f32)GetTicksPerSecond() * 1000.0f;
+        }
+        glDeleteSync(*fence);
+        *fence = 0;
+    }
+
+    // NOTE: Frames complete in order, so the earlier ones are checked without waiting
+    renderer->completedFrameIndex = renderer->frameIndex - Renderer::FramesInFlight + 1;
+    for (u32 i = 1; i < Renderer::FramesInFlight; i++) {
+        u32 frame = renderer->frameIndex - Renderer::FramesInFlight + i;
+        auto frameFence = renderer->frameFences + (frame % Renderer::FramesInFlight);
+        if (*frameFence) {
+            auto status = glClientWaitSync(*frameFence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                break;
+            }
+        }
+        renderer->completedFrameIndex = frame + 1;
+    }
+
+    BeginUniformBufferFrame(&renderer->frameUniformBuffer, renderer->frameRegion);
+    BeginUniformBufferFrame(&renderer->meshUniformBuffer, renderer->frameRegion);
+}
+
+// NOTE: Called once per frame after frame pacing has updated the completed frame
+void UpdateStagingRing(Renderer* renderer) {
+    u32 allocationCount = (u32)(renderer->stagingHead >> 32);
+    u32 retiredCount = renderer->stagingRetiredCount;
+    u32 tail = renderer->stagingTail;
+    while (retiredCount != allocationCount) {
+        auto allocation = renderer->stagingAllocations + (retiredCount % Renderer::StagingMaxAllocations);
+        if (allocation->released && (i32)(allocation->frame - renderer->completedFrameIndex) < 0) {
+            allocation->released = false;
+            tail = allocation->end;
+            retiredCount++;
+        } else {
+            break;
+        }
+    }
+    AtomicExchange(&renderer->stagingTail, tail);
+    AtomicExchange(&renderer->stagingRetiredCount, retiredCount);
+}
+
+uptr MeshVertexBufferSize(Mesh* mesh) {
+    // NOTE: Using SOA layout of buffer
+    // positions | normals | uvs | tangents | bitangents
+    uptr result = mesh->vertexCount * (sizeof(v3) * 4 + sizeof(v2));
+    return result;
+}
+
+uptr MeshIndexBufferSize(Mesh* mesh) {
+    uptr result = mesh->indexCount * sizeof(u32);
+    return result;
+}
+
+void CopyVertexStream(byte* dest, void* source, uptr size) {
+    if (source) {
+        memcpy(dest, source, size);
+    } else {
+        memset(dest, 0, size);
+    }
+}
+
+StagingRegion StageMesh(Renderer* renderer, Mesh* mesh) {
+    uptr totalSize = 0;
+    for (auto it = mesh; it; it = it->next) {
+        totalSize += MeshVertexBufferSize(it) + MeshIndexBufferSize(it);
+    }
+    StagingRegion result = {};
+    result.renderer = renderer;
+    if (totalSize <= Renderer::StagingBufferSize) {
+        result = AllocateStagingRegion(renderer, (u32)totalSize);
+        if (result.ptr) {
+            auto at = (byte*)result.ptr;
+            for (auto it = mesh; it; it = it->next) {
+                uptr v3Size = it->vertexCount * sizeof(v3);
+                uptr v2Size = it->vertexCount * sizeof(v2);
+                CopyVertexStream(at, it->vertices, v3Size); at += v3Size;
+                CopyVertexStream(at, it->normals, v3Size); at += v3Size;
+                CopyVertexStream(at, it->uvs, v2Size); at += v2Size;
+                CopyVertexStream(at, it->tangents, v3Size); at += v3Size;
+                CopyVertexStream(at, it->bitangents, v3Size); at += v3Size;
+                uptr indexBufferSize = MeshIndexBufferSize(it);
+                memcpy(at, it->indices, indexBufferSize); at += indexBufferSize;
+            }
+        }
     }
     return result;
 }
 
-void CompleteTextureTransfer(TexTransferBufferInfo* info, Texture* texture) {
-    auto renderer = info->renderer;
-    if (info->ptr) {
-        auto bufferHandle = renderer->textureTransferBuffers[info->index];
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferHandle);
-        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
-        renderer->textureTransferBuffersUsage[info->index] = false;
-        assert(renderer->textureTransferBuffersUsageCount > 0);
-        renderer->textureTransferBuffersUsageCount--;
+void CompleteMeshTransfer(StagingRegion* region, Mesh* mesh) {
+    if (region->ptr) {
+        auto renderer = region->renderer;
+        uptr offset = region->offset;
+        while (mesh) {
+            uptr vertexBufferSize = MeshVertexBufferSize(mesh);
+            uptr indexBufferSize = MeshIndexBufferSize(mesh);
+            if (!mesh->gpuVertexBufferHandle && !mesh->gpuIndexBufferHandle) {
+                GLuint handles[2];
+                glCreateBuffers(2, handles);
+                if (handles[0] && handles[1]) {
+                    glNamedBufferStorage(handles[0], vertexBufferSize, nullptr, 0);
+                    glNamedBufferStorage(handles[1], indexBufferSize, nullptr, 0);
+                    glCopyNamedBufferSubData(renderer->stagingBuffer, handles[0], offset, 0, vertexBufferSize);
+                    glCopyNamedBufferSubData(renderer->stagingBuffer, handles[1], offset + vertexBufferSize, 0, indexBufferSize);
+                    mesh->gpuVertexBufferHandle = handles[0];
+                    mesh->gpuIndexBufferHandle = handles[1];
+                }
+            }
+            offset += vertexBufferSize + indexBufferSize;
+            mesh = mesh->next;
+        }
+        ReleaseStagingRegion(region);
+    } else {
+        // NOTE: Staging ring was full. Falling back to synchronous upload
+        UploadToGPU(mesh);
+    }
+}
 
+void CompleteTextureTransfer(StagingRegion* region, Texture* texture) {
+    if (region->ptr) {
+        auto renderer = region->renderer;
         GLuint handle;
         if (!texture->gpuHandle) {
             glGenTextures(1, &handle);
@@ -192,13 +643,19 @@ void CompleteTextureTransfer(TexTransferBufferInfo* info, Texture* texture) {
             glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_ARB, 8.0f);
         }
 
-        // TODO: Mips control
-        glGenerateMipmap(GL_TEXTURE_2D);
-
         glBindTexture(GL_TEXTURE_2D, 0);
 
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, renderer->stagingBuffer);
+        glTextureSubImage2D(handle, 0, 0, 0, texture->width, texture->height, format.format, format.type, (void*)(uptr)region->offset);
         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-        *info = {};
+
+        // TODO: Mips control
+        glGenerateTextureMipmap(handle);
+
+        ReleaseStagingRegion(region);
+    } else {
+        // NOTE: Staging ring was full. Falling back to synchronous upload
+        UploadToGPU(texture);
     }
 }
 
@@ -351,24 +808,216 @@ void GenBRDFLut(const Renderer* renderer, Texture* t) {
     glFlush();
 }
 
-void ReloadShadowMaps(Renderer* renderer, u32 newResolution = 0) {
-    // TODO: There are maybe could be a problems on some drivers
-    // with changing framebuffer attachments so this code needs to be checked
-    // on different GPUs and drivers
+// NOTE: Cached textures are stored in the same format they have on GPU,
+// except 16 bit float formats are transferred as half floats
+GLTextureFormat ToOpenGLCache(TextureFormat format) {
+    auto result = ToOpenGL(format);
+    if (result.internal == GL_RGB16F || result.internal == GL_RG16F) {
+        result.type = GL_HALF_FLOAT;
+    }
+    return result;
+}
+
+u32 CachePixelSize(GLTextureFormat format) {
+    u32 componentCount = 0;
+    switch (format.format) {
+    case GL_RED: { componentCount = 1; } break;
+    case GL_RG: { componentCount = 2; } break;
+    case GL_RGB: { componentCount = 3; } break;
+    case GL_RGBA: { componentCount = 4; } break;
+        invalid_default();
+    }
+    u32 componentSize = 0;
+    switch (format.type) {
+    case GL_UNSIGNED_BYTE: { componentSize = 1; } break;
+    case GL_HALF_FLOAT: { componentSize = 2; } break;
+    case GL_FLOAT: { componentSize = 4; } break;
+        invalid_default();
+    }
+    return componentCount * componentSize;
+}
+
+u32 CacheLevelSize(GLTextureFormat format, u32 width, u32 height, u32 faceCount, u32 level) {
+    u32 w = Max(width >> level, 1u);
+    u32 h = Max(height >> level, 1u);
+    return w * h * faceCount * CachePixelSize(format);
+}
+
+u32 CacheDataSize(GLTextureFormat format, u32 width, u32 height, u32 faceCount, u32 levelCount) {
+    u32 result = 0;
+    for (u32 level = 0; level < levelCount; level++) {
+        result += CacheLevelSize(format, width, height, faceCount, level);
+    }
+    return result;
+}
+
+u64 HashShaderSource(const char* shaderName, u64 hash) {
+    for (u32 i = 0; i < ShaderCount; i++) {
+        if (strcmp(ShaderNames[i], shaderName) == 0) {
+            hash = HashProgramSource(ShaderSources + i, hash);
+            break;
+        }
+    }
+    return hash;
+}
+
+// NOTE: Null GL backend never writes texel data back, so texture caches are neither saved nor loaded with it.
+// Cache keys do not cover the backend, and its output would be loaded as valid by the next run on a GPU
+bool TextureCacheEnabled() {
+    return GlobalPlatform.gl->nullStats == nullptr;
+}
+
+// NOTE: Returns immutable texture with data from the cache file or 0 if cache is missing or stale
+GLuint LoadTextureCache(GLenum target, const wchar_t* filename, u64 key, TextureFormat format, u32 width, u32 height, u32 levelCount) {
+    GLuint result = 0;
+    u32 faceCount = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    auto glFormat = ToOpenGLCache(format);
+    auto fileSize = TextureCacheEnabled() ? PlatformDebugGetFileSize(filename) : 0;
+    if (fileSize >= sizeof(FluxTextureCacheHeader)) {
+        void* file = PlatformAlloc(fileSize, 0, nullptr);
+        defer { PlatformFree(file, nullptr); };
+        u32 bytesRead = PlatformDebugReadFile(file, fileSize, filename);
+        auto header = (FluxTextureCacheHeader*)file;
+        if ((bytesRead == fileSize) &&
+            (header->header.magicValue == FluxFileHeader::MagicValue) &&
+            (header->header.type == FluxFileHeader::TextureCache) &&
+            (header->version == 1) &&
+            (header->key == key) &&
+            (header->format == (u32)format) &&
+            (header->width == width) &&
+            (header->height == height) &&
+            (header->faceCount == faceCount) &&
+            (header->levelCount == levelCount) &&
+            (header->dataSize == CacheDataSize(glFormat, width, height, faceCount, levelCount)) &&
+            ((uptr)header->data + header->dataSize <= fileSize)) {
+
+            glCreateTextures(target, 1, &result);
+            assert(result);
+            glTextureStorage2D(result, levelCount, glFormat.internal, width, height);
+
+            auto at = (byte*)file + header->data;
+            for (u32 level = 0; level < levelCount; level++) {
+                u32 w = Max(width >> level, 1u);
+                u32 h = Max(height >> level, 1u);
+                if (target == GL_TEXTURE_CUBE_MAP) {
+                    glTextureSubImage3D(result, level, 0, 0, 0, w, h, 6, glFormat.format, glFormat.type, at);
+                } else {
+                    glTextureSubImage2D(result, level, 0, 0, w, h, glFormat.format, glFormat.type, at);
+                }
+                at += CacheLevelSize(glFormat, width, height, faceCount, level);
+            }
+        }
+    }
+    return result;
+}
+
+void SaveTextureCache(GLenum target, GLuint handle, const wchar_t* filename, u64 key, TextureFormat format, u32 width, u32 height, u32 levelCount) {
+    if (TextureCacheEnabled()) {
+        u32 faceCount = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+        auto glFormat = ToOpenGLCache(format);
+        u32 dataSize = CacheDataSize(glFormat, width, height, faceCount, levelCount);
+        u32 fileSize = sizeof(FluxTextureCacheHeader) + dataSize;
+        void* file = PlatformAlloc(fileSize, 0, nullptr);
+        defer { PlatformFree(file, nullptr); };
+
+        auto header = (FluxTextureCacheHeader*)file;
+        *header = {};
+        header->header.type = FluxFileHeader::TextureCache;
+        header->key = key;
+        header->format = (u32)format;
+        header->width = width;
+        header->height = height;
+        header->faceCount = faceCount;
+        header->levelCount = levelCount;
+        header->data = sizeof(FluxTextureCacheHeader);
+        header->dataSize = dataSize;
+
+        auto at = (byte*)file + header->data;
+        for (u32 level = 0; level < levelCount; level++) {
+            u32 levelSize = CacheLevelSize(glFormat, width, height, faceCount, level);
+            glGetTextureImage(handle, level, glFormat.format, glFormat.type, levelSize, at);
+            at += levelSize;
+        }
+
+        if (!PlatformDebugWriteFile(filename, file, fileSize)) {
+            printf("[Renderer] Failed to write texture cache: %ls\n", filename);
+        }
+    }
+}
+
+void SetCubeTextureParameters(CubeTexture* texture) {
+    auto wrapMode = ToOpenGL(texture->wrapMode);
+    auto filter = ToOpenGL(texture->filter);
+    glTextureParameteri(texture->gpuHandle, GL_TEXTURE_WRAP_S, wrapMode);
+    glTextureParameteri(texture->gpuHandle, GL_TEXTURE_WRAP_T, wrapMode);
+    glTextureParameteri(texture->gpuHandle, GL_TEXTURE_WRAP_R, wrapMode);
+    glTextureParameteri(texture->gpuHandle, GL_TEXTURE_MAG_FILTER, filter.mag);
+    glTextureParameteri(texture->gpuHandle, GL_TEXTURE_MIN_FILTER, filter.min);
+    if (filter.anisotropic) {
+        // TODO: Anisotropy value
+        glTextureParameterf(texture->gpuHandle, GL_TEXTURE_MAX_ANISOTROPY_ARB, 8.0f);
+    }
+}
+
+bool LoadFromCache(CubeTexture* texture, const wchar_t* filename, u64 key, u32 levelCount) {
+    assert(!texture->gpuHandle);
+    auto handle = LoadTextureCache(GL_TEXTURE_CUBE_MAP, filename, key, texture->format, texture->width, texture->height, levelCount);
+    if (handle) {
+        texture->gpuHandle = handle;
+        SetCubeTextureParameters(texture);
+    }
+    return handle != 0;
+}
+
+void SaveToCache(CubeTexture* texture, const wchar_t* filename, u64 key, u32 levelCount) {
+    assert(texture->gpuHandle);
+    SaveTextureCache(GL_TEXTURE_CUBE_MAP, texture->gpuHandle, filename, key, texture->format, texture->width, texture->height, levelCount);
+}
+
+// NOTE: Only the static caster cache is persistent. Shadow map, its debug color and EVSM targets are transients
+// of the render graph, so they follow resolution and cascade count on their own
+void ReloadShadowMaps(Renderer* renderer, u32 newResolution = 0, u32 newCascadeCount = 0) {
     if (newResolution) {
         renderer->shadowMapRes = newResolution;
     }
-    glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->shadowMapDepthTarget);
-    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32, renderer->shadowMapRes, renderer->shadowMapRes, Renderer::NumShadowCascades, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->shadowMapDebugColorTarget);
-    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, renderer->shadowMapRes, renderer->shadowMapRes, Renderer::NumShadowCascades, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+    if (newCascadeCount) {
+        assert(newCascadeCount <= Renderer::MaxShadowCascades);
+        renderer->shadowCascadeCount = newCascadeCount;
+    }
+    ReleaseFramebuffers(renderer->graph, renderer->shadowMapStaticDepthTarget);
+    ReleaseFramebuffers(renderer->graph, renderer->shadowMapStaticDebugColorTarget);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->shadowMapStaticDepthTarget);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32, renderer->shadowMapRes, renderer->shadowMapRes, renderer->shadowCascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+
+    if (renderer->shadowMapDebugColor) {
+        if (!renderer->shadowMapStaticDebugColorTarget) {
+            glGenTextures(1, &renderer->shadowMapStaticDebugColorTarget);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->shadowMapStaticDebugColorTarget);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->shadowMapStaticDebugColorTarget);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, renderer->shadowMapRes, renderer->shadowMapRes, renderer->shadowCascadeCount, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+    } else if (renderer->shadowMapStaticDebugColorTarget) {
+        glDeleteTextures(1, &renderer->shadowMapStaticDebugColorTarget);
+        renderer->shadowMapStaticDebugColorTarget = 0;
+    }
     glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    renderer->shadowStaticValidMask = 0;
 }
 
 uv2 GetRenderResolution(Renderer* renderer) {
     return renderer->renderRes;
 }
 
+void SetOutputTarget(Renderer* renderer, GLuint texture) {
+    renderer->outputTarget = texture;
+}
+
 u32 GetRenderSampleCount(Renderer* renderer) {
     return renderer->sampleCount;
 }
@@ -377,27 +1026,49 @@ u32 GetRenderMaxSampleCount(Renderer* renderer) {
     return renderer->maxSupportedSampleCount;
 }
 
-void ChangeRenderResolution(Renderer* renderer, uv2 newRes, u32 newSampleCount) {
-    // TODO: There are maybe could be a problems on some drivers
-    // with changing framebuffer attachments so this code needs to be checked
-    // on different GPUs and drivers
-    if (newSampleCount <= renderer->maxSupportedSampleCount) {
-        renderer->renderRes = newRes;
-        renderer->sampleCount = newSampleCount;
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, renderer->offscreenColorTarget);
-        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, newSampleCount, GL_RGBA16F, renderer->renderRes.x, renderer->renderRes.y, GL_FALSE);
-
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, renderer->offscreenDepthTarget);
-        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, newSampleCount, GL_DEPTH_COMPONENT32, renderer->renderRes.x, renderer->renderRes.y, GL_FALSE);
+// NOTE: Depth is never sampled with a precision higher than 24 bit and stencil is not used
+RenderTextureDesc SceneTargetDesc(Renderer* renderer, GLenum format) {
+    RenderTextureDesc desc = {};
+    desc.type = RenderTextureType::Texture2DMultisample;
+    desc.format = format;
+    desc.width = renderer->targetRes.x;
+    desc.height = renderer->targetRes.y;
+    desc.samples = renderer->sampleCount;
+    return desc;
+}
 
-        glBindTexture(GL_TEXTURE_2D, renderer->offscreenDownsampledColorTarget);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, renderer->renderRes.x, renderer->renderRes.y, 0, GL_RGBA, GL_FLOAT, 0);
+void FreeDepthHistory(Renderer* renderer) {
+    if (renderer->depthHistoryTarget) {
+        ReleaseFramebuffers(renderer->graph, renderer->depthHistoryTarget);
+        glDeleteTextures(1, &renderer->depthHistoryTarget);
+        renderer->depthHistoryTarget = 0;
+    }
+    renderer->depthHistoryValid = false;
+}
 
-        glBindTexture(GL_TEXTURE_2D, renderer->srgbColorTarget);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, renderer->renderRes.x, renderer->renderRes.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+void AllocateDepthHistory(Renderer* renderer) {
+    FreeDepthHistory(renderer);
+    RenderTextureDesc desc = SceneTargetDesc(renderer, GL_DEPTH_COMPONENT24);
+    glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &renderer->depthHistoryTarget);
+    assert(renderer->depthHistoryTarget);
+    glTextureStorage2DMultisample(renderer->depthHistoryTarget, desc.samples, desc.format, desc.width, desc.height, GL_FALSE);
+}
 
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
-        glBindTexture(GL_TEXTURE_2D, 0);
+void ChangeRenderResolution(Renderer* renderer, uv2 newRes, u32 newSampleCount) {
+    if (newSampleCount <= renderer->maxSupportedSampleCount) {
+        renderer->renderRes = newRes;
+        renderer->depthHistoryValid = false;
+
+        // NOTE: Targets are reallocated only if the window grows beyond them. Transients pick the new size up
+        // from their descriptions, old pooled textures are released by the graph after a few frames
+        uv2 targetRes = UV2(Max(newRes.x, renderer->targetRes.x), Max(newRes.y, renderer->targetRes.y));
+        if (newSampleCount != renderer->sampleCount || targetRes.x != renderer->targetRes.x || targetRes.y != renderer->targetRes.y) {
+            renderer->targetRes = targetRes;
+            renderer->sampleCount = newSampleCount;
+            if (renderer->depthHistoryTarget) {
+                AllocateDepthHistory(renderer);
+            }
+        }
     }
 }
 
@@ -413,9 +1084,15 @@ Renderer* InitializeRenderer(uv2 renderRes, u32 sampleCount) {
     renderer->maxSupportedSampleCount = maxSamples;
     assert(renderer->maxSupportedSampleCount >= sampleCount);
     glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, (GLint*)&renderer->uniformBufferAligment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, (GLint*)&renderer->storageBufferAlignment);
+    // NOTE: Vertex shaders of the GPU-driven passes read the instances and the object data
+    GLint maxVertexStorageBlocks = 0;
+    glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &maxVertexStorageBlocks);
+    renderer->gpuDrivenSupported = maxVertexStorageBlocks >= 2;
 
-    ReallocUniformBuffer(&renderer->frameUniformBuffer);
-    ReallocUniformBuffer(&renderer->meshUniformBuffer);
+    // NOTE: Mesh uniforms are written once per draw of every pass, frame uniforms a few times per frame
+    ReallocUniformBuffer(&renderer->frameUniformBuffer, renderer->uniformBufferAligment, Renderer::FrameUniformBlocksPerFrame, Renderer::FramesInFlight);
+    ReallocUniformBuffer(&renderer->meshUniformBuffer, renderer->uniformBufferAligment, Renderer::MeshUniformBlocksPerFrame, Renderer::FramesInFlight);
 
     GLfloat maxAnisotropy;
     glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_ARB, &maxAnisotropy);
@@ -424,109 +1101,34 @@ Renderer* InitializeRenderer(uv2 renderRes, u32 sampleCount) {
     renderer->gamma = 2.4f;
     renderer->exposure = 1.0f;
     renderer->renderRes = renderRes;
+    renderer->targetRes = renderRes;
+    renderer->viewportRes = renderRes;
     renderer->sampleCount = sampleCount;
 
-    GLuint lineBufferHandle;
-    glGenBuffers(1, &lineBufferHandle);
-    assert(lineBufferHandle);
-    renderer->lineBufferHandle = lineBufferHandle;
-
-    glGenFramebuffers(1, &renderer->offscreenBufferHandle);
-    assert(renderer->offscreenBufferHandle);
-    glGenTextures(1, &renderer->offscreenColorTarget);
-    assert(renderer->offscreenColorTarget);
-    glGenTextures(1, &renderer->offscreenDepthTarget);
-    assert(renderer->offscreenDepthTarget);
-
-    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, renderer->offscreenColorTarget);
-    glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, sampleCount, GL_RGBA16F, renderRes.x, renderRes.y, GL_FALSE);
-
-    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, renderer->offscreenDepthTarget);
-    glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, sampleCount, GL_DEPTH_COMPONENT32, renderRes.x, renderRes.y, GL_FALSE);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->offscreenBufferHandle);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, renderer->offscreenColorTarget, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D_MULTISAMPLE, renderer->offscreenDepthTarget, 0);
-    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glGenQueries(Renderer::GPUTimerQueryCount, renderer->gpuTimerQueries);
 
-    glGenFramebuffers(1, &renderer->offscreenDownsampledBuffer);
-    assert(renderer->offscreenDownsampledBuffer);
-    glGenTextures(1, &renderer->offscreenDownsampledColorTarget);
-    assert(renderer->offscreenDownsampledColorTarget);
+    AllocatePerFrameBuffer(renderer, &renderer->debugLineBuffer, Renderer::DebugLineBufferRegionSize);
 
-    glBindTexture(GL_TEXTURE_2D, renderer->offscreenDownsampledColorTarget);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, renderRes.x, renderRes.y, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->offscreenDownsampledBuffer);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->offscreenDownsampledColorTarget, 0);
-    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
-
-    glGenFramebuffers(1, &renderer->srgbBufferHandle);
-    assert(renderer->srgbBufferHandle);
-    glGenTextures(1, &renderer->srgbColorTarget);
-    assert(renderer->srgbColorTarget);
-
-    glBindTexture(GL_TEXTURE_2D, renderer->srgbColorTarget);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, renderRes.x, renderRes.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->srgbBufferHandle);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->srgbColorTarget, 0);
-    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    renderer->graph = CreateRenderGraph();
 
     glGenFramebuffers(1, &renderer->captureFramebuffer);
     assert(renderer->captureFramebuffer);
 
-    glGenFramebuffers(3, renderer->shadowMapFramebuffers);
-    // TODO: Checking!
-    assert(renderer->shadowMapFramebuffers[0]);
-
-    { // Initializing depth targets
-        glGenTextures(1, &renderer->shadowMapDepthTarget);
-        glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->shadowMapDepthTarget);
-
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
-
-        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32, renderer->shadowMapRes, renderer->shadowMapRes, Renderer::NumShadowCascades, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
-    }
-    { // Initializing debug color targets
-        glGenTextures(1, &renderer->shadowMapDebugColorTarget);
-        glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->shadowMapDebugColorTarget);
-
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
-
-        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, renderer->shadowMapRes, renderer->shadowMapRes, Renderer::NumShadowCascades, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+    { // Initializing static caster cache targets
+        glGenTextures(1, &renderer->shadowMapStaticDepthTarget);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->shadowMapStaticDepthTarget);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32, renderer->shadowMapRes, renderer->shadowMapRes, renderer->shadowCascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
     }
 
     glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
-    for (u32x i = 0; i < Renderer::NumShadowCascades; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, renderer->shadowMapFramebuffers[i]);
-        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, renderer->shadowMapDepthTarget, 0, i);
-        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, renderer->shadowMapDebugColorTarget, 0, i);
-        //glDrawBuffer(GL_NONE);
-        //glReadBuffer(GL_NONE);
-        assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // NOTE: Shadow map has depth comparison enabled which is undefined for non-shadow samplers
+    glCreateSamplers(1, &renderer->evsmDepthSampler);
+    glSamplerParameteri(renderer->evsmDepthSampler, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glSamplerParameteri(renderer->evsmDepthSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glSamplerParameteri(renderer->evsmDepthSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
     ReloadShadowMaps(renderer);
 
@@ -550,22 +1152,33 @@ Renderer* InitializeRenderer(uv2 renderRes, u32 sampleCount) {
     }
 
     if (!renderer->BRDFLutHandle) {
+        // NOTE: LUT depends only on integrator shader so it is generated once and then loaded from cache
+        const wchar_t* cacheFile = L"brdf_lut.cache";
+        u64 cacheKey = HashShaderSource("BRDFIntegrator", Hash64("BRDFLut", sizeof("BRDFLut")));
         Texture t = CreateTexture(512, 512, TextureFormat::RG32F, TextureWrapMode::ClampToEdge, TextureFilter::Bilinear);
-        UploadToGPU(&t);
-        assert(t.gpuHandle);
-        GenBRDFLut(renderer, &t);
-        renderer->BRDFLutHandle = t.gpuHandle;
-#if 0
-        void* bitmap = PlatformAlloc(sizeof(f32) * 2 * 512 * 512);
-        defer { PlatformFree(bitmap); };
-        glBindTexture(GL_TEXTURE_2D, renderer->BRDFLutHandle);
-        glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, bitmap);
-        PlatformDebugWriteFile(L"brdf_lut.aab", bitmap, sizeof(f32) * 2 * 512 * 512);
-#endif
-    }
-
-    // NOTE: Texture transfer buffers
-    glGenBuffers(Renderer::TextureTransferBufferCount, renderer->textureTransferBuffers);
+        GLuint handle = LoadTextureCache(GL_TEXTURE_2D, cacheFile, cacheKey, t.format, t.width, t.height, 1);
+        if (handle) {
+            glTextureParameteri(handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTextureParameteri(handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            renderer->BRDFLutHandle = handle;
+        } else {
+            UploadToGPU(&t);
+            assert(t.gpuHandle);
+            GenBRDFLut(renderer, &t);
+            SaveTextureCache(GL_TEXTURE_2D, t.gpuHandle, cacheFile, cacheKey, t.format, t.width, t.height, 1);
+            renderer->BRDFLutHandle = t.gpuHandle;
+        }
+    }
+
+    // NOTE: Staging ring
+    glCreateBuffers(1, &renderer->stagingBuffer);
+    assert(renderer->stagingBuffer);
+    GLbitfield stagingFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glNamedBufferStorage(renderer->stagingBuffer, Renderer::StagingBufferSize, nullptr, stagingFlags);
+    renderer->stagingMemory = (byte*)glMapNamedBufferRange(renderer->stagingBuffer, 0, Renderer::StagingBufferSize, stagingFlags);
+    panic(renderer->stagingMemory, "[Renderer] Failed to map staging buffer");
 
     // NOTE: Fallback material
     renderer->fallbackPhongMaterial.workflow = Material::Phong;
@@ -598,63 +1211,19 @@ Renderer* InitializeRenderer(uv2 renderRes, u32 sampleCount) {
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullTexData);
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    return renderer;
-}
-
-void GenIrradanceMap(const Renderer* renderer, CubeTexture* t, GLuint sourceHandle) {
-    assert(t->gpuHandle);
-#if defined(PROFILE_IRRADANCE_GEN)
-    SOKO_INFO("Generating irradance map...");
-    glFinish();
-    i64 beginTime = GetTimeStamp();
-#endif
-
-    // TODO: Make this constexpr
-    static auto projInv = Inverse(PerspectiveGLRH(0.1, 10.0f, 90.0f, 1.0f));
-    static m3x3 capViews[] = {
-        M3x3(Inverse(LookAtGLRH(V3(0.0f), V3(-1.0f, 0.0f, 0.0f), V3(0.0f, -1.0f, 0.0f)))),
-        M3x3(Inverse(LookAtGLRH(V3(0.0f), V3(1.0f, 0.0f, 0.0f), V3(0.0f, -1.0f, 0.0f)))),
-        M3x3(Inverse(LookAtGLRH(V3(0.0f), V3(0.0f, -1.0f, 0.0f), V3(0.0f, 0.0f, 1.0f)))),
-        M3x3(Inverse(LookAtGLRH(V3(0.0f), V3(0.0f, 1.0f, 0.0f), V3(0.0f, 0.0f, -1.0f)))),
-        M3x3(Inverse(LookAtGLRH(V3(0.0f), V3(0.0f, 0.0f, -1.0f), V3(0.0f, -1.0f, 0.0f)))),
-        M3x3(Inverse(LookAtGLRH(V3(0.0f), V3(0.0f, 0.0f, 1.0f), V3(0.0f, -1.0f, 0.0f)))),
-    };
-
-    auto prog = renderer->shaders.IrradanceConvolver;
-    glUseProgram(prog);
-
-    auto buffer = Map(renderer->frameUniformBuffer);
-    buffer->invProjMatrix = projInv;
-    Unmap(renderer->frameUniformBuffer);
-
-    glDisable(GL_DEPTH_TEST);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, renderer->captureFramebuffer);
-
-    glBindTextureUnit(IrradanceConvolver::SourceCubemap, sourceHandle);
-
-    for (u32 i = 0; i < 6; i++) {
-        glViewport(0, 0, t->width, t->height);
-        auto buffer = Map(renderer->frameUniformBuffer);
-        buffer->invViewMatrix = M4x4(capViews[i]);
-        Unmap(renderer->frameUniformBuffer);
-
-        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, t->gpuHandle, 0);
-        glClear(GL_COLOR_BUFFER_BIT);
+    renderer->occlusionBuffer = CreateOcclusionBuffer();
 
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-    }
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glFlush();
-#if defined (PROFILE_IRRADANCE_GEN)
-    glFinish();
-    i64 timeElapsed = GetTimeStamp() - beginTime;
-    SOKO_INFO("Time: %i64 us", timeElapsed);
-#endif
+    renderer->lightClusters = CreateLightClusterGrid();
+    renderer->localLights = (ShaderLocalLight*)PlatformAlloc(sizeof(ShaderLocalLight) * LightClusterGrid::MaxLights, 0, nullptr);
+    renderer->localLightBounds = (v4*)PlatformAlloc(sizeof(v4) * LightClusterGrid::MaxLights, 0, nullptr);
+    AllocatePerFrameBuffer(renderer, &renderer->localLightBuffer, sizeof(ShaderLocalLight) * LightClusterGrid::MaxLights);
+    AllocatePerFrameBuffer(renderer, &renderer->lightClusterBuffer, sizeof(u32) * 2 * LightClusterGrid::ClusterCount);
+    AllocatePerFrameBuffer(renderer, &renderer->lightIndexBuffer, sizeof(u32) * LightClusterGrid::MaxLightIndices);
 
+    return renderer;
 }
 
-void GenEnvPrefiliteredMap(const Renderer* renderer, CubeTexture* t, GLuint sourceHandle, u32 mipLevels) {
+void GenEnvPrefiliteredMap(Renderer* renderer, CubeTexture* t, GLuint sourceHandle, u32 mipLevels) {
     assert(t->gpuHandle);
     assert(t->useMips);
     assert(t->filter == TextureFilter::Trilinear);
@@ -677,9 +1246,9 @@ void GenEnvPrefiliteredMap(const Renderer* renderer, CubeTexture* t, GLuint sour
     assert(t->width == t->height);
     glUniform1i(EnvMapPrefilterShader::Resolution, t->width);
 
-    auto buffer = Map(renderer->frameUniformBuffer);
+    auto buffer = Map(&renderer->frameUniformBuffer);
     buffer->invProjMatrix = capProj;
-    Unmap(renderer->frameUniformBuffer);
+    Unmap(&renderer->frameUniformBuffer);
 
     glBindTextureUnit(EnvMapPrefilterShader::SourceCubemap, sourceHandle);
 
@@ -697,9 +1266,9 @@ void GenEnvPrefiliteredMap(const Renderer* renderer, CubeTexture* t, GLuint sour
 
         for (u32 i = 0; i < 6; i++) {
             // TODO: Use another buffer for this
-            auto buffer = Map(renderer->frameUniformBuffer);
+            auto buffer = Map(&renderer->frameUniformBuffer);
             buffer->invViewMatrix = M4x4(capViews[i]);
-            Unmap(renderer->frameUniformBuffer);
+            Unmap(&renderer->frameUniformBuffer);
             glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
                                    GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, t->gpuHandle, mipLevel);
             glClear(GL_COLOR_BUFFER_BIT);
@@ -729,8 +1298,9 @@ m3x3 MakeNormalMatrix(m4x4 model) {
     return normal;
 }
 
+// NOTE: Returns light-space ortho projection bounds of the view frustum slice. Z is distance from the light
 // TODO: @Speed Make shure this function inlined
-m4x4 CalcShadowProjection(const CameraBase* camera, f32 nearPlane, f32 farPlane, m4x4 lightLookAt, u32 shadowMapRes, bool stable) {
+BBoxAligned CalcShadowProjectionBounds(const CameraBase* camera, f32 nearPlane, f32 farPlane, m4x4 lightLookAt, u32 shadowMapRes, bool stable) {
     // NOTE Shadow projection bounds
     v3 min;
     v3 max;
@@ -849,108 +1419,1333 @@ m4x4 CalcShadowProjection(const CameraBase* camera, f32 nearPlane, f32 farPlane,
         max = maxViewSpace;
     }
 
-    auto result = OrthoGLRH(min.x, max.x, min.y, max.y, min.z, max.z);
+    BBoxAligned result;
+    result.min = min;
+    result.max = max;
     return result;
 }
 
-void RenderShadowMap(Renderer* renderer, RenderGroup* group, AssetManager* manager) {
-    if (group->commandQueueAt) {
-        auto shader = renderer->shaders.Shadow;
-        for (u32 i = 0; i < group->commandQueueAt; i++) {
-            CommandQueueEntry* command = group->commandQueue + i;
-
-            switch (command->type) {
-            case RenderCommand::LineBegin:
-            {
-            } break;
-            case RenderCommand::DrawMesh: {
-                auto* data = (RenderCommandDrawMesh*)(group->renderBuffer + command->rbOffset);
-
-                auto mesh = GetMesh(manager, data->meshID);
-                if (mesh) {
-                    auto normalMatrix = MakeNormalMatrix(data->transform);
-
-                    auto meshBuffer = Map(renderer->meshUniformBuffer);
-                    meshBuffer->modelMatrix = data->transform;
-                    meshBuffer->normalMatrix = normalMatrix;
-                    Unmap(renderer->meshUniformBuffer);
-
-                    while (mesh) {
-                        glBindBuffer(GL_ARRAY_BUFFER, mesh->gpuVertexBufferHandle);
-
-                        auto posAttrLoc = ShadowPassShader::PositionAttribLocation;
-                        glEnableVertexAttribArray(posAttrLoc);
-                        glVertexAttribPointer(posAttrLoc, 3, GL_FLOAT, GL_FALSE, 0, 0);
+// NOTE: Shrinks cascade depth ranges to the casters which overlap cascade light-space rectangle.
+// Casters in front of the near plane are not clipped since shadow pass uses depth clamp.
+// If depthStep is not zero the fitted planes are snapped outward to multiples of it, so stable
+// cascades keep the same projection (and cached static layers) while casters move a little
+void FitShadowDepthBounds(RenderGroup* group, AssetManager* manager, m4x4 lightLookAt, BBoxAligned* cascadeBounds, u32 cascadeCount, const f32* depthSteps) {
+    f32 casterNear[Renderer::MaxShadowCascades];
+    f32 casterFar[Renderer::MaxShadowCascades];
+    for (u32x cascadeIndex = 0; cascadeIndex < cascadeCount; cascadeIndex++) {
+        casterNear[cascadeIndex] = F32::Max;
+        casterFar[cascadeIndex] = -F32::Max;
+    }
 
-                        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->gpuIndexBufferHandle);
-                        glDrawElements(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, 0);
-                        mesh = mesh->next;
+    for (u32 i = 0; i < group->commandQueueAt; i++) {
+        CommandQueueEntry* command = group->commandQueue + i;
+        if (command->type == RenderCommand::DrawMesh) {
+            auto* data = (RenderCommandDrawMesh*)command->data;
+            m4x4 m = lightLookAt * data->transform;
+            auto mesh = GetMesh(manager, data->meshID);
+            while (mesh) {
+                v3 min = V3(F32::Max);
+                v3 max = V3(-F32::Max);
+                for (u32x corner = 0; corner < 8; corner++) {
+                    v3 p = V3(corner & 1 ? mesh->aabb.max.x : mesh->aabb.min.x,
+                              corner & 2 ? mesh->aabb.max.y : mesh->aabb.min.y,
+                              corner & 4 ? mesh->aabb.max.z : mesh->aabb.min.z);
+                    p = (m * V4(p, 1.0f)).xyz;
+                    min = V3(Min(min.x, p.x), Min(min.y, p.y), Min(min.z, p.z));
+                    max = V3(Max(max.x, p.x), Max(max.y, p.y), Max(max.z, p.z));
+                }
+                for (u32x cascadeIndex = 0; cascadeIndex < cascadeCount; cascadeIndex++) {
+                    auto bounds = cascadeBounds + cascadeIndex;
+                    if (max.x >= bounds->min.x && min.x <= bounds->max.x &&
+                        max.y >= bounds->min.y && min.y <= bounds->max.y) {
+                        // NOTE: Light view is Z negative-forward
+                        casterNear[cascadeIndex] = Min(casterNear[cascadeIndex], -max.z);
+                        casterFar[cascadeIndex] = Max(casterFar[cascadeIndex], -min.z);
                     }
                 }
-            } break;
+                mesh = mesh->next;
+            }
+        }
+    }
+
+    for (u32x cascadeIndex = 0; cascadeIndex < cascadeCount; cascadeIndex++) {
+        f32 n = casterNear[cascadeIndex];
+        f32 f = casterFar[cascadeIndex];
+        if (n < f) {
+            f32 step = depthSteps[cascadeIndex];
+            if (step > 0.0f) {
+                n = Floor(n / step) * step;
+                f = Ceil(f / step) * step;
+            }
+            auto bounds = cascadeBounds + cascadeIndex;
+            n = Max(bounds->min.z, n);
+            f = Min(bounds->max.z, f);
+            if (n < f) {
+                bounds->min.z = n;
+                bounds->max.z = f;
             }
         }
     }
 }
 
-void ShadowPass(Renderer* renderer, RenderGroup* group, AssetManager* manager) {
-    auto light = &group->dirLight;
-    auto camera = group->camera;
+// NOTE: Returns a bit for every cascade from cascadeMask whose light-space volume intersects the mesh bounds
+u32 CalcShadowCascadeMask(Renderer* renderer, const m4x4* transform, BBoxAligned aabb, u32 cascadeMask) {
+    u32 result = 0;
+    for (u32x cascadeIndex = 0; cascadeIndex < renderer->shadowCascadeCount; cascadeIndex++) {
+        if (cascadeMask & (1 << cascadeIndex)) {
+            // NOTE: Cascade projections are orthographic, so w is always 1
+            m4x4 m = renderer->shadowCascadeViewProjMatrices[cascadeIndex] * *transform;
+            v3 min = V3(F32::Max);
+            v3 max = V3(-F32::Max);
+            for (u32x corner = 0; corner < 8; corner++) {
+                v3 p = V3(corner & 1 ? aabb.max.x : aabb.min.x,
+                          corner & 2 ? aabb.max.y : aabb.min.y,
+                          corner & 4 ? aabb.max.z : aabb.min.z);
+                p = (m * V4(p, 1.0f)).xyz;
+                min = V3(Min(min.x, p.x), Min(min.y, p.y), Min(min.z, p.z));
+                max = V3(Max(max.x, p.x), Max(max.y, p.y), Max(max.z, p.z));
+            }
+            // NOTE: Casters in front of the near plane are clamped to it, so only far plane culls
+            if (max.x >= -1.0f && min.x <= 1.0f &&
+                max.y >= -1.0f && min.y <= 1.0f &&
+                min.z <= 1.0f) {
+                result |= 1 << cascadeIndex;
+            }
+        }
+    }
+    return result;
+}
 
+// NOTE: Must match Casters of GPUCullCompute.glsl
+enum struct ShadowCasters : u32 {
+    All, Static, Dynamic
+};
 
-    glEnable(GL_POLYGON_OFFSET_FILL);
-    defer { glDisable(GL_POLYGON_OFFSET_FILL); };
-    glPolygonOffset(renderer->shadowSlopeBiasScale, 0.0f);
-    glEnable(GL_DEPTH_TEST);
-    glViewport(0, 0, (GLsizei)renderer->shadowMapRes, (GLsizei)renderer->shadowMapRes);
+//
+// NOTE: GPU-driven passes, see the GPU-driven section of Renderer
+//
 
-    auto shader = renderer->shaders.Shadow;
-    glUseProgram(shader);
+// NOTE: Element sizes of the vertex streams in the order of the mesh buffers: positions, normals, uvs, tangents, bitangents.
+// Stream N is bound to attribute N
+static const u32 GPUPoolStreamElementSizes[] = { sizeof(v3), sizeof(v3), sizeof(v2), sizeof(v3), sizeof(v3) };
 
-    for (u32x cascadeIndex = 0; cascadeIndex < Renderer::NumShadowCascades; cascadeIndex++) {
-        auto viewProj = renderer->shadowCascadeViewProjMatrices[cascadeIndex];
+void InitGPUPoolAllocator(Renderer::GPUPoolAllocator* allocator, u32 capacity) {
+    allocator->freeRangeCount = 1;
+    allocator->freeRanges[0] = { 0, capacity };
+}
 
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, renderer->shadowMapFramebuffers[cascadeIndex]);
-        glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-        glUniform1i(ShadowPassShader::CascadeIndexLocation, cascadeIndex);
-        RenderShadowMap(renderer, group, manager);
+// NOTE: First fit. Returns U32::Max if there is no free range large enough
+u32 AllocateGPUPoolRange(Renderer::GPUPoolAllocator* allocator, u32 count) {
+    u32 result = U32::Max;
+    for (u32 i = 0; i < allocator->freeRangeCount; i++) {
+        auto range = allocator->freeRanges + i;
+        if (range->count >= count) {
+            result = range->begin;
+            range->begin += count;
+            range->count -= count;
+            if (!range->count) {
+                allocator->freeRangeCount--;
+                memmove(range, range + 1, sizeof(Renderer::GPUPoolRange) * (allocator->freeRangeCount - i));
+            }
+            break;
+        }
     }
+    return result;
 }
 
-void MainPass(Renderer* renderer, RenderGroup* group, AssetManager* assetManager) {
-
-    DEBUG_OVERLAY_SLIDER(renderer->gamma, 1.0f, 10.0f);
-    DEBUG_OVERLAY_SLIDER(renderer->exposure, 0.0f, 10.0f);
-    bool showShadowCascadesBoundaries = renderer->showShadowCascadesBoundaries;
-    DEBUG_OVERLAY_TOGGLE(showShadowCascadesBoundaries);
-    renderer->showShadowCascadesBoundaries = showShadowCascadesBoundaries;
+void FreeGPUPoolRange(Renderer::GPUPoolAllocator* allocator, u32 begin, u32 count) {
+    auto ranges = allocator->freeRanges;
+    u32 at = 0;
+    while (at < allocator->freeRangeCount && ranges[at].begin < begin) {
+        at++;
+    }
+    bool mergePrev = at > 0 && ranges[at - 1].begin + ranges[at - 1].count == begin;
+    bool mergeNext = at < allocator->freeRangeCount && begin + count == ranges[at].begin;
+    if (mergePrev && mergeNext) {
+        ranges[at - 1].count += count + ranges[at].count;
+        allocator->freeRangeCount--;
+        memmove(ranges + at, ranges + at + 1, sizeof(Renderer::GPUPoolRange) * (allocator->freeRangeCount - at));
+    } else if (mergePrev) {
+        ranges[at - 1].count += count;
+    } else if (mergeNext) {
+        ranges[at].begin = begin;
+        ranges[at].count += count;
+    } else {
+        assert(allocator->freeRangeCount < array_count(allocator->freeRanges));
+        memmove(ranges + at + 1, ranges + at, sizeof(Renderer::GPUPoolRange) * (allocator->freeRangeCount - at));
+        ranges[at] = { begin, count };
+        allocator->freeRangeCount++;
+    }
+}
 
-    auto camera = group->camera;
-    auto dirLight = group->dirLight;
+void AllocateGPUDrivenBuffers(Renderer* renderer) {
+    GLuint handles[6];
+    glCreateBuffers(6, handles);
+    renderer->gpuPoolVertexBuffer = handles[0];
+    renderer->gpuPoolIndexBuffer = handles[1];
+    renderer->gpuVisibleInstanceBuffer = handles[2];
+    renderer->gpuShadowVisibleInstanceBuffer = handles[3];
+    renderer->gpuOccludedInstanceBuffer = handles[4];
+    renderer->gpuObjectDataBuffer = handles[5];
+
+    uptr poolVertexSize = 0;
+    for (u32x stream = 0; stream < array_count(GPUPoolStreamElementSizes); stream++) {
+        poolVertexSize += (uptr)GPUPoolStreamElementSizes[stream] * Renderer::GPUPoolVertexCapacity;
+    }
+    glNamedBufferStorage(renderer->gpuPoolVertexBuffer, poolVertexSize, nullptr, 0);
+    glNamedBufferStorage(renderer->gpuPoolIndexBuffer, sizeof(u32) * (uptr)Renderer::GPUPoolIndexCapacity, nullptr, 0);
+    InitGPUPoolAllocator(&renderer->gpuPoolVertices, Renderer::GPUPoolVertexCapacity);
+    InitGPUPoolAllocator(&renderer->gpuPoolIndices, Renderer::GPUPoolIndexCapacity);
+
+    // NOTE: Shadow command sets are bound as storage ranges, so every set is aligned
+    u32 alignment = renderer->storageBufferAlignment;
+    renderer->gpuShadowCommandSetSize = (u32)((sizeof(DrawElementsIndirectCommand) * Renderer::MaxGPUDrawSlots + (alignment - 1)) / alignment * alignment);
+    AllocatePerFrameBuffer(renderer, &renderer->gpuCullInstanceBuffer, sizeof(GPUCullInstance) * Renderer::MaxGPUCullInstances);
+    AllocatePerFrameBuffer(renderer, &renderer->gpuDrawCommandBuffer, sizeof(DrawElementsIndirectCommand) * Renderer::MaxGPUDrawCommands * 2);
+    AllocatePerFrameBuffer(renderer, &renderer->gpuShadowCommandBuffer, (uptr)renderer->gpuShadowCommandSetSize * Renderer::GPUShadowCommandSets);
+    glNamedBufferStorage(renderer->gpuVisibleInstanceBuffer, sizeof(u32) * Renderer::MaxGPUCullInstances * 2, nullptr, 0);
+    glNamedBufferStorage(renderer->gpuShadowVisibleInstanceBuffer, sizeof(u32) * Renderer::MaxGPUCullInstances * Renderer::GPUShadowCommandSets, nullptr, 0);
+    glNamedBufferStorage(renderer->gpuOccludedInstanceBuffer, sizeof(u32) * Renderer::MaxGPUCullInstances, nullptr, 0);
+    glNamedBufferStorage(renderer->gpuObjectDataBuffer, sizeof(ShaderMeshData) * (uptr)(RenderScene::MaxObjects + Renderer::MaxGPUCullInstances), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    renderer->gpuCullInstances = (GPUCullInstance*)PlatformAlloc(sizeof(GPUCullInstance) * Renderer::MaxGPUCullInstances, 0, nullptr);
+    renderer->gpuObjectData = (ShaderMeshData*)PlatformAlloc(sizeof(ShaderMeshData) * Renderer::MaxGPUCullInstances, 0, nullptr);
+    renderer->gpuDrawCommands = (DrawElementsIndirectCommand*)PlatformAlloc(sizeof(DrawElementsIndirectCommand) * Renderer::MaxGPUDrawCommands * 2, 0, nullptr);
+    renderer->gpuShadowCommands = (DrawElementsIndirectCommand*)PlatformAlloc(sizeof(DrawElementsIndirectCommand) * Renderer::MaxGPUDrawSlots, 0, nullptr);
+}
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, renderer->offscreenBufferHandle);
-    glViewport(0, 0, renderer->renderRes.x, renderer->renderRes.y);
-    glClearColor(renderer->clearColor.r, renderer->clearColor.g, renderer->clearColor.b, renderer->clearColor.a);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable(GL_DEPTH_TEST);
+// NOTE: Copies vertex streams and indices of the submesh to the pool on first use. Returns one-based slot or zero if it does not fit
+u32 GetGPUDrawSlot(Renderer* renderer, Mesh* mesh) {
+    if (!mesh->gpuDrawSlot && mesh->indexCount && mesh->gpuVertexBufferHandle && mesh->gpuIndexBufferHandle) {
+        u32 slotIndex = U32::Max;
+        if (renderer->gpuFreeDrawSlotCount) {
+            slotIndex = renderer->gpuFreeDrawSlots[renderer->gpuFreeDrawSlotCount - 1];
+        } else if (renderer->gpuDrawSlotCount < Renderer::MaxGPUDrawSlots) {
+            slotIndex = renderer->gpuDrawSlotCount;
+        }
 
-    if (group->commandQueueAt) {
-        for (u32 i = 0; i < group->commandQueueAt; i++) {
-            CommandQueueEntry* command = group->commandQueue + i;
+        u32 firstVertex = U32::Max;
+        u32 firstIndex = U32::Max;
+        if (slotIndex != U32::Max) {
+            firstVertex = AllocateGPUPoolRange(&renderer->gpuPoolVertices, mesh->vertexCount);
+            if (firstVertex != U32::Max) {
+                firstIndex = AllocateGPUPoolRange(&renderer->gpuPoolIndices, mesh->indexCount);
+                if (firstIndex == U32::Max) {
+                    FreeGPUPoolRange(&renderer->gpuPoolVertices, firstVertex, mesh->vertexCount);
+                }
+            }
+        }
 
-            switch (command->type) {
+        if (firstIndex != U32::Max) {
+            if (renderer->gpuFreeDrawSlotCount) {
+                renderer->gpuFreeDrawSlotCount--;
+            } else {
+                renderer->gpuDrawSlotCount++;
+            }
+            auto slot = renderer->gpuDrawSlots + slotIndex;
+            slot->indexCount = mesh->indexCount;
+            slot->firstIndex = firstIndex;
+            slot->baseVertex = (i32)firstVertex;
+            slot->vertexCount = mesh->vertexCount;
+
+            uptr sourceOffset = 0;
+            uptr poolOffset = 0;
+            for (u32x stream = 0; stream < array_count(GPUPoolStreamElementSizes); stream++) {
+                uptr elementSize = GPUPoolStreamElementSizes[stream];
+                glCopyNamedBufferSubData(mesh->gpuVertexBufferHandle, renderer->gpuPoolVertexBuffer, sourceOffset, poolOffset + elementSize * firstVertex, elementSize * mesh->vertexCount);
+                sourceOffset += elementSize * mesh->vertexCount;
+                poolOffset += elementSize * Renderer::GPUPoolVertexCapacity;
+            }
+            glCopyNamedBufferSubData(mesh->gpuIndexBufferHandle, renderer->gpuPoolIndexBuffer, 0, sizeof(u32) * (uptr)firstIndex, sizeof(u32) * (uptr)mesh->indexCount);
+            mesh->gpuDrawSlot = slotIndex + 1;
+        } else if (!renderer->gpuPoolFull) {
+            renderer->gpuPoolFull = true;
+            printf("[Renderer] GPU geometry pool is full. Meshes which do not fit are drawn from the CPU\n");
+        }
+    }
+    return mesh->gpuDrawSlot;
+}
+
+// NOTE: Slot of an unloaded mesh. Later frames may reuse the ranges right away, GL orders the copies after the draws
+// of the frames in flight which read them
+void FreeGPUDrawSlot(Renderer* renderer, u32 slot) {
+    assert(slot && slot <= renderer->gpuDrawSlotCount);
+    auto drawSlot = renderer->gpuDrawSlots + (slot - 1);
+    FreeGPUPoolRange(&renderer->gpuPoolVertices, (u32)drawSlot->baseVertex, drawSlot->vertexCount);
+    FreeGPUPoolRange(&renderer->gpuPoolIndices, drawSlot->firstIndex, drawSlot->indexCount);
+    *drawSlot = {};
+    renderer->gpuFreeDrawSlots[renderer->gpuFreeDrawSlotCount++] = slot - 1;
+    renderer->gpuPoolFull = false;
+}
+
+// NOTE: Object data does not depend on what is loaded. Values of the maps the material uses are replaced by the values
+// of the fallback material, the batch tells the shaders which maps are bound
+void FillObjectData(Renderer* renderer, ShaderMeshData* objectData, const RenderCommandDrawMesh* data) {
+    *objectData = {};
+    objectData->modelMatrix = data->transform;
+    objectData->normalMatrix = MakeNormalMatrix(data->transform);
+    auto m = &data->material;
+    switch (m->workflow) {
+    case Material::Phong: {
+        auto fallback = &renderer->fallbackPhongMaterial.phong;
+        objectData->phongUseDiffuseMap = m->phong.useDiffuseMap ? 1 : 0;
+        objectData->phongUseSpecularMap = m->phong.useSpecularMap ? 1 : 0;
+        objectData->customPhongDiffuse = m->phong.useDiffuseMap ? fallback->diffuseValue : m->phong.diffuseValue;
+        objectData->customPhongSpecular = m->phong.useSpecularMap ? fallback->specularValue : m->phong.specularValue;
+    } break;
+    case Material::PBRMetallic: {
+        auto fallback = &renderer->fallbackMetallicMaterial.pbrMetallic;
+        objectData->pbrAlbedoValue = m->pbrMetallic.useAlbedoMap ? fallback->albedoValue : m->pbrMetallic.albedoValue;
+        objectData->pbrRoughnessValue = m->pbrMetallic.useRoughnessMap ? fallback->roughnessValue : m->pbrMetallic.roughnessValue;
+        objectData->pbrMetallicValue = m->pbrMetallic.useMetallicMap ? fallback->metallicValue : m->pbrMetallic.metallicValue;
+        if (m->pbrMetallic.emitsLight && !m->pbrMetallic.useEmissionMap) {
+            objectData->pbrEmissionValue = m->pbrMetallic.emissionValue * m->pbrMetallic.emissionIntensity;
+        }
+    } break;
+    default: {} break;
+    }
+}
+
+// NOTE: Render thread, called by Begin every frame. Updates object data of the changed scene objects and uploads it
+// if the GPU-driven buffers exist. Assets of the changed objects are resolved again when a pass needs them
+void UpdateSceneObjects(Renderer* renderer, RenderScene* scene) {
+    if (!scene->objectData) {
+        scene->objectData = (ShaderMeshData*)PlatformAlloc(sizeof(ShaderMeshData) * RenderScene::MaxObjects, 0, nullptr);
+        scene->assets = (RenderObjectAssets*)PlatformAlloc(sizeof(RenderObjectAssets) * RenderScene::MaxObjects, 0, nullptr);
+    }
+    if (scene->dirtyBegin < scene->dirtyEnd) {
+        for (u32 i = scene->dirtyBegin; i < scene->dirtyEnd; i++) {
+            FillObjectData(renderer, scene->objectData + i, scene->objects + i);
+            scene->assets[i].generation = 0;
+        }
+        if (renderer->gpuObjectDataBuffer) {
+            glNamedBufferSubData(renderer->gpuObjectDataBuffer, sizeof(ShaderMeshData) * (uptr)scene->dirtyBegin, sizeof(ShaderMeshData) * (uptr)(scene->dirtyEnd - scene->dirtyBegin), scene->objectData + scene->dirtyBegin);
+        }
+        scene->objectEnd = Max(scene->objectEnd, scene->dirtyEnd);
+        scene->dirtyBegin = RenderScene::MaxObjects;
+        scene->dirtyEnd = 0;
+    }
+}
+
+// NOTE: Mesh and textures of the draw. Maps which are not loaded yet are left out. Program of the PBR workflow
+// also depends on the submesh, so the callers pick it from the features
+void ResolveDrawAssets(Renderer* renderer, AssetManager* manager, const RenderCommandDrawMesh* data, RenderObjectAssets* assets) {
+    *assets = {};
+    assets->generation = manager->generation;
+    assets->mesh = GetMesh(manager, data->meshID);
+    auto m = &data->material;
+    u32 features = 0;
+    switch (m->workflow) {
+    case Material::Phong: {
+        if (m->phong.useDiffuseMap) {
+            auto diffuseMap = GetTexture(manager, m->phong.diffuseMap);
+            if (diffuseMap) {
+                assets->mapMask |= 1;
+                assets->textures[MeshShader::DiffMap] = diffuseMap->gpuHandle;
+            }
+        }
+        if (m->phong.useSpecularMap) {
+            auto specularMap = GetTexture(manager, m->phong.specularMap);
+            if (specularMap) {
+                assets->mapMask |= 2;
+                assets->textures[MeshShader::SpecMap] = specularMap->gpuHandle;
+            }
+        }
+    } break;
+    case Material::PBRMetallic: {
+        assets->pbr = true;
+        auto pbr = &m->pbrMetallic;
+        if (pbr->useAlbedoMap) {
+            auto albedoMap = GetTexture(manager, pbr->albedoMap);
+            if (albedoMap) {
+                features |= PbrMeshFeature::AlbedoMap;
+                assets->textures[MeshPBRShader::AlbedoMap] = albedoMap->gpuHandle;
+            }
+        }
+        if (pbr->useRoughnessMap) {
+            auto roughnessMap = GetTexture(manager, pbr->roughnessMap);
+            if (roughnessMap) {
+                features |= PbrMeshFeature::RoughnessMap;
+                assets->textures[MeshPBRShader::RoughnessMap] = roughnessMap->gpuHandle;
+            }
+        }
+        if (pbr->useMetallicMap) {
+            auto metallicMap = GetTexture(manager, pbr->metallicMap);
+            if (metallicMap) {
+                features |= PbrMeshFeature::MetallicMap;
+                assets->textures[MeshPBRShader::MetallicMap] = metallicMap->gpuHandle;
+            }
+        }
+        if (pbr->useNormalMap) {
+            auto normalMap = GetTexture(manager, pbr->normalMap);
+            if (normalMap) {
+                features |= PbrMeshFeature::NormalMap;
+                if (pbr->normalFormat == NormalFormat::DirectX) {
+                    features |= PbrMeshFeature::NormalMapDX;
+                }
+                assets->textures[MeshPBRShader::NormalMap] = normalMap->gpuHandle;
+            }
+        }
+        if (pbr->useAOMap) {
+            auto aoMap = GetTexture(manager, pbr->AOMap);
+            if (aoMap) {
+                features |= PbrMeshFeature::AOMap;
+                assets->textures[MeshPBRShader::AOMap] = aoMap->gpuHandle;
+            }
+        }
+        if (pbr->emitsLight) {
+            features |= PbrMeshFeature::Emission;
+            if (pbr->useEmissionMap) {
+                auto emissionMap = GetTexture(manager, pbr->emissionMap);
+                if (emissionMap) {
+                    features |= PbrMeshFeature::EmissionMap;
+                    assets->textures[MeshPBRShader::EmissionMap] = emissionMap->gpuHandle;
+                }
+            }
+        }
+    } break;
+    case Material::PBRSpecular: {
+        assets->pbr = true;
+        features |= PbrMeshFeature::SpecularWorkflow;
+    } break;
+        invalid_default();
+    }
+    assets->pbrFeatures = features;
+}
+
+// NOTE: Scene objects keep their assets until the object or the loaded assets change. Draws pushed this frame
+// are resolved into the storage
+const RenderObjectAssets* GetDrawAssets(Renderer* renderer, AssetManager* manager, RenderGroup* group, const RenderCommandDrawMesh* data, RenderObjectAssets* storage) {
+    RenderObjectAssets* result = storage;
+    if (data->objectIndex && group->scene) {
+        result = group->scene->assets + (data->objectIndex - 1);
+        if (result->generation != manager->generation) {
+            ResolveDrawAssets(renderer, manager, data, result);
+        }
+    } else {
+        ResolveDrawAssets(renderer, manager, data, result);
+    }
+    return result;
+}
+
+const ShaderMeshData* GetDrawObjectData(Renderer* renderer, RenderGroup* group, const RenderCommandDrawMesh* data, ShaderMeshData* storage) {
+    const ShaderMeshData* result = storage;
+    if (data->objectIndex && group->scene) {
+        result = group->scene->objectData + (data->objectIndex - 1);
+    } else {
+        FillObjectData(renderer, storage, data);
+    }
+    return result;
+}
+
+// NOTE: Returns index of the batch with the same program and textures, adds it if there is none. U32::Max if the batches are exhausted
+u32 FindGPUDrawBatch(Renderer* renderer, const Renderer::GPUDrawBatch* key) {
+    static_assert(IsPowerOfTwo(Renderer::GPUBatchTableSize));
+    uptr keySize = offset_of(Renderer::GPUDrawBatch, firstCommand);
+    u32 hash = (u32)Hash64(key, keySize);
+    u32 result = U32::Max;
+    for (u32 i = 0; i < Renderer::GPUBatchTableSize; i++) {
+        u32* entry = renderer->gpuBatchTable + ((hash + i) & (Renderer::GPUBatchTableSize - 1));
+        if (!*entry) {
+            if (renderer->gpuDrawBatchCount < Renderer::MaxGPUDrawBatches) {
+                result = renderer->gpuDrawBatchCount++;
+                renderer->gpuDrawBatches[result] = *key;
+                *entry = result + 1;
+            }
+            break;
+        }
+        if (memcmp(renderer->gpuDrawBatches + (*entry - 1), key, keySize) == 0) {
+            result = *entry - 1;
+            break;
+        }
+    }
+    return result;
+}
+
+// NOTE: Returns index of the command which draws the slot in the batch, adds it if there is none. U32::Max if the commands are exhausted
+u32 FindGPUDrawCommand(Renderer* renderer, u32 batch, u32 slotIndex) {
+    static_assert(IsPowerOfTwo(Renderer::GPUCommandTableSize));
+    u32 key = batch * Renderer::MaxGPUDrawSlots + slotIndex;
+    u32 hash = key * 2654435761u;
+    u32 result = U32::Max;
+    for (u32 i = 0; i < Renderer::GPUCommandTableSize; i++) {
+        u32* entry = renderer->gpuCommandTable + ((hash + i) & (Renderer::GPUCommandTableSize - 1));
+        if (!*entry) {
+            if (renderer->gpuDrawCommandCount < Renderer::MaxGPUDrawCommands) {
+                result = renderer->gpuDrawCommandCount++;
+                renderer->gpuCommandKeys[result] = key;
+                *entry = result + 1;
+            }
+            break;
+        }
+        if (renderer->gpuCommandKeys[*entry - 1] == key) {
+            result = *entry - 1;
+            break;
+        }
+    }
+    return result;
+}
+
+// NOTE: Adds instances for all submeshes of the draw. Command fields of the instances hold the unordered command and
+// the slot until the commands are laid out. Returns false if any of them does not fit, then the draw goes through the CPU path
+bool GatherGPUDraw(Renderer* renderer, const RenderCommandDrawMesh* data, const RenderObjectAssets* assets, u32* transientCount) {
+    auto mesh = assets->mesh;
+    u32 submeshCount = 0;
+    bool fits = true;
+    for (auto it = mesh; it && fits; it = it->next) {
+        fits = GetGPUDrawSlot(renderer, it) != 0;
+        submeshCount++;
+    }
+    fits = fits && (renderer->gpuCullInstanceCount + submeshCount <= Renderer::MaxGPUCullInstances);
+
+    u32 object = 0;
+    if (fits) {
+        if (data->objectIndex) {
+            object = data->objectIndex - 1;
+        } else if (*transientCount < Renderer::MaxGPUCullInstances) {
+            object = RenderScene::MaxObjects + *transientCount;
+        } else {
+            fits = false;
+        }
+    }
+
+    if (fits) {
+        Renderer::GPUDrawBatch key = {};
+        key.pbr = assets->pbr;
+        memcpy(key.textures, assets->textures, sizeof(key.textures));
+        u32 pbrFeatures = assets->pbrFeatures | PbrMeshFeature::Indirect;
+        if (!key.pbr) {
+            key.program = GetShaderPermutation(renderer, ShaderIndex::Mesh, MeshFeature::Indirect);
+            key.mapMask = assets->mapMask;
+        }
+        u32 instanceIndex = renderer->gpuCullInstanceCount;
+        for (auto it = mesh; it && fits; it = it->next) {
+            if (key.pbr) {
+                key.program = GetShaderPermutation(renderer, ShaderIndex::PbrMesh, it->bitangents ? pbrFeatures | PbrMeshFeature::HasBitangents : pbrFeatures);
+            }
+            u32 batch = FindGPUDrawBatch(renderer, &key);
+            u32 command = batch != U32::Max ? FindGPUDrawCommand(renderer, batch, it->gpuDrawSlot - 1) : U32::Max;
+            if (command != U32::Max) {
+                auto instance = renderer->gpuCullInstances + instanceIndex++;
+                instance->object = object;
+                instance->command = command;
+                instance->shadowCommand = it->gpuDrawSlot - 1;
+                instance->dynamic = data->dynamic;
+                instance->boundsMin = V4(it->aabb.min, 1.0f);
+                instance->boundsMax = V4(it->aabb.max, 1.0f);
+            } else {
+                fits = false;
+            }
+        }
+
+        if (fits) {
+            renderer->gpuCullInstanceCount = instanceIndex;
+            if (!data->objectIndex) {
+                FillObjectData(renderer, renderer->gpuObjectData + *transientCount, data);
+                (*transientCount)++;
+            }
+        }
+    }
+    return fits;
+}
+
+// NOTE: Called by Begin of GPU-driven frames. Gathers instances and draw commands of the frame and uploads them
+// with the object data. Everything the GPU-driven passes can not draw goes to the CPU draw list
+void PrepareGPUDrivenFrame(Renderer* renderer, RenderGroup* group, AssetManager* manager) {
+    if (!renderer->gpuPoolVertexBuffer) {
+        AllocateGPUDrivenBuffers(renderer);
+        // NOTE: Objects updated before the buffer existed were never uploaded
+        auto scene = group->scene;
+        if (scene && scene->objectEnd) {
+            glNamedBufferSubData(renderer->gpuObjectDataBuffer, 0, sizeof(ShaderMeshData) * (uptr)scene->objectEnd, scene->objectData);
+        }
+    }
+
+    if (renderer->cpuDrawCapacity < group->commandQueueCapacity) {
+        if (renderer->cpuDraws) {
+            PlatformFree(renderer->cpuDraws, nullptr);
+        }
+        renderer->cpuDrawCapacity = group->commandQueueCapacity;
+        renderer->cpuDraws = (u32*)PlatformAlloc(sizeof(u32) * renderer->cpuDrawCapacity, 0, nullptr);
+    }
+
+    memset(renderer->gpuBatchTable, 0, sizeof(renderer->gpuBatchTable));
+    memset(renderer->gpuCommandTable, 0, sizeof(renderer->gpuCommandTable));
+    renderer->gpuCullInstanceCount = 0;
+    renderer->gpuDrawBatchCount = 0;
+    renderer->gpuDrawCommandCount = 0;
+    renderer->gpuShadowCommandCount = 0;
+    renderer->cpuDrawCount = 0;
+
+    u32 transientCount = 0;
+    for (u32 i = 0; i < group->commandQueueAt; i++) {
+        CommandQueueEntry* command = group->commandQueue + i;
+        if (command->type == RenderCommand::DrawMesh) {
+            auto data = (RenderCommandDrawMesh*)command->data;
+            RenderObjectAssets storage;
+            auto assets = GetDrawAssets(renderer, manager, group, data, &storage);
+            if (assets->mesh && !GatherGPUDraw(renderer, data, assets, &transientCount)) {
+                renderer->cpuDraws[renderer->cpuDrawCount++] = i;
+            }
+        } else {
+            renderer->cpuDraws[renderer->cpuDrawCount++] = i;
+        }
+    }
+
+    u32 instanceCount = renderer->gpuCullInstanceCount;
+    u32 commandCount = renderer->gpuDrawCommandCount;
+
+    // NOTE: Commands of a batch are contiguous, so a batch is drawn with a single multi draw
+    for (u32 i = 0; i < commandCount; i++) {
+        renderer->gpuDrawBatches[renderer->gpuCommandKeys[i] / Renderer::MaxGPUDrawSlots].commandCount++;
+    }
+    u32 firstCommand = 0;
+    for (u32 i = 0; i < renderer->gpuDrawBatchCount; i++) {
+        auto batch = renderer->gpuDrawBatches + i;
+        batch->firstCommand = firstCommand;
+        firstCommand += batch->commandCount;
+        batch->commandCount = 0;
+    }
+    for (u32 i = 0; i < commandCount; i++) {
+        auto batch = renderer->gpuDrawBatches + renderer->gpuCommandKeys[i] / Renderer::MaxGPUDrawSlots;
+        u32 position = batch->firstCommand + batch->commandCount++;
+        auto drawSlot = renderer->gpuDrawSlots + renderer->gpuCommandKeys[i] % Renderer::MaxGPUDrawSlots;
+        auto drawCommand = renderer->gpuDrawCommands + position;
+        drawCommand->count = drawSlot->indexCount;
+        drawCommand->instanceCount = 0;
+        drawCommand->firstIndex = drawSlot->firstIndex;
+        drawCommand->baseVertex = drawSlot->baseVertex;
+        // NOTE: Instance count of the command until the ranges are assigned
+        drawCommand->baseInstance = 0;
+        renderer->gpuCommandOrder[i] = position;
+    }
+
+    // NOTE: Every command reserves the instance range for all of its instances
+    for (u32 i = 0; i < instanceCount; i++) {
+        auto instance = renderer->gpuCullInstances + i;
+        instance->command = renderer->gpuCommandOrder[instance->command];
+        renderer->gpuDrawCommands[instance->command].baseInstance++;
+    }
+    u32 instanceOffset = 0;
+    for (u32 i = 0; i < commandCount; i++) {
+        auto drawCommand = renderer->gpuDrawCommands + i;
+        u32 count = drawCommand->baseInstance;
+        drawCommand->baseInstance = instanceOffset;
+        instanceOffset += count;
+    }
+    for (u32 i = 0; i < commandCount; i++) {
+        auto drawCommand = renderer->gpuDrawCommands + commandCount + i;
+        *drawCommand = renderer->gpuDrawCommands[i];
+        drawCommand->baseInstance += Renderer::MaxGPUCullInstances;
+    }
+
+    // NOTE: Shadow passes do not bind textures, so there is one command per used slot
+    memset(renderer->gpuSlotShadowCommands, 0, sizeof(u32) * renderer->gpuDrawSlotCount);
+    for (u32 i = 0; i < instanceCount; i++) {
+        renderer->gpuSlotShadowCommands[renderer->gpuCullInstances[i].shadowCommand]++;
+    }
+    u32 shadowCommandCount = 0;
+    instanceOffset = 0;
+    for (u32 slot = 0; slot < renderer->gpuDrawSlotCount; slot++) {
+        u32 slotInstanceCount = renderer->gpuSlotShadowCommands[slot];
+        if (slotInstanceCount) {
+            auto drawSlot = renderer->gpuDrawSlots + slot;
+            auto drawCommand = renderer->gpuShadowCommands + shadowCommandCount;
+            drawCommand->count = drawSlot->indexCount;
+            drawCommand->instanceCount = 0;
+            drawCommand->firstIndex = drawSlot->firstIndex;
+            drawCommand->baseVertex = drawSlot->baseVertex;
+            drawCommand->baseInstance = instanceOffset;
+            instanceOffset += slotInstanceCount;
+            renderer->gpuSlotShadowCommands[slot] = shadowCommandCount++;
+        }
+    }
+    for (u32 i = 0; i < instanceCount; i++) {
+        auto instance = renderer->gpuCullInstances + i;
+        instance->shadowCommand = renderer->gpuSlotShadowCommands[instance->shadowCommand];
+    }
+    renderer->gpuShadowCommandCount = shadowCommandCount;
+
+    if (transientCount) {
+        glNamedBufferSubData(renderer->gpuObjectDataBuffer, sizeof(ShaderMeshData) * (uptr)RenderScene::MaxObjects, sizeof(ShaderMeshData) * (uptr)transientCount, renderer->gpuObjectData);
+    }
+    if (instanceCount) {
+        memcpy(GetFrameMemory(renderer, &renderer->gpuCullInstanceBuffer), renderer->gpuCullInstances, sizeof(GPUCullInstance) * instanceCount);
+        memcpy(GetFrameMemory(renderer, &renderer->gpuDrawCommandBuffer), renderer->gpuDrawCommands, sizeof(DrawElementsIndirectCommand) * commandCount * 2);
+    }
+}
+
+// NOTE: Number of draws the CPU path goes through and the queue entry of the N-th one.
+// GPU-driven frames leave only some of them to the CPU
+u32 GetCPUDrawCount(Renderer* renderer, RenderGroup* group) {
+    return renderer->gpuDrivenFrame ? renderer->cpuDrawCount : group->commandQueueAt;
+}
+
+CommandQueueEntry* GetCPUDraw(Renderer* renderer, RenderGroup* group, u32 at) {
+    return group->commandQueue + (renderer->gpuDrivenFrame ? renderer->cpuDraws[at] : at);
+}
+
+void BuildHiZ(Renderer* renderer, GLuint depth, uv2 size, u32 sampleCount) {
+    if (renderer->hiZSize.x != size.x || renderer->hiZSize.y != size.y) {
+        if (renderer->hiZTarget) {
+            glDeleteTextures(1, &renderer->hiZTarget);
+        }
+        u32 levelCount = 1;
+        for (u32 s = Max(size.x, size.y); s > 1; s >>= 1) {
+            levelCount++;
+        }
+        glCreateTextures(GL_TEXTURE_2D, 1, &renderer->hiZTarget);
+        glTextureStorage2D(renderer->hiZTarget, levelCount, GL_R32F, size.x, size.y);
+        glTextureParameteri(renderer->hiZTarget, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTextureParameteri(renderer->hiZTarget, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(renderer->hiZTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(renderer->hiZTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        renderer->hiZSize = size;
+        renderer->hiZLevelCount = levelCount;
+    }
+
+    glUseProgram(renderer->shaders.HiZ);
+    glUniform1i(HiZShader::SampleCountLocation, sampleCount);
+    glBindTextureUnit(HiZShader::Source, depth);
+    glBindImageTexture(HiZShader::Dest, renderer->hiZTarget, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute((size.x + HiZShader::GroupSize - 1) / HiZShader::GroupSize, (size.y + HiZShader::GroupSize - 1) / HiZShader::GroupSize, 1);
+
+    glUseProgram(GetShaderPermutation(renderer, ShaderIndex::HiZ, HiZFeature::Downsample));
+    for (u32 level = 1; level < renderer->hiZLevelCount; level++) {
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        u32 w = Max(1u, size.x >> level);
+        u32 h = Max(1u, size.y >> level);
+        glBindImageTexture(HiZShader::Source, renderer->hiZTarget, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(HiZShader::Dest, renderer->hiZTarget, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((w + HiZShader::GroupSize - 1) / HiZShader::GroupSize, (h + HiZShader::GroupSize - 1) / HiZShader::GroupSize, 1);
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+// NOTE: First phase tests instances against the view frustum and the pyramid of the depth rendered with hiZViewProj.
+// Second phase builds nothing itself, it retests the instances the first phase rejected against the current pyramid
+void DispatchGPUCull(Renderer* renderer, u32 phase, const m4x4* viewProj, const m4x4* hiZViewProj, bool hiZEnabled) {
+    glUseProgram(renderer->shaders.GPUCull);
+    glUniform1ui(GPUCullShader::InstanceCountLocation, renderer->gpuCullInstanceCount);
+    glUniformMatrix4fv(GPUCullShader::CullViewProjLocation, 1, GL_FALSE, viewProj->data);
+    glUniformMatrix4fv(GPUCullShader::HiZViewProjLocation, 1, GL_FALSE, hiZViewProj->data);
+    glUniform1i(GPUCullShader::HiZEnabledLocation, hiZEnabled ? 1 : 0);
+    glUniform1i(GPUCullShader::PhaseLocation, phase);
+    glUniform1ui(GPUCullShader::CommandOffsetLocation, phase == 1 ? 0 : renderer->gpuDrawCommandCount);
+    glBindTextureUnit(GPUCullShader::HiZ, renderer->hiZTarget);
+    BindFrameStorageBuffer(renderer, GPUCullShader::Instances, &renderer->gpuCullInstanceBuffer);
+    BindFrameStorageBuffer(renderer, GPUCullShader::Commands, &renderer->gpuDrawCommandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPUCullShader::VisibleInstances, renderer->gpuVisibleInstanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPUCullShader::ObjectData, renderer->gpuObjectDataBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPUCullShader::OccludedInstances, renderer->gpuOccludedInstanceBuffer);
+    glDispatchCompute((renderer->gpuCullInstanceCount + GPUCullShader::GroupSize - 1) / GPUCullShader::GroupSize, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// NOTE: Pool streams go to attributes 0-4, the visible instance index to the instanced attribute
+void BindGPUPoolStreams(Renderer* renderer, GLuint visibleInstances, uptr visibleOffset) {
+    glBindBuffer(GL_ARRAY_BUFFER, renderer->gpuPoolVertexBuffer);
+    uptr offset = 0;
+    for (u32x stream = 0; stream < array_count(GPUPoolStreamElementSizes); stream++) {
+        glEnableVertexAttribArray(stream);
+        glVertexAttribPointer(stream, GPUPoolStreamElementSizes[stream] / sizeof(f32), GL_FLOAT, GL_FALSE, 0, (void*)offset);
+        offset += (uptr)GPUPoolStreamElementSizes[stream] * Renderer::GPUPoolVertexCapacity;
+    }
+
+    // NOTE: Instanced attribute fetch is offset by baseInstance of the command
+    glBindBuffer(GL_ARRAY_BUFFER, visibleInstances);
+    glEnableVertexAttribArray(IndirectDrawShader::InstanceIndex);
+    glVertexAttribIPointer(IndirectDrawShader::InstanceIndex, 1, GL_UNSIGNED_INT, 0, (void*)visibleOffset);
+    glVertexAttribDivisor(IndirectDrawShader::InstanceIndex, 1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->gpuPoolIndexBuffer);
+    BindFrameStorageBuffer(renderer, GPUCullShader::Instances, &renderer->gpuCullInstanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPUCullShader::ObjectData, renderer->gpuObjectDataBuffer);
+}
+
+void UnbindGPUPoolStreams() {
+    glVertexAttribDivisor(IndirectDrawShader::InstanceIndex, 0);
+    glDisableVertexAttribArray(IndirectDrawShader::InstanceIndex);
+}
+
+// NOTE: Draws the culled instances of the phase command set, one multi draw per batch
+void DrawGPUBatches(Renderer* renderer, RenderGroup* group, GLuint shadowMap, GLuint shadowMoments, u32 phase) {
+    BindGPUPoolStreams(renderer, renderer->gpuVisibleInstanceBuffer, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer->gpuDrawCommandBuffer.handle);
+    uptr commandOffset = GetFrameOffset(renderer, &renderer->gpuDrawCommandBuffer);
+    if (phase == 2) {
+        commandOffset += sizeof(DrawElementsIndirectCommand) * renderer->gpuDrawCommandCount;
+    }
+
+    for (u32 i = 0; i < renderer->gpuDrawBatchCount; i++) {
+        auto batch = renderer->gpuDrawBatches + i;
+        glUseProgram(batch->program);
+        // NOTE: Units of the shared textures differ between the workflows
+        if (batch->pbr) {
+            glBindTextureUnit(MeshPBRShader::EnviromentMap, group->envMapHandle);
+            glBindTextureUnit(MeshPBRShader::BRDFLut, renderer->BRDFLutHandle);
+            glBindTextureUnit(MeshPBRShader::ShadowMap, shadowMap);
+            glBindTextureUnit(MeshPBRShader::ShadowMoments, shadowMoments);
+        } else {
+            glBindTextureUnit(MeshShader::ShadowMap, shadowMap);
+            glBindTextureUnit(MeshShader::ShadowMoments, shadowMoments);
+            glUniform1ui(IndirectDrawShader::MapMaskLocation, batch->mapMask);
+        }
+        for (u32x unit = 0; unit < Renderer::GPUBatchTextureUnits; unit++) {
+            if (batch->textures[unit]) {
+                glBindTextureUnit(unit, batch->textures[unit]);
+            }
+        }
+        auto commands = (void*)(commandOffset + sizeof(DrawElementsIndirectCommand) * batch->firstCommand);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, commands, batch->commandCount, 0);
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    UnbindGPUPoolStreams();
+}
+
+// NOTE: Culls the instances against the cascade and draws the casters which passed to the bound framebuffer.
+// Every shadow pass of the frame uses its own set, since the command templates are written by the CPU
+void DrawShadowCascadeGPU(Renderer* renderer, u32 set, u32 cascadeIndex, ShadowCasters casters) {
+    u32 commandCount = renderer->gpuShadowCommandCount;
+    if (commandCount) {
+        u32 commandOffset = GetFrameOffset(renderer, &renderer->gpuShadowCommandBuffer) + set * renderer->gpuShadowCommandSetSize;
+        memcpy(renderer->gpuShadowCommandBuffer.memory + commandOffset, renderer->gpuShadowCommands, sizeof(DrawElementsIndirectCommand) * commandCount);
+        uptr visibleOffset = sizeof(u32) * (uptr)Renderer::MaxGPUCullInstances * set;
+
+        glUseProgram(GetShaderPermutation(renderer, ShaderIndex::GPUCull, GPUCullFeature::Shadow));
+        glUniform1ui(GPUCullShader::InstanceCountLocation, renderer->gpuCullInstanceCount);
+        glUniformMatrix4fv(GPUCullShader::CullViewProjLocation, 1, GL_FALSE, renderer->shadowCascadeViewProjMatrices[cascadeIndex].data);
+        glUniform1i(GPUCullShader::CastersLocation, (i32)casters);
+        BindFrameStorageBuffer(renderer, GPUCullShader::Instances, &renderer->gpuCullInstanceBuffer);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, GPUCullShader::Commands, renderer->gpuShadowCommandBuffer.handle, commandOffset, renderer->gpuShadowCommandSetSize);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, GPUCullShader::VisibleInstances, renderer->gpuShadowVisibleInstanceBuffer, visibleOffset, sizeof(u32) * Renderer::MaxGPUCullInstances);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPUCullShader::ObjectData, renderer->gpuObjectDataBuffer);
+        glDispatchCompute((renderer->gpuCullInstanceCount + GPUCullShader::GroupSize - 1) / GPUCullShader::GroupSize, 1, 1);
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUseProgram(GetShaderPermutation(renderer, ShaderIndex::Shadow, ShadowFeature::Indirect));
+        glUniform1i(ShadowPassShader::CascadeIndexLocation, cascadeIndex);
+        BindGPUPoolStreams(renderer, renderer->gpuShadowVisibleInstanceBuffer, visibleOffset);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer->gpuShadowCommandBuffer.handle);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(uptr)commandOffset, commandCount, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        UnbindGPUPoolStreams();
+    }
+}
+
+// NOTE: If layered is true, every mesh is drawn once instanced for all the cascades it overlaps.
+// Otherwise cascadeMask should contain a single cascade which framebuffer is bound
+void RenderShadowMap(Renderer* renderer, RenderGroup* group, AssetManager* manager, u32 cascadeMask, bool layered, ShadowCasters casters) {
+    u32 drawCount = GetCPUDrawCount(renderer, group);
+    if (drawCount) {
+        for (u32 i = 0; i < drawCount; i++) {
+            CommandQueueEntry* command = GetCPUDraw(renderer, group, i);
+
+            switch (command->type) {
+            case RenderCommand::DrawMesh: {
+                auto* data = (RenderCommandDrawMesh*)command->data;
+                if ((casters == ShadowCasters::Static && data->dynamic) ||
+                    (casters == ShadowCasters::Dynamic && !data->dynamic)) {
+                    break;
+                }
+
+                RenderObjectAssets assetStorage;
+                auto mesh = GetDrawAssets(renderer, manager, group, data, &assetStorage)->mesh;
+                if (mesh) {
+                    bool uniformsUploaded = false;
+                    while (mesh) {
+                        u32 meshCascades = CalcShadowCascadeMask(renderer, &data->transform, mesh->aabb, cascadeMask);
+                        if (meshCascades) {
+                            if (!uniformsUploaded) {
+                                ShaderMeshData objectStorage;
+                                auto objectData = GetDrawObjectData(renderer, group, data, &objectStorage);
+                                auto meshBuffer = Map(&renderer->meshUniformBuffer);
+                                *meshBuffer = *objectData;
+                                Unmap(&renderer->meshUniformBuffer);
+                                uniformsUploaded = true;
+                            }
+
+                            glBindBuffer(GL_ARRAY_BUFFER, mesh->gpuVertexBufferHandle);
+
+                            auto posAttrLoc = ShadowPassShader::PositionAttribLocation;
+                            glEnableVertexAttribArray(posAttrLoc);
+                            glVertexAttribPointer(posAttrLoc, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+                            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->gpuIndexBufferHandle);
+                            if (layered) {
+                                glUniform1ui(ShadowPassShader::CascadeMaskLocation, meshCascades);
+                                glDrawElementsInstanced(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, 0, CountSetBits(meshCascades));
+                            } else {
+                                glDrawElements(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, 0);
+                            }
+                        }
+                        mesh = mesh->next;
+                    }
+                }
+            } break;
+            }
+        }
+    }
+}
+
+// NOTE: Draws casters to the cascades in the mask, either to all the layers at once or per cascade.
+// Color is the optional debug copy of the depth
+void DrawShadowCascades(Renderer* renderer, RenderGroup* group, AssetManager* manager, RenderGraph* graph, RenderGraphTexture color, RenderGraphTexture depth, u32 cascadeMask, ShadowCasters casters, bool clear) {
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    defer { glDisable(GL_POLYGON_OFFSET_FILL); };
+    glPolygonOffset(renderer->shadowSlopeBiasScale, 0.0f);
+    // NOTE: Pancaking. Casters in front of the cascade near plane still write depth (clamped to zero)
+    glEnable(GL_DEPTH_CLAMP);
+    defer { glDisable(GL_DEPTH_CLAMP); };
+    glEnable(GL_DEPTH_TEST);
+    glViewport(0, 0, (GLsizei)renderer->shadowMapRes, (GLsizei)renderer->shadowMapRes);
+
+    u32 allCascades = (1 << renderer->shadowCascadeCount) - 1;
+    if (renderer->gpuDrivenFrame) {
+        // NOTE: Pass per cascade, the cull pass writes the draws of one cascade. Draws left to the CPU follow
+        for (u32x cascadeIndex = 0; cascadeIndex < renderer->shadowCascadeCount; cascadeIndex++) {
+            if (cascadeMask & (1 << cascadeIndex)) {
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GetFramebuffer(graph, color, depth, cascadeIndex));
+                if (clear) {
+                    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+                }
+                u32 set = (casters == ShadowCasters::Static ? 0 : Renderer::MaxShadowCascades) + cascadeIndex;
+                DrawShadowCascadeGPU(renderer, set, cascadeIndex, casters);
+                glUseProgram(renderer->shaders.Shadow);
+                glUniform1i(ShadowPassShader::CascadeIndexLocation, cascadeIndex);
+                RenderShadowMap(renderer, group, manager, 1 << cascadeIndex, false, casters);
+            }
+        }
+    } else if (GlobalPlatform.gl->extensions.ARB_shader_viewport_layer_array) {
+        glUseProgram(GetShaderPermutation(renderer, ShaderIndex::Shadow, ShadowFeature::Layered));
+        GLuint layeredFramebuffer = GetFramebuffer(graph, color, depth);
+        if (clear) {
+            if (cascadeMask == allCascades) {
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, layeredFramebuffer);
+                glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+            } else {
+                for (u32x cascadeIndex = 0; cascadeIndex < renderer->shadowCascadeCount; cascadeIndex++) {
+                    if (cascadeMask & (1 << cascadeIndex)) {
+                        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GetFramebuffer(graph, color, depth, cascadeIndex));
+                        glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+                    }
+                }
+            }
+        }
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, layeredFramebuffer);
+        RenderShadowMap(renderer, group, manager, cascadeMask, true, casters);
+    } else {
+        // NOTE: Fallback. Pass per cascade, still skipping meshes outside of the cascade
+        glUseProgram(renderer->shaders.Shadow);
+        for (u32x cascadeIndex = 0; cascadeIndex < renderer->shadowCascadeCount; cascadeIndex++) {
+            if (cascadeMask & (1 << cascadeIndex)) {
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GetFramebuffer(graph, color, depth, cascadeIndex));
+                if (clear) {
+                    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+                }
+                glUniform1i(ShadowPassShader::CascadeIndexLocation, cascadeIndex);
+                RenderShadowMap(renderer, group, manager, 1 << cascadeIndex, false, casters);
+            }
+        }
+    }
+}
+
+// NOTE: Anything that changes the contents of static layers goes to the hash
+u64 HashStaticShadowCasters(Renderer* renderer, RenderGroup* group, AssetManager* manager) {
+    u64 hash = Hash64(&renderer->shadowConstantBias, sizeof(renderer->shadowConstantBias));
+    hash = Hash64(&renderer->shadowSlopeBiasScale, sizeof(renderer->shadowSlopeBiasScale), hash);
+    for (u32 i = 0; i < group->commandQueueAt; i++) {
+        CommandQueueEntry* command = group->commandQueue + i;
+        if (command->type == RenderCommand::DrawMesh) {
+            auto* data = (RenderCommandDrawMesh*)command->data;
+            if (!data->dynamic) {
+                // NOTE: Mesh could be still loading
+                b32 loaded = GetMesh(manager, data->meshID) ? true : false;
+                hash = Hash64(&data->transform, sizeof(data->transform), hash);
+                hash = Hash64(&data->meshID, sizeof(data->meshID), hash);
+                hash = Hash64(&loaded, sizeof(loaded), hash);
+            }
+        }
+    }
+    return hash;
+}
+
+// NOTE: Builds prefiltered EVSM moments from the shadow map. Blur runs at full cascade resolution
+// per cascade layer, then the mip chain is generated so distant receivers get filtered fetches too
+void FilterShadowMoments(Renderer* renderer, GLuint shadowMap, GLuint moments, GLuint blur) {
+    GLuint horizontal = renderer->shaders.EVSMBlur;
+    GLuint vertical = GetShaderPermutation(renderer, ShaderIndex::EVSMBlur, EVSMBlurFeature::Vertical);
+    GLuint res = renderer->shadowMapRes;
+    GLuint groupCount = (res + EVSMBlurShader::GroupSize - 1) / EVSMBlurShader::GroupSize;
+    i32 radius = Clamp(renderer->evsmBlurRadius, 0, EVSMBlurShader::MaxBlurRadius);
+
+    for (u32x cascadeIndex = 0; cascadeIndex < renderer->shadowCascadeCount; cascadeIndex++) {
+        glUseProgram(horizontal);
+        glUniform1i(EVSMBlurShader::CascadeLocation, cascadeIndex);
+        glUniform1i(EVSMBlurShader::RadiusLocation, radius);
+        glBindTextureUnit(EVSMBlurShader::Source, shadowMap);
+        glBindSampler(EVSMBlurShader::Source, renderer->evsmDepthSampler);
+        glBindImageTexture(EVSMBlurShader::Dest, blur, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute(groupCount, res, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        glUseProgram(vertical);
+        glUniform1i(EVSMBlurShader::CascadeLocation, cascadeIndex);
+        glUniform1i(EVSMBlurShader::RadiusLocation, radius);
+        glBindSampler(EVSMBlurShader::Source, 0);
+        glBindTextureUnit(EVSMBlurShader::Source, blur);
+        glBindImageTexture(EVSMBlurShader::Dest, moments, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute(groupCount, res, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    glGenerateTextureMipmap(moments);
+}
+
+void ExecuteStaticShadowPass(RenderGraph* graph, void* data) {
+    auto frame = (RenderFrame*)data;
+    DrawShadowCascades(frame->renderer, frame->group, frame->manager, graph, frame->shadowStaticDebugColor, frame->shadowStaticDepth, frame->invalidStaticCascades, ShadowCasters::Static, true);
+}
+
+void ExecuteShadowPass(RenderGraph* graph, void* data) {
+    auto frame = (RenderFrame*)data;
+    auto renderer = frame->renderer;
+    u32 allCascades = (1 << renderer->shadowCascadeCount) - 1;
+
+    if (frame->shadowStaticDepth) {
+        GLsizei res = (GLsizei)renderer->shadowMapRes;
+        glCopyImageSubData(GetTextureHandle(graph, frame->shadowStaticDepth), GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+                           GetTextureHandle(graph, frame->shadowMap), GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+                           res, res, renderer->shadowCascadeCount);
+        if (frame->shadowDebugColor && frame->shadowStaticDebugColor) {
+            glCopyImageSubData(GetTextureHandle(graph, frame->shadowStaticDebugColor), GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+                               GetTextureHandle(graph, frame->shadowDebugColor), GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+                               res, res, renderer->shadowCascadeCount);
+        }
+
+        DrawShadowCascades(renderer, frame->group, frame->manager, graph, frame->shadowDebugColor, frame->shadowMap, allCascades, ShadowCasters::Dynamic, false);
+    } else {
+        DrawShadowCascades(renderer, frame->group, frame->manager, graph, frame->shadowDebugColor, frame->shadowMap, allCascades, ShadowCasters::All, true);
+    }
+}
+
+void ExecuteEVSMPass(RenderGraph* graph, void* data) {
+    auto frame = (RenderFrame*)data;
+    auto renderer = frame->renderer;
+    GLuint moments = GetTextureHandle(graph, frame->evsmMoments);
+    // NOTE: Pooled textures do not carry anisotropy, moments are the only target which needs it
+    glTextureParameterf(moments, GL_TEXTURE_MAX_ANISOTROPY_ARB, renderer->maxAnisotropy);
+    FilterShadowMoments(renderer, GetTextureHandle(graph, frame->shadowMap), moments, GetTextureHandle(graph, frame->evsmBlur));
+}
+
+void ShadowPass(Renderer* renderer, RenderGroup* group, AssetManager* manager) {
+    auto graph = renderer->graph;
+    auto frame = &renderer->frame;
+    u32 allCascades = (1 << renderer->shadowCascadeCount) - 1;
+
+    RenderTextureDesc shadowMapDesc = {};
+    shadowMapDesc.type = RenderTextureType::Texture2DArray;
+    shadowMapDesc.format = GL_DEPTH_COMPONENT32;
+    shadowMapDesc.width = renderer->shadowMapRes;
+    shadowMapDesc.height = renderer->shadowMapRes;
+    shadowMapDesc.layers = renderer->shadowCascadeCount;
+    shadowMapDesc.flags = RenderTextureFlags::DepthCompare;
+    frame->shadowMap = CreateTransientTexture(graph, "ShadowMap", shadowMapDesc);
+
+    if (renderer->shadowMapDebugColor) {
+        RenderTextureDesc debugColorDesc = shadowMapDesc;
+        debugColorDesc.format = GL_R8;
+        debugColorDesc.flags = RenderTextureFlags::Nearest;
+        frame->shadowDebugColor = CreateTransientTexture(graph, "ShadowMapDebugColor", debugColorDesc);
+    }
+
+    if (renderer->cacheStaticShadows) {
+        u64 staticHash = HashStaticShadowCasters(renderer, group, manager);
+        if (staticHash != renderer->shadowStaticCastersHash) {
+            renderer->shadowStaticCastersHash = staticHash;
+            renderer->shadowStaticValidMask = 0;
+        }
+
+        // NOTE: Stable cascades are snapped to texels, so the matrix stays exactly the same until camera moves far enough
+        u32 invalidCascades = 0;
+        for (u32x cascadeIndex = 0; cascadeIndex < renderer->shadowCascadeCount; cascadeIndex++) {
+            auto viewProj = renderer->shadowCascadeViewProjMatrices + cascadeIndex;
+            auto cached = renderer->shadowStaticViewProjMatrices + cascadeIndex;
+            if (!(renderer->shadowStaticValidMask & (1 << cascadeIndex)) || memcmp(viewProj, cached, sizeof(m4x4)) != 0) {
+                invalidCascades |= 1 << cascadeIndex;
+                *cached = *viewProj;
+            }
+        }
+
+        frame->shadowStaticDepth = ImportTexture(graph, "ShadowMapStatic", renderer->shadowMapStaticDepthTarget);
+        if (renderer->shadowMapStaticDebugColorTarget) {
+            frame->shadowStaticDebugColor = ImportTexture(graph, "ShadowMapStaticDebugColor", renderer->shadowMapStaticDebugColorTarget);
+        }
+
+        if (invalidCascades) {
+            frame->invalidStaticCascades = invalidCascades;
+            u32 pass = AddRenderPass(graph, "StaticShadows", ExecuteStaticShadowPass, frame);
+            WriteTexture(graph, pass, frame->shadowStaticDepth);
+            WriteTexture(graph, pass, frame->shadowStaticDebugColor);
+            renderer->shadowStaticValidMask = allCascades;
+        }
+    }
+
+    u32 pass = AddRenderPass(graph, "Shadows", ExecuteShadowPass, frame);
+    ReadTexture(graph, pass, frame->shadowStaticDepth);
+    ReadTexture(graph, pass, frame->shadowStaticDebugColor);
+    WriteTexture(graph, pass, frame->shadowMap);
+    WriteTexture(graph, pass, frame->shadowDebugColor);
+
+    // NOTE: Declared regardless of the filter. The graph culls it unless the main pass reads the moments
+    u32 levelCount = 1;
+    while ((renderer->shadowMapRes >> levelCount) > 0) {
+        levelCount++;
+    }
+    RenderTextureDesc momentsDesc = shadowMapDesc;
+    momentsDesc.format = GL_RGBA16F;
+    momentsDesc.levels = levelCount;
+    momentsDesc.flags = 0;
+    frame->evsmMoments = CreateTransientTexture(graph, "EVSMMoments", momentsDesc);
+
+    RenderTextureDesc blurDesc = {};
+    blurDesc.type = RenderTextureType::Texture2D;
+    blurDesc.format = GL_RGBA16F;
+    blurDesc.width = renderer->shadowMapRes;
+    blurDesc.height = renderer->shadowMapRes;
+    blurDesc.flags = RenderTextureFlags::Nearest;
+    frame->evsmBlur = CreateTransientTexture(graph, "EVSMBlur", blurDesc);
+
+    pass = AddRenderPass(graph, "EVSM", ExecuteEVSMPass, frame);
+    ReadTexture(graph, pass, frame->shadowMap);
+    WriteTexture(graph, pass, frame->evsmMoments);
+    WriteTexture(graph, pass, frame->evsmBlur);
+}
+
+void DrawDebugLines(Renderer* renderer, RenderGroup* group) {
+    auto batch = &group->debugLines;
+    u32 regionOffset = GetFrameOffset(renderer, &renderer->debugLineBuffer);
+    auto regionVertices = (DebugLineVertex*)GetFrameMemory(renderer, &renderer->debugLineBuffer);
+    u32 bucketOffsets[DebugLineBatch::WidthBucketCount];
+    u32 vertexCount = 0;
+    for (u32x bucket = 0; bucket < DebugLineBatch::WidthBucketCount; bucket++) {
+        bucketOffsets[bucket] = vertexCount;
+        if (batch->vertexCount[bucket]) {
+            memcpy(regionVertices + vertexCount, batch->vertices[bucket], sizeof(DebugLineVertex) * batch->vertexCount[bucket]);
+            vertexCount += batch->vertexCount[bucket];
+        }
+    }
+    DEBUG_OVERLAY_TRACE(vertexCount);
+
+    if (vertexCount) {
+        glUseProgram(renderer->shaders.Line);
+        glBindBuffer(GL_ARRAY_BUFFER, renderer->debugLineBuffer.handle);
+        glEnableVertexAttribArray(LineShader::Position);
+        glEnableVertexAttribArray(LineShader::Color);
+        glVertexAttribPointer(LineShader::Position, 3, GL_FLOAT, GL_FALSE, sizeof(DebugLineVertex), (void*)((uptr)regionOffset + offset_of(DebugLineVertex, position)));
+        glVertexAttribPointer(LineShader::Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DebugLineVertex), (void*)((uptr)regionOffset + offset_of(DebugLineVertex, color)));
+
+        for (u32x bucket = 0; bucket < DebugLineBatch::WidthBucketCount; bucket++) {
+            if (batch->vertexCount[bucket]) {
+                glLineWidth(GetDebugLineBucketWidth(bucket));
+                glDrawArrays(GL_LINES, bucketOffsets[bucket], batch->vertexCount[bucket]);
+            }
+        }
+        glDisableVertexAttribArray(LineShader::Color);
+    }
+}
+
+bool OcclusionCulled(Renderer* renderer, const m4x4* transform, const Mesh* mesh) {
+    bool result = false;
+    if (renderer->occlusionActive && !IsVisible(renderer->occlusionBuffer, transform, mesh->aabb)) {
+        renderer->occlusionCulledCount++;
+        result = true;
+    }
+    return result;
+}
+
+int CompareDrawSortKeys(const void* a, const void* b) {
+    auto keyA = (const DrawSortKey*)a;
+    auto keyB = (const DrawSortKey*)b;
+    int result;
+    if (keyA->depth != keyB->depth) {
+        result = keyA->depth < keyB->depth ? -1 : 1;
+    } else {
+        // NOTE: qsort is not stable, queue order breaks ties so the result is deterministic
+        result = keyA->index < keyB->index ? -1 : (keyA->index > keyB->index ? 1 : 0);
+    }
+    return result;
+}
+
+// NOTE: Mesh draws are sorted among the slots they already occupy, so all other commands keep their positions
+void SortDrawsFrontToBack(Renderer* renderer, RenderGroup* group) {
+    if (renderer->drawSortCapacity < group->commandQueueCapacity) {
+        if (renderer->drawSortKeys) {
+            PlatformFree(renderer->drawSortKeys, nullptr);
+            PlatformFree(renderer->drawSortEntries, nullptr);
+        }
+        renderer->drawSortCapacity = group->commandQueueCapacity;
+        renderer->drawSortKeys = (DrawSortKey*)PlatformAlloc(sizeof(DrawSortKey) * renderer->drawSortCapacity, 0, nullptr);
+        renderer->drawSortEntries = (CommandQueueEntry*)PlatformAlloc(sizeof(CommandQueueEntry) * renderer->drawSortCapacity, 0, nullptr);
+    }
+
+    auto viewMatrix = &group->camera->viewMatrix;
+    u32 count = 0;
+    for (u32 i = 0; i < group->commandQueueAt; i++) {
+        CommandQueueEntry* command = group->commandQueue + i;
+        if (command->type == RenderCommand::DrawMesh) {
+            auto data = (RenderCommandDrawMesh*)command->data;
+            v4 viewPos = *viewMatrix * V4(ExtractTranslation(data->transform), 1.0f);
+            renderer->drawSortKeys[count].depth = -viewPos.z;
+            renderer->drawSortKeys[count].index = i;
+            count++;
+        }
+    }
+
+    if (count > 1) {
+        qsort(renderer->drawSortKeys, count, sizeof(DrawSortKey), CompareDrawSortKeys);
+        for (u32 i = 0; i < count; i++) {
+            renderer->drawSortEntries[i] = group->commandQueue[renderer->drawSortKeys[i].index];
+        }
+        u32 at = 0;
+        for (u32 i = 0; i < group->commandQueueAt; i++) {
+            if (group->commandQueue[i].type == RenderCommand::DrawMesh) {
+                group->commandQueue[i] = renderer->drawSortEntries[at++];
+            }
+        }
+    }
+}
+
+// NOTE: Position only pass with the shadow program. Main pass vertex shaders are not invariant with it,
+// so depth is pushed slightly back to make sure that visible fragments pass GL_LEQUAL
+void DrawDepthPrePass(Renderer* renderer, RenderGroup* group, AssetManager* manager) {
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    defer { glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE); };
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    defer { glDisable(GL_POLYGON_OFFSET_FILL); };
+    glPolygonOffset(1.0f, 1.0f);
+
+    glUseProgram(GetShaderPermutation(renderer, ShaderIndex::Shadow, ShadowFeature::PrePass));
+
+    for (u32 i = 0; i < group->commandQueueAt; i++) {
+        CommandQueueEntry* command = group->commandQueue + i;
+        if (command->type == RenderCommand::DrawMesh) {
+            auto data = (RenderCommandDrawMesh*)command->data;
+            RenderObjectAssets assetStorage;
+            auto mesh = GetDrawAssets(renderer, manager, group, data, &assetStorage)->mesh;
+            bool uniformsUploaded = false;
+            while (mesh) {
+                if (!renderer->occlusionActive || IsVisible(renderer->occlusionBuffer, &data->transform, mesh->aabb)) {
+                    if (!uniformsUploaded) {
+                        ShaderMeshData objectStorage;
+                        auto objectData = GetDrawObjectData(renderer, group, data, &objectStorage);
+                        auto meshBuffer = Map(&renderer->meshUniformBuffer);
+                        *meshBuffer = *objectData;
+                        Unmap(&renderer->meshUniformBuffer);
+                        uniformsUploaded = true;
+                    }
+
+                    glBindBuffer(GL_ARRAY_BUFFER, mesh->gpuVertexBufferHandle);
+                    glEnableVertexAttribArray(ShadowPassShader::PositionAttribLocation);
+                    glVertexAttribPointer(ShadowPassShader::PositionAttribLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
+                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->gpuIndexBufferHandle);
+                    glDrawElements(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, 0);
+                }
+                mesh = mesh->next;
+            }
+        }
+    }
+}
+
+void ExecuteMainPass(RenderGraph* graph, void* data) {
+    auto frame = (RenderFrame*)data;
+    auto renderer = frame->renderer;
+    auto group = frame->group;
+    auto assetManager = frame->manager;
+    GLuint shadowMap = GetTextureHandle(graph, frame->shadowMap);
+    // NOTE: Zero when the EVSM pass is culled
+    GLuint shadowMoments = GetTextureHandle(graph, frame->evsmMoments);
+
+    auto camera = group->camera;
+    auto dirLight = group->dirLight;
+
+    FinishOcclusion(renderer->occlusionBuffer);
+    renderer->occlusionCulledCount = 0;
+    if (renderer->occlusionActive) {
+        DEBUG_OVERLAY_TRACE(renderer->occlusionBuffer->triangleCount);
+    }
+
+    auto clusters = renderer->lightClusters;
+    FinishLightClusters(clusters);
+    memcpy(GetFrameMemory(renderer, &renderer->lightClusterBuffer), clusters->clusters, sizeof(u32) * 2 * LightClusterGrid::ClusterCount);
+    if (clusters->lightIndexCount) {
+        memcpy(GetFrameMemory(renderer, &renderer->lightIndexBuffer), clusters->lightIndices, sizeof(u32) * clusters->lightIndexCount);
+    }
+    BindFrameStorageBuffer(renderer, LocalLightsShader::Lights, &renderer->localLightBuffer);
+    BindFrameStorageBuffer(renderer, LocalLightsShader::Clusters, &renderer->lightClusterBuffer);
+    BindFrameStorageBuffer(renderer, LocalLightsShader::LightIndices, &renderer->lightIndexBuffer);
+    DEBUG_OVERLAY_TRACE(clusters->lightIndexCount);
+
+    m4x4 viewProj = camera->projectionMatrix * camera->viewMatrix;
+    bool gpuDraws = renderer->gpuDrivenFrame && renderer->gpuCullInstanceCount;
+    // NOTE: Hi-Z is built before the depth buffer of the previous frame is cleared. Without the history every
+    // instance in the frustum passes the first phase
+    if (gpuDraws) {
+        if (renderer->depthHistoryValid) {
+            BuildHiZ(renderer, renderer->depthHistoryTarget, renderer->viewportRes, renderer->sampleCount);
+        }
+        DispatchGPUCull(renderer, 1, &viewProj, &renderer->prevViewProj, renderer->depthHistoryValid);
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GetFramebuffer(graph, frame->hdrColor, frame->sceneDepth));
+    glViewport(0, 0, renderer->viewportRes.x, renderer->viewportRes.y);
+    glClearColor(renderer->clearColor.r, renderer->clearColor.g, renderer->clearColor.b, renderer->clearColor.a);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+
+    if (gpuDraws) {
+        glDepthFunc(GL_LESS);
+        DrawGPUBatches(renderer, group, shadowMap, shadowMoments, 1);
+        if (renderer->depthHistoryValid) {
+            BuildHiZ(renderer, renderer->depthHistoryTarget, renderer->viewportRes, renderer->sampleCount);
+            DispatchGPUCull(renderer, 2, &viewProj, &viewProj, true);
+            DrawGPUBatches(renderer, group, shadowMap, shadowMoments, 2);
+        }
+    }
+
+    bool depthPassDrawn = false;
+    if (!renderer->gpuDrivenFrame) {
+        if (renderer->sortFrontToBack) {
+            SortDrawsFrontToBack(renderer, group);
+        }
+        if (renderer->depthPrePass == DepthPrePass::CPU) {
+            DrawDepthPrePass(renderer, group, assetManager);
+            depthPassDrawn = true;
+        }
+    }
+    glDepthFunc(depthPassDrawn ? GL_LEQUAL : GL_LESS);
+    // NOTE: Pre-pass covers every mesh the main pass draws, so mesh depth is final
+    bool meshDepthWrites = !depthPassDrawn;
+
+    u32 drawCount = GetCPUDrawCount(renderer, group);
+    if (drawCount) {
+        for (u32 i = 0; i < drawCount; i++) {
+            CommandQueueEntry* command = GetCPUDraw(renderer, group, i);
+
+            switch (command->type) {
             case RenderCommand::DrawWater: {
-                auto* data = (RenderCommandDrawWater*)(group->renderBuffer + command->rbOffset);
+                auto* data = (RenderCommandDrawWater*)command->data;
                 auto program = renderer->shaders.Water;
 
                 m3x3 normalMatrix = MakeNormalMatrix(data->transform);
 
                 glUseProgram(program);
 
-                auto meshBuffer = Map(renderer->meshUniformBuffer);
+                auto meshBuffer = Map(&renderer->meshUniformBuffer);
                 meshBuffer->modelMatrix = data->transform;
                 meshBuffer->normalMatrix = normalMatrix;
-                Unmap(renderer->meshUniformBuffer);
+                Unmap(&renderer->meshUniformBuffer);
 
                 auto* mesh = data->mesh;
 
@@ -972,83 +2767,42 @@ void MainPass(Renderer* renderer, RenderGroup* group, AssetManager* assetManager
 
                 glDrawElements(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, 0);
             } break;
-            case RenderCommand::LineBegin: {
-                auto* data = (RenderCommandLineBegin*)(group->renderBuffer + command->rbOffset);
-
-                glUseProgram(renderer->shaders.Line);
-
-                auto meshBuffer = Map(renderer->meshUniformBuffer);
-                meshBuffer->lineColor = data->color;
-                Unmap(renderer->meshUniformBuffer);
-
-                uptr bufferSize = command->instanceCount * sizeof(RenderCommandPushLineVertex);
-                void* instanceData = (void*)((byte*)data + sizeof(RenderCommandLineBegin));
-
-                glBindBuffer(GL_ARRAY_BUFFER, renderer->lineBufferHandle);
-                glBufferData(GL_ARRAY_BUFFER, bufferSize, instanceData, GL_STATIC_DRAW);
-
-                glEnableVertexAttribArray(0);
-                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(v3), 0);
-
-                glLineWidth(data->width);
-
-                GLuint lineType;
-                switch (data->type) {
-                case RenderCommandLineBegin::Segments: { lineType = GL_LINES; } break;
-                case RenderCommandLineBegin::Strip: { lineType = GL_LINE_STRIP; } break;
-                default: {lineType = GL_LINES; assert(false, "sdf"); } break;
-                }
-
-                glDrawArrays(lineType, 0, command->instanceCount);
-
-            } break;
             case RenderCommand::DrawMesh: {
-                auto data = (RenderCommandDrawMesh*)(group->renderBuffer + command->rbOffset);
-                auto mesh = GetMesh(assetManager, data->meshID);
+                auto data = (RenderCommandDrawMesh*)command->data;
+                RenderObjectAssets assetStorage;
+                auto assets = GetDrawAssets(renderer, assetManager, group, data, &assetStorage);
+                auto mesh = assets->mesh;
                 if (mesh) {
-                    if (data->material.workflow == Material::Phong) {
-                        auto meshProg = renderer->shaders.Mesh;
-
-                        glUseProgram(meshProg);
-                        auto meshBuffer = Map(renderer->meshUniformBuffer);
-
-                        glBindTextureUnit(MeshShader::ShadowMap, renderer->shadowMapDepthTarget);
-
-                        if (data->material.phong.useDiffuseMap) {
-                            auto diffuseMap = GetTexture(assetManager, data->material.phong.diffuseMap);
-                            if (diffuseMap) {
-                                meshBuffer->phongUseDiffuseMap = 1;
-                                glBindTextureUnit(MeshShader::DiffMap, diffuseMap->gpuHandle);
-                            } else {
-                                meshBuffer->phongUseDiffuseMap = 0;
-                                meshBuffer->customPhongDiffuse = renderer->fallbackPhongMaterial.phong.diffuseValue;
-                            }
-                        } else {
-                            meshBuffer->phongUseDiffuseMap = 0;
-                            meshBuffer->customPhongDiffuse = data->material.phong.diffuseValue;
-                        }
-
-                        if (data->material.phong.useSpecularMap) {
-                            auto specularMap = GetTexture(assetManager, data->material.phong.specularMap);
-                            if (specularMap) {
-                                meshBuffer->phongUseSpecularMap = 1;
-                                glBindTextureUnit(MeshShader::SpecMap, specularMap->gpuHandle);
-                            } else {
-                                meshBuffer->phongUseSpecularMap = 0;
-                                meshBuffer->customPhongSpecular = renderer->fallbackPhongMaterial.phong.specularValue;
-                            }
-                        } else {
-                            meshBuffer->phongUseSpecularMap = 0;
-                            meshBuffer->customPhongSpecular = data->material.phong.specularValue;
+                    glDepthMask(meshDepthWrites ? GL_TRUE : GL_FALSE);
+                    defer { glDepthMask(GL_TRUE); };
+
+                    ShaderMeshData objectStorage;
+                    auto objectData = GetDrawObjectData(renderer, group, data, &objectStorage);
+                    auto meshBuffer = Map(&renderer->meshUniformBuffer);
+                    *meshBuffer = *objectData;
+                    // NOTE: Maps which are still loading are not sampled
+                    meshBuffer->phongUseDiffuseMap = (assets->mapMask & 1) ? 1 : 0;
+                    meshBuffer->phongUseSpecularMap = (assets->mapMask & 2) ? 1 : 0;
+                    Unmap(&renderer->meshUniformBuffer);
+
+                    // NOTE: Unused units hold zero
+                    for (u32x unit = 0; unit < RenderObjectAssets::TextureUnits; unit++) {
+                        if (assets->textures[unit]) {
+                            glBindTextureUnit(unit, assets->textures[unit]);
                         }
+                    }
 
-                        m3x3 normalMatrix = MakeNormalMatrix(data->transform);
-
-                        meshBuffer->modelMatrix = data->transform;
-                        meshBuffer->normalMatrix = normalMatrix;
-                        Unmap(renderer->meshUniformBuffer);
+                    if (data->material.workflow == Material::Phong) {
+                        glUseProgram(renderer->shaders.Mesh);
+                        glBindTextureUnit(MeshShader::ShadowMap, shadowMap);
+                        glBindTextureUnit(MeshShader::ShadowMoments, shadowMoments);
 
                         while (mesh) {
+                            if (OcclusionCulled(renderer, &data->transform, mesh)) {
+                                mesh = mesh->next;
+                                continue;
+                            }
+
                             glBindBuffer(GL_ARRAY_BUFFER, mesh->gpuVertexBufferHandle);
 
                             glEnableVertexAttribArray(0);
@@ -1069,158 +2823,29 @@ void MainPass(Renderer* renderer, RenderGroup* group, AssetManager* assetManager
                         }
                     } else if (data->material.workflow == Material::PBRMetallic ||
                                data->material.workflow == Material::PBRSpecular) {
-                        assert(group->irradanceMapHandle);
-
-                        auto meshProg = renderer->shaders.PbrMesh;
-                        glUseProgram(meshProg);
-
-                        auto meshBuffer = Map(renderer->meshUniformBuffer);
-
                         // TODO: Are they need to be binded every shader invocation?
-                        glBindTextureUnit(MeshPBRShader::IrradanceMap, group->irradanceMapHandle);
                         glBindTextureUnit(MeshPBRShader::EnviromentMap, group->envMapHandle);
-                        glBindTextureUnit(MeshPBRShader::ShadowMap, renderer->shadowMapDepthTarget);
-
-                        auto m = &data->material;
-
-                        // Getting materials
-                        switch (m->workflow) {
-                        case Material::PBRMetallic: {
-                            meshBuffer->metallicWorkflow = 1;
-
-                            // TODO: Refactor these
-                            if (data->material.pbrMetallic.useAlbedoMap) {
-                                auto albedoMap = GetTexture(assetManager, data->material.pbrMetallic.albedoMap);
-                                if (albedoMap) {
-                                    meshBuffer->pbrUseAlbedoMap = 1;
-                                    glBindTextureUnit(MeshPBRShader::AlbedoMap, albedoMap->gpuHandle);
-                                } else {
-                                    meshBuffer->pbrUseAlbedoMap = 0;
-                                    meshBuffer->pbrAlbedoValue = renderer->fallbackMetallicMaterial.pbrMetallic.albedoValue;
-                                }
-                            } else {
-                                meshBuffer->pbrUseAlbedoMap = 0;
-                                meshBuffer->pbrAlbedoValue = data->material.pbrMetallic.albedoValue;
-                            }
-
-                            if (data->material.pbrMetallic.useRoughnessMap) {
-                                auto roughnessMap = GetTexture(assetManager, data->material.pbrMetallic.roughnessMap);
-                                if (roughnessMap) {
-                                    meshBuffer->pbrUseRoughnessMap = 1;
-                                    glBindTextureUnit(MeshPBRShader::RoughnessMap, roughnessMap->gpuHandle);
-                                } else {
-                                    meshBuffer->pbrUseRoughnessMap = 0;
-                                    meshBuffer->pbrRoughnessValue = renderer->fallbackMetallicMaterial.pbrMetallic.roughnessValue;;
-                                }
-                            } else {
-                                meshBuffer->pbrUseRoughnessMap = 0;
-                                meshBuffer->pbrRoughnessValue = data->material.pbrMetallic.roughnessValue;
-                            }
-
-                            if (data->material.pbrMetallic.useMetallicMap) {
-                                auto metallicMap = GetTexture(assetManager, data->material.pbrMetallic.metallicMap);
-                                if (metallicMap) {
-                                    meshBuffer->pbrUseMetallicMap = 1;
-                                    glBindTextureUnit(MeshPBRShader::MetallicMap, metallicMap->gpuHandle);
-                                } else {
-                                    meshBuffer->pbrUseMetallicMap = 0;
-                                    meshBuffer->pbrMetallicValue = renderer->fallbackMetallicMaterial.pbrMetallic.metallicValue;;
-                                }
-                            } else {
-                                meshBuffer->pbrUseMetallicMap = 0;
-                                meshBuffer->pbrMetallicValue = data->material.pbrMetallic.metallicValue;
-                            }
-
-                            if (data->material.pbrMetallic.useNormalMap) {
-                                meshBuffer->normalFormat = m->pbrMetallic.normalFormat == NormalFormat::OpenGL ? 0 : 1;
-                                auto normalMap = GetTexture(assetManager, data->material.pbrMetallic.normalMap);
-                                if (normalMap) {
-                                    meshBuffer->pbrUseNormalMap = 1;
-                                    glBindTextureUnit(MeshPBRShader::NormalMap, normalMap->gpuHandle);
-                                } else {
-                                    meshBuffer->pbrUseNormalMap = 0;
-                                }
-                            } else {
-                                meshBuffer->pbrUseNormalMap = 0;
-                            }
-
-                            if (data->material.pbrMetallic.useAOMap) {
-                                auto aoMap = GetTexture(assetManager, data->material.pbrMetallic.AOMap);
-                                if (aoMap) {
-                                    meshBuffer->pbrUseAOMap = 1;
-                                    glBindTextureUnit(MeshPBRShader::AOMap, aoMap->gpuHandle);
-                                } else {
-                                    meshBuffer->pbrUseAOMap = 0;
-                                }
-                            } else {
-                                meshBuffer->pbrUseAOMap = 0;
-                            }
-
-                            if (data->material.pbrMetallic.emitsLight) {
-                                meshBuffer->emitsLight = 1;
-                                if (data->material.pbrMetallic.useEmissionMap) {
-                                    auto emissionMap = GetTexture(assetManager, data->material.pbrMetallic.emissionMap);
-                                    if (emissionMap) {
-                                        meshBuffer->pbrUseEmissionMap = 1;
-                                        glBindTextureUnit(MeshPBRShader::EmissionMap, emissionMap->gpuHandle);
-                                    } else {
-                                        meshBuffer->pbrUseEmissionMap = 0;
-                                    }
-                                } else {
-                                    meshBuffer->pbrUseEmissionMap = 0;
-                                    meshBuffer->pbrEmissionValue = data->material.pbrMetallic.emissionValue * data->material.pbrMetallic.emissionIntensity;
-                                }
-                            } else {
-                                meshBuffer->emitsLight = 0;
-                            }
-
-                        } break;
-                        case Material::PBRSpecular: {
-                            // TODO: Implement
-#if 0
-                            meshBuffer->metallicWorkflow = 0;
-
-                            auto albedoMap = GetTexture(assetManager, m->pbrMetallic.albedo);
-                            auto specularMap = GetTexture(assetManager, m->pbrSpecular.specular);
-                            auto glossMap = GetTexture(assetManager, m->pbrSpecular.gloss);
-                            auto normalMap = GetTexture(assetManager, m->pbrMetallic.normals);
-
-                            auto albedoHandle = albedoMap ? albedoMap->gpuHandle : renderer->nullTexture2D;
-                            glBindTextureUnit(MeshPBRShader::AlbedoMap, albedoHandle);
-
-                            auto specularHandle = specularMap ? specularMap->gpuHandle : renderer->nullTexture2D;
-                            glBindTextureUnit(MeshPBRShader::SpecularMap, specularHandle);
-
-                            auto glossHandle = glossMap ? glossMap->gpuHandle : renderer->nullTexture2D;
-                            glBindTextureUnit(MeshPBRShader::GlossMap, glossHandle);
-
-                            auto normalHandle = normalMap ? normalMap->gpuHandle : renderer->nullTexture2D;
-                            glBindTextureUnit(MeshPBRShader::NormalMap, normalHandle);
-#endif
-                        } break;
-                            invalid_default();
-                        }
-
+                        glBindTextureUnit(MeshPBRShader::ShadowMap, shadowMap);
+                        glBindTextureUnit(MeshPBRShader::ShadowMoments, shadowMoments);
                         glBindTextureUnit(MeshPBRShader::BRDFLut, renderer->BRDFLutHandle);
 
-                        auto normalMatrix = MakeNormalMatrix(data->transform);
-                        meshBuffer->modelMatrix = data->transform;
-                        meshBuffer->normalMatrix = normalMatrix;
-
-                        Unmap(renderer->meshUniformBuffer);
-
+                        u32 features = assets->pbrFeatures;
+                        GLuint currentProg = 0;
                         while (mesh) {
+                            if (OcclusionCulled(renderer, &data->transform, mesh)) {
+                                mesh = mesh->next;
+                                continue;
+                            }
+
                             glBindBuffer(GL_ARRAY_BUFFER, mesh->gpuVertexBufferHandle);
 
                             bool hasBitangents = mesh->bitangents ? true : false;
 
-                            // TODO: This is very slow and stupid
-                            // There are probably sould be different shaders for meshes that have bitangents
-                            // and for those that do not.
-                            // Or maybe bitangents sholdn't be optional at all?
-                            auto meshBuffer = Map(renderer->meshUniformBuffer);
-                            meshBuffer->hasBitangents = hasBitangents ? 1 : 0;
-                            Unmap(renderer->meshUniformBuffer);
+                            auto meshProg = GetShaderPermutation(renderer, ShaderIndex::PbrMesh, hasBitangents ? features | PbrMeshFeature::HasBitangents : features);
+                            if (meshProg != currentProg) {
+                                glUseProgram(meshProg);
+                                currentProg = meshProg;
+                            }
 
 
                             glEnableVertexAttribArray(0);
@@ -1257,20 +2882,144 @@ void MainPass(Renderer* renderer, RenderGroup* group, AssetManager* assetManager
             } break;
             }
         }
-        Reset(group);
     }
+    DrawDebugLines(renderer, group);
+    Reset(group);
 
     if (group->drawSkybox) {
         glDepthFunc(GL_EQUAL);
         DrawSkybox(renderer, group, &camera->invViewMatrix, &camera->invProjectionMatrix);
-        glDepthFunc(GL_LESS);
     }
+    glDepthFunc(GL_LESS);
+
+    renderer->prevViewProj = camera->projectionMatrix * camera->viewMatrix;
+    renderer->depthHistoryValid = renderer->depthHistoryTarget != 0;
 }
 
-void Begin(Renderer* renderer, RenderGroup* group) {
+void MainPass(Renderer* renderer, RenderGroup* group, AssetManager* assetManager) {
+    DEBUG_OVERLAY_SLIDER(renderer->gamma, 1.0f, 10.0f);
+    DEBUG_OVERLAY_SLIDER(renderer->exposure, 0.0f, 10.0f);
+    bool showShadowCascadesBoundaries = renderer->showShadowCascadesBoundaries;
+    DEBUG_OVERLAY_TOGGLE(showShadowCascadesBoundaries);
+    renderer->showShadowCascadesBoundaries = showShadowCascadesBoundaries;
+
+    i32 depthPrePass = (i32)renderer->depthPrePass;
+    DEBUG_OVERLAY_SLIDER(depthPrePass, 0, (i32)DepthPrePass::CPU);
+    renderer->depthPrePass = (DepthPrePass)depthPrePass;
+    bool sortFrontToBack = renderer->sortFrontToBack;
+    DEBUG_OVERLAY_TOGGLE(sortFrontToBack);
+    renderer->sortFrontToBack = sortFrontToBack;
+
+    auto graph = renderer->graph;
+    auto frame = &renderer->frame;
+
+    GLenum hdrFormat = renderer->hdrFormat == HDRFormat::RGBA16F ? GL_RGBA16F : GL_R11F_G11F_B10F;
+    frame->hdrColor = CreateTransientTexture(graph, "HDRColor", SceneTargetDesc(renderer, hdrFormat));
+
+    // NOTE: Hi-Z of the GPU-driven passes is built from the depth of the previous frame, so only then
+    // depth outlives the frame. Otherwise it is a transient and is dropped after the main pass
+    if (renderer->gpuDrivenFrame) {
+        if (!renderer->depthHistoryTarget) {
+            AllocateDepthHistory(renderer);
+        }
+        frame->sceneDepth = ImportTexture(graph, "SceneDepth", renderer->depthHistoryTarget);
+    } else {
+        FreeDepthHistory(renderer);
+        frame->sceneDepth = CreateTransientTexture(graph, "SceneDepth", SceneTargetDesc(renderer, GL_DEPTH_COMPONENT24));
+    }
+
+    u32 pass = AddRenderPass(graph, "Main", ExecuteMainPass, frame);
+    ReadTexture(graph, pass, frame->shadowMap);
+    if (renderer->shadowFilter == ShadowFilter::EVSM) {
+        ReadTexture(graph, pass, frame->evsmMoments);
+    }
+    WriteTexture(graph, pass, frame->hdrColor);
+    WriteTexture(graph, pass, frame->sceneDepth);
+}
+
+void UpdateDynamicResolution(Renderer* renderer) {
+    // NOTE: The query at the write position is the oldest one, issued GPUTimerQueryCount frames ago
+    if (renderer->gpuTimerQueriesIssued >= Renderer::GPUTimerQueryCount) {
+        GLuint query = renderer->gpuTimerQueries[renderer->gpuTimerQueryAt];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            f32 ms = (f32)((f64)elapsed / 1000000.0);
+            renderer->gpuFrameTimeMs = renderer->gpuFrameTimeMs > 0.0f ? Lerp(renderer->gpuFrameTimeMs, ms, 0.2f) : ms;
+        }
+    }
+
+    if (renderer->resolutionCooldown) {
+        renderer->resolutionCooldown--;
+    }
+
+    // NOTE: Offscreen output is compared with references, so it does not depend on GPU timings
+    f32 scale = 1.0f;
+    if (renderer->dynamicResolution && !renderer->outputTarget) {
+        scale = renderer->resolutionScale;
+        f32 budget = renderer->gpuFrameBudgetMs;
+        f32 time = renderer->gpuFrameTimeMs;
+        // NOTE: Cost is roughly proportional to the pixel count, hence square root. Scale is only raised when
+        // there is a noticeable headroom and changes are spaced out so timings of the new scale could arrive
+        if (!renderer->resolutionCooldown && time > 0.0f && (time > budget || time < budget * 0.8f)) {
+            f32 target = scale * Sqrt(budget / time);
+            f32 step = Clamp(target - scale, -2.0f * Renderer::ResolutionScaleStep, 2.0f * Renderer::ResolutionScaleStep);
+            f32 newScale = Round((scale + step) / Renderer::ResolutionScaleStep) * Renderer::ResolutionScaleStep;
+            newScale = Clamp(newScale, Renderer::MinResolutionScale, 1.0f);
+            if (newScale != scale) {
+                scale = newScale;
+                renderer->resolutionCooldown = Renderer::ResolutionChangeCooldown;
+            }
+        }
+    }
+    renderer->resolutionScale = scale;
+
+    uv2 viewportRes;
+    viewportRes.x = Max(1u, (u32)Round(renderer->renderRes.x * scale));
+    viewportRes.y = Max(1u, (u32)Round(renderer->renderRes.y * scale));
+    if (viewportRes.x != renderer->viewportRes.x || viewportRes.y != renderer->viewportRes.y) {
+        renderer->viewportRes = viewportRes;
+        // NOTE: Previous depth does not match new viewport
+        renderer->depthHistoryValid = false;
+    }
+}
+
+void Begin(Renderer* renderer, RenderGroup* group, AssetManager* manager) {
     auto light = group->dirLight;
     auto camera = group->camera;
 
+    ApplyRenderSceneUpdates(group);
+    if (group->scene) {
+        UpdateSceneObjects(renderer, group->scene);
+    }
+
+    BeginRenderGraph(renderer->graph);
+    renderer->frame = {};
+    renderer->frame.renderer = renderer;
+    renderer->frame.group = group;
+    renderer->frame.manager = manager;
+    renderer->frame.backbuffer = ImportTexture(renderer->graph, "Backbuffer", renderer->outputTarget);
+
+    bool dynamicResolution = renderer->dynamicResolution;
+    DEBUG_OVERLAY_TOGGLE(dynamicResolution);
+    renderer->dynamicResolution = dynamicResolution;
+    DEBUG_OVERLAY_SLIDER(renderer->gpuFrameBudgetMs, 4.0f, 50.0f);
+
+    i32 hdrFormat = (i32)renderer->hdrFormat;
+    DEBUG_OVERLAY_SLIDER(hdrFormat, 0, (i32)HDRFormat::RGBA16F);
+    renderer->hdrFormat = (HDRFormat)hdrFormat;
+    bool gpuDriven = renderer->gpuDriven;
+    DEBUG_OVERLAY_TOGGLE(gpuDriven);
+    renderer->gpuDriven = gpuDriven;
+    renderer->gpuDrivenFrame = renderer->gpuDriven && renderer->gpuDrivenSupported;
+    UpdateDynamicResolution(renderer);
+    DEBUG_OVERLAY_TRACE(renderer->gpuFrameTimeMs);
+    DEBUG_OVERLAY_TRACE(renderer->frameWaitMs);
+    DEBUG_OVERLAY_TRACE(renderer->resolutionScale);
+    glBeginQuery(GL_TIME_ELAPSED, renderer->gpuTimerQueries[renderer->gpuTimerQueryAt]);
+
     DEBUG_OVERLAY_SLIDER(renderer->shadowSlopeBiasScale, 0.0f, 2.5f);
     DEBUG_OVERLAY_SLIDER(renderer->shadowConstantBias, 0.0f, 0.5f);
 
@@ -1279,6 +3028,33 @@ void Begin(Renderer* renderer, RenderGroup* group) {
     DEBUG_OVERLAY_SLIDER(EnableStableShadows, 0, 1);
     renderer->stableShadows = EnableStableShadows;
 
+    bool cacheStaticShadows = renderer->cacheStaticShadows;
+    DEBUG_OVERLAY_TOGGLE(cacheStaticShadows);
+    if (renderer->cacheStaticShadows != (b32)cacheStaticShadows) {
+        renderer->cacheStaticShadows = cacheStaticShadows;
+        renderer->shadowStaticValidMask = 0;
+    }
+
+    i32 shadowCascadeCount = renderer->shadowCascadeCount;
+    DEBUG_OVERLAY_SLIDER(shadowCascadeCount, 1, (i32)Renderer::MaxShadowCascades);
+    if (shadowCascadeCount != (i32)renderer->shadowCascadeCount) {
+        ReloadShadowMaps(renderer, 0, shadowCascadeCount);
+    }
+    DEBUG_OVERLAY_SLIDER(renderer->shadowSplitLambda, 0.0f, 1.0f);
+    bool tightShadowDepthBounds = renderer->tightShadowDepthBounds;
+    DEBUG_OVERLAY_TOGGLE(tightShadowDepthBounds);
+    renderer->tightShadowDepthBounds = tightShadowDepthBounds;
+
+    i32 shadowFilter = (i32)renderer->shadowFilter;
+    DEBUG_OVERLAY_SLIDER(shadowFilter, 0, (i32)ShadowFilter::EVSM);
+    renderer->shadowFilter = (ShadowFilter)shadowFilter;
+    if (renderer->shadowFilter == ShadowFilter::EVSM) {
+        DEBUG_OVERLAY_SLIDER(renderer->evsmPositiveExponent, 0.0f, 5.54f);
+        DEBUG_OVERLAY_SLIDER(renderer->evsmNegativeExponent, 0.0f, 5.54f);
+        DEBUG_OVERLAY_SLIDER(renderer->evsmLightBleedingReduction, 0.0f, 0.99f);
+        DEBUG_OVERLAY_SLIDER(renderer->evsmBlurRadius, 0, EVSMBlurShader::MaxBlurRadius);
+    }
+
     //
     // NOTE: Calculating light-space matrices
     //
@@ -1286,43 +3062,99 @@ void Begin(Renderer* renderer, RenderGroup* group) {
     // TODO: Fix the mess with lookAt matrices4
     m4x4 lightLookAt = LookAtGLRH(light.from, Normalize(-light.dir), V3(0.0f, 1.0f, 0.0f));
 
-    f32 frustrumDepth = camera->farPlane - camera->nearPlane;
-    f32 cascadeDepth = frustrumDepth / Renderer::NumShadowCascades;
-    for (u32x cascadeIndex = 0; cascadeIndex < Renderer::NumShadowCascades; cascadeIndex++) {
-        f32 cascadeNear = cascadeDepth * cascadeIndex;
-        f32 cascadeFar = cascadeDepth * (cascadeIndex + 1);
-        renderer->shadowCascadeBounds[cascadeIndex] = camera->nearPlane + cascadeFar;
-        auto proj = CalcShadowProjection(camera, cascadeNear, cascadeFar, lightLookAt, renderer->shadowMapRes, renderer->stableShadows);
+    u32 cascadeCount = renderer->shadowCascadeCount;
+    f32 n = camera->nearPlane;
+    f32 f = camera->farPlane;
+    f32 lambda = renderer->shadowSplitLambda;
+    BBoxAligned cascadeBounds[Renderer::MaxShadowCascades];
+    f32 depthSteps[Renderer::MaxShadowCascades];
+    f32 cascadeNear = n;
+    for (u32x cascadeIndex = 0; cascadeIndex < cascadeCount; cascadeIndex++) {
+        f32 k = (f32)(cascadeIndex + 1) / (f32)cascadeCount;
+        f32 logSplit = n * Pow(f / n, k);
+        f32 uniformSplit = n + (f - n) * k;
+        f32 cascadeFar = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+        renderer->shadowCascadeBounds[cascadeIndex] = cascadeFar;
+        cascadeBounds[cascadeIndex] = CalcShadowProjectionBounds(camera, cascadeNear, cascadeFar, lightLookAt, renderer->shadowMapRes, renderer->stableShadows);
+        // NOTE: Bounding sphere size is constant for stable cascades, so is the step
+        depthSteps[cascadeIndex] = renderer->stableShadows ? (cascadeBounds[cascadeIndex].max.z - cascadeBounds[cascadeIndex].min.z) / 16.0f : 0.0f;
+        cascadeNear = cascadeFar;
+    }
+
+    if (renderer->tightShadowDepthBounds) {
+        FitShadowDepthBounds(group, manager, lightLookAt, cascadeBounds, cascadeCount, depthSteps);
+    }
+
+    for (u32x cascadeIndex = 0; cascadeIndex < cascadeCount; cascadeIndex++) {
+        auto bounds = cascadeBounds + cascadeIndex;
+        auto proj = OrthoGLRH(bounds->min.x, bounds->max.x, bounds->min.y, bounds->max.y, bounds->min.z, bounds->max.z);
         auto viewProj = proj * lightLookAt;
         renderer->shadowCascadeViewProjMatrices[cascadeIndex] = viewProj;
     }
 
+    //
+    // NOTE: Local lights
+    //
+
+    static_assert(RenderGroup::MaxLocalLights <= LightClusterGrid::MaxLights);
+    u32 lightCount = 0;
+    for (u32 i = 0; i < group->pointLightCount; i++) {
+        auto light = group->pointLights + i;
+        auto shaderLight = renderer->localLights + lightCount;
+        shaderLight->positionRadius = V4(light->position, light->radius);
+        shaderLight->colorSpotScale = V4(light->color, 0.0f);
+        shaderLight->spotDirectionOffset = V4(0.0f, 0.0f, 0.0f, 1.0f);
+        renderer->localLightBounds[lightCount] = shaderLight->positionRadius;
+        lightCount++;
+    }
+    for (u32 i = 0; i < group->spotLightCount; i++) {
+        auto light = group->spotLights + i;
+        // NOTE: Cone attenuation is saturate(cos * scale + offset) [ Lagarde, de Rousiers, Moving Frostbite to PBR ]
+        f32 cosOuter = Cos(ToRad(light->outerAngle));
+        f32 cosInner = Cos(ToRad(Min(light->innerAngle, light->outerAngle)));
+        f32 scale = 1.0f / Max(cosInner - cosOuter, 0.0001f);
+        f32 offset = -cosOuter * scale;
+        auto shaderLight = renderer->localLights + lightCount;
+        shaderLight->positionRadius = V4(light->position, light->radius);
+        shaderLight->colorSpotScale = V4(light->color, scale);
+        shaderLight->spotDirectionOffset = V4(Normalize(light->direction), offset);
+        renderer->localLightBounds[lightCount] = shaderLight->positionRadius;
+        lightCount++;
+    }
+    renderer->localLightCount = lightCount;
+    DEBUG_OVERLAY_TRACE(renderer->localLightCount);
+
+    if (lightCount) {
+        memcpy(GetFrameMemory(renderer, &renderer->localLightBuffer), renderer->localLights, sizeof(ShaderLocalLight) * lightCount);
+    }
+    BuildLightClusters(renderer->lightClusters, camera, renderer->localLightBounds, lightCount);
+
     //
     // NOTE: Fill frame uniform buffer
     //
 
     m4x4 viewProj = camera->projectionMatrix * camera->viewMatrix;
 
-    auto lightViewProj0 = renderer->shadowCascadeViewProjMatrices;
-    auto lightViewProj1 = renderer->shadowCascadeViewProjMatrices + 1;
-    auto lightViewProj2 = renderer->shadowCascadeViewProjMatrices + 2;
-
-    auto frameBuffer = Map(renderer->frameUniformBuffer);
+    auto frameBuffer = Map(&renderer->frameUniformBuffer);
     frameBuffer->viewProjMatrix = viewProj;
     frameBuffer->viewMatrix = camera->viewMatrix;
     frameBuffer->projectionMatrix = camera->projectionMatrix;
     frameBuffer->invViewMatrix = camera->invViewMatrix;
     frameBuffer->invProjMatrix = camera->invProjectionMatrix;
-    frameBuffer->lightSpaceMatrices[0] = *lightViewProj0;
-    frameBuffer->lightSpaceMatrices[1] = *lightViewProj1;
-    frameBuffer->lightSpaceMatrices[2] = *lightViewProj2;
+    for (u32x cascadeIndex = 0; cascadeIndex < cascadeCount; cascadeIndex++) {
+        frameBuffer->lightSpaceMatrices[cascadeIndex] = renderer->shadowCascadeViewProjMatrices[cascadeIndex];
+        frameBuffer->shadowCascadeSplits.data[cascadeIndex] = renderer->shadowCascadeBounds[cascadeIndex];
+    }
+    frameBuffer->shadowCascadeCount = (i32)cascadeCount;
+    frameBuffer->shadowFilterMode = (i32)renderer->shadowFilter;
+    frameBuffer->evsmExponents = V2(renderer->evsmPositiveExponent, renderer->evsmNegativeExponent);
+    frameBuffer->evsmLightBleedingReduction = renderer->evsmLightBleedingReduction;
     frameBuffer->dirLight.pos = light.from;
     frameBuffer->dirLight.dir = light.dir;
     frameBuffer->dirLight.ambient = light.ambient;
     frameBuffer->dirLight.diffuse = light.diffuse;
     frameBuffer->dirLight.specular = light.specular;
     frameBuffer->viewPos = camera->position;
-    frameBuffer->shadowCascadeSplits = *((v3*)&renderer->shadowCascadeBounds);
     frameBuffer->showShadowCascadeBoundaries = (i32)renderer->showShadowCascadesBoundaries;
     frameBuffer->shadowFilterSampleScale = renderer->shadowFilterScale;
     frameBuffer->debugF = renderer->debugF;
@@ -1332,60 +3164,157 @@ void Begin(Renderer* renderer, RenderGroup* group) {
     frameBuffer->constShadowBias = renderer->shadowConstantBias;
     frameBuffer->gamma = renderer->gamma;
     frameBuffer->exposure = renderer->exposure;
-    frameBuffer->screenSize = V2((f32)renderer->renderRes.x, (f32)renderer->renderRes.y);
+    frameBuffer->screenSize = V2((f32)renderer->viewportRes.x, (f32)renderer->viewportRes.y);
+    for (u32 i = 0; i < array_count(group->irradianceSH.coeffs); i++) {
+        frameBuffer->irradianceSH[i] = V4(group->irradianceSH.coeffs[i], 0.0f);
+    }
+    frameBuffer->clusterDepthScale = renderer->lightClusters->depthScale;
+    frameBuffer->clusterDepthBias = renderer->lightClusters->depthBias;
 
-    Unmap(renderer->frameUniformBuffer);
-}
+    Unmap(&renderer->frameUniformBuffer);
 
-void End(Renderer* renderer) {
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->offscreenBufferHandle);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, renderer->offscreenDownsampledBuffer);
-    glBlitFramebuffer(0, 0, renderer->renderRes.x, renderer->renderRes.y,
-                      0, 0, renderer->renderRes.x, renderer->renderRes.y,
-                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
-
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, renderer->srgbBufferHandle);
-    //glClearColor(renderer->clearColor.r, renderer->clearColor.g, renderer->clearColor.b, renderer->clearColor.a);
-    glClear(GL_COLOR_BUFFER_BIT);
+    if (renderer->gpuDrivenFrame) {
+        PrepareGPUDrivenFrame(renderer, group, manager);
+        DEBUG_OVERLAY_TRACE(renderer->gpuCullInstanceCount);
+        DEBUG_OVERLAY_TRACE(renderer->gpuDrawBatchCount);
+        DEBUG_OVERLAY_TRACE(renderer->gpuDrawCommandCount);
+        DEBUG_OVERLAY_TRACE(renderer->cpuDrawCount);
+    }
 
-    auto prog = renderer->shaders.PostFx;
-    glUseProgram(prog);
+    //
+    // NOTE: Occlusion culling. Occluders are rasterized on workers until the main pass needs the depth
+    //
+
+    bool occlusionCulling = renderer->occlusionCulling;
+    DEBUG_OVERLAY_TOGGLE(occlusionCulling);
+    renderer->occlusionCulling = occlusionCulling;
+    bool autoOccluders = renderer->autoOccluders;
+    DEBUG_OVERLAY_TOGGLE(autoOccluders);
+    renderer->autoOccluders = autoOccluders;
+
+    renderer->occlusionActive = renderer->occlusionCulling && !renderer->gpuDrivenFrame;
+    if (renderer->occlusionActive) {
+        auto occlusion = renderer->occlusionBuffer;
+        BeginOcclusionFrame(occlusion, &viewProj);
+        bool budgetLeft = true;
+        for (u32 i = 0; (i < group->commandQueueAt) && budgetLeft; i++) {
+            CommandQueueEntry* command = group->commandQueue + i;
+            if (command->type == RenderCommand::DrawMesh) {
+                auto* data = (RenderCommandDrawMesh*)command->data;
+                auto mesh = GetMesh(manager, data->meshID);
+                while (mesh && budgetLeft) {
+                    bool autoOccluder = renderer->autoOccluders && !data->dynamic && (mesh->indexCount / 3 <= Renderer::AutoOccluderMaxTriangles);
+                    if (data->occluder || autoOccluder) {
+                        budgetLeft = AddOccluder(occlusion, &data->transform, mesh);
+                    }
+                    mesh = mesh->next;
+                }
+            }
+        }
+        RasterizeOccluders(occlusion);
+        DEBUG_OVERLAY_TRACE(occlusion->occluderCount);
+    }
+}
 
-    glBindTextureUnit(PostFxShader::ColorSourceLinear, renderer->offscreenDownsampledColorTarget);
+// NOTE: MSAA resolve and tonemapping in a single dispatch straight from the multisampled target
+void ExecuteResolveTonemapPass(RenderGraph* graph, void* data) {
+    auto frame = (RenderFrame*)data;
+    auto renderer = frame->renderer;
+    uv2 res = renderer->viewportRes;
+    glUseProgram(renderer->shaders.ResolveTonemap);
+    glUniform1i(ResolveTonemapShader::SampleCountLocation, renderer->sampleCount);
+    glBindTextureUnit(ResolveTonemapShader::ColorSourceLinear, GetTextureHandle(graph, frame->hdrColor));
+    glBindImageTexture(ResolveTonemapShader::Result, GetTextureHandle(graph, frame->ldrColor), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glDispatchCompute((res.x + ResolveTonemapShader::GroupSize - 1) / ResolveTonemapShader::GroupSize, (res.y + ResolveTonemapShader::GroupSize - 1) / ResolveTonemapShader::GroupSize, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+}
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+// NOTE: Runs at output resolution and upscales the viewport bilinearly
+void ExecuteFinalPass(RenderGraph* graph, void* data) {
+    auto frame = (RenderFrame*)data;
+    auto renderer = frame->renderer;
+    uv2 res = renderer->viewportRes;
+    glViewport(0, 0, renderer->renderRes.x, renderer->renderRes.y);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GetFramebuffer(graph, frame->backbuffer, 0));
 
-    // NOTE: FXAA pass
-    static bool enableFXAA = true;
-    DEBUG_OVERLAY_TOGGLE(enableFXAA);
-    if (enableFXAA) {
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->srgbBufferHandle);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-        //glClearColor(renderer->clearColor.r, renderer->clearColor.g,  renderer->clearColor.b, renderer->clearColor.a);
+    if (frame->fxaa) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glUseProgram(renderer->shaders.FXAA);
-        glBindTextureUnit(FXAAShader::ColorSourcePerceptual, renderer->srgbColorTarget);
+        glUniform2f(FXAAShader::SourceScaleLocation, (f32)res.x / (f32)renderer->targetRes.x, (f32)res.y / (f32)renderer->targetRes.y);
+        glBindTextureUnit(FXAAShader::ColorSourcePerceptual, GetTextureHandle(graph, frame->ldrColor));
         glDrawArrays(GL_TRIANGLES, 0, 6);
     } else {
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->srgbBufferHandle);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-
-        glBlitFramebuffer(0, 0, renderer->renderRes.x, renderer->renderRes.y,
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, GetFramebuffer(graph, frame->ldrColor, 0));
+        glBlitFramebuffer(0, 0, res.x, res.y,
                           0, 0, renderer->renderRes.x, renderer->renderRes.y,
                           GL_COLOR_BUFFER_BIT, GL_LINEAR);
     }
+}
+
+void ExecuteShadowMapOverlayPass(RenderGraph* graph, void* data) {
+    auto frame = (RenderFrame*)data;
+    auto renderer = frame->renderer;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, GetFramebuffer(graph, frame->shadowDebugColor, 0, frame->shadowMapOverlayLayer));
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GetFramebuffer(graph, frame->backbuffer, 0));
+    glBlitFramebuffer(0, 0, renderer->shadowMapRes, renderer->shadowMapRes,
+                      0, 0, 512, 512, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+}
+
+void End(Renderer* renderer) {
+    DEBUG_OVERLAY_TRACE(renderer->occlusionCulledCount);
+    DEBUG_OVERLAY_TRACE(renderer->meshUniformBuffer.overflowCount);
+
+    auto graph = renderer->graph;
+    auto frame = &renderer->frame;
+
+    // NOTE: Resolved and tonemapped image with luma in alpha. Written by ResolveTonemap compute, read by FXAA
+    RenderTextureDesc ldrDesc = {};
+    ldrDesc.type = RenderTextureType::Texture2D;
+    ldrDesc.format = GL_RGBA8;
+    ldrDesc.width = renderer->targetRes.x;
+    ldrDesc.height = renderer->targetRes.y;
+    frame->ldrColor = CreateTransientTexture(graph, "LDRColor", ldrDesc);
+
+    u32 pass = AddRenderPass(graph, "ResolveTonemap", ExecuteResolveTonemapPass, frame);
+    ReadTexture(graph, pass, frame->hdrColor);
+    WriteTexture(graph, pass, frame->ldrColor);
+
+    static bool enableFXAA = true;
+    DEBUG_OVERLAY_TOGGLE(enableFXAA);
+    frame->fxaa = enableFXAA;
+    pass = AddRenderPass(graph, "Final", ExecuteFinalPass, frame);
+    ReadTexture(graph, pass, frame->ldrColor);
+    WriteTexture(graph, pass, frame->backbuffer);
 
     static i32 showShadowMap = false;
     DEBUG_OVERLAY_SLIDER(showShadowMap, 0, 1);
-
-    if (showShadowMap) {
+    if (showShadowMap && renderer->shadowMapDebugColor) {
         static i32 shadowCascadeLevel = 0;
-        DEBUG_OVERLAY_SLIDER(shadowCascadeLevel, 0, Renderer::NumShadowCascades - 1);
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->shadowMapFramebuffers[shadowCascadeLevel]);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        DEBUG_OVERLAY_SLIDER(shadowCascadeLevel, 0, (i32)renderer->shadowCascadeCount - 1);
+        shadowCascadeLevel = Min(shadowCascadeLevel, (i32)renderer->shadowCascadeCount - 1);
+        frame->shadowMapOverlayLayer = shadowCascadeLevel;
+        pass = AddRenderPass(graph, "ShadowMapOverlay", ExecuteShadowMapOverlayPass, frame);
+        ReadTexture(graph, pass, frame->shadowDebugColor);
+        WriteTexture(graph, pass, frame->backbuffer);
+    }
 
-        glBlitFramebuffer(0, 0, renderer->shadowMapRes, renderer->shadowMapRes,
-                          0, 0, 512, 512, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    ExecuteRenderGraph(graph);
+    DEBUG_OVERLAY_TRACE(graph->culledPassCount);
+    DEBUG_OVERLAY_TRACE(graph->transientTextureCount);
+    DEBUG_OVERLAY_TRACE(graph->aliasedTextureCount);
+
+    // NOTE: Static debug color is reallocated once the graph is done with it, so the overlay is shown starting from the next frame
+    if ((bool)showShadowMap != (bool)renderer->shadowMapDebugColor) {
+        renderer->shadowMapDebugColor = showShadowMap;
+        ReloadShadowMaps(renderer);
     }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    renderer->gpuTimerQueryAt = (renderer->gpuTimerQueryAt + 1) % Renderer::GPUTimerQueryCount;
+    renderer->gpuTimerQueriesIssued++;
+
+    AdvanceFrame(renderer);
+    UpdateStagingRing(renderer);
+    UpdateProgramCache(renderer);
 }
@@ -5,26 +5,37 @@ struct CubeTexture;
 struct Texture;
 struct AssetManager;
 
-struct TexTransferBufferInfo {
-    u32 index;
+// NOTE: A piece of the staging ring. ptr is null if allocation failed
+struct StagingRegion {
     void* ptr;
+    u32 offset;
+    u32 size;
+    u32 index;
     Renderer* renderer;
 };
 
 Renderer* InitializeRenderer(uv2 renderRes, u32 sampleCount);
 
-void GenIrradanceMap(const Renderer* renderer, CubeTexture* t, GLuint sourceHandle);
-void GenEnvPrefiliteredMap(const Renderer* renderer, CubeTexture* t, GLuint sourceHandle, u32 mipLevels);
+void GenEnvPrefiliteredMap(Renderer* renderer, CubeTexture* t, GLuint sourceHandle, u32 mipLevels);
+
+// NOTE: Disk cache for the data generated on GPU. Key should cover everything the data was generated from.
+// Texture description (format, size, filtering) should be filled before loading
+bool LoadFromCache(CubeTexture* texture, const wchar_t* filename, u64 key, u32 levelCount);
+void SaveToCache(CubeTexture* texture, const wchar_t* filename, u64 key, u32 levelCount);
+u64 HashShaderSource(const char* shaderName, u64 hash);
 
 // TODO: Temporary hack while struct is defined in cpp file
 uv2 GetRenderResolution(Renderer* renderer);
 u32 GetRenderSampleCount(Renderer* renderer);
 u32 GetRenderMaxSampleCount(Renderer* renderer);
 void ChangeRenderResolution(Renderer* renderer, uv2 newRes, u32 newSampleCount);
+// NOTE: Following frames are drawn to the texture instead of the default framebuffer, zero restores it. The texture must be
+// of the render resolution. Dynamic resolution is suspended while it is set
+void SetOutputTarget(Renderer* renderer, GLuint texture);
 
 struct RenderGroup;
 
-void Begin(Renderer* renderer, RenderGroup* group);
+void Begin(Renderer* renderer, RenderGroup* group, AssetManager* manager);
 void ShadowPass(Renderer* renderer, RenderGroup* group, AssetManager* manager);
 void MainPass(Renderer* renderer, RenderGroup* group, AssetManager* manager);
 void End(Renderer* renderer);
@@ -35,9 +46,16 @@ void UploadToGPU(Texture* texture);
 
 void FreeGPUBuffer(u32 id);
 void FreeGPUTexture(u32 id);
+// NOTE: Returns the pool ranges of the one-based slot of an unloaded mesh
+void FreeGPUDrawSlot(Renderer* renderer, u32 slot);
+
+// NOTE: These are thread safe and are called by asset loading workers
+StagingRegion AllocateStagingRegion(Renderer* renderer, u32 size);
+StagingRegion StageMesh(Renderer* renderer, Mesh* mesh);
 
-TexTransferBufferInfo GetTextureTransferBuffer(Renderer* renderer, u32 size);
-void CompleteTextureTransfer(TexTransferBufferInfo* info, Texture* texture);
+// NOTE: Main thread only. Records copies from the staging ring and releases the region
+void CompleteMeshTransfer(StagingRegion* region, Mesh* mesh);
+void CompleteTextureTransfer(StagingRegion* region, Texture* texture);
 
 
 void RecompileShaders(Renderer* renderer);
@@ -0,0 +1,159 @@
+#include "flux_renderer_benchmark.h"
+#include "NullOpenGL.h"
+
+bool RequestRendererBenchmark(Context* context, u32 frameCount, bool quitWhenDone) {
+    auto manager = &context->assetManager;
+    u32 meshID = GetID(&manager->nameTable, "../res/meshes/sphere.aab");
+    if (!meshID) {
+        meshID = AddMesh(manager, "../res/meshes/sphere.aab", MeshFileFormat::AAB).id;
+    }
+    if (meshID) {
+        context->benchmarkRequest.frameCount = frameCount;
+        context->benchmarkRequest.meshID = meshID;
+        context->benchmarkRequest.quitWhenDone = quitWhenDone;
+    }
+    return meshID != 0;
+}
+
+RendererBenchmark* CreateRendererBenchmark() {
+    auto benchmark = (RendererBenchmark*)PlatformAlloc(sizeof(RendererBenchmark), 0, nullptr);
+    *benchmark = {};
+    // NOTE: Queue grows to the largest draw count on the first run and is kept
+    benchmark->group = RenderGroup::Make(1024);
+    return benchmark;
+}
+
+void PushBenchmarkDraws(RendererBenchmark* benchmark, u32 meshID, u32 drawCount) {
+    auto group = &benchmark->group;
+
+    DirectionalLight light = {};
+    light.dir = Normalize(V3(0.3f, -1.0f, -0.95f));
+    light.from = V3(4.0f, 200.0f, 0.0f);
+    light.ambient = V3(0.3f);
+    light.diffuse = V3(5.8f);
+    light.specular = V3(1.0f);
+    RenderCommandSetDirLight lightCommand = { light };
+    Push(group, &lightCommand);
+
+    u32 gridSize = 1;
+    while (gridSize * gridSize < drawCount) gridSize++;
+    f32 gridOffset = (f32)(gridSize - 1) * RendererBenchmark::GridSpacing * 0.5f;
+
+    for (u32 i = 0; i < drawCount; i++) {
+        f32 x = (f32)(i % gridSize) * RendererBenchmark::GridSpacing - gridOffset;
+        f32 z = (f32)(i / gridSize) * RendererBenchmark::GridSpacing - gridOffset;
+        RenderCommandDrawMesh command = {};
+        command.transform = Translate(V3(x, 0.0f, z));
+        command.meshID = meshID;
+        command.material.workflow = Material::PBRMetallic;
+        command.material.pbrMetallic.albedoValue = V3((f32)(i % 7) / 6.0f, 0.5f, (f32)(i % 3) / 2.0f);
+        command.material.pbrMetallic.roughnessValue = (f32)(i % 5) / 4.0f;
+        command.material.pbrMetallic.metallicValue = (f32)(i % 2);
+        command.dynamic = (i % RendererBenchmark::DynamicDrawInterval) == 0;
+        Push(group, &command);
+    }
+}
+
+bool RunRendererBenchmark(RendererBenchmark* benchmark, Renderer* renderer, AssetManager* manager, RendererBenchmarkRequest* request) {
+    if (!GetMesh(manager, request->meshID)) {
+        printf("[Benchmark] Benchmark mesh failed to load\n");
+        return false;
+    }
+
+    u32 frameCount = request->frameCount ? request->frameCount : RendererBenchmark::DefaultFrameCount;
+    auto nullStats = GlobalPlatform.gl->nullStats;
+    auto group = &benchmark->group;
+    auto camera = &benchmark->camera;
+
+    printf("[Benchmark] Running renderer benchmark: %u frames per run%s\n", frameCount, nullStats ? ", null GL backend" : "");
+
+    // NOTE: Per frame values. GL counters are empty without the null backend
+    char report[RendererBenchmark::MaxReportSize];
+    i32 reportSize = snprintf(report, array_count(report), "draws,frames,null_gl,render_ms,render_ns_per_draw,push_ms,gl_calls,draw_calls,draws_issued,dispatches,uploaded_kb\n");
+
+    for (u32 run = 0; run < array_count(RendererBenchmark::DrawCounts); run++) {
+        u32 drawCount = RendererBenchmark::DrawCounts[run];
+
+        // NOTE: Camera looks at the grid center from above, so the frustum covers a part of the grid and culling has work to do
+        uv2 viewport = GetRenderResolution(renderer);
+        *camera = {};
+        camera->aspectRatio = (f32)viewport.x / (f32)Max(viewport.y, 1u);
+        camera->position = V3(0.0f, 30.0f, 60.0f);
+        camera->front = Normalize(camera->position);
+        camera->viewMatrix = LookAtGLRH(camera->position, camera->front, V3(0.0f, 1.0f, 0.0f));
+        camera->projectionMatrix = PerspectiveGLRH(camera->nearPlane, camera->farPlane, camera->fovDeg, camera->aspectRatio);
+        camera->invViewMatrix = Inverse(camera->viewMatrix);
+        camera->invProjectionMatrix = Inverse(camera->projectionMatrix);
+
+        group->camera = camera;
+        group->irradianceSH = {};
+        group->drawSkybox = false;
+
+        u64 pushTicks = 0;
+        u64 renderTicks = 0;
+        NullOpenGLStats statsBegin = {};
+        for (u32 frame = 0; frame < RendererBenchmark::WarmupFrames + frameCount; frame++) {
+            if (frame == RendererBenchmark::WarmupFrames) {
+                pushTicks = 0;
+                renderTicks = 0;
+                if (nullStats) statsBegin = *nullStats;
+            }
+
+            u64 pushBegin = GetTimeStamp();
+            PushBenchmarkDraws(benchmark, request->meshID, drawCount);
+            u64 renderBegin = GetTimeStamp();
+
+            BeginDebugOverlayRecorder(&benchmark->overlay);
+            Begin(renderer, group, manager);
+            ShadowPass(renderer, group, manager);
+            MainPass(renderer, group, manager);
+            End(renderer);
+            EndDebugOverlayRecorder(&benchmark->overlay);
+
+            u64 renderEnd = GetTimeStamp();
+            pushTicks += renderBegin - pushBegin;
+            renderTicks += renderEnd - renderBegin;
+        }
+
+        f64 ticksToMs = 1000.0 / (f64)GetTicksPerSecond();
+        f64 pushMs = (f64)pushTicks * ticksToMs / (f64)frameCount;
+        f64 renderMs = (f64)renderTicks * ticksToMs / (f64)frameCount;
+        printf("[Benchmark] %6u draws: render %8.3f ms/frame (%7.1f ns/draw), push %7.3f ms/frame\n", drawCount, renderMs, renderMs * 1000000.0 / (f64)drawCount, pushMs);
+        reportSize += snprintf(report + reportSize, array_count(report) - reportSize, "%u,%u,%d,%.4f,%.2f,%.4f", drawCount, frameCount, nullStats ? 1 : 0, renderMs, renderMs * 1000000.0 / (f64)drawCount, pushMs);
+
+        if (nullStats) {
+            auto stats = nullStats;
+            f64 frames = (f64)frameCount;
+            printf("[Benchmark]     per frame: %.0f GL calls, %.0f draw calls (%.0f draws), %.0f dispatches, %.1f KB uploaded\n",
+                   (f64)(stats->callCount - statsBegin.callCount) / frames,
+                   (f64)(stats->drawCallCount - statsBegin.drawCallCount) / frames,
+                   (f64)(stats->drawCount - statsBegin.drawCount) / frames,
+                   (f64)(stats->dispatchCount - statsBegin.dispatchCount) / frames,
+                   (f64)(stats->bytesUploaded - statsBegin.bytesUploaded) / frames / 1024.0);
+            printf("[Benchmark]     binds per frame: %.0f program, %.0f framebuffer, %.0f texture, %.0f buffer, %.0f sampler, %.0f vertex array; %.0f enable/disable, %.0f uniform\n",
+                   (f64)(stats->programBinds - statsBegin.programBinds) / frames,
+                   (f64)(stats->framebufferBinds - statsBegin.framebufferBinds) / frames,
+                   (f64)(stats->textureBinds - statsBegin.textureBinds) / frames,
+                   (f64)(stats->bufferBinds - statsBegin.bufferBinds) / frames,
+                   (f64)(stats->samplerBinds - statsBegin.samplerBinds) / frames,
+                   (f64)(stats->vertexArrayBinds - statsBegin.vertexArrayBinds) / frames,
+                   (f64)(stats->capabilityChanges - statsBegin.capabilityChanges) / frames,
+                   (f64)(stats->uniformUpdates - statsBegin.uniformUpdates) / frames);
+            reportSize += snprintf(report + reportSize, array_count(report) - reportSize, ",%.0f,%.0f,%.0f,%.0f,%.1f\n",
+                                   (f64)(stats->callCount - statsBegin.callCount) / frames,
+                                   (f64)(stats->drawCallCount - statsBegin.drawCallCount) / frames,
+                                   (f64)(stats->drawCount - statsBegin.drawCount) / frames,
+                                   (f64)(stats->dispatchCount - statsBegin.dispatchCount) / frames,
+                                   (f64)(stats->bytesUploaded - statsBegin.bytesUploaded) / frames / 1024.0);
+        } else {
+            reportSize += snprintf(report + reportSize, array_count(report) - reportSize, ",,,,,\n");
+        }
+    }
+
+    const wchar_t* reportFile = L"renderer_benchmark.csv";
+    bool written = PlatformDebugWriteFile(reportFile, report, (u32)reportSize);
+    if (!written) {
+        printf("[Benchmark] Failed to write %ls\n", reportFile);
+    }
+    return written;
+}
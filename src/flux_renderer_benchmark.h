@@ -0,0 +1,43 @@
+#pragma once
+#include "flux_camera.h"
+#include "flux_render_group.h"
+#include "flux_debug_overlay.h"
+
+struct Renderer;
+struct AssetManager;
+struct Context;
+
+// NOTE: Requested by the benchmark_renderer console command or -benchmark_renderer option and carried to the render
+// thread by the frame packet. Mesh is resolved by the requester, since adding assets waits for the render thread
+struct RendererBenchmarkRequest {
+    u32 frameCount;
+    u32 meshID;
+    // NOTE: Automated run. The process exits when the benchmark is done, with nonzero code if it failed
+    b32 quitWhenDone;
+};
+
+// NOTE: CPU side renderer benchmark. Draws frames of synthetic render groups through the whole Begin/ShadowPass/MainPass/End
+// path and reports the time spent on the render thread per frame and per draw. On the null GL backend (-nullgl) the GL calls,
+// draws and state changes per frame are reported too, and frame times show the renderer alone without the driver.
+// Results are printed and written to renderer_benchmark.csv
+struct RendererBenchmark {
+    static constexpr u32 DrawCounts[] = { 1000, 10000, 100000 };
+    static constexpr u32 WarmupFrames = 4;
+    static constexpr u32 DefaultFrameCount = 32;
+    // NOTE: Every n-th draw is dynamic, the rest go to the cached static shadow layers
+    static constexpr u32 DynamicDrawInterval = 4;
+    static constexpr f32 GridSpacing = 2.5f;
+    static constexpr u32 MaxReportSize = 4096;
+
+    RenderGroup group;
+    CameraBase camera;
+    // NOTE: Overlay items pushed by the renderer are recorded here and dropped
+    DebugOverlayRecorder overlay;
+};
+
+// NOTE: Update thread. Loads the benchmark mesh and queues the request for the next frame
+bool RequestRendererBenchmark(Context* context, u32 frameCount, bool quitWhenDone);
+
+RendererBenchmark* CreateRendererBenchmark();
+// NOTE: Must be called on the render thread between frames. Returns false if the benchmark did not run
+bool RunRendererBenchmark(RendererBenchmark* benchmark, Renderer* renderer, AssetManager* manager, RendererBenchmarkRequest* request);
@@ -135,6 +135,7 @@ Mesh* ReadMeshFileFlux(void* file, u32 fileSize) {
 
         loaded->gpuVertexBufferHandle = 0;
         loaded->gpuIndexBufferHandle = 0;
+        loaded->gpuDrawSlot = 0;
     }
 
     return (Mesh*)memory;
@@ -402,7 +403,7 @@ CubeTexture LoadCubemap(const char* backPath, const char* downPath, const char*
     CubeTexture texture = {};
 
     // TODO: Use memory arena
-    // TODO: Free memory
+    // NOTE: Images are owned by the texture until FreeCubemap is called
     auto back = ResourceLoaderLoadImage(backPath, range, false, 0, PlatformAlloc, GlobalLogger, GlobalLoggerData);
     //defer { PlatformFree(back->base); };
     auto down = ResourceLoaderLoadImage(downPath, range, false, 0, PlatformAlloc, GlobalLogger, GlobalLoggerData);
@@ -438,9 +439,37 @@ CubeTexture LoadCubemap(const char* backPath, const char* downPath, const char*
     texture.rightData = right->bits;
     texture.upData = up->bits;
 
+    LoadedImage* images[] = { right, left, up, down, front, back };
+    for (u32 i = 0; i < array_count(images); i++) {
+        texture.base[i] = images[i];
+    }
+
     return texture;
 }
 
+void FreeCubemap(CubeTexture* texture) {
+    for (u32 i = 0; i < array_count(texture->base); i++) {
+        if (texture->base[i]) {
+            PlatformFree(texture->base[i], nullptr);
+        }
+        texture->base[i] = nullptr;
+        texture->data[i] = nullptr;
+    }
+}
+
+u64 HashFile(const char* filename, u64 hash) {
+    wchar_t filenameW[MaxAssetPathSize];
+    mbstowcs(filenameW, filename, array_count(filenameW));
+    auto fileSize = PlatformDebugGetFileSize(filenameW);
+    if (fileSize) {
+        void* file = PlatformAlloc(fileSize, 0, nullptr);
+        defer { PlatformFree(file, nullptr); };
+        u32 bytesRead = PlatformDebugReadFile(file, fileSize, filenameW);
+        hash = Hash64(file, bytesRead, hash);
+    }
+    return hash;
+}
+
 CubeTexture MakeEmptyCubemap(u32 w, u32 h, TextureFormat format, TextureFilter filter, TextureWrapMode wrapMode, bool useMips) {
     CubeTexture texture = {};
     texture.useMips = useMips;
@@ -452,6 +481,21 @@ CubeTexture MakeEmptyCubemap(u32 w, u32 h, TextureFormat format, TextureFilter f
     return texture;
 }
 
+void LockAssets(AssetManager* manager) {
+    while (AtomicCompareExchange(&manager->lock, 0, 1) != 0) {}
+}
+
+void UnlockAssets(AssetManager* manager) {
+    AtomicExchange(&manager->lock, 0);
+}
+
+void PushPendingGPUFree(AssetManager* manager, PendingGPUFree::Type type, u32 handle) {
+    LockAssets(manager);
+    assert(manager->pendingGPUFreeCount < array_count(manager->pendingGPUFrees));
+    manager->pendingGPUFrees[manager->pendingGPUFreeCount++] = { type, handle };
+    UnlockAssets(manager);
+}
+
 AssetQueueEntry* AssetQueuePush(AssetManager* manager) {
     AssetQueueEntry* ptr = nullptr;
     if (manager->assetQueueUsage < array_count(manager->assetQueue)) {
@@ -486,6 +530,7 @@ AssetQueueEntry* AssetQueueGet(AssetManager* manager, u32 index) {
 
 void LoadMeshWork(void* data0, void* data1, void* data2, u32 threadIndex) {
     auto queueEntry = (AssetQueueEntry*)data0;
+    auto renderer = (Renderer*)data1;
     assert(queueEntry->used);
     assert(queueEntry->type == AssetType::Mesh);
     auto slot = (MeshSlot*)(&queueEntry->meshSlot);
@@ -503,6 +548,7 @@ void LoadMeshWork(void* data0, void* data1, void* data2, u32 threadIndex) {
     }
     if (mesh) {
         slot->mesh = mesh;
+        queueEntry->stagingRegion = StageMesh(renderer, mesh);
         auto prevState = AtomicExchange((u32 volatile*)&slot->state, (u32)AssetState::JustLoaded);
         assert(prevState == (u32)AssetState::Queued);
     } else {
@@ -514,6 +560,7 @@ void LoadMeshWork(void* data0, void* data1, void* data2, u32 threadIndex) {
 
 void LoadTextureWork(void* data0, void* data1, void* data2, u32 threadIndex) {
     auto queueEntry = (AssetQueueEntry*)data0;
+    auto renderer = (Renderer*)data1;
     assert(queueEntry->used);
     assert(queueEntry->type == AssetType::Texture);
     auto slot = (TextureSlot*)(&queueEntry->textureSlot);
@@ -524,10 +571,10 @@ void LoadTextureWork(void* data0, void* data1, void* data2, u32 threadIndex) {
         if (bitmapSize == slot->bitmapSize) {
             slot->texture = tex;
             // TODO: Load directly to buffer
-            for (uptr i = 0; i < bitmapSize; i++) {
-                ((byte*)queueEntry->texTransferBufferInfo.ptr)[i] = ((byte*)tex.data)[i];
+            queueEntry->stagingRegion = AllocateStagingRegion(renderer, bitmapSize);
+            if (queueEntry->stagingRegion.ptr) {
+                memcpy(queueEntry->stagingRegion.ptr, tex.data, bitmapSize);
             }
-            //memcpy(queueEntry->texTransferBufferInfo.ptr, tex.data, bitmapSize);
             auto prevState = AtomicExchange((u32 volatile*)&slot->state, (u32)AssetState::JustLoaded);
             assert(prevState == (u32)AssetState::Queued);
         } else {
@@ -577,6 +624,8 @@ void GetAssetName(const char* filename, AssetName* name) {
 }
 
 AddAssetResult AddMesh(AssetManager* manager, const char* filename, MeshFileFormat format) {
+    // NOTE: Tables may grow
+    PlatformWaitForRender();
     AddAssetResult result = {};
     OpenMeshResult fileStatus = {};
     switch (format) {
@@ -599,6 +648,7 @@ AddAssetResult AddMesh(AssetManager* manager, const char* filename, MeshFileForm
             strcpy_s(slot->name, array_count(slot->name), name.name);
             strcpy_s(slot->filename, array_count(slot->filename), filename);
             slot->format = format;
+            manager->generation++;
             result = { AddAssetResult::Ok, id };
         } else {
             printf("[Asset manager] Failed to load asset %s. An asset with the same name is already loaded.\n", filename);
@@ -612,6 +662,8 @@ AddAssetResult AddMesh(AssetManager* manager, const char* filename, MeshFileForm
 
 AddAssetResult AddTexture(AssetManager* manager, const char* filename, TextureFormat format, TextureWrapMode wrapMode, TextureFilter filter, DynamicRange range) {
     // TODO: Validate file
+    // NOTE: Tables may grow
+    PlatformWaitForRender();
     AddAssetResult result = {};
     auto info = ResourceLoaderValidateImageFile(filename, GlobalLogger, GlobalLoggerData);
     if (info.valid) {
@@ -638,6 +690,7 @@ AddAssetResult AddTexture(AssetManager* manager, const char* filename, TextureFo
                     slot->bitmapSize = info.width * info.height * PixelSize(slot->format);
                     strcpy_s(slot->name, array_count(slot->name), name.name);
                     strcpy_s(slot->filename, array_count(slot->filename), filename);
+                    manager->generation++;
                     result = { AddAssetResult::Ok, id };
                 } else {
                     printf("[Asset manager] Failed to load tuexture %s. An asset with the same name is already loaded.\n", filename);
@@ -664,26 +717,34 @@ void LoadMesh(AssetManager* manager, u32 id) {
         if (queueEntry) {
             queueEntry->id = id;
             queueEntry->type = AssetType::Mesh;
+            queueEntry->stagingRegion = {};
             auto slotPtr = (MeshSlot*)queueEntry->meshSlot;
             *slotPtr = *slot;
 
             // TODO: Spin-locking here for now. We should handle the case when platform queue is full propperly
-            while (!PlatformPushWork(GlobalLowPriorityWorkQueue, LoadMeshWork, queueEntry, nullptr, nullptr)) {}
+            while (!PlatformPushWork(GlobalLowPriorityWorkQueue, LoadMeshWork, queueEntry, manager->renderer, nullptr)) {}
         }
     }
 }
 
 void UnloadMesh(AssetManager* manager, MeshSlot* slot) {
     if (slot->state == AssetState::Loaded) {
-        FreeGPUBuffer(slot->mesh->gpuVertexBufferHandle);
-        FreeGPUBuffer(slot->mesh->gpuIndexBufferHandle);
+        for (auto mesh = slot->mesh; mesh; mesh = mesh->next) {
+            PushPendingGPUFree(manager, PendingGPUFree::Type::Buffer, mesh->gpuVertexBufferHandle);
+            PushPendingGPUFree(manager, PendingGPUFree::Type::Buffer, mesh->gpuIndexBufferHandle);
+            if (mesh->gpuDrawSlot) {
+                PushPendingGPUFree(manager, PendingGPUFree::Type::DrawSlot, mesh->gpuDrawSlot);
+            }
+        }
         PlatformFree(slot->mesh->base, nullptr);
         slot->mesh = nullptr;
         slot->state = AssetState::Unloaded;
+        manager->generation++;
     }
 }
 
 void UnloadMesh(AssetManager* manager, u32 id) {
+    PlatformWaitForRender();
     auto slot = GetMeshSlot(manager, id);
     if (slot) {
         UnloadMesh(manager, slot);
@@ -691,6 +752,7 @@ void UnloadMesh(AssetManager* manager, u32 id) {
 }
 
 void RemoveMesh(AssetManager* manager, u32 id) {
+    PlatformWaitForRender();
     auto slot = GetMeshSlot(manager, id);
     if (slot && (slot->state == AssetState::Loaded || slot->state == AssetState::Unloaded)) {
         UnloadMesh(manager, slot);
@@ -701,14 +763,16 @@ void RemoveMesh(AssetManager* manager, u32 id) {
 
 void UnloadTexture(AssetManager* manager, TextureSlot* slot) {
     if (slot->state == AssetState::Loaded) {
-        FreeGPUTexture(slot->texture.gpuHandle);
+        PushPendingGPUFree(manager, PendingGPUFree::Type::Texture, slot->texture.gpuHandle);
         PlatformFree(slot->texture.base, nullptr);
         slot->texture = {};
         slot->state = AssetState::Unloaded;
+        manager->generation++;
     }
 }
 
 void UnloadTexture(AssetManager* manager, u32 id) {
+    PlatformWaitForRender();
     auto slot = GetTextureSlot(manager, id);
     if (slot) {
         UnloadTexture(manager, slot);
@@ -716,6 +780,7 @@ void UnloadTexture(AssetManager* manager, u32 id) {
 }
 
 void RemoveTexture(AssetManager* manager, u32 id) {
+    PlatformWaitForRender();
     auto slot = GetTextureSlot(manager, id);
     if (slot && (slot->state == AssetState::Loaded || slot->state == AssetState::Unloaded)) {
         UnloadTexture(manager, slot);
@@ -727,22 +792,17 @@ void RemoveTexture(AssetManager* manager, u32 id) {
 void LoadTexture(AssetManager* manager, u32 id) {
     auto slot = Get(&manager->textureTable, &id);
     if (slot) {
-        auto transferBuffer = GetTextureTransferBuffer(manager->renderer, slot->bitmapSize);
-        if (transferBuffer.ptr) {
-            auto queueEntry = AssetQueuePush(manager);
-            if (queueEntry) {
-                queueEntry->id = id;
-                queueEntry->type = AssetType::Texture;
-                queueEntry->texTransferBufferInfo = transferBuffer;
-                slot->state = AssetState::Queued;
-                auto slotPtr = (TextureSlot*)queueEntry->textureSlot;
-                *slotPtr = *slot;
-
-                // TODO: Spin-locking here for now. We should handle the case when platform queue is full propperly
-                while (!PlatformPushWork(GlobalLowPriorityWorkQueue, LoadTextureWork, queueEntry, nullptr, nullptr )) {}
-            }
-        } else {
-            printf("[Asset manager] Failed to load the texture %s. Unable to get transfer buffer\n", slot->name);
+        auto queueEntry = AssetQueuePush(manager);
+        if (queueEntry) {
+            queueEntry->id = id;
+            queueEntry->type = AssetType::Texture;
+            queueEntry->stagingRegion = {};
+            slot->state = AssetState::Queued;
+            auto slotPtr = (TextureSlot*)queueEntry->textureSlot;
+            *slotPtr = *slot;
+
+            // TODO: Spin-locking here for now. We should handle the case when platform queue is full propperly
+            while (!PlatformPushWork(GlobalLowPriorityWorkQueue, LoadTextureWork, queueEntry, manager->renderer, nullptr )) {}
         }
     }
 }
@@ -760,10 +820,11 @@ void CompleteAssetLoad(AssetManager* manager, AssetType type, u32 queueIndex, u3
             *slot = *queueSlot;
             AssetQueueRemove(manager, queueIndex);
             auto begin = GetTimeStamp();
-            UploadToGPU(slot->mesh);
+            CompleteMeshTransfer(&queueEntry->stagingRegion, slot->mesh);
             auto end = GetTimeStamp();
             printf("[Asset manager] Loaded mesh on gpu: %f ms\n", (end - begin) * 1000.0f);
             slot->state = AssetState::Loaded;
+            manager->generation++;
         } else if (queueSlot->state == AssetState::Error) {
             auto slot = Get(&manager->meshTable, &id);
             assert(slot);
@@ -784,10 +845,11 @@ void CompleteAssetLoad(AssetManager* manager, AssetType type, u32 queueIndex, u3
             *slot = *queueSlot;
             AssetQueueRemove(manager, queueIndex);
             auto begin = GetTimeStamp();
-            CompleteTextureTransfer(&queueEntry->texTransferBufferInfo, &slot->texture);
+            CompleteTextureTransfer(&queueEntry->stagingRegion, &slot->texture);
             auto end = GetTimeStamp();
             printf("[Asset manager] Loaded material on gpu: %f ms\n", (end - begin) * 1000.0f);
             slot->state = AssetState::Loaded;
+            manager->generation++;
         } else if (queueSlot->state == AssetState::Error) {
             auto slot = Get(&manager->textureTable, &id);
             assert(slot);
@@ -802,12 +864,46 @@ void CompleteAssetLoad(AssetManager* manager, AssetType type, u32 queueIndex, u3
 }
 
 void CompletePendingLoads(AssetManager* manager) {
+    LockAssets(manager);
+    for (u32 i = 0; i < manager->pendingGPUFreeCount; i++) {
+        auto pending = manager->pendingGPUFrees + i;
+        switch (pending->type) {
+        case PendingGPUFree::Type::Buffer: { FreeGPUBuffer(pending->handle); } break;
+        case PendingGPUFree::Type::Texture: { FreeGPUTexture(pending->handle); } break;
+        case PendingGPUFree::Type::DrawSlot: { FreeGPUDrawSlot(manager->renderer, pending->handle); } break;
+            invalid_default();
+        }
+    }
+    manager->pendingGPUFreeCount = 0;
+
     for (u32 i = 0; i < array_count(manager->assetQueue); i++) {
         auto entry = manager->assetQueue + i;
         if (entry->used) {
             CompleteAssetLoad(manager, entry->type, i, entry->id);
         }
     }
+    UnlockAssets(manager);
+}
+
+bool HasPendingLoads(AssetManager* manager) {
+    bool result = false;
+    LockAssets(manager);
+    for (MeshSlot& slot : manager->meshTable) {
+        if (slot.state == AssetState::Queued || slot.state == AssetState::JustLoaded) {
+            result = true;
+            break;
+        }
+    }
+    if (!result) {
+        for (TextureSlot& slot : manager->textureTable) {
+            if (slot.state == AssetState::Queued || slot.state == AssetState::JustLoaded) {
+                result = true;
+                break;
+            }
+        }
+    }
+    UnlockAssets(manager);
+    return result;
 }
 
 MeshSlot* GetMeshSlot(AssetManager* manager, u32 id) {
@@ -821,6 +917,7 @@ TextureSlot* GetTextureSlot(AssetManager* manager, u32 id) {
 Mesh* GetMesh(AssetManager* manager, u32 id) {
     Mesh* result = nullptr;
     if (id) {
+        LockAssets(manager);
         auto mesh = Get(&manager->meshTable, &id);
         if (mesh) {
             switch (mesh->state) {
@@ -837,6 +934,7 @@ Mesh* GetMesh(AssetManager* manager, u32 id) {
                 invalid_default();
             }
         }
+        UnlockAssets(manager);
     }
     return result;
 }
@@ -844,6 +942,7 @@ Mesh* GetMesh(AssetManager* manager, u32 id) {
 Texture* GetTexture(AssetManager* manager, u32 id) {
     Texture* result = nullptr;
     if (id) {
+        LockAssets(manager);
         auto texture = Get(&manager->textureTable, &id);
         if (texture) {
             switch (texture->state) {
@@ -859,6 +958,7 @@ Texture* GetTexture(AssetManager* manager, u32 id) {
                 invalid_default();
             }
         }
+        UnlockAssets(manager);
     }
     return result;
 }
@@ -127,6 +127,8 @@ struct CubeTexture {
     u32 width;
     u32 height;
     b32 useMips;
+    // NOTE: Loaded images owning the data
+    void* base[6];
     union {
         void* data[6];
         struct {
@@ -208,7 +210,7 @@ enum struct AssetType {
 struct AssetQueueEntry {
     b32 used;
     u32 id;
-    TexTransferBufferInfo texTransferBufferInfo;
+    StagingRegion stagingRegion;
     AssetType type;
     union {
         // NOTE: HACK! Bacause of stupid c++ initialization rules we can't make union
@@ -218,6 +220,15 @@ struct AssetQueueEntry {
     };
 };
 
+struct PendingGPUFree {
+    // NOTE: Draw slot handle is one-based slot of the GPU-driven geometry pool
+    enum struct Type : u32 { Buffer, Texture, DrawSlot } type;
+    u32 handle;
+};
+
+// NOTE: Assets are requested by both the update and the render thread. Slot states and the load queue are
+// guarded by the lock. Adding, removing and unloading assets changes the tables and frees memory, so these
+// wait for the render thread to finish the frame in flight first. Must be done on the update thread
 struct AssetManager {
     static u32 Hasher(void* key) { return *((u32*)key); }
     static bool Comparator(void* a, void* b) { return *((u32*)a) == *((u32*)b); }
@@ -227,6 +238,13 @@ struct AssetManager {
     HashMap<u32, TextureSlot, Hasher, Comparator> textureTable = HashMap<u32, TextureSlot, Hasher, Comparator>::Make();
     u32 assetQueueUsage;
     AssetQueueEntry assetQueue[512];
+    u32 volatile lock;
+    // NOTE: GL objects of unloaded assets. Deleted by CompletePendingLoads on the render thread
+    u32 pendingGPUFreeCount;
+    PendingGPUFree pendingGPUFrees[4096];
+    // NOTE: Changes when an asset is added, finishes loading or is unloaded. The renderer resolves the assets of render
+    // objects again when it does. Changed either by the render thread or by the update thread after waiting for it
+    u32 generation = 1;
 
     static void Init(AssetManager* manager, Renderer* renderer) {
         manager->renderer = renderer;
@@ -260,7 +278,10 @@ MeshSlot* GetMeshSlot(AssetManager* manager, u32 id);
 Texture* GetTexture(AssetManager* manager, u32 id);
 TextureSlot* GetTextureSlot(AssetManager* manager, u32 id);
 
+// NOTE: Render thread
 void CompletePendingLoads(AssetManager* manager);
+// NOTE: True while any asset is queued or waits for the render thread to finish its upload
+bool HasPendingLoads(AssetManager* manager);
 
 struct OpenMeshResult {
     enum Result {UnknownError = 0, Ok, FileNameIsTooLong, FileNotFound, ReadFileError, InvalidFileFormat } status;
@@ -280,6 +301,8 @@ Texture LoadTextureFromFile(const char* filename, TextureFormat format = Texture
 Texture CreateTexture(i32 width, i32 height, TextureFormat format, TextureWrapMode wrapMode, TextureFilter filter, void* data = 0);
 CubeTexture LoadCubemap(const char* backPath, const char* downPath, const char* frontPath, const char* leftPath, const char* rightPath, const char* upPath, DynamicRange range = DynamicRange::LDR, TextureFormat format = TextureFormat::Unknown, TextureFilter filter = TextureFilter::Default, TextureWrapMode wrapMode = TextureWrapMode::Default);
 CubeTexture MakeEmptyCubemap(u32 w, u32 h, TextureFormat format, TextureFilter filter, TextureWrapMode wrapMode, bool useMips);
+void FreeCubemap(CubeTexture* texture);
+u64 HashFile(const char* filename, u64 hash);
 
 inline CubeTexture LoadCubemapLDR(const char* backPath, const char* downPath, const char* frontPath,
                                const char* leftPath, const char* rightPath, const char* upPath) {
@@ -1,136 +1,654 @@
 #include "flux_shaders.h"
+#include "flux_file_formats.h"
 
-GLuint CompileGLSL(const char* name, const char* vertexSource, const char* fragmentSource)
+struct ShaderCompileJob
+{
+    // NOTE: Either vertex and fragment or a single compute shader
+    GLuint shaderHandles[2];
+    GLenum shaderTypes[2];
+    u32 shaderCount;
+    GLuint programHandle;
+    bool finished;
+};
+
+constexpr u32 MaxPermutationDefinesSize = 1024;
+const wchar_t* ProgramCacheFilename = L"shaders.cache";
+
+// NOTE: Defines have to go after #version directive which is always the first line of the source
+void ShaderSourceWithDefines(GLuint shaderHandle, const char* source, const char* defines)
+{
+    if (defines && *defines)
+    {
+        const char* body = strchr(source, '\n');
+        body = body ? body + 1 : source + strlen(source);
+        const char* strings[] = { source, defines, "#line 2\n", body };
+        GLint lengths[] = { (GLint)(body - source), -1, -1, -1 };
+        glShaderSource(shaderHandle, array_count(strings), strings, lengths);
+    }
+    else
+    {
+        glShaderSource(shaderHandle, 1, &source, nullptr);
+    }
+}
+
+void BeginCompileShader(ShaderCompileJob* job, GLenum type, const char* source, const char* defines)
+{
+    assert(job->shaderCount < array_count(job->shaderHandles));
+    GLuint handle = glCreateShader(type);
+    assert(handle, "Failed to create shader");
+    ShaderSourceWithDefines(handle, source, defines);
+    glCompileShader(handle);
+    job->shaderHandles[job->shaderCount] = handle;
+    job->shaderTypes[job->shaderCount] = type;
+    job->shaderCount++;
+}
+
+const char* ShaderTypeName(GLenum type)
+{
+    const char* result = "";
+    switch (type)
+    {
+    case GL_VERTEX_SHADER: { result = "vertex"; } break;
+    case GL_FRAGMENT_SHADER: { result = "frag"; } break;
+    case GL_COMPUTE_SHADER: { result = "compute"; } break;
+    invalid_default();
+    }
+    return result;
+}
+
+// NOTE: Issues compile and link commands without querying any status, so the driver
+// is free to do the work in the background when KHR_parallel_shader_compile is supported
+void BeginCompileGLSL(ShaderCompileJob* job, const ShaderProgramSource* source, const char* defines = nullptr)
+{
+    *job = {};
+    if (source->comp)
+    {
+        BeginCompileShader(job, GL_COMPUTE_SHADER, source->comp, defines);
+    }
+    else
+    {
+        BeginCompileShader(job, GL_VERTEX_SHADER, source->vert, defines);
+        BeginCompileShader(job, GL_FRAGMENT_SHADER, source->frag, defines);
+    }
+
+    job->programHandle = glCreateProgram();
+    assert(job->programHandle, "Failed to create shader program");
+    for (u32x i = 0; i < job->shaderCount; i++)
+    {
+        glAttachShader(job->programHandle, job->shaderHandles[i]);
+    }
+    glProgramParameteri(job->programHandle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(job->programHandle);
+}
+
+bool IsCompileGLSLComplete(ShaderCompileJob* job)
+{
+    bool result = true;
+    if (GlobalPlatform.gl->extensions.KHR_parallel_shader_compile.supported)
+    {
+        GLint completed = 0;
+        glGetProgramiv(job->programHandle, GL_COMPLETION_STATUS_KHR, &completed);
+        result = completed;
+    }
+    return result;
+}
+
+// NOTE: Blocks until the program is linked if it is not complete yet.
+// Returns program handle or 0 if compilation or linking failed
+GLuint FinishCompileGLSL(ShaderCompileJob* job, const char* name)
 {
     GLuint resultHandle = 0;
+    job->finished = true;
 
-    GLuint vertexHandle = glCreateShader(GL_VERTEX_SHADER);
-    if (vertexHandle)
+    bool compiled = true;
+    for (u32x i = 0; i < job->shaderCount; i++)
     {
-        glShaderSource(vertexHandle, 1, &vertexSource, nullptr);
-        glCompileShader(vertexHandle);
+        GLint compileResult = 0;
+        glGetShaderiv(job->shaderHandles[i], GL_COMPILE_STATUS, &compileResult);
+        if (!compileResult)
+        {
+            GLint logLength;
+            glGetShaderiv(job->shaderHandles[i], GL_INFO_LOG_LENGTH, &logLength);
+            char* message = (char*)PlatformAlloc(logLength, 0, nullptr);
+            defer { PlatformFree(message, nullptr); };
+            glGetShaderInfoLog(job->shaderHandles[i], logLength, nullptr, message);
+            printf("[Error]: Failed to compile %s shader (%s)\n%s\n", ShaderTypeName(job->shaderTypes[i]), name, message);
+            compiled = false;
+            break;
+        }
+    }
 
-        GLint vertexResult = 0;
-        glGetShaderiv(vertexHandle, GL_COMPILE_STATUS, &vertexResult);
-        if (vertexResult)
+    if (compiled)
+    {
+        GLint linkResult = 0;
+        glGetProgramiv(job->programHandle, GL_LINK_STATUS, &linkResult);
+        if (linkResult)
         {
-            GLuint fragmentHandle;
-            fragmentHandle = glCreateShader(GL_FRAGMENT_SHADER);
-            if (fragmentHandle)
+            resultHandle = job->programHandle;
+        }
+        else
+        {
+            i32 logLength;
+            glGetProgramiv(job->programHandle, GL_INFO_LOG_LENGTH, &logLength);
+            // TODO: Stop using alloca
+            char* message = (char*)PlatformAlloc(logLength, 0, nullptr);
+            defer { PlatformFree(message, nullptr); };
+            glGetProgramInfoLog(job->programHandle, logLength, 0, message);
+            printf("[Error]: Failed to link shader program (%s) \n%s\n", name, message);
+        }
+    }
+
+    for (u32x i = 0; i < job->shaderCount; i++)
+    {
+        glDeleteShader(job->shaderHandles[i]);
+    }
+    if (!resultHandle)
+    {
+        glDeleteProgram(job->programHandle);
+    }
+    return resultHandle;
+}
+
+GLuint CompileGLSL(const char* name, const ShaderProgramSource* source, const char* defines)
+{
+    ShaderCompileJob job;
+    BeginCompileGLSL(&job, source, defines);
+    return FinishCompileGLSL(&job, name);
+}
+
+GLuint CompileGLSL(const char* name, const char* vertexSource, const char* fragmentSource, const char* defines)
+{
+    ShaderProgramSource source = { vertexSource, fragmentSource, nullptr };
+    return CompileGLSL(name, &source, defines);
+}
+
+u64 HashProgramSource(const ShaderProgramSource* source, u64 hash)
+{
+    const char* sources[] = { source->vert, source->frag, source->comp };
+    for (u32x i = 0; i < array_count(sources); i++)
+    {
+        if (sources[i])
+        {
+            hash = Hash64(sources[i], strlen(sources[i]), hash);
+        }
+    }
+    return hash;
+}
+
+// NOTE: Writes a define line for every feature in the mask
+void BuildPermutationDefines(u32 program, u32 featureMask, char* buffer, u32 bufferSize)
+{
+    auto info = ShaderPermutations + program;
+    u32 at = 0;
+    buffer[0] = 0;
+    for (u32x i = 0; i < info->featureCount; i++)
+    {
+        if (featureMask & (1u << i))
+        {
+            i32 written = snprintf(buffer + at, bufferSize - at, "#define %s\n", info->featureDefines[i]);
+            assert(written > 0 && at + written < bufferSize);
+            at += (u32)written;
+        }
+    }
+}
+
+u64 ProgramSourceKey(u32 program, const char* defines)
+{
+    u64 hash = HashProgramSource(ShaderSources + program, Hash64(nullptr, 0));
+    if (defines)
+    {
+        hash = Hash64(defines, strlen(defines), hash);
+    }
+    return hash;
+}
+
+u32 PermutationCount(u32 program)
+{
+    return 1u << ShaderPermutations[program].featureCount;
+}
+
+// NOTE: Permutation 0 is the program compiled without any features
+GLuint* GetProgramSlot(Renderer* renderer, u32 program, u32 permutation)
+{
+    GLuint* result = renderer->shaderHandles + program;
+    if (permutation)
+    {
+        result = renderer->shaderPermutations + ShaderPermutations[program].firstPermutation + permutation;
+    }
+    return result;
+}
+
+// NOTE: Program binaries are only compatible with the exact driver they were produced by
+u64 GetProgramBinaryDriverKey()
+{
+    u64 hash = Hash64(nullptr, 0);
+    GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (u32x i = 0; i < array_count(strings); i++)
+    {
+        auto string = (const char*)glGetString(strings[i]);
+        if (string)
+        {
+            hash = Hash64(string, strlen(string), hash);
+        }
+    }
+    return hash;
+}
+
+// NOTE: Returns the whole cache file or nullptr if cache is missing, corrupted or was produced by another driver.
+// Caller owns the memory
+FluxProgramCacheHeader* LoadProgramCache(const wchar_t* filename, u64 driverKey)
+{
+    FluxProgramCacheHeader* result = nullptr;
+    auto fileSize = PlatformDebugGetFileSize(filename);
+    if (fileSize >= sizeof(FluxProgramCacheHeader))
+    {
+        auto file = (FluxProgramCacheHeader*)PlatformAlloc(fileSize, 0, nullptr);
+        u32 bytesRead = PlatformDebugReadFile(file, (u32)fileSize, filename);
+        if ((bytesRead == fileSize) &&
+            (file->header.magicValue == FluxFileHeader::MagicValue) &&
+            (file->header.type == FluxFileHeader::ProgramCache) &&
+            (file->version == 2) &&
+            (file->driverKey == driverKey) &&
+            ((u64)file->entries + (u64)file->entryCount * sizeof(FluxProgramCacheEntry) <= fileSize) &&
+            ((u64)file->data + (u64)file->dataSize <= fileSize))
+        {
+            result = file;
+        }
+        else
+        {
+            PlatformFree(file, nullptr);
+        }
+    }
+    return result;
+}
+
+FluxProgramCacheEntry* FindProgramCacheEntry(FluxProgramCacheHeader* cache, u32 program, u32 permutation, u64 sourceKey)
+{
+    FluxProgramCacheEntry* result = nullptr;
+    if (cache)
+    {
+        auto entries = (FluxProgramCacheEntry*)((byte*)cache + cache->entries);
+        for (u32x i = 0; i < cache->entryCount; i++)
+        {
+            auto entry = entries + i;
+            if (entry->program == program && entry->permutation == permutation)
             {
-                glShaderSource(fragmentHandle, 1, &fragmentSource, nullptr);
-                glCompileShader(fragmentHandle);
+                if ((entry->sourceKey == sourceKey) &&
+                    (entry->offset >= cache->data) &&
+                    ((u64)entry->offset + entry->size <= (u64)cache->data + cache->dataSize))
+                {
+                    result = entry;
+                }
+                break;
+            }
+        }
+    }
+    return result;
+}
 
-                GLint fragmentResult = 0;
-                glGetShaderiv(fragmentHandle, GL_COMPILE_STATUS, &fragmentResult);
-                if (fragmentResult)
+// NOTE: Returns linked program or 0 if there is no binary for this source or the driver rejected it
+GLuint LoadProgramBinary(FluxProgramCacheHeader* cache, u32 program, u32 permutation, u64 sourceKey)
+{
+    GLuint resultHandle = 0;
+    auto entry = FindProgramCacheEntry(cache, program, permutation, sourceKey);
+    if (entry)
+    {
+        GLuint programHandle = glCreateProgram();
+        glProgramBinary(programHandle, entry->binaryFormat, (byte*)cache + entry->offset, entry->size);
+        GLint linkResult = 0;
+        glGetProgramiv(programHandle, GL_LINK_STATUS, &linkResult);
+        if (linkResult)
+        {
+            resultHandle = programHandle;
+        }
+        else
+        {
+            glDeleteProgram(programHandle);
+        }
+    }
+    return resultHandle;
+}
+
+// NOTE: Writes binaries of all live programs. Entries of permutations which were not requested
+// during this session are carried over from the old cache if their sources are still the same
+void SaveProgramCache(Renderer* renderer)
+{
+    auto oldCache = renderer->programCache;
+    char defines[MaxPermutationDefinesSize];
+
+    u32 entryCount = 0;
+    u32 dataSize = 0;
+    for (u32x program = 0; program < ShaderCount; program++)
+    {
+        for (u32x permutation = 0; permutation < PermutationCount(program); permutation++)
+        {
+            GLuint handle = *GetProgramSlot(renderer, program, permutation);
+            if (handle)
+            {
+                GLint binarySize = 0;
+                glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+                if (binarySize > 0)
                 {
-                    GLint programHandle;
-                    programHandle = glCreateProgram();
-                    if (programHandle)
-                    {
-                        glAttachShader(programHandle, vertexHandle);
-                        glAttachShader(programHandle, fragmentHandle);
-                        glLinkProgram(programHandle);
-
-                        GLint linkResult = 0;
-                        glGetProgramiv(programHandle, GL_LINK_STATUS, &linkResult);
-                        if (linkResult)
-                        {
-                            glDeleteShader(vertexHandle);
-                            glDeleteShader(fragmentHandle);
-                            resultHandle = programHandle;
-                        }
-                        else
-                        {
-                            i32 logLength;
-                            glGetProgramiv(programHandle, GL_INFO_LOG_LENGTH, &logLength);
-                            // TODO: Stop using alloca
-                            char* message = (char*)PlatformAlloc(logLength, 0, nullptr);
-                            defer { PlatformFree(message, nullptr); };
-                            glGetProgramInfoLog(programHandle, logLength, 0, message);
-                            printf("[Error]: Failed to link shader program (%s) \n%s\n", name, message);
-                        }
-                    }
-                    else
-                    {
-                        assert(false, "Failed to create shader program");
-                    }
+                    entryCount++;
+                    dataSize += (u32)binarySize;
                 }
-                else
+            }
+        }
+    }
+    if (oldCache)
+    {
+        auto oldEntries = (FluxProgramCacheEntry*)((byte*)oldCache + oldCache->entries);
+        for (u32x i = 0; i < oldCache->entryCount; i++)
+        {
+            auto entry = oldEntries + i;
+            if (entry->program < ShaderCount && entry->permutation < PermutationCount(entry->program) &&
+                !*GetProgramSlot(renderer, entry->program, entry->permutation))
+            {
+                entryCount++;
+                dataSize += entry->size;
+            }
+        }
+    }
+
+    u32 entriesOffset = sizeof(FluxProgramCacheHeader);
+    u32 dataOffset = entriesOffset + entryCount * sizeof(FluxProgramCacheEntry);
+    u32 fileSize = dataOffset + dataSize;
+
+    auto memory = (byte*)PlatformAlloc(fileSize, 0, nullptr);
+    auto file = (FluxProgramCacheHeader*)memory;
+    *file = {};
+    file->header.type = FluxFileHeader::ProgramCache;
+    file->driverKey = renderer->programCacheDriverKey;
+    file->entries = entriesOffset;
+    file->data = dataOffset;
+
+    auto entries = (FluxProgramCacheEntry*)(memory + entriesOffset);
+    u32 at = dataOffset;
+    for (u32x program = 0; program < ShaderCount; program++)
+    {
+        for (u32x permutation = 0; permutation < PermutationCount(program); permutation++)
+        {
+            GLuint handle = *GetProgramSlot(renderer, program, permutation);
+            if (handle)
+            {
+                GLint binarySize = 0;
+                glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+                if (binarySize > 0 && at + (u32)binarySize <= fileSize)
                 {
-                    GLint logLength;
-                    glGetShaderiv(fragmentHandle, GL_INFO_LOG_LENGTH, &logLength);
-                    char* message = (char*)PlatformAlloc(logLength, 0, nullptr);
-                    defer { PlatformFree(message, nullptr); };
-                    glGetShaderInfoLog(fragmentHandle, logLength, nullptr, message);
-                    printf("[Error]: Failed to compile frag shader (%s)\n%s\n", name, message);
+                    GLsizei length = 0;
+                    GLenum binaryFormat = 0;
+                    glGetProgramBinary(handle, binarySize, &length, &binaryFormat, memory + at);
+                    if (length > 0)
+                    {
+                        BuildPermutationDefines(program, permutation, defines, array_count(defines));
+                        auto entry = entries + file->entryCount;
+                        entry->sourceKey = ProgramSourceKey(program, permutation ? defines : nullptr);
+                        entry->program = program;
+                        entry->permutation = permutation;
+                        entry->binaryFormat = binaryFormat;
+                        entry->offset = at;
+                        entry->size = (u32)length;
+                        file->entryCount++;
+                        at += (u32)length;
+                    }
                 }
             }
-            else
+        }
+    }
+    if (oldCache)
+    {
+        auto oldEntries = (FluxProgramCacheEntry*)((byte*)oldCache + oldCache->entries);
+        for (u32x i = 0; i < oldCache->entryCount; i++)
+        {
+            auto oldEntry = oldEntries + i;
+            if (oldEntry->program < ShaderCount && oldEntry->permutation < PermutationCount(oldEntry->program) &&
+                !*GetProgramSlot(renderer, oldEntry->program, oldEntry->permutation))
             {
-                assert(false, "Failed to create fragment shader");
+                BuildPermutationDefines(oldEntry->program, oldEntry->permutation, defines, array_count(defines));
+                u64 sourceKey = ProgramSourceKey(oldEntry->program, oldEntry->permutation ? defines : nullptr);
+                if (FindProgramCacheEntry(oldCache, oldEntry->program, oldEntry->permutation, sourceKey) == oldEntry)
+                {
+                    auto entry = entries + file->entryCount;
+                    *entry = *oldEntry;
+                    entry->offset = at;
+                    memcpy(memory + at, (byte*)oldCache + oldEntry->offset, oldEntry->size);
+                    file->entryCount++;
+                    at += oldEntry->size;
+                }
             }
         }
-        else
+    }
+    file->dataSize = at - dataOffset;
+
+    if (!PlatformDebugWriteFile(ProgramCacheFilename, memory, at))
+    {
+        printf("[Renderer] Failed to write program cache: %ls\n", ProgramCacheFilename);
+    }
+
+    // NOTE: Keeping the new file around, so permutations requested later could be loaded from it
+    if (oldCache)
+    {
+        PlatformFree(oldCache, nullptr);
+    }
+    renderer->programCache = file;
+    renderer->programCacheDirty = false;
+    renderer->programCacheIdleFrames = 0;
+}
+
+void FlushProgramCache(Renderer* renderer)
+{
+    if (renderer->programCacheEnabled && renderer->programCacheDirty)
+    {
+        SaveProgramCache(renderer);
+    }
+}
+
+void UpdateProgramCache(Renderer* renderer)
+{
+    if (renderer->programCacheEnabled && renderer->programCacheDirty)
+    {
+        renderer->programCacheIdleFrames++;
+        if (renderer->programCacheIdleFrames >= Renderer::ProgramCacheSaveDelay)
         {
-            GLint logLength;
-            glGetShaderiv(vertexHandle, GL_INFO_LOG_LENGTH, &logLength);
-            char* message = (char*)PlatformAlloc(logLength, 0, nullptr);
-            defer { PlatformFree(message, nullptr); };
-            glGetShaderInfoLog(vertexHandle, logLength, nullptr, message);
-            printf("[Error]: Failed to compile vertex shader (%s)\n%s", name, message);
+            SaveProgramCache(renderer);
         }
     }
-    else
+}
+
+GLuint GetShaderPermutation(Renderer* renderer, u32 program, u32 featureMask)
+{
+    GLuint resultHandle = renderer->shaderHandles[program];
+    if (featureMask)
     {
-        assert(false, "Falled to create vertex shader");
+        assert(featureMask < PermutationCount(program));
+        u32 slot = ShaderPermutations[program].firstPermutation + featureMask;
+        if (!renderer->shaderPermutationRequested[slot])
+        {
+            renderer->shaderPermutationRequested[slot] = true;
+
+            char defines[MaxPermutationDefinesSize];
+            BuildPermutationDefines(program, featureMask, defines, array_count(defines));
+            u64 sourceKey = ProgramSourceKey(program, defines);
+
+            GLuint handle = LoadProgramBinary(renderer->programCache, program, featureMask, sourceKey);
+            if (!handle)
+            {
+                handle = CompileGLSL(ShaderNames[program], ShaderSources + program, defines);
+                if (!handle)
+                {
+                    printf("[Error]: Permutation defines:\n%s", defines);
+                }
+                renderer->programCacheDirty = true;
+                renderer->programCacheIdleFrames = 0;
+            }
+            renderer->shaderPermutations[slot] = handle;
+        }
+        resultHandle = renderer->shaderPermutations[slot];
     }
     return resultHandle;
 }
 
 void RecompileShaders(Renderer* renderer)
 {
-    for (u32x i = 0; i < array_count(renderer->shaderHandles); i++)
+    GLint binaryFormatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+    // NOTE: Null GL backend has no binaries, and its driver key would replace the cache of the real driver
+    renderer->programCacheEnabled = binaryFormatCount > 0 && !GlobalPlatform.gl->nullStats;
+
+    u64 driverKey = GetProgramBinaryDriverKey();
+    if (renderer->programCache && renderer->programCacheDriverKey != driverKey)
+    {
+        PlatformFree(renderer->programCache, nullptr);
+        renderer->programCache = nullptr;
+    }
+    renderer->programCacheDriverKey = driverKey;
+    if (renderer->programCacheEnabled && !renderer->programCache)
+    {
+        renderer->programCache = LoadProgramCache(ProgramCacheFilename, driverKey);
+    }
+
+    auto parallelCompile = &GlobalPlatform.gl->extensions.KHR_parallel_shader_compile;
+    if (parallelCompile->supported)
+    {
+        // NOTE: 0xffffffff lets the driver pick the number of threads
+        parallelCompile->glMaxShaderCompilerThreadsKHR(0xffffffff);
+    }
+
+    // NOTE: Permutations are compiled again on first use
+    for (u32x i = 0; i < ShaderPermutationCount; i++)
+    {
+        if (renderer->shaderPermutations[i])
+        {
+            DeleteProgram(renderer->shaderPermutations[i]);
+            renderer->shaderPermutations[i] = 0;
+        }
+        renderer->shaderPermutationRequested[i] = false;
+    }
+
+    ShaderCompileJob jobs[ShaderCount] = {};
+    u32 pendingCount = 0;
+    for (u32x i = 0; i < ShaderCount; i++)
     {
         auto handle = renderer->shaderHandles[i];
         if (handle)
         {
             DeleteProgram(handle);
+            renderer->shaderHandles[i] = 0;
+        }
+
+        renderer->shaderHandles[i] = LoadProgramBinary(renderer->programCache, i, 0, ProgramSourceKey(i, nullptr));
+        if (!renderer->shaderHandles[i])
+        {
+            BeginCompileGLSL(jobs + i, ShaderSources + i);
+            pendingCount++;
+        }
+    }
+
+    u32 compiledCount = pendingCount;
+    // NOTE: Finishing programs in the order the driver completes them. If none of them
+    // is ready, blocking on the first pending one. Without KHR_parallel_shader_compile
+    // every job reports completion immediately and FinishCompileGLSL blocks as usual
+    while (pendingCount)
+    {
+        i32 firstPending = -1;
+        u32 finishedCount = 0;
+        for (u32x i = 0; i < ShaderCount; i++)
+        {
+            auto job = jobs + i;
+            if (job->programHandle && !job->finished)
+            {
+                if (IsCompileGLSLComplete(job))
+                {
+                    renderer->shaderHandles[i] = FinishCompileGLSL(job, ShaderNames[i]);
+                    finishedCount++;
+                }
+                else if (firstPending == -1)
+                {
+                    firstPending = (i32)i;
+                }
+            }
+        }
+        if (!finishedCount && firstPending != -1)
+        {
+            renderer->shaderHandles[firstPending] = FinishCompileGLSL(jobs + firstPending, ShaderNames[firstPending]);
+            finishedCount++;
         }
-        renderer->shaderHandles[i] = CompileGLSL(ShaderNames[i], ShaderSources[i].vert, ShaderSources[i].frag);
+        pendingCount -= finishedCount;
+    }
+
+    printf("[Renderer] Shaders: %u loaded from cache, %u compiled\n", ShaderCount - compiledCount, compiledCount);
+
+    if (compiledCount)
+    {
+        renderer->programCacheDirty = true;
     }
+    FlushProgramCache(renderer);
 }
 
 template<typename T, u32 Binding>
-inline void ReallocUniformBuffer(UniformBuffer<T, Binding>* buffer)
+inline void ReallocUniformBuffer(UniformBuffer<T, Binding>* buffer, u32 alignment, u32 blocksPerFrame, u32 frameCount)
 {
     if (buffer->handle)
     {
         glDeleteBuffers(1, &buffer->handle);
+        glDeleteBuffers(1, &buffer->overflowHandle);
         buffer->handle = 0;
+        buffer->overflowHandle = 0;
     }
+    buffer->blockSize = (sizeof(T) + (alignment - 1)) / alignment * alignment;
+    buffer->blocksPerFrame = blocksPerFrame;
+    buffer->region = 0;
+    buffer->at = 0;
+
+    uptr size = (uptr)buffer->blockSize * blocksPerFrame * frameCount;
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
     glCreateBuffers(1, &buffer->handle);
     assert(buffer->handle);
-    glNamedBufferStorage(buffer->handle, sizeof(T), 0, GL_DYNAMIC_STORAGE_BIT | GL_MAP_WRITE_BIT);
+    glNamedBufferStorage(buffer->handle, size, nullptr, flags);
+    buffer->memory = (byte*)glMapNamedBufferRange(buffer->handle, 0, size, flags);
+    panic(buffer->memory, "[Renderer] Failed to map uniform buffer");
+
+    glCreateBuffers(1, &buffer->overflowHandle);
+    assert(buffer->overflowHandle);
+    glNamedBufferStorage(buffer->overflowHandle, sizeof(T), nullptr, GL_DYNAMIC_STORAGE_BIT);
 }
 
 template<typename T, u32 Binding>
-T* Map(UniformBuffer<T, Binding> buffer)
+void BeginUniformBufferFrame(UniformBuffer<T, Binding>* buffer, u32 region)
 {
-    // TODO: Is that safe for previous data to be invalidated in opengl
-    // Check propperly what happens to old buffer storage when it`s invalidated
-    auto mem = (T*)glMapNamedBufferRange(buffer.handle, 0, sizeof(T), GL_MAP_WRITE_BIT);// | GL_MAP_INVALIDATE_RANGE_BIT);
-    assert(mem);
-    return mem;
+    buffer->region = region;
+    buffer->at = 0;
+    buffer->overflowCount = 0;
 }
 
 template<typename T, u32 Binding>
-void Unmap(UniformBuffer<T, Binding> buffer)
+T* Map(UniformBuffer<T, Binding>* buffer)
 {
-    glUnmapNamedBuffer(buffer.handle);
+    T* result;
+    if (buffer->at < buffer->blocksPerFrame)
+    {
+        buffer->mapped = buffer->region * buffer->blocksPerFrame + buffer->at++;
+        result = (T*)(buffer->memory + (uptr)buffer->mapped * buffer->blockSize);
+    }
+    else
+    {
+        buffer->mapped = 0xffffffff;
+        buffer->overflowCount++;
+        result = &buffer->overflowBlock;
+    }
+    return result;
+}
 
-    glBindBuffer(GL_UNIFORM_BUFFER, buffer.handle);
-    glBindBufferRange(GL_UNIFORM_BUFFER, Binding, buffer.handle, 0, sizeof(T));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+template<typename T, u32 Binding>
+void Unmap(UniformBuffer<T, Binding>* buffer)
+{
+    if (buffer->mapped != 0xffffffff)
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, Binding, buffer->handle, (uptr)buffer->mapped * buffer->blockSize, sizeof(T));
+    }
+    else
+    {
+        glNamedBufferSubData(buffer->overflowHandle, 0, sizeof(T), &buffer->overflowBlock);
+        glBindBufferRange(GL_UNIFORM_BUFFER, Binding, buffer->overflowHandle, 0, sizeof(T));
+    }
 }
@@ -5,6 +5,14 @@ struct Renderer;
 struct ShaderProgramSource  {
     const char* vert;
     const char* frag;
+    // NOTE: Compute programs have only this one
+    const char* comp;
+};
+
+struct ShaderPermutationInfo {
+    u32 firstPermutation;
+    u32 featureCount;
+    const char* const* featureDefines;
 };
 
 #include "flux_shaders_generated.h"
@@ -12,23 +20,48 @@ struct ShaderProgramSource  {
 constexpr u32 ShaderCount = sizeof(Shaders) / sizeof(GLuint);
 static_assert(ShaderCount == array_count(ShaderSources));
 
-GLuint CompileGLSL(const char* name, const char* vert, const char* frag);
+GLuint CompileGLSL(const char* name, const char* vert, const char* frag, const char* defines = nullptr);
+GLuint CompileGLSL(const char* name, const ShaderProgramSource* source, const char* defines = nullptr);
+u64 HashProgramSource(const ShaderProgramSource* source, u64 hash);
 void RecompileShaders(Renderer* renderer);
+// NOTE: Returns program compiled with defines of features in the mask. Permutations are compiled on first use
+GLuint GetShaderPermutation(Renderer* renderer, u32 program, u32 featureMask);
+// NOTE: Writes program binary cache to disk if new programs were compiled since the last flush
+void FlushProgramCache(Renderer* renderer);
+// NOTE: Called every frame. Flushes the cache once permutation compiles have settled
+void UpdateProgramCache(Renderer* renderer);
 inline void DeleteProgram(GLuint handle) { glDeleteProgram(handle); }
 
+// NOTE: Uniform ring. One persistently mapped buffer with a region per frame in flight, every region is split
+// into blocks aligned to the uniform buffer offset alignment. Every Map() takes the next block of the current
+// frame region, so blocks which may still be read by the GPU are never overwritten. When the region is exhausted
+// blocks are uploaded to the overflow buffer with glNamedBufferSubData
 template <typename T, u32 Binding>
 struct UniformBuffer {
     GLuint handle;
+    GLuint overflowHandle;
+    byte* memory;
+    u32 blockSize;
+    u32 blocksPerFrame;
+    u32 region;
+    u32 at;
+    u32 mapped;
+    u32 overflowCount;
+    T overflowBlock;
 };
 
 template<typename T, u32 Binding>
-void ReallocUniformBuffer(UniformBuffer<T, Binding>* buffer);
+void ReallocUniformBuffer(UniformBuffer<T, Binding>* buffer, u32 alignment, u32 blocksPerFrame, u32 frameCount);
 
+// NOTE: Called by frame pacing when the frame moves to the next region
 template<typename T, u32 Binding>
-T* Map(UniformBuffer<T, Binding> buffer);
+void BeginUniformBufferFrame(UniformBuffer<T, Binding>* buffer, u32 region);
 
 template<typename T, u32 Binding>
-void Unmap(UniformBuffer<T, Binding> buffer);
+T* Map(UniformBuffer<T, Binding>* buffer);
+
+template<typename T, u32 Binding>
+void Unmap(UniformBuffer<T, Binding>* buffer);
 
 struct WaterShader {
     static constexpr u32 Position = 0;
@@ -40,14 +73,15 @@ struct MeshShader {
     static constexpr u32 DiffMap = 0;
     static constexpr u32 SpecMap = 1;
     static constexpr u32 ShadowMap = 2;
+    static constexpr u32 ShadowMoments = 3;
 };
 
 struct MeshPhongCustomShader {
     static constexpr u32 ShadowMap = 0;
+    static constexpr u32 ShadowMoments = 1;
 };
 
 struct MeshPBRShader {
-    static constexpr u32 IrradanceMap = 0;
     static constexpr u32 EnviromentMap = 1;
     static constexpr u32 BRDFLut = 2;
     static constexpr u32 AlbedoMap = 3;
@@ -59,24 +93,118 @@ struct MeshPBRShader {
     static constexpr u32 ShadowMap = 9;
     static constexpr u32 AOMap = 10;
     static constexpr u32 EmissionMap = 11;
+    static constexpr u32 ShadowMoments = 12;
 };
 
 struct ShadowPassShader {
     static constexpr u32 CascadeIndexLocation = 0;
+    static constexpr u32 CascadeMaskLocation = 1;
     static constexpr u32 PositionAttribLocation = 0;
     static constexpr u32 NormalAttribLocation = 1;
 };
 
+struct EVSMBlurShader {
+    static constexpr u32 GroupSize = 128;
+    static constexpr i32 MaxBlurRadius = 8;
+    static constexpr u32 CascadeLocation = 0;
+    static constexpr u32 RadiusLocation = 1;
+    static constexpr u32 Source = 0;
+    static constexpr u32 Dest = 0;
+};
+
+// NOTE: Must match SHADOW_FILTER_* in ShadowsCommon.glh
+enum struct ShadowFilter : u32 {
+    PCF = 0, EVSM
+};
+
+struct HiZShader {
+    static constexpr u32 GroupSize = 8;
+    static constexpr u32 SampleCountLocation = 0;
+    static constexpr u32 Source = 0;
+    static constexpr u32 Dest = 1;
+};
+
+struct GPUCullShader {
+    static constexpr u32 GroupSize = 64;
+    static constexpr u32 InstanceCountLocation = 0;
+    static constexpr u32 HiZViewProjLocation = 1;
+    static constexpr u32 HiZEnabledLocation = 2;
+    static constexpr u32 PhaseLocation = 3;
+    static constexpr u32 CommandOffsetLocation = 4;
+    static constexpr u32 CullViewProjLocation = 5;
+    static constexpr u32 CastersLocation = 6;
+    static constexpr u32 HiZ = 0;
+    static constexpr u32 Instances = 0;
+    static constexpr u32 Commands = 1;
+    static constexpr u32 VisibleInstances = 2;
+    // NOTE: Slots 3-5 stay bound to the lights for the whole main pass, see LocalLightsShader
+    static constexpr u32 ObjectData = 6;
+    static constexpr u32 OccludedInstances = 7;
+};
+
+// NOTE: Indirect permutations of the Mesh, PbrMesh and Shadow programs. Vertex streams use the attribute
+// locations of the regular programs, instances and object data use the GPUCullShader bindings
+struct IndirectDrawShader {
+    static constexpr u32 InstanceIndex = 5;
+    // NOTE: Mesh only. Bit 0 is set if the diffuse map is bound, bit 1 for the specular map
+    static constexpr u32 MapMaskLocation = 0;
+};
+
+// NOTE: std430, must match CullInstance in GPUCull.glh
+struct GPUCullInstance {
+    // NOTE: Index in the object data buffer
+    u32 object;
+    u32 command;
+    u32 shadowCommand;
+    b32 dynamic;
+    v4 boundsMin;
+    v4 boundsMax;
+};
+
+static_assert(sizeof(GPUCullInstance) == 48);
+
+// NOTE: Layout is defined by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    u32 count;
+    u32 instanceCount;
+    u32 firstIndex;
+    i32 baseVertex;
+    u32 baseInstance;
+};
+
+// NOTE: SSBO bindings of clustered lights. Must match Lights.glh
+struct LocalLightsShader {
+    static constexpr u32 Lights = 3;
+    static constexpr u32 Clusters = 4;
+    static constexpr u32 LightIndices = 5;
+};
+
+// NOTE: std430, must match LocalLight in Lights.glh
+struct ShaderLocalLight {
+    v4 positionRadius;
+    v4 colorSpotScale;
+    v4 spotDirectionOffset;
+};
+
+struct LineShader {
+    static constexpr u32 Position = 0;
+    static constexpr u32 Color = 1;
+};
+
 struct SkyboxShader {
     static constexpr u32 CubeTexture = 0;
 };
 
-struct PostFxShader {
+struct ResolveTonemapShader {
+    static constexpr u32 GroupSize = 8;
+    static constexpr u32 SampleCountLocation = 0;
     static constexpr u32 ColorSourceLinear = 0;
+    static constexpr u32 Result = 0;
 };
 
 struct FXAAShader {
     static constexpr u32 ColorSourcePerceptual = 0;
+    static constexpr u32 SourceScaleLocation = 0;
 };
 
 struct EnvMapPrefilterShader {
@@ -85,12 +213,10 @@ struct EnvMapPrefilterShader {
     static constexpr u32 Resolution = 1;
 };
 
-struct IrradanceConvolver {
-    static constexpr u32 SourceCubemap = 0;
-};
-
 struct layout_std140 ShaderFrameData {
     static constexpr u32 Binding = 0;
+    // NOTE: Must match MAX_SHADOW_CASCADES in Common.glh
+    static constexpr u32 MaxShadowCascades = 4;
     struct layout_std140 DirLight {
         std140_vec3 pos;
         std140_vec3 dir;
@@ -104,10 +230,14 @@ struct layout_std140 ShaderFrameData {
     std140_mat4 projectionMatrix;
     std140_mat4 invViewMatrix;
     std140_mat4 invProjMatrix;
-    std140_mat4 lightSpaceMatrices[3];
+    std140_mat4 lightSpaceMatrices[MaxShadowCascades];
     DirLight dirLight;
     std140_vec3 viewPos;
-    std140_vec3 shadowCascadeSplits;
+    std140_vec4 shadowCascadeSplits;
+    std140_int shadowCascadeCount;
+    std140_int shadowFilterMode;
+    std140_vec2 evsmExponents;
+    std140_float evsmLightBleedingReduction;
     std140_int showShadowCascadeBoundaries;
     std140_float shadowFilterSampleScale;
     std140_int debugF;
@@ -118,6 +248,11 @@ struct layout_std140 ShaderFrameData {
     std140_float gamma;
     std140_float exposure;
     std140_vec2 screenSize;
+    // NOTE: Diffuse irradiance SH9. vec4 because of std140 array stride
+    std140_vec4 irradianceSH[9];
+    // NOTE: Light cluster slice is floor(log(viewDepth) * scale + bias)
+    std140_float clusterDepthScale;
+    std140_float clusterDepthBias;
 };
 
 struct layout_std140 ShaderMeshData {
@@ -126,20 +261,6 @@ struct layout_std140 ShaderMeshData {
     std140_mat3 normalMatrix;
     std140_vec3 lineColor;
 
-    std140_int hasBitangents;
-
-    std140_int metallicWorkflow;
-    std140_int emitsLight;
-
-    std140_int pbrUseAlbedoMap;
-    std140_int pbrUseRoughnessMap;
-    std140_int pbrUseMetallicMap;
-    std140_int pbrUseSpecularMap;
-    std140_int pbrUseGlossMap;
-    std140_int pbrUseNormalMap;
-    std140_int pbrUseAOMap;
-    std140_int pbrUseEmissionMap;
-
     std140_vec3 pbrAlbedoValue;
     std140_float pbrRoughnessValue;
     std140_float pbrMetallicValue;
@@ -151,9 +272,11 @@ struct layout_std140 ShaderMeshData {
     std140_int phongUseSpecularMap;
     std140_vec3 customPhongDiffuse;
     std140_vec3 customPhongSpecular;
-    std140_int normalFormat;
 };
 
+// NOTE: Also the element of the std430 object data array of GPU-driven passes, which has the same layout
+static_assert(sizeof(ShaderMeshData) % 16 == 0);
+
 struct layout_std140 ChunkFragUniformBuffer {
     struct layout_std140 DirLight {
         std140_vec3 dir;
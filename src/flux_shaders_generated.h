@@ -10,12 +10,14 @@ struct Shaders
     GLuint PbrMesh;
     GLuint Shadow;
     GLuint Skybox;
-    GLuint PostFx;
+    GLuint ResolveTonemap;
     GLuint FXAA;
     GLuint BRDFIntegrator;
     GLuint EnvMapPrefilter;
-    GLuint IrradanceConvolver;
     GLuint Water;
+    GLuint EVSMBlur;
+    GLuint HiZ;
+    GLuint GPUCull;
 };
 
 const char* ShaderNames[] =
@@ -27,14 +29,144 @@ const char* ShaderNames[] =
     "PbrMesh",
     "Shadow",
     "Skybox",
-    "PostFx",
+    "ResolveTonemap",
     "FXAA",
     "BRDFIntegrator",
     "EnvMapPrefilter",
-    "IrradanceConvolver",
     "Water",
+    "EVSMBlur",
+    "HiZ",
+    "GPUCull",
 };
 
+struct ShaderIndex
+{
+    static constexpr u32 Chunk = 0;
+    static constexpr u32 Mesh = 1;
+    static constexpr u32 MeshPhongCustom = 2;
+    static constexpr u32 Line = 3;
+    static constexpr u32 PbrMesh = 4;
+    static constexpr u32 Shadow = 5;
+    static constexpr u32 Skybox = 6;
+    static constexpr u32 ResolveTonemap = 7;
+    static constexpr u32 FXAA = 8;
+    static constexpr u32 BRDFIntegrator = 9;
+    static constexpr u32 EnvMapPrefilter = 10;
+    static constexpr u32 Water = 11;
+    static constexpr u32 EVSMBlur = 12;
+    static constexpr u32 HiZ = 13;
+    static constexpr u32 GPUCull = 14;
+};
+
+struct MeshFeature
+{
+    static constexpr u32 Indirect = 1 << 0;
+};
+
+const char* MeshFeatureDefines[] =
+{
+    "INDIRECT",
+};
+
+struct PbrMeshFeature
+{
+    static constexpr u32 AlbedoMap = 1 << 0;
+    static constexpr u32 NormalMap = 1 << 1;
+    static constexpr u32 NormalMapDX = 1 << 2;
+    static constexpr u32 AOMap = 1 << 3;
+    static constexpr u32 Emission = 1 << 4;
+    static constexpr u32 EmissionMap = 1 << 5;
+    static constexpr u32 RoughnessMap = 1 << 6;
+    static constexpr u32 MetallicMap = 1 << 7;
+    static constexpr u32 SpecularWorkflow = 1 << 8;
+    static constexpr u32 SpecularMap = 1 << 9;
+    static constexpr u32 GlossMap = 1 << 10;
+    static constexpr u32 HasBitangents = 1 << 11;
+    static constexpr u32 Indirect = 1 << 12;
+};
+
+const char* PbrMeshFeatureDefines[] =
+{
+    "ALBEDO_MAP",
+    "NORMAL_MAP",
+    "NORMAL_MAP_DX",
+    "AO_MAP",
+    "EMISSION",
+    "EMISSION_MAP",
+    "ROUGHNESS_MAP",
+    "METALLIC_MAP",
+    "SPECULAR_WORKFLOW",
+    "SPECULAR_MAP",
+    "GLOSS_MAP",
+    "HAS_BITANGENTS",
+    "INDIRECT",
+};
+
+struct ShadowFeature
+{
+    static constexpr u32 Layered = 1 << 0;
+    static constexpr u32 PrePass = 1 << 1;
+    static constexpr u32 Indirect = 1 << 2;
+};
+
+const char* ShadowFeatureDefines[] =
+{
+    "LAYERED",
+    "PRE_PASS",
+    "INDIRECT",
+};
+
+struct EVSMBlurFeature
+{
+    static constexpr u32 Vertical = 1 << 0;
+};
+
+const char* EVSMBlurFeatureDefines[] =
+{
+    "VERTICAL",
+};
+
+struct HiZFeature
+{
+    static constexpr u32 Downsample = 1 << 0;
+};
+
+const char* HiZFeatureDefines[] =
+{
+    "DOWNSAMPLE",
+};
+
+struct GPUCullFeature
+{
+    static constexpr u32 Shadow = 1 << 0;
+};
+
+const char* GPUCullFeatureDefines[] =
+{
+    "SHADOW",
+};
+
+const ShaderPermutationInfo ShaderPermutations[] =
+{
+    { 0, 0, nullptr },
+    { 0, 1, MeshFeatureDefines },
+    { 0, 0, nullptr },
+    { 0, 0, nullptr },
+    { 2, 13, PbrMeshFeatureDefines },
+    { 8194, 3, ShadowFeatureDefines },
+    { 0, 0, nullptr },
+    { 0, 0, nullptr },
+    { 0, 0, nullptr },
+    { 0, 0, nullptr },
+    { 0, 0, nullptr },
+    { 0, 0, nullptr },
+    { 8202, 1, EVSMBlurFeatureDefines },
+    { 8204, 1, HiZFeatureDefines },
+    { 8206, 1, GPUCullFeatureDefines },
+};
+
+constexpr u32 ShaderPermutationCount = 8208;
+
 const ShaderProgramSource ShaderSources[] =
 {
     {
@@ -50,6 +182,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -57,10 +191,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -71,23 +209,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -98,8 +229,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -117,12 +257,10 @@ const ShaderProgramSource ShaderSources[] =
         "layout (location = 1) in vec3 a_Normal;\n"
         "layout (location = 2) in int a_TileId;\n"
         "layout (location = 3) out vec3 v_ViewPosition;\n"
-        "layout (location = 4) out vec4 v_LightSpacePos[3];\n"
         "layout (location = 7) flat out int v_TileId;\n"
         "layout (location = 8) out vec3 v_Normal;\n"
         "layout (location = 9) out vec2 v_UV;\n"
         "layout (location = 10) out vec4 v_Position;\n"
-        "#define NUM_SHADOW_CASCADES 3\n"
         "#define TERRAIN_TEX_ARRAY_NUM_LAYERS 32\n"
         "#define INDICES_PER_CHUNK_QUAD 6\n"
         "#define VERTICES_PER_QUAD 4\n"
@@ -141,9 +279,6 @@ const ShaderProgramSource ShaderSources[] =
         "    v_Position = (MeshData.modelMatrix * vec4(a_Position, 1.0f));\n"
         "    v_ViewPosition = (FrameData.viewMatrix * MeshData.modelMatrix * vec4(a_Position, 1.0f)).xyz;\n"
         "    v_Normal = MeshData.normalMatrix * a_Normal;\n"
-        "    v_LightSpacePos[0] = FrameData.lightSpaceMatrices[0] * MeshData.modelMatrix * vec4(a_Position, 1.0f);\n"
-        "    v_LightSpacePos[1] = FrameData.lightSpaceMatrices[1] * MeshData.modelMatrix * vec4(a_Position, 1.0f);\n"
-        "    v_LightSpacePos[2] = FrameData.lightSpaceMatrices[2] * MeshData.modelMatrix * vec4(a_Position, 1.0f);\n"
         "    gl_Position = FrameData.projectionMatrix * FrameData.viewMatrix * MeshData.modelMatrix * vec4(a_Position, 1.0f);\n"
         "}\n"
 ,
@@ -159,6 +294,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -166,10 +303,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -180,23 +321,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -207,8 +341,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -223,7 +366,9 @@ const ShaderProgramSource ShaderSources[] =
         "}\n"
         "#line 3\n"
         "#line 100000\n"
-        "#define NUM_SHADOW_CASCADES 3\n"
+        "// NOTE: Must match ShadowFilter in flux_shaders.h\n"
+        "#define SHADOW_FILTER_PCF 0\n"
+        "#define SHADOW_FILTER_EVSM 1\n"
         "// NOTE: Reference: https://github.com/TheRealMJP/Shadows/blob/master/Shadows/PCFKernels.hlsl\n"
         "const vec2 PoissonSamples[64] = vec2[64]\n"
         "(\n"
@@ -292,16 +437,18 @@ const ShaderProgramSource ShaderSources[] =
         "    vec2(-0.4241052f, 0.5581087f),\n"
         "    vec2(-0.1020106f, 0.6724468f)\n"
         ");\n"
-        "vec3 CascadeColors[NUM_SHADOW_CASCADES] = vec3[NUM_SHADOW_CASCADES]\n"
+        "vec3 CascadeColors[MAX_SHADOW_CASCADES] = vec3[MAX_SHADOW_CASCADES]\n"
         "(\n"
         "    vec3(1.0f, 0.0f, 0.0f),\n"
         "    vec3(0.0f, 1.0f, 0.0f),\n"
-        "    vec3(0.0f, 0.0f, 1.0f)\n"
+        "    vec3(0.0f, 0.0f, 1.0f),\n"
+        "    vec3(1.0f, 1.0f, 0.0f)\n"
         ");\n"
-        "int GetShadowCascadeIndex(float viewSpaceDepth, vec3 bounds)\n"
+        "int GetShadowCascadeIndex(float viewSpaceDepth, vec4 bounds, int cascadeCount)\n"
         "{\n"
-        "    int cascadeNum = 0;\n"
-        "    for (int i = 0; i < NUM_SHADOW_CASCADES; i++)\n"
+        "    // NOTE: Everything past the last split falls into the last cascade\n"
+        "    int cascadeNum = cascadeCount - 1;\n"
+        "    for (int i = 0; i < cascadeCount; i++)\n"
         "    {\n"
         "        if (viewSpaceDepth < bounds[i])\n"
         "        {\n"
@@ -311,6 +458,15 @@ const ShaderProgramSource ShaderSources[] =
         "    }\n"
         "    return cascadeNum;\n"
         "}\n"
+        "vec3 GetShadowLightSpacePos(int cascadeIndex, vec3 worldPos)\n"
+        "{\n"
+        "    vec4 lightSpacePos = FrameData.lightSpaceMatrices[cascadeIndex] * vec4(worldPos, 1.0f);\n"
+        "    vec3 result = lightSpacePos.xyz / lightSpacePos.w;\n"
+        "    result = result * 0.5f + 0.5f;\n"
+        "    // NOTE: Cascade far plane could be fitted to the casters, so everything behind it is lit\n"
+        "    result.z = min(result.z, 1.0f);\n"
+        "    return result;\n"
+        "}\n"
         "vec3 ShadowPCF(in sampler2DArrayShadow shadowMap, int cascadeIndex,\n"
         "               vec3 lightSpaceP, float viewSpaceDepth,\n"
         "               float filterSampleScale, int showCascadeBounds)\n"
@@ -381,18 +537,74 @@ const ShaderProgramSource ShaderSources[] =
         "    }\n"
         "    return result;\n"
         "}\n"
-        "vec3 CalcShadow(vec3 viewSpacePos, vec3 cascadeSplits, vec4 lightSpacePos[3], sampler2DArrayShadow shadowMap, float sampleScale, int debugCascadeBounds)\n"
+        "// NOTE: Exponential variance shadow maps\n"
+        "// [ Lauritzen, McCool, Layered Variance Shadow Maps ]\n"
+        "vec2 EVSMWarpDepth(float depth, vec2 exponents)\n"
+        "{\n"
+        "    // NOTE: Depth is remapped to [-1, 1] so both exponents fit into 16 bit float moments\n"
+        "    depth = 2.0f * depth - 1.0f;\n"
+        "    float pos = exp(exponents.x * depth);\n"
+        "    float neg = -exp(-exponents.y * depth);\n"
+        "    return vec2(pos, neg);\n"
+        "}\n"
+        "vec4 EVSMMoments(float depth, vec2 exponents)\n"
+        "{\n"
+        "    vec2 warped = EVSMWarpDepth(depth, exponents);\n"
+        "    return vec4(warped.x, warped.x * warped.x, warped.y, warped.y * warped.y);\n"
+        "}\n"
+        "float ChebyshevUpperBound(vec2 moments, float mean, float minVariance, float lightBleedingReduction)\n"
+        "{\n"
+        "    float variance = max(moments.y - moments.x * moments.x, minVariance);\n"
+        "    float d = mean - moments.x;\n"
+        "    float pMax = variance / (variance + d * d);\n"
+        "    // NOTE: Cutting off the tail of the distribution reduces light bleeding\n"
+        "    pMax = saturate((pMax - lightBleedingReduction) / (1.0f - lightBleedingReduction));\n"
+        "    return mean <= moments.x ? 1.0f : pMax;\n"
+        "}\n"
+        "vec3 ShadowEVSM(in sampler2DArray shadowMoments, int cascadeIndex, vec3 lightSpaceP, int showCascadeBounds)\n"
+        "{\n"
+        "    vec2 exponents = FrameData.evsmExponents;\n"
+        "    vec2 warped = EVSMWarpDepth(lightSpaceP.z, exponents);\n"
+        "    vec4 moments = texture(shadowMoments, vec3(lightSpaceP.xy, float(cascadeIndex)));\n"
+        "    // NOTE: Min variance is scaled with the derivative of the warp function\n"
+        "    vec2 depthScale = 0.0001f * exponents * abs(warped);\n"
+        "    vec2 minVariance = depthScale * depthScale;\n"
+        "    float lightBleedingReduction = FrameData.evsmLightBleedingReduction;\n"
+        "    float pos = ChebyshevUpperBound(moments.xy, warped.x, minVariance.x, lightBleedingReduction);\n"
+        "    float neg = ChebyshevUpperBound(moments.zw, warped.y, minVariance.y, lightBleedingReduction);\n"
+        "    float kShadow = min(pos, neg);\n"
+        "    vec3 result;\n"
+        "    if (showCascadeBounds == 1)\n"
+        "    {\n"
+        "        vec3 cascadeColor = CascadeColors[cascadeIndex];\n"
+        "        result = vec3(kShadow) * cascadeColor;\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        result = vec3(kShadow);\n"
+        "    }\n"
+        "    return result;\n"
+        "}\n"
+        "// NOTE: Light space position is computed per fragment since cascade count is not known at compile time\n"
+        "// and passing every cascade position through varyings costs MAX_SHADOW_CASCADES vec4 per vertex\n"
+        "vec3 CalcShadow(vec3 viewSpacePos, vec3 worldPos, vec4 cascadeSplits, int cascadeCount, sampler2DArrayShadow shadowMap, sampler2DArray shadowMoments, float sampleScale, int debugCascadeBounds)\n"
         "{\n"
         "    float viewSpaceDepth = -viewSpacePos.z;\n"
-        "    int cascadeIndex = GetShadowCascadeIndex(-viewSpacePos.z, cascadeSplits);\n"
-        "    vec3 lightSpaceP = lightSpacePos[cascadeIndex].xyz / lightSpacePos[cascadeIndex].w;\n"
-        "    lightSpaceP = lightSpaceP * 0.5f + 0.5f;\n"
-        "    vec3 kShadow = ShadowPCF(shadowMap, cascadeIndex, lightSpaceP, viewSpaceDepth, sampleScale, debugCascadeBounds);\n"
+        "    int cascadeIndex = GetShadowCascadeIndex(-viewSpacePos.z, cascadeSplits, cascadeCount);\n"
+        "    vec3 lightSpaceP = GetShadowLightSpacePos(cascadeIndex, worldPos);\n"
+        "    vec3 kShadow;\n"
+        "    if (FrameData.shadowFilterMode == SHADOW_FILTER_EVSM)\n"
+        "    {\n"
+        "        kShadow = ShadowEVSM(shadowMoments, cascadeIndex, lightSpaceP, debugCascadeBounds);\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        kShadow = ShadowPCF(shadowMap, cascadeIndex, lightSpaceP, viewSpaceDepth, sampleScale, debugCascadeBounds);\n"
+        "    }\n"
         "    return kShadow;\n"
         "}\n"
         "#line 4\n"
         "layout (location = 3) in vec3 v_ViewPosition;\n"
-        "layout (location = 4) in vec4 v_LightSpacePos[3];\n"
         "layout (location = 7) flat in int v_TileId;\n"
         "layout (location = 8) in vec3 v_Normal;\n"
         "layout (location = 9) in vec2 v_UV;\n"
@@ -411,9 +623,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 lightDirReflected = reflect(-lightDir, normal);\n"
         "    float Kd = max(dot(normal, lightDir), 0.0);\n"
         "    float viewSpaceDepth = -v_ViewPosition.z;\n"
-        "    int cascadeIndex = GetShadowCascadeIndex(-v_ViewPosition.z, FrameData.shadowCascadeSplits);\n"
-        "    vec3 lightSpaceP = v_LightSpacePos[cascadeIndex].xyz / v_LightSpacePos[cascadeIndex].w;\n"
-        "    lightSpaceP = lightSpaceP * 0.5f + 0.5f;\n"
+        "    int cascadeIndex = GetShadowCascadeIndex(-v_ViewPosition.z, FrameData.shadowCascadeSplits, FrameData.shadowCascadeCount);\n"
+        "    vec3 lightSpaceP = GetShadowLightSpacePos(cascadeIndex, v_Position.xyz);\n"
         "#if DUMMY_PCF\n"
         "   vec3 Kshadow = ShadowPCF(u_ShadowMap, cascadeIndex, lightSpaceP, viewSpaceDepth, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries);\n"
         "#endif\n"
@@ -452,6 +663,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -459,10 +672,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -473,23 +690,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -500,8 +710,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -518,24 +737,58 @@ const ShaderProgramSource ShaderSources[] =
         "layout (location = 0) in vec3 Pos;\n"
         "layout (location = 1) in vec3 Normal;\n"
         "layout (location = 2) in vec2 UV;\n"
+        "#if defined(INDIRECT)\n"
+        "#line 100000\n"
+        "// NOTE: Instance data of GPU-driven passes. std430, must match GPUCullInstance in flux_shaders.h\n"
+        "struct CullInstance\n"
+        "{\n"
+        "    uint object;\n"
+        "    uint command;\n"
+        "    uint shadowCommand;\n"
+        "    uint dynamic;\n"
+        "    vec4 boundsMin;\n"
+        "    vec4 boundsMax;\n"
+        "};\n"
+        "// NOTE: Layout of DrawElementsIndirectCommand\n"
+        "struct DrawCommand\n"
+        "{\n"
+        "    uint count;\n"
+        "    uint instanceCount;\n"
+        "    uint firstIndex;\n"
+        "    int baseVertex;\n"
+        "    uint baseInstance;\n"
+        "};\n"
+        "layout (std430, binding = 0) readonly buffer CullInstances\n"
+        "{\n"
+        "    CullInstance Instances[];\n"
+        "};\n"
+        "// NOTE: Render scene objects by slot followed by draws pushed this frame\n"
+        "layout (std430, binding = 6) readonly buffer ObjectMeshData\n"
+        "{\n"
+        "    MeshDataFields Objects[];\n"
+        "};\n"
+        "#line 8\n"
+        "// NOTE: Index of the visible instance. Instanced attribute, fetch is offset by baseInstance of the draw command\n"
+        "layout (location = 5) in uint InstanceIndex;\n"
+        "layout (location = 14) flat out uint ObjectIndex;\n"
+        "#endif\n"
         "layout (location = 3) out VertOut\n"
         "{\n"
         "    vec3 fragPos;\n"
         "    vec3 normal;\n"
         "    vec2 uv;\n"
         "    vec3 viewPosition;\n"
-        "    vec4 lightSpacePos[3];\n"
         "} vertOut;\n"
         "void main()\n"
         "{\n"
+        "#if defined(INDIRECT)\n"
+        "    ObjectIndex = Instances[InstanceIndex].object;\n"
+        "#endif\n"
         "    gl_Position = FrameData.projectionMatrix * FrameData.viewMatrix * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
         "    vertOut.fragPos = (MeshData.modelMatrix * vec4(Pos, 1.0f)).xyz;\n"
         "    vertOut.uv = UV;\n"
         "    vertOut.normal = MeshData.normalMatrix * Normal;\n"
         "    vertOut.viewPosition = (FrameData.viewMatrix * MeshData.modelMatrix * vec4(Pos, 1.0f)).xyz;\n"
-        "    vertOut.lightSpacePos[0] = FrameData.lightSpaceMatrices[0] * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
-        "    vertOut.lightSpacePos[1] = FrameData.lightSpaceMatrices[1] * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
-        "    vertOut.lightSpacePos[2] = FrameData.lightSpaceMatrices[2] * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
         "}\n"
 ,
         "#version 450\n"
@@ -550,6 +803,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -557,10 +812,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -571,23 +830,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -598,8 +850,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -614,7 +875,9 @@ const ShaderProgramSource ShaderSources[] =
         "}\n"
         "#line 2\n"
         "#line 100000\n"
-        "#define NUM_SHADOW_CASCADES 3\n"
+        "// NOTE: Must match ShadowFilter in flux_shaders.h\n"
+        "#define SHADOW_FILTER_PCF 0\n"
+        "#define SHADOW_FILTER_EVSM 1\n"
         "// NOTE: Reference: https://github.com/TheRealMJP/Shadows/blob/master/Shadows/PCFKernels.hlsl\n"
         "const vec2 PoissonSamples[64] = vec2[64]\n"
         "(\n"
@@ -683,16 +946,18 @@ const ShaderProgramSource ShaderSources[] =
         "    vec2(-0.4241052f, 0.5581087f),\n"
         "    vec2(-0.1020106f, 0.6724468f)\n"
         ");\n"
-        "vec3 CascadeColors[NUM_SHADOW_CASCADES] = vec3[NUM_SHADOW_CASCADES]\n"
+        "vec3 CascadeColors[MAX_SHADOW_CASCADES] = vec3[MAX_SHADOW_CASCADES]\n"
         "(\n"
         "    vec3(1.0f, 0.0f, 0.0f),\n"
         "    vec3(0.0f, 1.0f, 0.0f),\n"
-        "    vec3(0.0f, 0.0f, 1.0f)\n"
+        "    vec3(0.0f, 0.0f, 1.0f),\n"
+        "    vec3(1.0f, 1.0f, 0.0f)\n"
         ");\n"
-        "int GetShadowCascadeIndex(float viewSpaceDepth, vec3 bounds)\n"
+        "int GetShadowCascadeIndex(float viewSpaceDepth, vec4 bounds, int cascadeCount)\n"
         "{\n"
-        "    int cascadeNum = 0;\n"
-        "    for (int i = 0; i < NUM_SHADOW_CASCADES; i++)\n"
+        "    // NOTE: Everything past the last split falls into the last cascade\n"
+        "    int cascadeNum = cascadeCount - 1;\n"
+        "    for (int i = 0; i < cascadeCount; i++)\n"
         "    {\n"
         "        if (viewSpaceDepth < bounds[i])\n"
         "        {\n"
@@ -702,6 +967,15 @@ const ShaderProgramSource ShaderSources[] =
         "    }\n"
         "    return cascadeNum;\n"
         "}\n"
+        "vec3 GetShadowLightSpacePos(int cascadeIndex, vec3 worldPos)\n"
+        "{\n"
+        "    vec4 lightSpacePos = FrameData.lightSpaceMatrices[cascadeIndex] * vec4(worldPos, 1.0f);\n"
+        "    vec3 result = lightSpacePos.xyz / lightSpacePos.w;\n"
+        "    result = result * 0.5f + 0.5f;\n"
+        "    // NOTE: Cascade far plane could be fitted to the casters, so everything behind it is lit\n"
+        "    result.z = min(result.z, 1.0f);\n"
+        "    return result;\n"
+        "}\n"
         "vec3 ShadowPCF(in sampler2DArrayShadow shadowMap, int cascadeIndex,\n"
         "               vec3 lightSpaceP, float viewSpaceDepth,\n"
         "               float filterSampleScale, int showCascadeBounds)\n"
@@ -772,13 +1046,70 @@ const ShaderProgramSource ShaderSources[] =
         "    }\n"
         "    return result;\n"
         "}\n"
-        "vec3 CalcShadow(vec3 viewSpacePos, vec3 cascadeSplits, vec4 lightSpacePos[3], sampler2DArrayShadow shadowMap, float sampleScale, int debugCascadeBounds)\n"
+        "// NOTE: Exponential variance shadow maps\n"
+        "// [ Lauritzen, McCool, Layered Variance Shadow Maps ]\n"
+        "vec2 EVSMWarpDepth(float depth, vec2 exponents)\n"
+        "{\n"
+        "    // NOTE: Depth is remapped to [-1, 1] so both exponents fit into 16 bit float moments\n"
+        "    depth = 2.0f * depth - 1.0f;\n"
+        "    float pos = exp(exponents.x * depth);\n"
+        "    float neg = -exp(-exponents.y * depth);\n"
+        "    return vec2(pos, neg);\n"
+        "}\n"
+        "vec4 EVSMMoments(float depth, vec2 exponents)\n"
+        "{\n"
+        "    vec2 warped = EVSMWarpDepth(depth, exponents);\n"
+        "    return vec4(warped.x, warped.x * warped.x, warped.y, warped.y * warped.y);\n"
+        "}\n"
+        "float ChebyshevUpperBound(vec2 moments, float mean, float minVariance, float lightBleedingReduction)\n"
+        "{\n"
+        "    float variance = max(moments.y - moments.x * moments.x, minVariance);\n"
+        "    float d = mean - moments.x;\n"
+        "    float pMax = variance / (variance + d * d);\n"
+        "    // NOTE: Cutting off the tail of the distribution reduces light bleeding\n"
+        "    pMax = saturate((pMax - lightBleedingReduction) / (1.0f - lightBleedingReduction));\n"
+        "    return mean <= moments.x ? 1.0f : pMax;\n"
+        "}\n"
+        "vec3 ShadowEVSM(in sampler2DArray shadowMoments, int cascadeIndex, vec3 lightSpaceP, int showCascadeBounds)\n"
+        "{\n"
+        "    vec2 exponents = FrameData.evsmExponents;\n"
+        "    vec2 warped = EVSMWarpDepth(lightSpaceP.z, exponents);\n"
+        "    vec4 moments = texture(shadowMoments, vec3(lightSpaceP.xy, float(cascadeIndex)));\n"
+        "    // NOTE: Min variance is scaled with the derivative of the warp function\n"
+        "    vec2 depthScale = 0.0001f * exponents * abs(warped);\n"
+        "    vec2 minVariance = depthScale * depthScale;\n"
+        "    float lightBleedingReduction = FrameData.evsmLightBleedingReduction;\n"
+        "    float pos = ChebyshevUpperBound(moments.xy, warped.x, minVariance.x, lightBleedingReduction);\n"
+        "    float neg = ChebyshevUpperBound(moments.zw, warped.y, minVariance.y, lightBleedingReduction);\n"
+        "    float kShadow = min(pos, neg);\n"
+        "    vec3 result;\n"
+        "    if (showCascadeBounds == 1)\n"
+        "    {\n"
+        "        vec3 cascadeColor = CascadeColors[cascadeIndex];\n"
+        "        result = vec3(kShadow) * cascadeColor;\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        result = vec3(kShadow);\n"
+        "    }\n"
+        "    return result;\n"
+        "}\n"
+        "// NOTE: Light space position is computed per fragment since cascade count is not known at compile time\n"
+        "// and passing every cascade position through varyings costs MAX_SHADOW_CASCADES vec4 per vertex\n"
+        "vec3 CalcShadow(vec3 viewSpacePos, vec3 worldPos, vec4 cascadeSplits, int cascadeCount, sampler2DArrayShadow shadowMap, sampler2DArray shadowMoments, float sampleScale, int debugCascadeBounds)\n"
         "{\n"
         "    float viewSpaceDepth = -viewSpacePos.z;\n"
-        "    int cascadeIndex = GetShadowCascadeIndex(-viewSpacePos.z, cascadeSplits);\n"
-        "    vec3 lightSpaceP = lightSpacePos[cascadeIndex].xyz / lightSpacePos[cascadeIndex].w;\n"
-        "    lightSpaceP = lightSpaceP * 0.5f + 0.5f;\n"
-        "    vec3 kShadow = ShadowPCF(shadowMap, cascadeIndex, lightSpaceP, viewSpaceDepth, sampleScale, debugCascadeBounds);\n"
+        "    int cascadeIndex = GetShadowCascadeIndex(-viewSpacePos.z, cascadeSplits, cascadeCount);\n"
+        "    vec3 lightSpaceP = GetShadowLightSpacePos(cascadeIndex, worldPos);\n"
+        "    vec3 kShadow;\n"
+        "    if (FrameData.shadowFilterMode == SHADOW_FILTER_EVSM)\n"
+        "    {\n"
+        "        kShadow = ShadowEVSM(shadowMoments, cascadeIndex, lightSpaceP, debugCascadeBounds);\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        kShadow = ShadowPCF(shadowMap, cascadeIndex, lightSpaceP, viewSpaceDepth, sampleScale, debugCascadeBounds);\n"
+        "    }\n"
         "    return kShadow;\n"
         "}\n"
         "#line 3\n"
@@ -789,16 +1120,58 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 normal;\n"
         "    vec2 uv;\n"
         "    vec3 viewPosition;\n"
-        "    vec4 lightSpacePos[3];\n"
         "} fragIn;\n"
         "layout (binding = 0) uniform sampler2D DiffMap;\n"
         "layout (binding = 1) uniform sampler2D SpecMap;\n"
         "layout (binding = 2) uniform sampler2DArrayShadow ShadowMap;\n"
+        "layout (binding = 3) uniform sampler2DArray ShadowMoments;\n"
+        "#if defined(INDIRECT)\n"
+        "#line 100000\n"
+        "// NOTE: Instance data of GPU-driven passes. std430, must match GPUCullInstance in flux_shaders.h\n"
+        "struct CullInstance\n"
+        "{\n"
+        "    uint object;\n"
+        "    uint command;\n"
+        "    uint shadowCommand;\n"
+        "    uint dynamic;\n"
+        "    vec4 boundsMin;\n"
+        "    vec4 boundsMax;\n"
+        "};\n"
+        "// NOTE: Layout of DrawElementsIndirectCommand\n"
+        "struct DrawCommand\n"
+        "{\n"
+        "    uint count;\n"
+        "    uint instanceCount;\n"
+        "    uint firstIndex;\n"
+        "    int baseVertex;\n"
+        "    uint baseInstance;\n"
+        "};\n"
+        "layout (std430, binding = 0) readonly buffer CullInstances\n"
+        "{\n"
+        "    CullInstance Instances[];\n"
+        "};\n"
+        "// NOTE: Render scene objects by slot followed by draws pushed this frame\n"
+        "layout (std430, binding = 6) readonly buffer ObjectMeshData\n"
+        "{\n"
+        "    MeshDataFields Objects[];\n"
+        "};\n"
+        "#line 21\n"
+        "layout (location = 14) flat in uint ObjectIndex;\n"
+        "#endif\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: Maps bound for the batch. Material of the object may use a map which is still loading\n"
+        "layout (location = 0) uniform uint MapMask;\n"
+        "#define DIFFUSE_MAP_BOUND ((MapMask & 1u) != 0u)\n"
+        "#define SPECULAR_MAP_BOUND ((MapMask & 2u) != 0u)\n"
+        "#else\n"
+        "#define DIFFUSE_MAP_BOUND true\n"
+        "#define SPECULAR_MAP_BOUND true\n"
+        "#endif\n"
         "void main()\n"
         "{\n"
         "    vec3 normal = normalize(fragIn.normal);\n"
         "    vec4 diffSample;\n"
-        "    if (MeshData.phongUseDiffuseMap == 1)\n"
+        "    if (MeshData.phongUseDiffuseMap == 1 && DIFFUSE_MAP_BOUND)\n"
         "    {\n"
         "        diffSample = texture(DiffMap, fragIn.uv);\n"
         "    }\n"
@@ -807,7 +1180,7 @@ const ShaderProgramSource ShaderSources[] =
         "        diffSample = vec4(MeshData.customPhongDiffuse, 1.0f);\n"
         "    }\n"
         "    vec4 specSample;\n"
-        "    if (MeshData.phongUseSpecularMap == 1)\n"
+        "    if (MeshData.phongUseSpecularMap == 1 && SPECULAR_MAP_BOUND)\n"
         "    {\n"
         "        specSample = texture(SpecMap, fragIn.uv);\n"
         "    }\n"
@@ -821,7 +1194,7 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 viewDir = normalize(FrameData.viewPos - fragIn.fragPos);\n"
         "    vec3 rFromLight = reflect(-lightDir, normal);\n"
         "    float kSpec = pow(max(dot(viewDir, rFromLight), 0.0f), 32.0f);\n"
-        "    vec4 kShadow = vec4(CalcShadow(fragIn.viewPosition, FrameData.shadowCascadeSplits, fragIn.lightSpacePos, ShadowMap, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries), 1.0f);\n"
+        "    vec4 kShadow = vec4(CalcShadow(fragIn.viewPosition, fragIn.fragPos, FrameData.shadowCascadeSplits, FrameData.shadowCascadeCount, ShadowMap, ShadowMoments, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries), 1.0f);\n"
         "    vec4 ambient = diffSample * vec4(FrameData.dirLight.ambient, 1.0f);\n"
         "    vec4 diffuse = diffSample * kDiff * vec4(FrameData.dirLight.diffuse, 1.0f) * kShadow;\n"
         "    vec4 specular = specSample * kSpec * vec4(FrameData.dirLight.specular, 1.0f) * kShadow;\n"
@@ -841,6 +1214,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -848,10 +1223,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -862,23 +1241,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -889,8 +1261,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -907,24 +1288,58 @@ const ShaderProgramSource ShaderSources[] =
         "layout (location = 0) in vec3 Pos;\n"
         "layout (location = 1) in vec3 Normal;\n"
         "layout (location = 2) in vec2 UV;\n"
+        "#if defined(INDIRECT)\n"
+        "#line 100000\n"
+        "// NOTE: Instance data of GPU-driven passes. std430, must match GPUCullInstance in flux_shaders.h\n"
+        "struct CullInstance\n"
+        "{\n"
+        "    uint object;\n"
+        "    uint command;\n"
+        "    uint shadowCommand;\n"
+        "    uint dynamic;\n"
+        "    vec4 boundsMin;\n"
+        "    vec4 boundsMax;\n"
+        "};\n"
+        "// NOTE: Layout of DrawElementsIndirectCommand\n"
+        "struct DrawCommand\n"
+        "{\n"
+        "    uint count;\n"
+        "    uint instanceCount;\n"
+        "    uint firstIndex;\n"
+        "    int baseVertex;\n"
+        "    uint baseInstance;\n"
+        "};\n"
+        "layout (std430, binding = 0) readonly buffer CullInstances\n"
+        "{\n"
+        "    CullInstance Instances[];\n"
+        "};\n"
+        "// NOTE: Render scene objects by slot followed by draws pushed this frame\n"
+        "layout (std430, binding = 6) readonly buffer ObjectMeshData\n"
+        "{\n"
+        "    MeshDataFields Objects[];\n"
+        "};\n"
+        "#line 8\n"
+        "// NOTE: Index of the visible instance. Instanced attribute, fetch is offset by baseInstance of the draw command\n"
+        "layout (location = 5) in uint InstanceIndex;\n"
+        "layout (location = 14) flat out uint ObjectIndex;\n"
+        "#endif\n"
         "layout (location = 3) out VertOut\n"
         "{\n"
         "    vec3 fragPos;\n"
         "    vec3 normal;\n"
         "    vec2 uv;\n"
         "    vec3 viewPosition;\n"
-        "    vec4 lightSpacePos[3];\n"
         "} vertOut;\n"
         "void main()\n"
         "{\n"
+        "#if defined(INDIRECT)\n"
+        "    ObjectIndex = Instances[InstanceIndex].object;\n"
+        "#endif\n"
         "    gl_Position = FrameData.projectionMatrix * FrameData.viewMatrix * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
         "    vertOut.fragPos = (MeshData.modelMatrix * vec4(Pos, 1.0f)).xyz;\n"
         "    vertOut.uv = UV;\n"
         "    vertOut.normal = MeshData.normalMatrix * Normal;\n"
         "    vertOut.viewPosition = (FrameData.viewMatrix * MeshData.modelMatrix * vec4(Pos, 1.0f)).xyz;\n"
-        "    vertOut.lightSpacePos[0] = FrameData.lightSpaceMatrices[0] * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
-        "    vertOut.lightSpacePos[1] = FrameData.lightSpaceMatrices[1] * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
-        "    vertOut.lightSpacePos[2] = FrameData.lightSpaceMatrices[2] * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
         "}\n"
 ,
         "#version 450\n"
@@ -939,6 +1354,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -946,10 +1363,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -960,23 +1381,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -987,8 +1401,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -1003,7 +1426,9 @@ const ShaderProgramSource ShaderSources[] =
         "}\n"
         "#line 2\n"
         "#line 100000\n"
-        "#define NUM_SHADOW_CASCADES 3\n"
+        "// NOTE: Must match ShadowFilter in flux_shaders.h\n"
+        "#define SHADOW_FILTER_PCF 0\n"
+        "#define SHADOW_FILTER_EVSM 1\n"
         "// NOTE: Reference: https://github.com/TheRealMJP/Shadows/blob/master/Shadows/PCFKernels.hlsl\n"
         "const vec2 PoissonSamples[64] = vec2[64]\n"
         "(\n"
@@ -1072,16 +1497,18 @@ const ShaderProgramSource ShaderSources[] =
         "    vec2(-0.4241052f, 0.5581087f),\n"
         "    vec2(-0.1020106f, 0.6724468f)\n"
         ");\n"
-        "vec3 CascadeColors[NUM_SHADOW_CASCADES] = vec3[NUM_SHADOW_CASCADES]\n"
+        "vec3 CascadeColors[MAX_SHADOW_CASCADES] = vec3[MAX_SHADOW_CASCADES]\n"
         "(\n"
         "    vec3(1.0f, 0.0f, 0.0f),\n"
         "    vec3(0.0f, 1.0f, 0.0f),\n"
-        "    vec3(0.0f, 0.0f, 1.0f)\n"
+        "    vec3(0.0f, 0.0f, 1.0f),\n"
+        "    vec3(1.0f, 1.0f, 0.0f)\n"
         ");\n"
-        "int GetShadowCascadeIndex(float viewSpaceDepth, vec3 bounds)\n"
+        "int GetShadowCascadeIndex(float viewSpaceDepth, vec4 bounds, int cascadeCount)\n"
         "{\n"
-        "    int cascadeNum = 0;\n"
-        "    for (int i = 0; i < NUM_SHADOW_CASCADES; i++)\n"
+        "    // NOTE: Everything past the last split falls into the last cascade\n"
+        "    int cascadeNum = cascadeCount - 1;\n"
+        "    for (int i = 0; i < cascadeCount; i++)\n"
         "    {\n"
         "        if (viewSpaceDepth < bounds[i])\n"
         "        {\n"
@@ -1091,6 +1518,15 @@ const ShaderProgramSource ShaderSources[] =
         "    }\n"
         "    return cascadeNum;\n"
         "}\n"
+        "vec3 GetShadowLightSpacePos(int cascadeIndex, vec3 worldPos)\n"
+        "{\n"
+        "    vec4 lightSpacePos = FrameData.lightSpaceMatrices[cascadeIndex] * vec4(worldPos, 1.0f);\n"
+        "    vec3 result = lightSpacePos.xyz / lightSpacePos.w;\n"
+        "    result = result * 0.5f + 0.5f;\n"
+        "    // NOTE: Cascade far plane could be fitted to the casters, so everything behind it is lit\n"
+        "    result.z = min(result.z, 1.0f);\n"
+        "    return result;\n"
+        "}\n"
         "vec3 ShadowPCF(in sampler2DArrayShadow shadowMap, int cascadeIndex,\n"
         "               vec3 lightSpaceP, float viewSpaceDepth,\n"
         "               float filterSampleScale, int showCascadeBounds)\n"
@@ -1161,13 +1597,70 @@ const ShaderProgramSource ShaderSources[] =
         "    }\n"
         "    return result;\n"
         "}\n"
-        "vec3 CalcShadow(vec3 viewSpacePos, vec3 cascadeSplits, vec4 lightSpacePos[3], sampler2DArrayShadow shadowMap, float sampleScale, int debugCascadeBounds)\n"
+        "// NOTE: Exponential variance shadow maps\n"
+        "// [ Lauritzen, McCool, Layered Variance Shadow Maps ]\n"
+        "vec2 EVSMWarpDepth(float depth, vec2 exponents)\n"
+        "{\n"
+        "    // NOTE: Depth is remapped to [-1, 1] so both exponents fit into 16 bit float moments\n"
+        "    depth = 2.0f * depth - 1.0f;\n"
+        "    float pos = exp(exponents.x * depth);\n"
+        "    float neg = -exp(-exponents.y * depth);\n"
+        "    return vec2(pos, neg);\n"
+        "}\n"
+        "vec4 EVSMMoments(float depth, vec2 exponents)\n"
+        "{\n"
+        "    vec2 warped = EVSMWarpDepth(depth, exponents);\n"
+        "    return vec4(warped.x, warped.x * warped.x, warped.y, warped.y * warped.y);\n"
+        "}\n"
+        "float ChebyshevUpperBound(vec2 moments, float mean, float minVariance, float lightBleedingReduction)\n"
+        "{\n"
+        "    float variance = max(moments.y - moments.x * moments.x, minVariance);\n"
+        "    float d = mean - moments.x;\n"
+        "    float pMax = variance / (variance + d * d);\n"
+        "    // NOTE: Cutting off the tail of the distribution reduces light bleeding\n"
+        "    pMax = saturate((pMax - lightBleedingReduction) / (1.0f - lightBleedingReduction));\n"
+        "    return mean <= moments.x ? 1.0f : pMax;\n"
+        "}\n"
+        "vec3 ShadowEVSM(in sampler2DArray shadowMoments, int cascadeIndex, vec3 lightSpaceP, int showCascadeBounds)\n"
+        "{\n"
+        "    vec2 exponents = FrameData.evsmExponents;\n"
+        "    vec2 warped = EVSMWarpDepth(lightSpaceP.z, exponents);\n"
+        "    vec4 moments = texture(shadowMoments, vec3(lightSpaceP.xy, float(cascadeIndex)));\n"
+        "    // NOTE: Min variance is scaled with the derivative of the warp function\n"
+        "    vec2 depthScale = 0.0001f * exponents * abs(warped);\n"
+        "    vec2 minVariance = depthScale * depthScale;\n"
+        "    float lightBleedingReduction = FrameData.evsmLightBleedingReduction;\n"
+        "    float pos = ChebyshevUpperBound(moments.xy, warped.x, minVariance.x, lightBleedingReduction);\n"
+        "    float neg = ChebyshevUpperBound(moments.zw, warped.y, minVariance.y, lightBleedingReduction);\n"
+        "    float kShadow = min(pos, neg);\n"
+        "    vec3 result;\n"
+        "    if (showCascadeBounds == 1)\n"
+        "    {\n"
+        "        vec3 cascadeColor = CascadeColors[cascadeIndex];\n"
+        "        result = vec3(kShadow) * cascadeColor;\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        result = vec3(kShadow);\n"
+        "    }\n"
+        "    return result;\n"
+        "}\n"
+        "// NOTE: Light space position is computed per fragment since cascade count is not known at compile time\n"
+        "// and passing every cascade position through varyings costs MAX_SHADOW_CASCADES vec4 per vertex\n"
+        "vec3 CalcShadow(vec3 viewSpacePos, vec3 worldPos, vec4 cascadeSplits, int cascadeCount, sampler2DArrayShadow shadowMap, sampler2DArray shadowMoments, float sampleScale, int debugCascadeBounds)\n"
         "{\n"
         "    float viewSpaceDepth = -viewSpacePos.z;\n"
-        "    int cascadeIndex = GetShadowCascadeIndex(-viewSpacePos.z, cascadeSplits);\n"
-        "    vec3 lightSpaceP = lightSpacePos[cascadeIndex].xyz / lightSpacePos[cascadeIndex].w;\n"
-        "    lightSpaceP = lightSpaceP * 0.5f + 0.5f;\n"
-        "    vec3 kShadow = ShadowPCF(shadowMap, cascadeIndex, lightSpaceP, viewSpaceDepth, sampleScale, debugCascadeBounds);\n"
+        "    int cascadeIndex = GetShadowCascadeIndex(-viewSpacePos.z, cascadeSplits, cascadeCount);\n"
+        "    vec3 lightSpaceP = GetShadowLightSpacePos(cascadeIndex, worldPos);\n"
+        "    vec3 kShadow;\n"
+        "    if (FrameData.shadowFilterMode == SHADOW_FILTER_EVSM)\n"
+        "    {\n"
+        "        kShadow = ShadowEVSM(shadowMoments, cascadeIndex, lightSpaceP, debugCascadeBounds);\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        kShadow = ShadowPCF(shadowMap, cascadeIndex, lightSpaceP, viewSpaceDepth, sampleScale, debugCascadeBounds);\n"
+        "    }\n"
         "    return kShadow;\n"
         "}\n"
         "#line 3\n"
@@ -1178,9 +1671,9 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 normal;\n"
         "    vec2 uv;\n"
         "    vec3 viewPosition;\n"
-        "    vec4 lightSpacePos[3];\n"
         "} fragIn;\n"
         "layout (binding = 0) uniform sampler2DArrayShadow ShadowMap;\n"
+        "layout (binding = 1) uniform sampler2DArray ShadowMoments;\n"
         "void main()\n"
         "{\n"
         "    vec3 normal = normalize(fragIn.normal);\n"
@@ -1191,7 +1684,7 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 viewDir = normalize(FrameData.viewPos - fragIn.fragPos);\n"
         "    vec3 rFromLight = reflect(-lightDir, normal);\n"
         "    float kSpec = pow(max(dot(viewDir, rFromLight), 0.0f), 32.0f);\n"
-        "    vec4 kShadow = vec4(CalcShadow(fragIn.viewPosition, FrameData.shadowCascadeSplits, fragIn.lightSpacePos, ShadowMap, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries), 1.0f);\n"
+        "    vec4 kShadow = vec4(CalcShadow(fragIn.viewPosition, fragIn.fragPos, FrameData.shadowCascadeSplits, FrameData.shadowCascadeCount, ShadowMap, ShadowMoments, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries), 1.0f);\n"
         "    vec4 ambient = diffSamle * vec4(FrameData.dirLight.ambient, 1.0f);\n"
         "    vec4 diffuse = diffSamle * kDiff * vec4(FrameData.dirLight.diffuse, 1.0f) * kShadow;\n"
         "    vec4 specular = specSample * kSpec * vec4(FrameData.dirLight.specular, 1.0f) * kShadow;\n"
@@ -1211,6 +1704,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -1218,10 +1713,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -1232,23 +1731,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -1259,8 +1751,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -1275,11 +1776,12 @@ const ShaderProgramSource ShaderSources[] =
         "}\n"
         "#line 2\n"
         "layout (location = 0) in vec3 Pos;\n"
+        "layout (location = 1) in vec4 VertexColor;\n"
         "layout (location = 1) out vec3 Color;\n"
         "void main()\n"
         "{\n"
         "    gl_Position = FrameData.viewProjMatrix * vec4(Pos, 1.0f);\n"
-        "    Color = MeshData.lineColor;\n"
+        "    Color = VertexColor.rgb;\n"
         "}\n"
 ,
         "#version 450\n"
@@ -1303,6 +1805,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -1310,10 +1814,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -1324,23 +1832,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -1351,8 +1852,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -1371,6 +1881,41 @@ const ShaderProgramSource ShaderSources[] =
         "layout (location = 2) in vec2 UV;\n"
         "layout (location = 3) in vec3 Tangent;\n"
         "layout (location = 4) in vec3 Bitangent;\n"
+        "#if defined(INDIRECT)\n"
+        "#line 100000\n"
+        "// NOTE: Instance data of GPU-driven passes. std430, must match GPUCullInstance in flux_shaders.h\n"
+        "struct CullInstance\n"
+        "{\n"
+        "    uint object;\n"
+        "    uint command;\n"
+        "    uint shadowCommand;\n"
+        "    uint dynamic;\n"
+        "    vec4 boundsMin;\n"
+        "    vec4 boundsMax;\n"
+        "};\n"
+        "// NOTE: Layout of DrawElementsIndirectCommand\n"
+        "struct DrawCommand\n"
+        "{\n"
+        "    uint count;\n"
+        "    uint instanceCount;\n"
+        "    uint firstIndex;\n"
+        "    int baseVertex;\n"
+        "    uint baseInstance;\n"
+        "};\n"
+        "layout (std430, binding = 0) readonly buffer CullInstances\n"
+        "{\n"
+        "    CullInstance Instances[];\n"
+        "};\n"
+        "// NOTE: Render scene objects by slot followed by draws pushed this frame\n"
+        "layout (std430, binding = 6) readonly buffer ObjectMeshData\n"
+        "{\n"
+        "    MeshDataFields Objects[];\n"
+        "};\n"
+        "#line 10\n"
+        "// NOTE: Index of the visible instance. Instanced attribute, fetch is offset by baseInstance of the draw command\n"
+        "layout (location = 5) in uint InstanceIndex;\n"
+        "layout (location = 14) flat out uint ObjectIndex;\n"
+        "#endif\n"
         "layout (location = 5) out VertOut\n"
         "{\n"
         "    vec3 fragPos;\n"
@@ -1378,22 +1923,20 @@ const ShaderProgramSource ShaderSources[] =
         "    vec2 uv;\n"
         "    mat3 tbn;\n"
         "    vec3 viewPosition;\n"
-        "    vec4 lightSpacePos[3];\n"
         "} vertOut;\n"
         "void main()\n"
         "{\n"
+        "#if defined(INDIRECT)\n"
+        "    ObjectIndex = Instances[InstanceIndex].object;\n"
+        "#endif\n"
         "    vec3 n = normalize(MeshData.normalMatrix * Normal);\n"
         "    vec3 t = normalize(MeshData.normalMatrix * Tangent);\n"
         "    t = normalize(t - dot(t, n) * n);\n"
-        "    vec3 b;\n"
-        "    if (MeshData.hasBitangents == 1)\n"
-        "    {\n"
-        "        b = normalize(MeshData.normalMatrix * Bitangent);\n"
-        "    }\n"
-        "    else\n"
-        "    {\n"
-        "        b = normalize(cross(n, t));\n"
-        "    }\n"
+        "#if defined(HAS_BITANGENTS)\n"
+        "    vec3 b = normalize(MeshData.normalMatrix * Bitangent);\n"
+        "#else\n"
+        "    vec3 b = normalize(cross(n, t));\n"
+        "#endif\n"
         "    mat3 tbn = mat3(t, b, n);\n"
         "    gl_Position = FrameData.viewProjMatrix * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
         "    vertOut.fragPos = (MeshData.modelMatrix * vec4(Pos, 1.0f)).xyz;\n"
@@ -1401,9 +1944,6 @@ const ShaderProgramSource ShaderSources[] =
         "    vertOut.normal = n;\n"
         "    vertOut.tbn = tbn;\n"
         "    vertOut.viewPosition = (FrameData.viewMatrix * MeshData.modelMatrix * vec4(Pos, 1.0f)).xyz;\n"
-        "    vertOut.lightSpacePos[0] = FrameData.lightSpaceMatrices[0] * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
-        "    vertOut.lightSpacePos[1] = FrameData.lightSpaceMatrices[1] * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
-        "    vertOut.lightSpacePos[2] = FrameData.lightSpaceMatrices[2] * MeshData.modelMatrix * vec4(Pos, 1.0f);\n"
         "}\n"
 ,
         "#version 450\n"
@@ -1418,6 +1958,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -1425,10 +1967,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -1439,23 +1985,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -1466,8 +2005,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -1595,7 +2143,21 @@ const ShaderProgramSource ShaderSources[] =
         "{\n"
         "    return F0 + (max(vec3(1.0f - roughness), F0) - F0) * pow(1.0f - cosTheta, 5.0f);\n"
         "}\n"
-        "vec3 Unreal4EnviromentLight(PBR pbr, samplerCube irradanceMap, samplerCube enviromentMap, sampler2D brdfLut)\n"
+        "// NOTE: Coefficients are premultiplied by clamped cosine lobe and divided by Pi on CPU\n"
+        "vec3 IrradianceSH9(vec3 n)\n"
+        "{\n"
+        "    vec3 result = FrameData.irradianceSH[0].rgb * 0.282095f;\n"
+        "    result += FrameData.irradianceSH[1].rgb * 0.488603f * n.y;\n"
+        "    result += FrameData.irradianceSH[2].rgb * 0.488603f * n.z;\n"
+        "    result += FrameData.irradianceSH[3].rgb * 0.488603f * n.x;\n"
+        "    result += FrameData.irradianceSH[4].rgb * 1.092548f * n.x * n.y;\n"
+        "    result += FrameData.irradianceSH[5].rgb * 1.092548f * n.y * n.z;\n"
+        "    result += FrameData.irradianceSH[6].rgb * 0.315392f * (3.0f * n.z * n.z - 1.0f);\n"
+        "    result += FrameData.irradianceSH[7].rgb * 1.092548f * n.x * n.z;\n"
+        "    result += FrameData.irradianceSH[8].rgb * 0.546274f * (n.x * n.x - n.y * n.y);\n"
+        "    return max(result, vec3(0.0f));\n"
+        "}\n"
+        "vec3 Unreal4EnviromentLight(PBR pbr, samplerCube enviromentMap, sampler2D brdfLut)\n"
         "{\n"
         "    float roughness;\n"
         "    if (pbr.metallicWorkflow)\n"
@@ -1619,7 +2181,7 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 kS = Fenv;\n"
         "    vec3 kD = vec3(1.0f) - kS;\n"
         "    kD *= 1.0f - pbr.metallic;\n"
-        "    vec3 diffIrradance = texture(irradanceMap, pbr.N).rgb;\n"
+        "    vec3 diffIrradance = IrradianceSH9(pbr.N);\n"
         "    vec3 diffuse = diffIrradance * pbr.albedo;\n"
         "    vec3 irradance = (kD * diffuse + envSpecular) * pbr.AO;\n"
         "    return irradance;\n"
@@ -1653,7 +2215,9 @@ const ShaderProgramSource ShaderSources[] =
         "}\n"
         "#line 4\n"
         "#line 100000\n"
-        "#define NUM_SHADOW_CASCADES 3\n"
+        "// NOTE: Must match ShadowFilter in flux_shaders.h\n"
+        "#define SHADOW_FILTER_PCF 0\n"
+        "#define SHADOW_FILTER_EVSM 1\n"
         "// NOTE: Reference: https://github.com/TheRealMJP/Shadows/blob/master/Shadows/PCFKernels.hlsl\n"
         "const vec2 PoissonSamples[64] = vec2[64]\n"
         "(\n"
@@ -1722,16 +2286,18 @@ const ShaderProgramSource ShaderSources[] =
         "    vec2(-0.4241052f, 0.5581087f),\n"
         "    vec2(-0.1020106f, 0.6724468f)\n"
         ");\n"
-        "vec3 CascadeColors[NUM_SHADOW_CASCADES] = vec3[NUM_SHADOW_CASCADES]\n"
+        "vec3 CascadeColors[MAX_SHADOW_CASCADES] = vec3[MAX_SHADOW_CASCADES]\n"
         "(\n"
         "    vec3(1.0f, 0.0f, 0.0f),\n"
         "    vec3(0.0f, 1.0f, 0.0f),\n"
-        "    vec3(0.0f, 0.0f, 1.0f)\n"
+        "    vec3(0.0f, 0.0f, 1.0f),\n"
+        "    vec3(1.0f, 1.0f, 0.0f)\n"
         ");\n"
-        "int GetShadowCascadeIndex(float viewSpaceDepth, vec3 bounds)\n"
+        "int GetShadowCascadeIndex(float viewSpaceDepth, vec4 bounds, int cascadeCount)\n"
         "{\n"
-        "    int cascadeNum = 0;\n"
-        "    for (int i = 0; i < NUM_SHADOW_CASCADES; i++)\n"
+        "    // NOTE: Everything past the last split falls into the last cascade\n"
+        "    int cascadeNum = cascadeCount - 1;\n"
+        "    for (int i = 0; i < cascadeCount; i++)\n"
         "    {\n"
         "        if (viewSpaceDepth < bounds[i])\n"
         "        {\n"
@@ -1741,6 +2307,15 @@ const ShaderProgramSource ShaderSources[] =
         "    }\n"
         "    return cascadeNum;\n"
         "}\n"
+        "vec3 GetShadowLightSpacePos(int cascadeIndex, vec3 worldPos)\n"
+        "{\n"
+        "    vec4 lightSpacePos = FrameData.lightSpaceMatrices[cascadeIndex] * vec4(worldPos, 1.0f);\n"
+        "    vec3 result = lightSpacePos.xyz / lightSpacePos.w;\n"
+        "    result = result * 0.5f + 0.5f;\n"
+        "    // NOTE: Cascade far plane could be fitted to the casters, so everything behind it is lit\n"
+        "    result.z = min(result.z, 1.0f);\n"
+        "    return result;\n"
+        "}\n"
         "vec3 ShadowPCF(in sampler2DArrayShadow shadowMap, int cascadeIndex,\n"
         "               vec3 lightSpaceP, float viewSpaceDepth,\n"
         "               float filterSampleScale, int showCascadeBounds)\n"
@@ -1811,16 +2386,133 @@ const ShaderProgramSource ShaderSources[] =
         "    }\n"
         "    return result;\n"
         "}\n"
-        "vec3 CalcShadow(vec3 viewSpacePos, vec3 cascadeSplits, vec4 lightSpacePos[3], sampler2DArrayShadow shadowMap, float sampleScale, int debugCascadeBounds)\n"
+        "// NOTE: Exponential variance shadow maps\n"
+        "// [ Lauritzen, McCool, Layered Variance Shadow Maps ]\n"
+        "vec2 EVSMWarpDepth(float depth, vec2 exponents)\n"
+        "{\n"
+        "    // NOTE: Depth is remapped to [-1, 1] so both exponents fit into 16 bit float moments\n"
+        "    depth = 2.0f * depth - 1.0f;\n"
+        "    float pos = exp(exponents.x * depth);\n"
+        "    float neg = -exp(-exponents.y * depth);\n"
+        "    return vec2(pos, neg);\n"
+        "}\n"
+        "vec4 EVSMMoments(float depth, vec2 exponents)\n"
+        "{\n"
+        "    vec2 warped = EVSMWarpDepth(depth, exponents);\n"
+        "    return vec4(warped.x, warped.x * warped.x, warped.y, warped.y * warped.y);\n"
+        "}\n"
+        "float ChebyshevUpperBound(vec2 moments, float mean, float minVariance, float lightBleedingReduction)\n"
+        "{\n"
+        "    float variance = max(moments.y - moments.x * moments.x, minVariance);\n"
+        "    float d = mean - moments.x;\n"
+        "    float pMax = variance / (variance + d * d);\n"
+        "    // NOTE: Cutting off the tail of the distribution reduces light bleeding\n"
+        "    pMax = saturate((pMax - lightBleedingReduction) / (1.0f - lightBleedingReduction));\n"
+        "    return mean <= moments.x ? 1.0f : pMax;\n"
+        "}\n"
+        "vec3 ShadowEVSM(in sampler2DArray shadowMoments, int cascadeIndex, vec3 lightSpaceP, int showCascadeBounds)\n"
+        "{\n"
+        "    vec2 exponents = FrameData.evsmExponents;\n"
+        "    vec2 warped = EVSMWarpDepth(lightSpaceP.z, exponents);\n"
+        "    vec4 moments = texture(shadowMoments, vec3(lightSpaceP.xy, float(cascadeIndex)));\n"
+        "    // NOTE: Min variance is scaled with the derivative of the warp function\n"
+        "    vec2 depthScale = 0.0001f * exponents * abs(warped);\n"
+        "    vec2 minVariance = depthScale * depthScale;\n"
+        "    float lightBleedingReduction = FrameData.evsmLightBleedingReduction;\n"
+        "    float pos = ChebyshevUpperBound(moments.xy, warped.x, minVariance.x, lightBleedingReduction);\n"
+        "    float neg = ChebyshevUpperBound(moments.zw, warped.y, minVariance.y, lightBleedingReduction);\n"
+        "    float kShadow = min(pos, neg);\n"
+        "    vec3 result;\n"
+        "    if (showCascadeBounds == 1)\n"
+        "    {\n"
+        "        vec3 cascadeColor = CascadeColors[cascadeIndex];\n"
+        "        result = vec3(kShadow) * cascadeColor;\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        result = vec3(kShadow);\n"
+        "    }\n"
+        "    return result;\n"
+        "}\n"
+        "// NOTE: Light space position is computed per fragment since cascade count is not known at compile time\n"
+        "// and passing every cascade position through varyings costs MAX_SHADOW_CASCADES vec4 per vertex\n"
+        "vec3 CalcShadow(vec3 viewSpacePos, vec3 worldPos, vec4 cascadeSplits, int cascadeCount, sampler2DArrayShadow shadowMap, sampler2DArray shadowMoments, float sampleScale, int debugCascadeBounds)\n"
         "{\n"
         "    float viewSpaceDepth = -viewSpacePos.z;\n"
-        "    int cascadeIndex = GetShadowCascadeIndex(-viewSpacePos.z, cascadeSplits);\n"
-        "    vec3 lightSpaceP = lightSpacePos[cascadeIndex].xyz / lightSpacePos[cascadeIndex].w;\n"
-        "    lightSpaceP = lightSpaceP * 0.5f + 0.5f;\n"
-        "    vec3 kShadow = ShadowPCF(shadowMap, cascadeIndex, lightSpaceP, viewSpaceDepth, sampleScale, debugCascadeBounds);\n"
+        "    int cascadeIndex = GetShadowCascadeIndex(-viewSpacePos.z, cascadeSplits, cascadeCount);\n"
+        "    vec3 lightSpaceP = GetShadowLightSpacePos(cascadeIndex, worldPos);\n"
+        "    vec3 kShadow;\n"
+        "    if (FrameData.shadowFilterMode == SHADOW_FILTER_EVSM)\n"
+        "    {\n"
+        "        kShadow = ShadowEVSM(shadowMoments, cascadeIndex, lightSpaceP, debugCascadeBounds);\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        kShadow = ShadowPCF(shadowMap, cascadeIndex, lightSpaceP, viewSpaceDepth, sampleScale, debugCascadeBounds);\n"
+        "    }\n"
         "    return kShadow;\n"
         "}\n"
         "#line 5\n"
+        "#line 100000\n"
+        "// NOTE: Clustered local lights. Must match LightClusterGrid in flux_light_clusters.h\n"
+        "// and ShaderLocalLight in flux_shaders.h\n"
+        "#define CLUSTER_COUNT_X 16\n"
+        "#define CLUSTER_COUNT_Y 9\n"
+        "#define CLUSTER_COUNT_Z 24\n"
+        "// NOTE: Point lights have spot scale 0 and offset 1, so cone attenuation is always 1\n"
+        "struct LocalLight\n"
+        "{\n"
+        "    vec4 positionRadius;\n"
+        "    vec4 colorSpotScale;\n"
+        "    vec4 spotDirectionOffset;\n"
+        "};\n"
+        "layout (std430, binding = 3) readonly buffer LocalLights\n"
+        "{\n"
+        "    LocalLight Lights[];\n"
+        "};\n"
+        "// NOTE: Offset and count of the light list of every cluster\n"
+        "layout (std430, binding = 4) readonly buffer LightClusters\n"
+        "{\n"
+        "    uvec2 Clusters[];\n"
+        "};\n"
+        "layout (std430, binding = 5) readonly buffer LightIndices\n"
+        "{\n"
+        "    uint LightIndexList[];\n"
+        "};\n"
+        "uint GetLightCluster(vec2 fragCoord, float viewDepth)\n"
+        "{\n"
+        "    uvec2 tile = uvec2(fragCoord / FrameData.screenSize * vec2(CLUSTER_COUNT_X, CLUSTER_COUNT_Y));\n"
+        "    tile = min(tile, uvec2(CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1));\n"
+        "    int slice = int(floor(log(max(viewDepth, 1e-5f)) * FrameData.clusterDepthScale + FrameData.clusterDepthBias));\n"
+        "    slice = clamp(slice, 0, CLUSTER_COUNT_Z - 1);\n"
+        "    return (uint(slice) * CLUSTER_COUNT_Y + tile.y) * CLUSTER_COUNT_X + tile.x;\n"
+        "}\n"
+        "// NOTE: Inverse square falloff windowed to reach zero at the radius\n"
+        "// [ Brian Karis, Real Shading in Unreal Engine 4 ]\n"
+        "float LocalLightFalloff(float distanceSq, float radius)\n"
+        "{\n"
+        "    float ratio = distanceSq / (radius * radius);\n"
+        "    float window = saturate(1.0f - ratio * ratio);\n"
+        "    return window * window / (distanceSq + 1.0f);\n"
+        "}\n"
+        "vec3 ClusteredLocalLights(PBR pbr, vec3 worldPos, vec3 viewPos)\n"
+        "{\n"
+        "    vec3 result = vec3(0.0f);\n"
+        "    uvec2 cluster = Clusters[GetLightCluster(gl_FragCoord.xy, -viewPos.z)];\n"
+        "    for (uint i = 0; i < cluster.y; i++)\n"
+        "    {\n"
+        "        LocalLight light = Lights[LightIndexList[cluster.x + i]];\n"
+        "        vec3 toLight = light.positionRadius.xyz - worldPos;\n"
+        "        float distanceSq = max(dot(toLight, toLight), 1e-8f);\n"
+        "        vec3 L = toLight * inversesqrt(distanceSq);\n"
+        "        float attenuation = LocalLightFalloff(distanceSq, light.positionRadius.w);\n"
+        "        float cone = saturate(dot(-L, light.spotDirectionOffset.xyz) * light.colorSpotScale.w + light.spotDirectionOffset.w);\n"
+        "        attenuation *= cone * cone;\n"
+        "        result += Unreal4DirectionalLight(pbr, L) * light.colorSpotScale.xyz * attenuation;\n"
+        "    }\n"
+        "    return result;\n"
+        "}\n"
+        "#line 6\n"
         "out vec4 resultColor;\n"
         "layout (location = 5) in VertOut\n"
         "{\n"
@@ -1829,137 +2521,149 @@ const ShaderProgramSource ShaderSources[] =
         "    vec2 uv;\n"
         "    mat3 tbn;\n"
         "    vec3 viewPosition;\n"
-        "    vec4 lightSpacePos[3];\n"
         "} fragIn;\n"
-        "layout (binding = 0) uniform samplerCube IrradanceMap;\n"
-        "layout (binding = 1) uniform samplerCube EnviromentMap;\n"
-        "layout (binding = 2) uniform sampler2D BRDFLut;\n"
-        "layout (binding = 3) uniform sampler2D AlbedoMap;\n"
-        "layout (binding = 4) uniform sampler2D NormalMap;\n"
-        "layout (binding = 5) uniform sampler2D RoughnessMap;\n"
-        "layout (binding = 6) uniform sampler2D MetallicMap;\n"
-        "layout (binding = 7) uniform sampler2D SpecularMap;\n"
+        "#if defined(INDIRECT)\n"
+        "#line 100000\n"
+        "// NOTE: Instance data of GPU-driven passes. std430, must match GPUCullInstance in flux_shaders.h\n"
+        "struct CullInstance\n"
+        "{\n"
+        "    uint object;\n"
+        "    uint command;\n"
+        "    uint shadowCommand;\n"
+        "    uint dynamic;\n"
+        "    vec4 boundsMin;\n"
+        "    vec4 boundsMax;\n"
+        "};\n"
+        "// NOTE: Layout of DrawElementsIndirectCommand\n"
+        "struct DrawCommand\n"
+        "{\n"
+        "    uint count;\n"
+        "    uint instanceCount;\n"
+        "    uint firstIndex;\n"
+        "    int baseVertex;\n"
+        "    uint baseInstance;\n"
+        "};\n"
+        "layout (std430, binding = 0) readonly buffer CullInstances\n"
+        "{\n"
+        "    CullInstance Instances[];\n"
+        "};\n"
+        "// NOTE: Render scene objects by slot followed by draws pushed this frame\n"
+        "layout (std430, binding = 6) readonly buffer ObjectMeshData\n"
+        "{\n"
+        "    MeshDataFields Objects[];\n"
+        "};\n"
+        "#line 20\n"
+        "layout (location = 14) flat in uint ObjectIndex;\n"
+        "#endif\n"
+        "layout (binding = 1) uniform samplerCube EnviromentMap;\n"
+        "layout (binding = 2) uniform sampler2D BRDFLut;\n"
+        "// NOTE: Material features are compile time permutations (see PbrMesh in flux_shader_config.txt)\n"
+        "#if defined(ALBEDO_MAP)\n"
+        "layout (binding = 3) uniform sampler2D AlbedoMap;\n"
+        "#endif\n"
+        "#if defined(NORMAL_MAP)\n"
+        "layout (binding = 4) uniform sampler2D NormalMap;\n"
+        "#endif\n"
+        "#if defined(ROUGHNESS_MAP)\n"
+        "layout (binding = 5) uniform sampler2D RoughnessMap;\n"
+        "#endif\n"
+        "#if defined(METALLIC_MAP)\n"
+        "layout (binding = 6) uniform sampler2D MetallicMap;\n"
+        "#endif\n"
+        "#if defined(SPECULAR_MAP)\n"
+        "layout (binding = 7) uniform sampler2D SpecularMap;\n"
+        "#endif\n"
+        "#if defined(GLOSS_MAP)\n"
         "layout (binding = 8) uniform sampler2D GlossMap;\n"
+        "#endif\n"
+        "#if defined(AO_MAP)\n"
         "layout (binding = 10) uniform sampler2D AOMap;\n"
+        "#endif\n"
+        "#if defined(EMISSION_MAP)\n"
         "layout (binding = 11) uniform sampler2D EmissionMap;\n"
+        "#endif\n"
         "layout (binding = 9) uniform sampler2DArrayShadow ShadowMap;\n"
+        "layout (binding = 12) uniform sampler2DArray ShadowMoments;\n"
         "//uniform sampler2D uAOMap;\n"
         "void main()\n"
         "{\n"
         "    vec3 V = normalize(FrameData.viewPos - fragIn.fragPos);\n"
         "    PBR context;\n"
-        "    vec3 N;\n"
-        "    if (MeshData.pbrUseNormalMap == 1)\n"
-        "    {\n"
-        "        vec3 n = texture(NormalMap, fragIn.uv).xyz * 2.0f - 1.0f;\n"
-        "        if (MeshData.normalFormat == 0)\n"
-        "        {\n"
-        "            // OpenGL format\n"
-        "        }\n"
-        "        else\n"
-        "        {\n"
-        "            // NOTE: Flipping y because engine uses LH normal maps (UE4) but OpenGL does it's job in RH space\n"
-        "            n.y = -n.y;\n"
-        "        }\n"
-        "        N = normalize(n);\n"
+        "#if defined(NORMAL_MAP)\n"
+        "    vec3 N = texture(NormalMap, fragIn.uv).xyz * 2.0f - 1.0f;\n"
+        "#if defined(NORMAL_MAP_DX)\n"
+        "    // NOTE: Flipping y because engine uses LH normal maps (UE4) but OpenGL does it's job in RH space\n"
+        "    N.y = -N.y;\n"
+        "#endif\n"
         "#if 0\n"
-        "        float roughness = texture(RoughnessMap, fragIn.uv).x;\n"
-        "        N = mix(N, vec3(0.0, 0.0, 1.0), pow(roughness, 0.5)); // smooth normal based on roughness (to reduce specular aliasing)\n"
-        "        N.x *= 2.0;\n"
-        "        N.y *= 2.0;\n"
+        "    float roughness = texture(RoughnessMap, fragIn.uv).x;\n"
+        "    N = mix(N, vec3(0.0, 0.0, 1.0), pow(roughness, 0.5)); // smooth normal based on roughness (to reduce specular aliasing)\n"
+        "    N.x *= 2.0;\n"
+        "    N.y *= 2.0;\n"
+        "#endif\n"
+        "    N = normalize(N);\n"
+        "    N = normalize(fragIn.tbn * N);\n"
+        "#else\n"
+        "    vec3 N = normalize(fragIn.normal);\n"
+        "#endif\n"
+        "#if defined(ALBEDO_MAP)\n"
+        "    vec3 albedo = texture(AlbedoMap, fragIn.uv).xyz;\n"
+        "#else\n"
+        "    vec3 albedo = MeshData.pbrAlbedoValue;\n"
+        "#endif\n"
+        "#if defined(AO_MAP)\n"
+        "    float AO = texture(AOMap, fragIn.uv).x;\n"
+        "#else\n"
+        "    float AO = 1.0f;\n"
         "#endif\n"
-        "        N = normalize(N);\n"
-        "        N = normalize(fragIn.tbn * N);\n"
-        "    }\n"
-        "    else\n"
-        "    {\n"
-        "        N = normalize(fragIn.normal);\n"
-        "    }\n"
-        "    vec3 albedo;\n"
-        "    if (MeshData.pbrUseAlbedoMap == 1)\n"
-        "    {\n"
-        "        albedo = texture(AlbedoMap, fragIn.uv).xyz;\n"
-        "    }\n"
-        "    else\n"
-        "    {\n"
-        "        albedo = MeshData.pbrAlbedoValue;\n"
-        "    }\n"
-        "    float AO;\n"
-        "    if (MeshData.pbrUseAOMap == 1)\n"
-        "    {\n"
-        "        AO = texture(AOMap, fragIn.uv).x;\n"
-        "    }\n"
-        "    else\n"
-        "    {\n"
-        "        AO = 1.0f;\n"
-        "    }\n"
         "    vec3 emissionColor = vec3(0.0f);\n"
-        "    if (MeshData.emitsLight == 1)\n"
-        "    {\n"
-        "        if (MeshData.pbrUseEmissionMap == 1)\n"
-        "        {\n"
-        "            emissionColor = texture(EmissionMap, fragIn.uv).xyz;\n"
-        "        }\n"
-        "        else\n"
-        "        {\n"
-        "            emissionColor = MeshData.pbrEmissionValue;\n"
-        "        }\n"
-        "    }\n"
-        "    if (MeshData.metallicWorkflow == 1)\n"
-        "    {\n"
-        "        float roughness;\n"
-        "        if (MeshData.pbrUseRoughnessMap == 1)\n"
-        "        {\n"
-        "            roughness = texture(RoughnessMap, fragIn.uv).x;\n"
-        "        }\n"
-        "        else\n"
-        "        {\n"
-        "            roughness = MeshData.pbrRoughnessValue;\n"
-        "        }\n"
-        "        float metallic;\n"
-        "        if (MeshData.pbrUseMetallicMap == 1)\n"
-        "        {\n"
-        "            metallic = texture(MetallicMap, fragIn.uv).x;\n"
-        "        }\n"
-        "        else\n"
-        "        {\n"
-        "            metallic = MeshData.pbrMetallicValue;\n"
-        "        }\n"
-        "        context = InitPBRMetallic(V, N, albedo, metallic, roughness, AO);\n"
-        "    }\n"
-        "    else // Specular workflow\n"
-        "    {\n"
-        "        vec3 specular;\n"
-        "        if (MeshData.pbrUseSpecularMap == 1)\n"
-        "        {\n"
-        "            specular = texture(SpecularMap, fragIn.uv).xyz;\n"
-        "        }\n"
-        "        else\n"
-        "        {\n"
-        "            specular = MeshData.pbrSpecularValue;\n"
-        "        }\n"
-        "        float gloss;\n"
-        "        if (MeshData.pbrUseGlossMap == 1)\n"
-        "        {\n"
-        "            gloss = texture(GlossMap, fragIn.uv).x;\n"
-        "        }\n"
-        "        else\n"
-        "        {\n"
-        "            gloss = MeshData.pbrGlossValue;\n"
-        "        }\n"
-        "         context = InitPBRSpecular(V, N, albedo, specular, gloss, AO);\n"
-        "    }\n"
+        "#if defined(EMISSION)\n"
+        "#if defined(EMISSION_MAP)\n"
+        "    emissionColor = texture(EmissionMap, fragIn.uv).xyz;\n"
+        "#else\n"
+        "    emissionColor = MeshData.pbrEmissionValue;\n"
+        "#endif\n"
+        "#endif\n"
+        "#if !defined(SPECULAR_WORKFLOW)\n"
+        "#if defined(ROUGHNESS_MAP)\n"
+        "    float roughness = texture(RoughnessMap, fragIn.uv).x;\n"
+        "#else\n"
+        "    float roughness = MeshData.pbrRoughnessValue;\n"
+        "#endif\n"
+        "#if defined(METALLIC_MAP)\n"
+        "    float metallic = texture(MetallicMap, fragIn.uv).x;\n"
+        "#else\n"
+        "    float metallic = MeshData.pbrMetallicValue;\n"
+        "#endif\n"
+        "    context = InitPBRMetallic(V, N, albedo, metallic, roughness, AO);\n"
+        "#else\n"
+        "#if defined(SPECULAR_MAP)\n"
+        "    vec3 specular = texture(SpecularMap, fragIn.uv).xyz;\n"
+        "#else\n"
+        "    vec3 specular = MeshData.pbrSpecularValue;\n"
+        "#endif\n"
+        "#if defined(GLOSS_MAP)\n"
+        "    float gloss = texture(GlossMap, fragIn.uv).x;\n"
+        "#else\n"
+        "    float gloss = MeshData.pbrGlossValue;\n"
+        "#endif\n"
+        "    context = InitPBRSpecular(V, N, albedo, specular, gloss, AO);\n"
+        "#endif\n"
         "    vec3 L = normalize(-FrameData.dirLight.dir);\n"
         "    vec3 H = normalize(V + L);\n"
         "    vec3 dirRadiance = FrameData.dirLight.diffuse;\n"
         "    dirRadiance = Unreal4DirectionalLight(context, L) * dirRadiance;\n"
-        "    vec3 envRadiance = Unreal4EnviromentLight(context, IrradanceMap, EnviromentMap, BRDFLut);\n"
-        "    vec3 kShadow = CalcShadow(fragIn.viewPosition, FrameData.shadowCascadeSplits, fragIn.lightSpacePos, ShadowMap, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries);\n"
-        "    resultColor = vec4((envRadiance +  dirRadiance * kShadow + emissionColor), 1.0f);\n"
+        "    vec3 envRadiance = Unreal4EnviromentLight(context, EnviromentMap, BRDFLut);\n"
+        "    vec3 localRadiance = ClusteredLocalLights(context, fragIn.fragPos, fragIn.viewPosition);\n"
+        "    vec3 kShadow = CalcShadow(fragIn.viewPosition, fragIn.fragPos, FrameData.shadowCascadeSplits, FrameData.shadowCascadeCount, ShadowMap, ShadowMoments, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries);\n"
+        "    resultColor = vec4((envRadiance +  dirRadiance * kShadow + localRadiance + emissionColor), 1.0f);\n"
         "}\n"
     },
     {
         "#version 450\n"
+        "#if defined(LAYERED)\n"
+        "#extension GL_ARB_shader_viewport_layer_array : require\n"
+        "#endif\n"
         "#line 100000\n"
         "#define PI (3.14159265359)\n"
         "#define PI_32 (3.14159265358979323846f)\n"
@@ -1971,6 +2675,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -1978,10 +2684,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -1992,23 +2702,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -2019,8 +2722,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -2033,17 +2745,74 @@ const ShaderProgramSource ShaderSources[] =
         "float Luminance(vec3 color) {\n"
         "    return color.r * 0.2126 + color.g * 0.7152 + color.b * 0.0722;\n"
         "}\n"
-        "#line 2\n"
+        "#line 5\n"
         "layout (location = 0) in vec3 Position;\n"
         "layout (location = 1) in vec3 Normal;\n"
+        "#if defined(INDIRECT)\n"
+        "#line 100000\n"
+        "// NOTE: Instance data of GPU-driven passes. std430, must match GPUCullInstance in flux_shaders.h\n"
+        "struct CullInstance\n"
+        "{\n"
+        "    uint object;\n"
+        "    uint command;\n"
+        "    uint shadowCommand;\n"
+        "    uint dynamic;\n"
+        "    vec4 boundsMin;\n"
+        "    vec4 boundsMax;\n"
+        "};\n"
+        "// NOTE: Layout of DrawElementsIndirectCommand\n"
+        "struct DrawCommand\n"
+        "{\n"
+        "    uint count;\n"
+        "    uint instanceCount;\n"
+        "    uint firstIndex;\n"
+        "    int baseVertex;\n"
+        "    uint baseInstance;\n"
+        "};\n"
+        "layout (std430, binding = 0) readonly buffer CullInstances\n"
+        "{\n"
+        "    CullInstance Instances[];\n"
+        "};\n"
+        "// NOTE: Render scene objects by slot followed by draws pushed this frame\n"
+        "layout (std430, binding = 6) readonly buffer ObjectMeshData\n"
+        "{\n"
+        "    MeshDataFields Objects[];\n"
+        "};\n"
+        "#line 11\n"
+        "// NOTE: Index of the visible instance. Instanced attribute, fetch is offset by baseInstance of the draw command\n"
+        "layout (location = 5) in uint InstanceIndex;\n"
+        "layout (location = 14) flat out uint ObjectIndex;\n"
+        "#endif\n"
         "layout (location = 0) uniform int CascadeIndex;\n"
+        "// NOTE: Layered pass only. Draw is instanced once for every cascade bit in the mask\n"
+        "layout (location = 1) uniform uint CascadeMask;\n"
         "void main()\n"
         "{\n"
-        "    mat4 viewProj = FrameData.lightSpaceMatrices[CascadeIndex];\n"
+        "#if defined(INDIRECT)\n"
+        "    ObjectIndex = Instances[InstanceIndex].object;\n"
+        "#endif\n"
+        "#if defined(PRE_PASS)\n"
+        "    // NOTE: Main camera depth pre-pass\n"
+        "    gl_Position = FrameData.viewProjMatrix * MeshData.modelMatrix * vec4(Position, 1.0f);\n"
+        "#else\n"
+        "#if defined(LAYERED)\n"
+        "    // NOTE: Instance N goes to the cascade of N-th set bit\n"
+        "    uint mask = CascadeMask;\n"
+        "    for (int i = 0; i < gl_InstanceID; i++)\n"
+        "    {\n"
+        "        mask &= mask - 1u;\n"
+        "    }\n"
+        "    int cascade = findLSB(mask);\n"
+        "    gl_Layer = cascade;\n"
+        "#else\n"
+        "    int cascade = CascadeIndex;\n"
+        "#endif\n"
+        "    mat4 viewProj = FrameData.lightSpaceMatrices[cascade];\n"
         "    vec3 normal = normalize(MeshData.normalMatrix * normalize(Normal));\n"
         "    float NdotL = dot(normal, FrameData.dirLight.pos);\n"
         "    vec3 p = (MeshData.modelMatrix * vec4(Position, 1.0f)).xyz;\n"
         "    gl_Position = viewProj * vec4(p, 1.0f);\n"
+        "#endif\n"
         "}\n"
 ,
         "#version 450\n"
@@ -2058,6 +2827,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -2065,10 +2836,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -2079,23 +2854,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -2106,8 +2874,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -2124,8 +2901,11 @@ const ShaderProgramSource ShaderSources[] =
         "out vec4 color;\n"
         "void main()\n"
         "{\n"
+        "    // NOTE: Pre-pass writes depth only and keeps early depth test\n"
+        "#if !defined(PRE_PASS)\n"
         "    gl_FragDepth = gl_FragCoord.z + FrameData.constShadowBias;\n"
         "    color = vec4(gl_FragCoord.z, gl_FragCoord.z, gl_FragCoord.z, 1.0f);\n"
+        "#endif\n"
         "}\n"
     },
     {
@@ -2141,6 +2921,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -2148,10 +2930,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -2162,23 +2948,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -2189,8 +2968,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -2230,21 +3018,8 @@ const ShaderProgramSource ShaderSources[] =
         "}\n"
     },
     {
-        "#version 450\n"
-        "vec2 VERTICES[] = vec2[](vec2(-1.0f, -1.0f),\n"
-        "                         vec2(1.0f, -1.0f),\n"
-        "                         vec2(1.0f, 1.0f),\n"
-        "                         vec2(1.0f, 1.0f),\n"
-        "                         vec2(-1.0f, 1.0f),\n"
-        "                         vec2(-1.0f, -1.0f));\n"
-        "layout (location = 0) out vec2 UV;\n"
-        "void main()\n"
-        "{\n"
-        "    vec4 vertexPos = vec4(VERTICES[min(gl_VertexID, 6)], 0.0f, 1.0f);\n"
-        "    gl_Position = vertexPos;\n"
-        "    UV = vertexPos.xy / 2.0f + 0.5f;\n"
-        "}\n"
-,
+        nullptr,
+        nullptr,
         "#version 450\n"
         "#line 100000\n"
         "#define PI (3.14159265359)\n"
@@ -2257,6 +3032,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -2264,10 +3041,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -2278,23 +3059,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -2305,8 +3079,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -2396,9 +3179,14 @@ const ShaderProgramSource ShaderSources[] =
         "    return x * lumScale;\n"
         "}\n"
         "#line 3\n"
-        "layout (location = 0) in vec2 UV;\n"
-        "out vec4 fragColorResult;\n"
-        "layout (binding = 0) uniform sampler2D ColorSourceLinear;\n"
+        "// NOTE: Fused MSAA resolve and tonemapping. Every sample is tonemapped before averaging, so bright HDR\n"
+        "// samples do not dominate edge pixels. Result is gamma encoded with perceptual luma in alpha for FXAA.\n"
+        "// Must match ResolveTonemapShader in flux_shaders.h\n"
+        "#define GROUP_SIZE 8\n"
+        "layout (local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE, local_size_z = 1) in;\n"
+        "layout (binding = 0) uniform sampler2DMS ColorSourceLinear;\n"
+        "layout (binding = 0, rgba8) uniform writeonly image2D Result;\n"
+        "layout (location = 0) uniform int SampleCount;\n"
         "float D3DX_FLOAT_to_SRGB(float val)\n"
         "{\n"
         "    if (val < 0.0031308f)\n"
@@ -2418,17 +3206,29 @@ const ShaderProgramSource ShaderSources[] =
         "    rgb.b = D3DX_FLOAT_to_SRGB(rgb.b);\n"
         "    return rgb;\n"
         "}\n"
+        "// TODO: Are these coefficients correct?\n"
+        "float Luma(vec3 rgb)\n"
+        "{\n"
+        "    float result = dot(rgb, vec3(0.299f, 0.587f, 0.114f));\n"
+        "    return result;\n"
+        "}\n"
         "void main()\n"
         "{\n"
-        "    vec3 hdrSample = texture(ColorSourceLinear, UV).xyz;\n"
-        "    vec3 ldrSample = ACESFilmApproxTonemap(hdrSample * FrameData.exposure);\n"
-        "    //vec3 ldrSample = ACESFilmStephenHillTonemap(hdrSample * FrameData.exposure);\n"
-        "    //vec3 ldrSample = Uncharted2Tonemap(hdrSample * FrameData.exposure);\n"
-        "    //vec3 ldrSample = ReinhardTonemap(hdrSample * FrameData.exposure);\n"
-        "    //vec3 ldrSample = Uncharted2TonemapLuminance(hdrSample * FrameData.exposure);\n"
-        "    //vec3 ldrSample = ACESFilmStephenHillTonemapLuminance(hdrSample * FrameData.exposure);\n"
+        "    ivec2 size = imageSize(Result);\n"
+        "    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);\n"
+        "    if (coord.x >= size.x || coord.y >= size.y)\n"
+        "    {\n"
+        "        return;\n"
+        "    }\n"
+        "    vec3 ldrSum = vec3(0.0f);\n"
+        "    for (int i = 0; i < SampleCount; i++)\n"
+        "    {\n"
+        "        vec3 hdrSample = texelFetch(ColorSourceLinear, coord, i).xyz;\n"
+        "        ldrSum += ACESFilmApproxTonemap(hdrSample * FrameData.exposure);\n"
+        "    }\n"
+        "    vec3 ldrSample = ldrSum / float(SampleCount);\n"
         "    vec3 resultSample = D3DX_RGB_to_SRGB(ldrSample * FrameData.exposure);\n"
-        "    fragColorResult = vec4(resultSample, 1.0f);\n"
+        "    imageStore(Result, coord, vec4(resultSample, Luma(saturate(resultSample))));\n"
         "}\n"
     },
     {
@@ -2459,6 +3259,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -2466,10 +3268,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -2480,23 +3286,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -2507,8 +3306,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -2522,15 +3330,12 @@ const ShaderProgramSource ShaderSources[] =
         "    return color.r * 0.2126 + color.g * 0.7152 + color.b * 0.0722;\n"
         "}\n"
         "#line 2\n"
-        "layout (location = 0) in vec2 UV;\n"
+        "layout (location = 0) in vec2 ScreenUV;\n"
         "out vec4 fragColorResult;\n"
         "layout (binding = 0)uniform sampler2D ColorSourcePerceptual;\n"
-        "// TODO: Are these coefficients correct?\n"
-        "float Luma(vec3 rgb)\n"
-        "{\n"
-        "    float result = dot(rgb, vec3(0.299f, 0.587f, 0.114f));\n"
-        "    return result;\n"
-        "}\n"
+        "// NOTE: Rendered viewport size relative to the source texture. Sampling only that part upscales it to the screen\n"
+        "layout (location = 0) uniform vec2 SourceScale;\n"
+        "// NOTE: Luma is precomputed by ResolveTonemapCompute.glsl and stored in alpha\n"
         "#define EDGE_MIN_THRESHOLD 0.0625f  //0.0312f\n"
         "#define EDGE_MAX_THRESHOLD 0.0625f  //0.125f\n"
         "#define ITERATIONS 12\n"
@@ -2539,23 +3344,25 @@ const ShaderProgramSource ShaderSources[] =
         "#define QUALITY(i) (STEPS[min(0, max(5, i))])\n"
         "void main()\n"
         "{\n"
-        "    vec2 invScreenSize = vec2(1.0f) / FrameData.screenSize;\n"
+        "    vec2 invScreenSize = SourceScale / FrameData.screenSize;\n"
+        "    vec2 UV = min(ScreenUV * SourceScale, SourceScale - 0.5f * invScreenSize);\n"
         "    // STUDY: Dependent texture reads\n"
-        "    vec3 sampleCenter = texture(ColorSourcePerceptual, UV).xyz;\n"
-        "    float lumaCenter = Luma(sampleCenter);\n"
-        "    float lumaDown = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(0, -1)).xyz);\n"
-        "    float lumaUp = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(0, 1)).xyz);\n"
-        "    float lumaLeft = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(-1, 0)).xyz);\n"
-        "    float lumaRight = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(1, 0)).xyz);\n"
+        "    vec4 sampleCenterLuma = texture(ColorSourcePerceptual, UV);\n"
+        "    vec3 sampleCenter = sampleCenterLuma.xyz;\n"
+        "    float lumaCenter = sampleCenterLuma.a;\n"
+        "    float lumaDown = textureOffset(ColorSourcePerceptual, UV, ivec2(0, -1)).a;\n"
+        "    float lumaUp = textureOffset(ColorSourcePerceptual, UV, ivec2(0, 1)).a;\n"
+        "    float lumaLeft = textureOffset(ColorSourcePerceptual, UV, ivec2(-1, 0)).a;\n"
+        "    float lumaRight = textureOffset(ColorSourcePerceptual, UV, ivec2(1, 0)).a;\n"
         "    float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));\n"
         "    float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));\n"
         "    float lumaRange = lumaMax - lumaMin;\n"
         "    if (lumaRange >= max(EDGE_MIN_THRESHOLD, lumaMax * EDGE_MAX_THRESHOLD))\n"
         "    {\n"
-        "        float lumaDownLeft = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(-1, -1)).xyz);\n"
-        "        float lumaUpRight = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(1, 1)).xyz);\n"
-        "        float lumaUpLeft = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(-1, 1)).xyz);\n"
-        "        float lumaDownRight = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(1, -1)).xyz);\n"
+        "        float lumaDownLeft = textureOffset(ColorSourcePerceptual, UV, ivec2(-1, -1)).a;\n"
+        "        float lumaUpRight = textureOffset(ColorSourcePerceptual, UV, ivec2(1, 1)).a;\n"
+        "        float lumaUpLeft = textureOffset(ColorSourcePerceptual, UV, ivec2(-1, 1)).a;\n"
+        "        float lumaDownRight = textureOffset(ColorSourcePerceptual, UV, ivec2(1, -1)).a;\n"
         "        float lumaDownUp = lumaDown + lumaUp;\n"
         "        float lumaLeftRight = lumaLeft + lumaRight;\n"
         "        float lumaLeftCorners = lumaDownLeft + lumaUpLeft;\n"
@@ -2588,8 +3395,8 @@ const ShaderProgramSource ShaderSources[] =
         "        vec2 offset = isHorizontal ? vec2(invScreenSize.x, 0.0f) : vec2(0.0f, invScreenSize.y);\n"
         "        vec2 uv1 = currUV - offset;\n"
         "        vec2 uv2 = currUV + offset;\n"
-        "        float lumaEnd1 = Luma(texture(ColorSourcePerceptual, uv1).xyz);\n"
-        "        float lumaEnd2 = Luma(texture(ColorSourcePerceptual, uv2).xyz);\n"
+        "        float lumaEnd1 = texture(ColorSourcePerceptual, uv1).a;\n"
+        "        float lumaEnd2 = texture(ColorSourcePerceptual, uv2).a;\n"
         "        lumaEnd1 -= lumaLocalAvg;\n"
         "        lumaEnd2 -= lumaLocalAvg;\n"
         "        bool reached1 = abs(lumaEnd1) >= gradScaled;\n"
@@ -2603,12 +3410,12 @@ const ShaderProgramSource ShaderSources[] =
         "            {\n"
         "                if (!reached1)\n"
         "                {\n"
-        "                    lumaEnd1 = Luma(texture(ColorSourcePerceptual, uv1).xyz);\n"
+        "                    lumaEnd1 = texture(ColorSourcePerceptual, uv1).a;\n"
         "                    lumaEnd1 -= lumaLocalAvg;\n"
         "                }\n"
         "                if (!reached2)\n"
         "                {\n"
-        "                    lumaEnd2 = Luma(texture(ColorSourcePerceptual, uv2).xyz);\n"
+        "                    lumaEnd2 = texture(ColorSourcePerceptual, uv2).a;\n"
         "                    lumaEnd2 -= lumaLocalAvg;\n"
         "                }\n"
         "                reached1 = abs(lumaEnd1) >= gradScaled;\n"
@@ -2672,6 +3479,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -2679,10 +3488,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -2693,23 +3506,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -2720,8 +3526,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -2849,7 +3664,21 @@ const ShaderProgramSource ShaderSources[] =
         "{\n"
         "    return F0 + (max(vec3(1.0f - roughness), F0) - F0) * pow(1.0f - cosTheta, 5.0f);\n"
         "}\n"
-        "vec3 Unreal4EnviromentLight(PBR pbr, samplerCube irradanceMap, samplerCube enviromentMap, sampler2D brdfLut)\n"
+        "// NOTE: Coefficients are premultiplied by clamped cosine lobe and divided by Pi on CPU\n"
+        "vec3 IrradianceSH9(vec3 n)\n"
+        "{\n"
+        "    vec3 result = FrameData.irradianceSH[0].rgb * 0.282095f;\n"
+        "    result += FrameData.irradianceSH[1].rgb * 0.488603f * n.y;\n"
+        "    result += FrameData.irradianceSH[2].rgb * 0.488603f * n.z;\n"
+        "    result += FrameData.irradianceSH[3].rgb * 0.488603f * n.x;\n"
+        "    result += FrameData.irradianceSH[4].rgb * 1.092548f * n.x * n.y;\n"
+        "    result += FrameData.irradianceSH[5].rgb * 1.092548f * n.y * n.z;\n"
+        "    result += FrameData.irradianceSH[6].rgb * 0.315392f * (3.0f * n.z * n.z - 1.0f);\n"
+        "    result += FrameData.irradianceSH[7].rgb * 1.092548f * n.x * n.z;\n"
+        "    result += FrameData.irradianceSH[8].rgb * 0.546274f * (n.x * n.x - n.y * n.y);\n"
+        "    return max(result, vec3(0.0f));\n"
+        "}\n"
+        "vec3 Unreal4EnviromentLight(PBR pbr, samplerCube enviromentMap, sampler2D brdfLut)\n"
         "{\n"
         "    float roughness;\n"
         "    if (pbr.metallicWorkflow)\n"
@@ -2873,7 +3702,7 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 kS = Fenv;\n"
         "    vec3 kD = vec3(1.0f) - kS;\n"
         "    kD *= 1.0f - pbr.metallic;\n"
-        "    vec3 diffIrradance = texture(irradanceMap, pbr.N).rgb;\n"
+        "    vec3 diffIrradance = IrradianceSH9(pbr.N);\n"
         "    vec3 diffuse = diffIrradance * pbr.albedo;\n"
         "    vec3 irradance = (kD * diffuse + envSpecular) * pbr.AO;\n"
         "    return irradance;\n"
@@ -2957,6 +3786,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -2964,10 +3795,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -2978,23 +3813,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -3005,8 +3833,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -3047,6 +3884,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -3054,10 +3893,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -3068,23 +3911,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -3095,8 +3931,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -3224,7 +4069,21 @@ const ShaderProgramSource ShaderSources[] =
         "{\n"
         "    return F0 + (max(vec3(1.0f - roughness), F0) - F0) * pow(1.0f - cosTheta, 5.0f);\n"
         "}\n"
-        "vec3 Unreal4EnviromentLight(PBR pbr, samplerCube irradanceMap, samplerCube enviromentMap, sampler2D brdfLut)\n"
+        "// NOTE: Coefficients are premultiplied by clamped cosine lobe and divided by Pi on CPU\n"
+        "vec3 IrradianceSH9(vec3 n)\n"
+        "{\n"
+        "    vec3 result = FrameData.irradianceSH[0].rgb * 0.282095f;\n"
+        "    result += FrameData.irradianceSH[1].rgb * 0.488603f * n.y;\n"
+        "    result += FrameData.irradianceSH[2].rgb * 0.488603f * n.z;\n"
+        "    result += FrameData.irradianceSH[3].rgb * 0.488603f * n.x;\n"
+        "    result += FrameData.irradianceSH[4].rgb * 1.092548f * n.x * n.y;\n"
+        "    result += FrameData.irradianceSH[5].rgb * 1.092548f * n.y * n.z;\n"
+        "    result += FrameData.irradianceSH[6].rgb * 0.315392f * (3.0f * n.z * n.z - 1.0f);\n"
+        "    result += FrameData.irradianceSH[7].rgb * 1.092548f * n.x * n.z;\n"
+        "    result += FrameData.irradianceSH[8].rgb * 0.546274f * (n.x * n.x - n.y * n.y);\n"
+        "    return max(result, vec3(0.0f));\n"
+        "}\n"
+        "vec3 Unreal4EnviromentLight(PBR pbr, samplerCube enviromentMap, sampler2D brdfLut)\n"
         "{\n"
         "    float roughness;\n"
         "    if (pbr.metallicWorkflow)\n"
@@ -3248,7 +4107,7 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 kS = Fenv;\n"
         "    vec3 kD = vec3(1.0f) - kS;\n"
         "    kD *= 1.0f - pbr.metallic;\n"
-        "    vec3 diffIrradance = texture(irradanceMap, pbr.N).rgb;\n"
+        "    vec3 diffIrradance = IrradianceSH9(pbr.N);\n"
         "    vec3 diffuse = diffIrradance * pbr.albedo;\n"
         "    vec3 irradance = (kD * diffuse + envSpecular) * pbr.AO;\n"
         "    return irradance;\n"
@@ -3334,6 +4193,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -3341,10 +4202,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -3355,23 +4220,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -3382,8 +4240,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -3397,50 +4264,24 @@ const ShaderProgramSource ShaderSources[] =
         "    return color.r * 0.2126 + color.g * 0.7152 + color.b * 0.0722;\n"
         "}\n"
         "#line 2\n"
-        "layout (location = 0) out vec3 UV;\n"
-        "vec2 VERTICES[] = vec2[](vec2(-1.0f, -1.0f),\n"
-        "                         vec2(1.0f, -1.0f),\n"
-        "                         vec2(1.0f, 1.0f),\n"
-        "                         vec2(1.0f, 1.0f),\n"
-        "                         vec2(-1.0f, 1.0f),\n"
-        "                         vec2(-1.0f, -1.0f));\n"
+        "layout (location = 0) in vec3 Position;\n"
+        "layout (location = 1) in vec3 Normal;\n"
+        "layout (location = 2) in vec2 UV;\n"
         "void main()\n"
         "{\n"
-        "    vec4 vertexPos = vec4(VERTICES[min(gl_VertexID, 6)], 0.0f, 1.0f);\n"
-        "    gl_Position = vertexPos;\n"
-        "    gl_Position = gl_Position.xyww;\n"
-        "    UV = mat3(FrameData.invViewMatrix) * (FrameData.invProjMatrix * gl_Position).xyz;\n"
+        "    gl_Position = FrameData.viewProjMatrix * MeshData.modelMatrix * vec4(Position, 1.0f);\n"
         "}\n"
 ,
         "#version 450\n"
-        "layout (location = 0) in vec3 UV;\n"
-        "out vec4 resultColor;\n"
-        "layout (binding = 0) uniform samplerCube uSourceCubemap;\n"
-        "const float PI_32 = 3.14159265358979323846f;\n"
+        "out vec4 Color;\n"
         "void main()\n"
         "{\n"
-        "    vec3 normal = normalize(UV);\n"
-        "    vec3 irradance = vec3(0.0f);\n"
-        "    vec3 up = vec3(0.0f, 1.0f, 0.0f);\n"
-        "    vec3 right = cross(up, normal);\n"
-        "    up = cross(normal, right);\n"
-        "    float sampleDelta = 0.025f;\n"
-        "    int sampleCount = 0;\n"
-        "    for (float phi = 0.0f; phi < (2.0f * PI_32); phi += sampleDelta)\n"
-        "    {\n"
-        "        for (float theta = 0.0f; theta < (0.5f * PI_32); theta += sampleDelta)\n"
-        "        {\n"
-        "            vec3 tgSample = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));\n"
-        "            vec3 sampleDir = tgSample.x * right + tgSample.y * up + tgSample.z * normal;\n"
-        "            irradance += texture(uSourceCubemap, sampleDir).xyz * cos(theta) * sin(theta);\n"
-        "            sampleCount++;\n"
-        "        }\n"
-        "    }\n"
-        "    irradance = PI_32 * irradance * (1.0f / float(sampleCount));\n"
-        "    resultColor = vec4(irradance, 1.0f);\n"
+        "    Color = vec4(0.2f, 0.6f, 0.9f, 1.0f);\n"
         "}\n"
     },
     {
+        nullptr,
+        nullptr,
         "#version 450\n"
         "#line 100000\n"
         "#define PI (3.14159265359)\n"
@@ -3453,6 +4294,8 @@ const ShaderProgramSource ShaderSources[] =
         "    vec3 diffuse;\n"
         "    vec3 specular;\n"
         "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
         "layout (std140, binding = 0) uniform ShaderFrameData\n"
         "{\n"
         "    mat4 viewProjMatrix;\n"
@@ -3460,10 +4303,14 @@ const ShaderProgramSource ShaderSources[] =
         "    mat4 projectionMatrix;\n"
         "    mat4 invViewMatrix;\n"
         "    mat4 invProjMatrix;\n"
-        "    mat4 lightSpaceMatrices[3];\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
         "    DirLight dirLight;\n"
         "    vec3 viewPos;\n"
-        "    vec3 shadowCascadeSplits;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
         "    int showShadowCascadeBoundaries;\n"
         "    float shadowFilterSampleScale;\n"
         "    int debugF;\n"
@@ -3474,23 +4321,16 @@ const ShaderProgramSource ShaderSources[] =
         "    float gamma;\n"
         "    float exposure;\n"
         "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
         "} FrameData;\n"
-        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
         "{\n"
         "    mat4 modelMatrix;\n"
         "    mat3 normalMatrix;\n"
         "    vec3 lineColor;\n"
-        "    int hasBitangents;\n"
-        "    int metallicWorkflow;\n"
-        "    int emitsLight;\n"
-        "    int pbrUseAlbedoMap;\n"
-        "    int pbrUseRoughnessMap;\n"
-        "    int pbrUseMetallicMap;\n"
-        "    int pbrUseSpecularMap;\n"
-        "    int pbrUseGlossMap;\n"
-        "    int pbrUseNormalMap;\n"
-        "    int pbrUseAOMap;\n"
-        "    int pbrUseEmissionMap;\n"
         "    vec3 pbrAlbedoValue;\n"
         "    float pbrRoughnessValue;\n"
         "    float pbrMetallicValue;\n"
@@ -3501,8 +4341,17 @@ const ShaderProgramSource ShaderSources[] =
         "    int phongUseSpecularMap;\n"
         "    vec3 customPhongDiffuse;\n"
         "    vec3 customPhongSpecular;\n"
-        "    int normalFormat;\n"
-        "} MeshData;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
         "float saturate(float x)\n"
         "{\n"
         "  return max(0.0f, min(1.0f, x));\n"
@@ -3516,19 +4365,634 @@ const ShaderProgramSource ShaderSources[] =
         "    return color.r * 0.2126 + color.g * 0.7152 + color.b * 0.0722;\n"
         "}\n"
         "#line 2\n"
-        "layout (location = 0) in vec3 Position;\n"
-        "layout (location = 1) in vec3 Normal;\n"
-        "layout (location = 2) in vec2 UV;\n"
-        "void main()\n"
-        "{\n"
-        "    gl_Position = FrameData.viewProjMatrix * MeshData.modelMatrix * vec4(Position, 1.0f);\n"
+        "#line 100000\n"
+        "// NOTE: Must match ShadowFilter in flux_shaders.h\n"
+        "#define SHADOW_FILTER_PCF 0\n"
+        "#define SHADOW_FILTER_EVSM 1\n"
+        "// NOTE: Reference: https://github.com/TheRealMJP/Shadows/blob/master/Shadows/PCFKernels.hlsl\n"
+        "const vec2 PoissonSamples[64] = vec2[64]\n"
+        "(\n"
+        "    vec2(-0.5119625f, -0.4827938f),\n"
+        "    vec2(-0.2171264f, -0.4768726f),\n"
+        "    vec2(-0.7552931f, -0.2426507f),\n"
+        "    vec2(-0.7136765f, -0.4496614f),\n"
+        "    vec2(-0.5938849f, -0.6895654f),\n"
+        "    vec2(-0.3148003f, -0.7047654f),\n"
+        "    vec2(-0.42215f, -0.2024607f),\n"
+        "    vec2(-0.9466816f, -0.2014508f),\n"
+        "    vec2(-0.8409063f, -0.03465778f),\n"
+        "    vec2(-0.6517572f, -0.07476326f),\n"
+        "    vec2(-0.1041822f, -0.02521214f),\n"
+        "    vec2(-0.3042712f, -0.02195431f),\n"
+        "    vec2(-0.5082307f, 0.1079806f),\n"
+        "    vec2(-0.08429877f, -0.2316298f),\n"
+        "    vec2(-0.9879128f, 0.1113683f),\n"
+        "    vec2(-0.3859636f, 0.3363545f),\n"
+        "    vec2(-0.1925334f, 0.1787288f),\n"
+        "    vec2(0.003256182f, 0.138135f),\n"
+        "    vec2(-0.8706837f, 0.3010679f),\n"
+        "    vec2(-0.6982038f, 0.1904326f),\n"
+        "    vec2(0.1975043f, 0.2221317f),\n"
+        "    vec2(0.1507788f, 0.4204168f),\n"
+        "    vec2(0.3514056f, 0.09865579f),\n"
+        "    vec2(0.1558783f, -0.08460935f),\n"
+        "    vec2(-0.0684978f, 0.4461993f),\n"
+        "    vec2(0.3780522f, 0.3478679f),\n"
+        "    vec2(0.3956799f, -0.1469177f),\n"
+        "    vec2(0.5838975f, 0.1054943f),\n"
+        "    vec2(0.6155105f, 0.3245716f),\n"
+        "    vec2(0.3928624f, -0.4417621f),\n"
+        "    vec2(0.1749884f, -0.4202175f),\n"
+        "    vec2(0.6813727f, -0.2424808f),\n"
+        "    vec2(-0.6707711f, 0.4912741f),\n"
+        "    vec2(0.0005130528f, -0.8058334f),\n"
+        "    vec2(0.02703013f, -0.6010728f),\n"
+        "    vec2(-0.1658188f, -0.9695674f),\n"
+        "    vec2(0.4060591f, -0.7100726f),\n"
+        "    vec2(0.7713396f, -0.4713659f),\n"
+        "    vec2(0.573212f, -0.51544f),\n"
+        "    vec2(-0.3448896f, -0.9046497f),\n"
+        "    vec2(0.1268544f, -0.9874692f),\n"
+        "    vec2(0.7418533f, -0.6667366f),\n"
+        "    vec2(0.3492522f, 0.5924662f),\n"
+        "    vec2(0.5679897f, 0.5343465f),\n"
+        "    vec2(0.5663417f, 0.7708698f),\n"
+        "    vec2(0.7375497f, 0.6691415f),\n"
+        "    vec2(0.2271994f, -0.6163502f),\n"
+        "    vec2(0.2312844f, 0.8725659f),\n"
+        "    vec2(0.4216993f, 0.9002838f),\n"
+        "    vec2(0.4262091f, -0.9013284f),\n"
+        "    vec2(0.2001408f, -0.808381f),\n"
+        "    vec2(0.149394f, 0.6650763f),\n"
+        "    vec2(-0.09640376f, 0.9843736f),\n"
+        "    vec2(0.7682328f, -0.07273844f),\n"
+        "    vec2(0.04146584f, 0.8313184f),\n"
+        "    vec2(0.9705266f, -0.1143304f),\n"
+        "    vec2(0.9670017f, 0.1293385f),\n"
+        "    vec2(0.9015037f, -0.3306949f),\n"
+        "    vec2(-0.5085648f, 0.7534177f),\n"
+        "    vec2(0.9055501f, 0.3758393f),\n"
+        "    vec2(0.7599946f, 0.1809109f),\n"
+        "    vec2(-0.2483695f, 0.7942952f),\n"
+        "    vec2(-0.4241052f, 0.5581087f),\n"
+        "    vec2(-0.1020106f, 0.6724468f)\n"
+        ");\n"
+        "vec3 CascadeColors[MAX_SHADOW_CASCADES] = vec3[MAX_SHADOW_CASCADES]\n"
+        "(\n"
+        "    vec3(1.0f, 0.0f, 0.0f),\n"
+        "    vec3(0.0f, 1.0f, 0.0f),\n"
+        "    vec3(0.0f, 0.0f, 1.0f),\n"
+        "    vec3(1.0f, 1.0f, 0.0f)\n"
+        ");\n"
+        "int GetShadowCascadeIndex(float viewSpaceDepth, vec4 bounds, int cascadeCount)\n"
+        "{\n"
+        "    // NOTE: Everything past the last split falls into the last cascade\n"
+        "    int cascadeNum = cascadeCount - 1;\n"
+        "    for (int i = 0; i < cascadeCount; i++)\n"
+        "    {\n"
+        "        if (viewSpaceDepth < bounds[i])\n"
+        "        {\n"
+        "            cascadeNum = i;\n"
+        "            break;\n"
+        "        }\n"
+        "    }\n"
+        "    return cascadeNum;\n"
         "}\n"
-,
+        "vec3 GetShadowLightSpacePos(int cascadeIndex, vec3 worldPos)\n"
+        "{\n"
+        "    vec4 lightSpacePos = FrameData.lightSpaceMatrices[cascadeIndex] * vec4(worldPos, 1.0f);\n"
+        "    vec3 result = lightSpacePos.xyz / lightSpacePos.w;\n"
+        "    result = result * 0.5f + 0.5f;\n"
+        "    // NOTE: Cascade far plane could be fitted to the casters, so everything behind it is lit\n"
+        "    result.z = min(result.z, 1.0f);\n"
+        "    return result;\n"
+        "}\n"
+        "vec3 ShadowPCF(in sampler2DArrayShadow shadowMap, int cascadeIndex,\n"
+        "               vec3 lightSpaceP, float viewSpaceDepth,\n"
+        "               float filterSampleScale, int showCascadeBounds)\n"
+        "{\n"
+        "    float kShadow = 0.0f;\n"
+        "    vec2 sampleScale = (1.0f / textureSize(shadowMap, 0).xy) * filterSampleScale;\n"
+        "    int sampleCount = 0;\n"
+        "    for (int y = -2; y <= 1; y++)\n"
+        "    {\n"
+        "        for (int x = -2; x <= 1; x++)\n"
+        "        {\n"
+        "            vec4 uv = vec4(lightSpaceP.xy + vec2(x, y) * sampleScale, float(cascadeIndex), lightSpaceP.z);\n"
+        "            kShadow += texture(shadowMap, uv);\n"
+        "            sampleCount++;\n"
+        "        }\n"
+        "    }\n"
+        "    kShadow /= sampleCount;\n"
+        "    vec3 result;\n"
+        "    if (showCascadeBounds == 1)\n"
+        "    {\n"
+        "        vec3 cascadeColor = CascadeColors[cascadeIndex];\n"
+        "        result = vec3(kShadow) * cascadeColor;\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        result = vec3(kShadow);\n"
+        "    }\n"
+        "    return result;\n"
+        "}\n"
+        "vec3 ShadowRandomDisc(in sampler2DArrayShadow shadowMap, in sampler1D randomTexture,\n"
+        "                      int cascadeIndex, vec3 lightSpaceP, float viewSpaceDepth,\n"
+        "                      float filterSampleScale, int showCascadeBounds)\n"
+        "{\n"
+        "    float kShadow = 0.0f;\n"
+        "    vec2 sampleScale = (1.0f / textureSize(shadowMap, 0).xy) * filterSampleScale;\n"
+        "#if RANDOMIZE_OFFSETS\n"
+        "    int randomTextureSize = textureSize(randomTexture, 0);\n"
+        "    // TODO: Better random here\n"
+        "    int randomSamplePos = int(gl_FragCoord.x + 845.0f * gl_FragCoord.y) % randomTextureSize;\n"
+        "    float theta = texelFetch(randomTexture, randomSamplePos, 0).r * 2.0f * PI;\n"
+        "    mat2 randomRotationMtx;\n"
+        "    randomRotationMtx[0] = vec2(cos(theta), sin(theta));\n"
+        "    randomRotationMtx[1] = vec2(-sin(theta), cos(theta));\n"
+        "    //randomRotationMtx[0] = vec2(cos(theta), -sin(theta));\n"
+        "    //randomRotationMtx[1] = vec2(sin(theta), cos(theta));\n"
+        "#endif\n"
+        "    const int sampleCount = 16;\n"
+        "    for (int i = 0; i < sampleCount; i++)\n"
+        "    {\n"
+        "#if RANDOMIZE_OFFSETS\n"
+        "        vec2 sampleOffset = (randomRotationMtx * PoissonSamples[i]) * sampleScale;\n"
+        "#else\n"
+        "        vec2 sampleOffset = PoissonSamples[i] *  sampleScale;\n"
+        "#endif\n"
+        "        vec4 uv = vec4(lightSpaceP.xy + sampleOffset, cascadeIndex, lightSpaceP.z);\n"
+        "        kShadow += texture(shadowMap, uv);\n"
+        "    }\n"
+        "    kShadow /= sampleCount;\n"
+        "    vec3 result;\n"
+        "    if (showCascadeBounds == 1)\n"
+        "    {\n"
+        "        vec3 cascadeColor = CascadeColors[cascadeIndex];\n"
+        "        result = vec3(kShadow) * cascadeColor;\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        result = vec3(kShadow);\n"
+        "    }\n"
+        "    return result;\n"
+        "}\n"
+        "// NOTE: Exponential variance shadow maps\n"
+        "// [ Lauritzen, McCool, Layered Variance Shadow Maps ]\n"
+        "vec2 EVSMWarpDepth(float depth, vec2 exponents)\n"
+        "{\n"
+        "    // NOTE: Depth is remapped to [-1, 1] so both exponents fit into 16 bit float moments\n"
+        "    depth = 2.0f * depth - 1.0f;\n"
+        "    float pos = exp(exponents.x * depth);\n"
+        "    float neg = -exp(-exponents.y * depth);\n"
+        "    return vec2(pos, neg);\n"
+        "}\n"
+        "vec4 EVSMMoments(float depth, vec2 exponents)\n"
+        "{\n"
+        "    vec2 warped = EVSMWarpDepth(depth, exponents);\n"
+        "    return vec4(warped.x, warped.x * warped.x, warped.y, warped.y * warped.y);\n"
+        "}\n"
+        "float ChebyshevUpperBound(vec2 moments, float mean, float minVariance, float lightBleedingReduction)\n"
+        "{\n"
+        "    float variance = max(moments.y - moments.x * moments.x, minVariance);\n"
+        "    float d = mean - moments.x;\n"
+        "    float pMax = variance / (variance + d * d);\n"
+        "    // NOTE: Cutting off the tail of the distribution reduces light bleeding\n"
+        "    pMax = saturate((pMax - lightBleedingReduction) / (1.0f - lightBleedingReduction));\n"
+        "    return mean <= moments.x ? 1.0f : pMax;\n"
+        "}\n"
+        "vec3 ShadowEVSM(in sampler2DArray shadowMoments, int cascadeIndex, vec3 lightSpaceP, int showCascadeBounds)\n"
+        "{\n"
+        "    vec2 exponents = FrameData.evsmExponents;\n"
+        "    vec2 warped = EVSMWarpDepth(lightSpaceP.z, exponents);\n"
+        "    vec4 moments = texture(shadowMoments, vec3(lightSpaceP.xy, float(cascadeIndex)));\n"
+        "    // NOTE: Min variance is scaled with the derivative of the warp function\n"
+        "    vec2 depthScale = 0.0001f * exponents * abs(warped);\n"
+        "    vec2 minVariance = depthScale * depthScale;\n"
+        "    float lightBleedingReduction = FrameData.evsmLightBleedingReduction;\n"
+        "    float pos = ChebyshevUpperBound(moments.xy, warped.x, minVariance.x, lightBleedingReduction);\n"
+        "    float neg = ChebyshevUpperBound(moments.zw, warped.y, minVariance.y, lightBleedingReduction);\n"
+        "    float kShadow = min(pos, neg);\n"
+        "    vec3 result;\n"
+        "    if (showCascadeBounds == 1)\n"
+        "    {\n"
+        "        vec3 cascadeColor = CascadeColors[cascadeIndex];\n"
+        "        result = vec3(kShadow) * cascadeColor;\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        result = vec3(kShadow);\n"
+        "    }\n"
+        "    return result;\n"
+        "}\n"
+        "// NOTE: Light space position is computed per fragment since cascade count is not known at compile time\n"
+        "// and passing every cascade position through varyings costs MAX_SHADOW_CASCADES vec4 per vertex\n"
+        "vec3 CalcShadow(vec3 viewSpacePos, vec3 worldPos, vec4 cascadeSplits, int cascadeCount, sampler2DArrayShadow shadowMap, sampler2DArray shadowMoments, float sampleScale, int debugCascadeBounds)\n"
+        "{\n"
+        "    float viewSpaceDepth = -viewSpacePos.z;\n"
+        "    int cascadeIndex = GetShadowCascadeIndex(-viewSpacePos.z, cascadeSplits, cascadeCount);\n"
+        "    vec3 lightSpaceP = GetShadowLightSpacePos(cascadeIndex, worldPos);\n"
+        "    vec3 kShadow;\n"
+        "    if (FrameData.shadowFilterMode == SHADOW_FILTER_EVSM)\n"
+        "    {\n"
+        "        kShadow = ShadowEVSM(shadowMoments, cascadeIndex, lightSpaceP, debugCascadeBounds);\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        kShadow = ShadowPCF(shadowMap, cascadeIndex, lightSpaceP, viewSpaceDepth, sampleScale, debugCascadeBounds);\n"
+        "    }\n"
+        "    return kShadow;\n"
+        "}\n"
+        "#line 3\n"
+        "// NOTE: Separable box filter of exponential shadow map moments. Horizontal pass converts depth of the cascade\n"
+        "// to moments, vertical pass writes the result to the cascade layer of the moments array.\n"
+        "// Must match EVSMBlurShader in flux_shaders.h\n"
+        "#define GROUP_SIZE 128\n"
+        "#define MAX_BLUR_RADIUS 8\n"
+        "layout (local_size_x = GROUP_SIZE, local_size_y = 1, local_size_z = 1) in;\n"
+        "layout (location = 0) uniform int Cascade;\n"
+        "layout (location = 1) uniform int Radius;\n"
+        "#if defined(VERTICAL)\n"
+        "layout (binding = 0) uniform sampler2D Source;\n"
+        "layout (binding = 0, rgba16f) uniform writeonly image2DArray Dest;\n"
+        "#else\n"
+        "// NOTE: Bound with a sampler that has depth comparison disabled\n"
+        "layout (binding = 0) uniform sampler2DArray Source;\n"
+        "layout (binding = 0, rgba16f) uniform writeonly image2D Dest;\n"
+        "#endif\n"
+        "shared vec4 Samples[GROUP_SIZE + 2 * MAX_BLUR_RADIUS];\n"
+        "#if defined(VERTICAL)\n"
+        "ivec2 TexelCoord(int along, int line)\n"
+        "{\n"
+        "    return ivec2(line, along);\n"
+        "}\n"
+        "vec4 LoadSample(ivec2 p)\n"
+        "{\n"
+        "    return texelFetch(Source, p, 0);\n"
+        "}\n"
+        "#else\n"
+        "ivec2 TexelCoord(int along, int line)\n"
+        "{\n"
+        "    return ivec2(along, line);\n"
+        "}\n"
+        "vec4 LoadSample(ivec2 p)\n"
+        "{\n"
+        "    float depth = texelFetch(Source, ivec3(p, Cascade), 0).r;\n"
+        "    return EVSMMoments(depth, FrameData.evsmExponents);\n"
+        "}\n"
+        "#endif\n"
+        "void main()\n"
+        "{\n"
+        "#if defined(VERTICAL)\n"
+        "    int lineLength = imageSize(Dest).y;\n"
+        "#else\n"
+        "    int lineLength = imageSize(Dest).x;\n"
+        "#endif\n"
+        "    int line = int(gl_WorkGroupID.y);\n"
+        "    int groupBegin = int(gl_WorkGroupID.x) * GROUP_SIZE - MAX_BLUR_RADIUS;\n"
+        "    for (int i = int(gl_LocalInvocationID.x); i < GROUP_SIZE + 2 * MAX_BLUR_RADIUS; i += GROUP_SIZE)\n"
+        "    {\n"
+        "        int along = clamp(groupBegin + i, 0, lineLength - 1);\n"
+        "        Samples[i] = LoadSample(TexelCoord(along, line));\n"
+        "    }\n"
+        "    barrier();\n"
+        "    int along = int(gl_GlobalInvocationID.x);\n"
+        "    if (along < lineLength)\n"
+        "    {\n"
+        "        int radius = clamp(Radius, 0, MAX_BLUR_RADIUS);\n"
+        "        int center = int(gl_LocalInvocationID.x) + MAX_BLUR_RADIUS;\n"
+        "        vec4 sum = vec4(0.0f);\n"
+        "        for (int i = -radius; i <= radius; i++)\n"
+        "        {\n"
+        "            sum += Samples[center + i];\n"
+        "        }\n"
+        "        vec4 moments = sum / float(2 * radius + 1);\n"
+        "#if defined(VERTICAL)\n"
+        "        imageStore(Dest, ivec3(TexelCoord(along, line), Cascade), moments);\n"
+        "#else\n"
+        "        imageStore(Dest, TexelCoord(along, line), moments);\n"
+        "#endif\n"
+        "    }\n"
+        "}\n"
+    },
+    {
+        nullptr,
+        nullptr,
         "#version 450\n"
-        "out vec4 Color;\n"
+        "// NOTE: Builds max depth pyramid from the depth buffer of the previous frame. First pass takes the farthest\n"
+        "// sample of every pixel of the multisampled depth buffer, next passes reduce the previous level.\n"
+        "// Must match HiZShader in flux_shaders.h\n"
+        "#define GROUP_SIZE 8\n"
+        "layout (local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE, local_size_z = 1) in;\n"
+        "layout (binding = 1, r32f) uniform writeonly image2D Dest;\n"
+        "#if defined(DOWNSAMPLE)\n"
+        "layout (binding = 0, r32f) uniform readonly image2D Source;\n"
+        "#else\n"
+        "layout (binding = 0) uniform sampler2DMS Source;\n"
+        "layout (location = 0) uniform int SampleCount;\n"
+        "#endif\n"
         "void main()\n"
         "{\n"
-        "    Color = vec4(0.2f, 0.6f, 0.9f, 1.0f);\n"
+        "    ivec2 destSize = imageSize(Dest);\n"
+        "    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);\n"
+        "    if (coord.x >= destSize.x || coord.y >= destSize.y)\n"
+        "    {\n"
+        "        return;\n"
+        "    }\n"
+        "    float depth = 0.0f;\n"
+        "#if defined(DOWNSAMPLE)\n"
+        "    ivec2 sourceSize = imageSize(Source);\n"
+        "    ivec2 base = coord * 2;\n"
+        "    // NOTE: When source size is odd the last texel of the row (column) also covers the extra source texel\n"
+        "    ivec2 extent = ivec2(2) + ivec2(equal(coord, destSize - 1)) * (sourceSize & 1);\n"
+        "    for (int y = 0; y < extent.y; y++)\n"
+        "    {\n"
+        "        for (int x = 0; x < extent.x; x++)\n"
+        "        {\n"
+        "            ivec2 texel = min(base + ivec2(x, y), sourceSize - 1);\n"
+        "            depth = max(depth, imageLoad(Source, texel).r);\n"
+        "        }\n"
+        "    }\n"
+        "#else\n"
+        "    for (int i = 0; i < SampleCount; i++)\n"
+        "    {\n"
+        "        depth = max(depth, texelFetch(Source, coord, i).r);\n"
+        "    }\n"
+        "#endif\n"
+        "    imageStore(Dest, coord, vec4(depth));\n"
+        "}\n"
+    },
+    {
+        nullptr,
+        nullptr,
+        "#version 450\n"
+        "#line 100000\n"
+        "#define PI (3.14159265359)\n"
+        "#define PI_32 (3.14159265358979323846f)\n"
+        "struct DirLight\n"
+        "{\n"
+        "    vec3 pos;\n"
+        "    vec3 dir;\n"
+        "    vec3 ambient;\n"
+        "    vec3 diffuse;\n"
+        "    vec3 specular;\n"
+        "};\n"
+        "// NOTE: Must match ShaderFrameData::MaxShadowCascades\n"
+        "#define MAX_SHADOW_CASCADES 4\n"
+        "layout (std140, binding = 0) uniform ShaderFrameData\n"
+        "{\n"
+        "    mat4 viewProjMatrix;\n"
+        "    mat4 viewMatrix;\n"
+        "    mat4 projectionMatrix;\n"
+        "    mat4 invViewMatrix;\n"
+        "    mat4 invProjMatrix;\n"
+        "    mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];\n"
+        "    DirLight dirLight;\n"
+        "    vec3 viewPos;\n"
+        "    vec4 shadowCascadeSplits;\n"
+        "    int shadowCascadeCount;\n"
+        "    int shadowFilterMode;\n"
+        "    vec2 evsmExponents;\n"
+        "    float evsmLightBleedingReduction;\n"
+        "    int showShadowCascadeBoundaries;\n"
+        "    float shadowFilterSampleScale;\n"
+        "    int debugF;\n"
+        "    int debugG;\n"
+        "    int debugD;\n"
+        "    int debugNormals;\n"
+        "    float constShadowBias;\n"
+        "    float gamma;\n"
+        "    float exposure;\n"
+        "    vec2 screenSize;\n"
+        "    vec4 irradianceSH[9];\n"
+        "    float clusterDepthScale;\n"
+        "    float clusterDepthBias;\n"
+        "} FrameData;\n"
+        "// NOTE: Must match ShaderMeshData in flux_shaders.h\n"
+        "struct MeshDataFields\n"
+        "{\n"
+        "    mat4 modelMatrix;\n"
+        "    mat3 normalMatrix;\n"
+        "    vec3 lineColor;\n"
+        "    vec3 pbrAlbedoValue;\n"
+        "    float pbrRoughnessValue;\n"
+        "    float pbrMetallicValue;\n"
+        "    vec3 pbrSpecularValue;\n"
+        "    float pbrGlossValue;\n"
+        "    vec3 pbrEmissionValue;\n"
+        "    int phongUseDiffuseMap;\n"
+        "    int phongUseSpecularMap;\n"
+        "    vec3 customPhongDiffuse;\n"
+        "    vec3 customPhongSpecular;\n"
+        "};\n"
+        "#if defined(INDIRECT)\n"
+        "// NOTE: GPU-driven passes read per object data from the storage buffer declared in GPUCull.glh. Index of the object\n"
+        "// is set by the vertex shader from the instance\n"
+        "#define MeshData Objects[ObjectIndex]\n"
+        "#else\n"
+        "layout (std140, binding = 1) uniform ShaderMeshData\n"
+        "{\n"
+        "    MeshDataFields MeshData;\n"
+        "};\n"
+        "#endif\n"
+        "float saturate(float x)\n"
+        "{\n"
+        "  return max(0.0f, min(1.0f, x));\n"
+        "}\n"
+        "vec3 saturate(vec3 x)\n"
+        "{\n"
+        "  return max(vec3(0.0f), min(vec3(1.0f), x));\n"
+        "}\n"
+        "// [ Real Time Rendering 4th edition, p.278 ]\n"
+        "float Luminance(vec3 color) {\n"
+        "    return color.r * 0.2126 + color.g * 0.7152 + color.b * 0.0722;\n"
+        "}\n"
+        "#line 2\n"
+        "#line 100000\n"
+        "// NOTE: Instance data of GPU-driven passes. std430, must match GPUCullInstance in flux_shaders.h\n"
+        "struct CullInstance\n"
+        "{\n"
+        "    uint object;\n"
+        "    uint command;\n"
+        "    uint shadowCommand;\n"
+        "    uint dynamic;\n"
+        "    vec4 boundsMin;\n"
+        "    vec4 boundsMax;\n"
+        "};\n"
+        "// NOTE: Layout of DrawElementsIndirectCommand\n"
+        "struct DrawCommand\n"
+        "{\n"
+        "    uint count;\n"
+        "    uint instanceCount;\n"
+        "    uint firstIndex;\n"
+        "    int baseVertex;\n"
+        "    uint baseInstance;\n"
+        "};\n"
+        "layout (std430, binding = 0) readonly buffer CullInstances\n"
+        "{\n"
+        "    CullInstance Instances[];\n"
+        "};\n"
+        "// NOTE: Render scene objects by slot followed by draws pushed this frame\n"
+        "layout (std430, binding = 6) readonly buffer ObjectMeshData\n"
+        "{\n"
+        "    MeshDataFields Objects[];\n"
+        "};\n"
+        "#line 3\n"
+        "// NOTE: Tests instance bounds against the view frustum and a Hi-Z pyramid. Visible instances are appended to the\n"
+        "// instance range of their draw command, so the draw can be issued with glMultiDrawElementsIndirect.\n"
+        "// First phase tests against the pyramid of the previous frame depth and marks instances it rejected. Second phase\n"
+        "// runs after the survivors are drawn and retests only the marked ones against the pyramid of that depth, so objects\n"
+        "// revealed since the previous frame are not lost.\n"
+        "// SHADOW tests against a shadow cascade volume instead and appends to the shadow commands of the instances.\n"
+        "// Must match GPUCullShader in flux_shaders.h\n"
+        "#define GROUP_SIZE 64\n"
+        "layout (local_size_x = GROUP_SIZE, local_size_y = 1, local_size_z = 1) in;\n"
+        "layout (std430, binding = 1) buffer DrawCommands\n"
+        "{\n"
+        "    DrawCommand Commands[];\n"
+        "};\n"
+        "layout (std430, binding = 2) writeonly buffer VisibleInstances\n"
+        "{\n"
+        "    uint Visible[];\n"
+        "};\n"
+        "#if !defined(SHADOW)\n"
+        "layout (std430, binding = 7) buffer OccludedInstances\n"
+        "{\n"
+        "    uint Occluded[];\n"
+        "};\n"
+        "layout (binding = 0) uniform sampler2D HiZ;\n"
+        "#endif\n"
+        "layout (location = 0) uniform uint InstanceCount;\n"
+        "// NOTE: Matrix the depth of the pyramid was rendered with\n"
+        "layout (location = 1) uniform mat4 HiZViewProj;\n"
+        "layout (location = 2) uniform int HiZEnabled;\n"
+        "layout (location = 3) uniform int Phase;\n"
+        "// NOTE: Second phase appends to its own copy of the draw commands\n"
+        "layout (location = 4) uniform uint CommandOffset;\n"
+        "// NOTE: Camera or shadow cascade the frustum test is done for\n"
+        "layout (location = 5) uniform mat4 CullViewProj;\n"
+        "// NOTE: Shadow only. Must match ShadowCasters in flux_renderer.cpp: 0 all, 1 static, 2 dynamic\n"
+        "layout (location = 6) uniform int Casters;\n"
+        "vec3 BoxCorner(CullInstance instance, int i)\n"
+        "{\n"
+        "    return vec3((i & 1) != 0 ? instance.boundsMax.x : instance.boundsMin.x,\n"
+        "                (i & 2) != 0 ? instance.boundsMax.y : instance.boundsMin.y,\n"
+        "                (i & 4) != 0 ? instance.boundsMax.z : instance.boundsMin.z);\n"
+        "}\n"
+        "bool FrustumVisible(CullInstance instance)\n"
+        "{\n"
+        "    mat4 m = CullViewProj * Objects[instance.object].modelMatrix;\n"
+        "    // NOTE: Box is outside if all of its corners are outside of the same clip plane\n"
+        "    uint outside = 63u;\n"
+        "    for (int i = 0; i < 8; i++)\n"
+        "    {\n"
+        "        vec4 p = m * vec4(BoxCorner(instance, i), 1.0f);\n"
+        "        uint code = 0u;\n"
+        "        code |= p.x < -p.w ? 1u : 0u;\n"
+        "        code |= p.x > p.w ? 2u : 0u;\n"
+        "        code |= p.y < -p.w ? 4u : 0u;\n"
+        "        code |= p.y > p.w ? 8u : 0u;\n"
+        "#if !defined(SHADOW)\n"
+        "        // NOTE: Shadow casters in front of the cascade near plane are clamped to it, so only far plane culls\n"
+        "        code |= p.z < -p.w ? 16u : 0u;\n"
+        "#endif\n"
+        "        code |= p.z > p.w ? 32u : 0u;\n"
+        "        outside &= code;\n"
+        "    }\n"
+        "    return outside == 0u;\n"
+        "}\n"
+        "#if !defined(SHADOW)\n"
+        "bool HiZVisible(CullInstance instance)\n"
+        "{\n"
+        "    mat4 m = HiZViewProj * Objects[instance.object].modelMatrix;\n"
+        "    vec3 ndcMin = vec3(1.0f);\n"
+        "    vec3 ndcMax = vec3(-1.0f);\n"
+        "    for (int i = 0; i < 8; i++)\n"
+        "    {\n"
+        "        vec4 p = m * vec4(BoxCorner(instance, i), 1.0f);\n"
+        "        if (p.w <= 0.00001f || p.z < -p.w)\n"
+        "        {\n"
+        "            // NOTE: Crossed near plane of the pyramid camera\n"
+        "            return true;\n"
+        "        }\n"
+        "        vec3 ndc = p.xyz / p.w;\n"
+        "        ndcMin = min(ndcMin, ndc);\n"
+        "        ndcMax = max(ndcMax, ndc);\n"
+        "    }\n"
+        "    vec2 uvMin = ndcMin.xy * 0.5f + 0.5f;\n"
+        "    vec2 uvMax = ndcMax.xy * 0.5f + 0.5f;\n"
+        "    if (any(greaterThan(uvMin, vec2(1.0f))) || any(lessThan(uvMax, vec2(0.0f))))\n"
+        "    {\n"
+        "        // NOTE: Off screen for the pyramid camera, nothing to test against\n"
+        "        return true;\n"
+        "    }\n"
+        "    // NOTE: Footprint in texels of the top level. Level sizes are rounded down and the last texel of an odd row\n"
+        "    // (column) covers the extra texel of the level below, so texel p of the top level is covered by\n"
+        "    // min(p >> level, levelSize - 1) on every level. All texels of the footprint are tested\n"
+        "    ivec2 baseSize = textureSize(HiZ, 0);\n"
+        "    ivec2 texelMin = clamp(ivec2(floor(uvMin * vec2(baseSize))), ivec2(0), baseSize - 1);\n"
+        "    ivec2 texelMax = clamp(ivec2(floor(uvMax * vec2(baseSize))), ivec2(0), baseSize - 1);\n"
+        "    // NOTE: Picking the level where the footprint is at most 4x4 texels\n"
+        "    int levelCount = textureQueryLevels(HiZ);\n"
+        "    int level = 0;\n"
+        "    while (level < levelCount - 1 && any(greaterThan((texelMax >> level) - (texelMin >> level), ivec2(3))))\n"
+        "    {\n"
+        "        level++;\n"
+        "    }\n"
+        "    ivec2 levelSize = textureSize(HiZ, level);\n"
+        "    ivec2 first = min(texelMin >> level, levelSize - 1);\n"
+        "    ivec2 last = min(texelMax >> level, levelSize - 1);\n"
+        "    float farthest = 0.0f;\n"
+        "    for (int y = first.y; y <= last.y; y++)\n"
+        "    {\n"
+        "        for (int x = first.x; x <= last.x; x++)\n"
+        "        {\n"
+        "            farthest = max(farthest, texelFetch(HiZ, ivec2(x, y), level).r);\n"
+        "        }\n"
+        "    }\n"
+        "    float nearest = ndcMin.z * 0.5f + 0.5f;\n"
+        "    return nearest <= farthest;\n"
+        "}\n"
+        "#endif\n"
+        "void main()\n"
+        "{\n"
+        "    uint index = gl_GlobalInvocationID.x;\n"
+        "    if (index >= InstanceCount)\n"
+        "    {\n"
+        "        return;\n"
+        "    }\n"
+        "#if defined(SHADOW)\n"
+        "    CullInstance instance = Instances[index];\n"
+        "    bool caster = Casters == 0 || (Casters == 1 && instance.dynamic == 0u) || (Casters == 2 && instance.dynamic != 0u);\n"
+        "    if (caster && FrustumVisible(instance))\n"
+        "    {\n"
+        "        uint slot = atomicAdd(Commands[instance.shadowCommand].instanceCount, 1u);\n"
+        "        Visible[Commands[instance.shadowCommand].baseInstance + slot] = index;\n"
+        "    }\n"
+        "#else\n"
+        "    if (Phase == 2 && Occluded[index] == 0u)\n"
+        "    {\n"
+        "        return;\n"
+        "    }\n"
+        "    CullInstance instance = Instances[index];\n"
+        "    bool visible = Phase == 2 || FrustumVisible(instance);\n"
+        "    bool occluded = false;\n"
+        "    if (visible && HiZEnabled != 0)\n"
+        "    {\n"
+        "        visible = HiZVisible(instance);\n"
+        "        occluded = !visible;\n"
+        "    }\n"
+        "    if (Phase == 1)\n"
+        "    {\n"
+        "        Occluded[index] = occluded ? 1u : 0u;\n"
+        "    }\n"
+        "    if (visible)\n"
+        "    {\n"
+        "        uint command = instance.command + CommandOffset;\n"
+        "        uint slot = atomicAdd(Commands[command].instanceCount, 1u);\n"
+        "        Visible[Commands[command].baseInstance + slot] = index;\n"
+        "    }\n"
+        "#endif\n"
         "}\n"
     },
 };
@@ -0,0 +1,208 @@
+#include "flux_spherical_harmonics.h"
+#include "flux_file_formats.h"
+
+// NOTE: Basis constants. [ Peter-Pike Sloan, Stupid Spherical Harmonics (SH) Tricks ]
+constexpr f32 SH9Basis0 = 0.282095f;
+constexpr f32 SH9Basis1 = 0.488603f;
+constexpr f32 SH9Basis2 = 1.092548f;
+constexpr f32 SH9Basis3 = 0.315392f;
+constexpr f32 SH9Basis4 = 0.546274f;
+
+struct SHProjectFaceJob {
+    const f32* data;
+    u32 width;
+    u32 height;
+    u32 face;
+    f32 weightSum;
+    f32 sums[9][3];
+};
+
+f32 HorizontalSum(__m128 v) {
+    alignas(16) f32 lanes[4];
+    _mm_store_ps(lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+void ProjectFaceSH9Work(void* data0, void* data1, void* data2, u32 threadIndex) {
+    auto job = (SHProjectFaceJob*)data0;
+
+    __m128 sums[9][3];
+    for (u32 i = 0; i < 9; i++) {
+        sums[i][0] = _mm_setzero_ps();
+        sums[i][1] = _mm_setzero_ps();
+        sums[i][2] = _mm_setzero_ps();
+    }
+    __m128 weightSum = _mm_setzero_ps();
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 negOne = _mm_set1_ps(-1.0f);
+    const __m128 three = _mm_set1_ps(3.0f);
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 invWidth = _mm_set1_ps(2.0f / (f32)job->width);
+    f32 invHeight = 2.0f / (f32)job->height;
+
+    for (u32 y = 0; y < job->height; y++) {
+        // NOTE: First row of the face data is t = 0
+        __m128 t = _mm_set1_ps(((f32)y + 0.5f) * invHeight - 1.0f);
+        __m128 negT = _mm_sub_ps(_mm_setzero_ps(), t);
+        const f32* row = job->data + (uptr)y * job->width * 3;
+
+        for (u32 x = 0; x < job->width; x += 4) {
+            __m128 s = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_set1_ps((f32)x), laneOffsets), invWidth), one);
+            __m128 negS = _mm_sub_ps(_mm_setzero_ps(), s);
+
+            // NOTE: Texel direction on the cube. Face order is +X, -X, +Y, -Y, +Z, -Z
+            __m128 dx, dy, dz;
+            switch (job->face) {
+            case 0: { dx = one; dy = negT; dz = negS; } break;
+            case 1: { dx = negOne; dy = negT; dz = s; } break;
+            case 2: { dx = s; dy = one; dz = t; } break;
+            case 3: { dx = s; dy = negOne; dz = negT; } break;
+            case 4: { dx = s; dy = negT; dz = one; } break;
+            case 5: { dx = negS; dy = negT; dz = negOne; } break;
+                invalid_default();
+            }
+
+            __m128 lengthSq = _mm_add_ps(one, _mm_add_ps(_mm_mul_ps(s, s), _mm_mul_ps(t, t)));
+            __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+            dx = _mm_mul_ps(dx, invLength);
+            dy = _mm_mul_ps(dy, invLength);
+            dz = _mm_mul_ps(dz, invLength);
+
+            // NOTE: Texel solid angle is proportional to 1 / (1 + s^2 + t^2)^(3/2)
+            __m128 weight = _mm_mul_ps(invLength, _mm_mul_ps(invLength, invLength));
+
+            // NOTE: Lanes past the end of the row get zero weight
+            alignas(16) f32 r[4];
+            alignas(16) f32 g[4];
+            alignas(16) f32 b[4];
+            alignas(16) f32 mask[4];
+            for (u32 lane = 0; lane < 4; lane++) {
+                u32 index = Min(x + lane, job->width - 1);
+                r[lane] = row[index * 3 + 0];
+                g[lane] = row[index * 3 + 1];
+                b[lane] = row[index * 3 + 2];
+                mask[lane] = (x + lane) < job->width ? 1.0f : 0.0f;
+            }
+            weight = _mm_mul_ps(weight, _mm_load_ps(mask));
+            weightSum = _mm_add_ps(weightSum, weight);
+
+            __m128 basis[9];
+            basis[0] = _mm_set1_ps(SH9Basis0);
+            basis[1] = _mm_mul_ps(_mm_set1_ps(SH9Basis1), dy);
+            basis[2] = _mm_mul_ps(_mm_set1_ps(SH9Basis1), dz);
+            basis[3] = _mm_mul_ps(_mm_set1_ps(SH9Basis1), dx);
+            basis[4] = _mm_mul_ps(_mm_set1_ps(SH9Basis2), _mm_mul_ps(dx, dy));
+            basis[5] = _mm_mul_ps(_mm_set1_ps(SH9Basis2), _mm_mul_ps(dy, dz));
+            basis[6] = _mm_mul_ps(_mm_set1_ps(SH9Basis3), _mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(dz, dz)), one));
+            basis[7] = _mm_mul_ps(_mm_set1_ps(SH9Basis2), _mm_mul_ps(dx, dz));
+            basis[8] = _mm_mul_ps(_mm_set1_ps(SH9Basis4), _mm_sub_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+
+            __m128 wr = _mm_mul_ps(weight, _mm_load_ps(r));
+            __m128 wg = _mm_mul_ps(weight, _mm_load_ps(g));
+            __m128 wb = _mm_mul_ps(weight, _mm_load_ps(b));
+
+            for (u32 i = 0; i < 9; i++) {
+                sums[i][0] = _mm_add_ps(sums[i][0], _mm_mul_ps(basis[i], wr));
+                sums[i][1] = _mm_add_ps(sums[i][1], _mm_mul_ps(basis[i], wg));
+                sums[i][2] = _mm_add_ps(sums[i][2], _mm_mul_ps(basis[i], wb));
+            }
+        }
+    }
+
+    for (u32 i = 0; i < 9; i++) {
+        job->sums[i][0] = HorizontalSum(sums[i][0]);
+        job->sums[i][1] = HorizontalSum(sums[i][1]);
+        job->sums[i][2] = HorizontalSum(sums[i][2]);
+    }
+    job->weightSum = HorizontalSum(weightSum);
+}
+
+SH9 ProjectCubemapSH9(CubeTexture* texture) {
+    assert(texture->format == TextureFormat::RGB16F);
+    SHProjectFaceJob jobs[6] = {};
+    for (u32 face = 0; face < array_count(jobs); face++) {
+        auto job = jobs + face;
+        assert(texture->data[face]);
+        job->data = (const f32*)texture->data[face];
+        job->width = texture->width;
+        job->height = texture->height;
+        job->face = face;
+        // TODO: Spin-locking here for now. We should handle the case when platform queue is full propperly
+        while (!PlatformPushWork(GlobalHighPriorityWorkQueue, ProjectFaceSH9Work, job, nullptr, nullptr)) {}
+    }
+    PlatformCompleteAllWork(GlobalHighPriorityWorkQueue);
+
+    f32 weightSum = 0.0f;
+    for (u32 face = 0; face < array_count(jobs); face++) {
+        weightSum += jobs[face].weightSum;
+    }
+
+    SH9 result = {};
+    if (weightSum > 0.0f) {
+        // NOTE: Normalizing weights so they sum up to the full sphere solid angle
+        f32 scale = 4.0f * F32::Pi / weightSum;
+        for (u32 face = 0; face < array_count(jobs); face++) {
+            for (u32 i = 0; i < 9; i++) {
+                result.coeffs[i] += V3(jobs[face].sums[i][0], jobs[face].sums[i][1], jobs[face].sums[i][2]) * scale;
+            }
+        }
+    }
+    return result;
+}
+
+SH9 IrradianceSH9(SH9 radiance) {
+    // NOTE: Clamped cosine lobe zonal coefficients (Pi, 2Pi/3, Pi/4) divided by Pi
+    // [ Ramamoorthi, Hanrahan, An Efficient Representation for Irradiance Environment Maps ]
+    const f32 bands[] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+    SH9 result;
+    for (u32 i = 0; i < 9; i++) {
+        result.coeffs[i] = radiance.coeffs[i] * bands[i];
+    }
+    return result;
+}
+
+v3 EvaluateSH9(const SH9* sh, v3 dir) {
+    v3 result = sh->coeffs[0] * SH9Basis0;
+    result += sh->coeffs[1] * (SH9Basis1 * dir.y);
+    result += sh->coeffs[2] * (SH9Basis1 * dir.z);
+    result += sh->coeffs[3] * (SH9Basis1 * dir.x);
+    result += sh->coeffs[4] * (SH9Basis2 * dir.x * dir.y);
+    result += sh->coeffs[5] * (SH9Basis2 * dir.y * dir.z);
+    result += sh->coeffs[6] * (SH9Basis3 * (3.0f * dir.z * dir.z - 1.0f));
+    result += sh->coeffs[7] * (SH9Basis2 * dir.x * dir.z);
+    result += sh->coeffs[8] * (SH9Basis4 * (dir.x * dir.x - dir.y * dir.y));
+    return result;
+}
+
+bool LoadSH9FromCache(SH9* sh, const wchar_t* filename, u64 key) {
+    bool result = false;
+    FluxSHCacheHeader file;
+    auto fileSize = PlatformDebugGetFileSize(filename);
+    if (fileSize == sizeof(file)) {
+        u32 bytesRead = PlatformDebugReadFile(&file, sizeof(file), filename);
+        if ((bytesRead == sizeof(file)) &&
+            (file.header.magicValue == FluxFileHeader::MagicValue) &&
+            (file.header.type == FluxFileHeader::SHCache) &&
+            (file.version == 1) &&
+            (file.key == key)) {
+            for (u32 i = 0; i < array_count(sh->coeffs); i++) {
+                sh->coeffs[i] = V3(file.coeffs[i].x, file.coeffs[i].y, file.coeffs[i].z);
+            }
+            result = true;
+        }
+    }
+    return result;
+}
+
+void SaveSH9ToCache(const SH9* sh, const wchar_t* filename, u64 key) {
+    FluxSHCacheHeader file = {};
+    file.header.type = FluxFileHeader::SHCache;
+    file.key = key;
+    for (u32 i = 0; i < array_count(sh->coeffs); i++) {
+        file.coeffs[i] = { sh->coeffs[i].x, sh->coeffs[i].y, sh->coeffs[i].z };
+    }
+    if (!PlatformDebugWriteFile(filename, &file, sizeof(file))) {
+        printf("[Renderer] Failed to write SH cache: %ls\n", filename);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+struct CubeTexture;
+
+// NOTE: Third order (9 coefficients) real spherical harmonics, RGB
+struct SH9 {
+    v3 coeffs[9];
+};
+
+// NOTE: Projects radiance of a cubemap onto SH9 basis. Expects CPU data in RGB f32 format
+// as it is loaded by LoadCubemapHDR. Faces are projected in parallel on worker threads
+SH9 ProjectCubemapSH9(CubeTexture* texture);
+
+// NOTE: Convolves radiance with clamped cosine lobe. The result is already divided by Pi
+// so evaluated irradiance could be directly multiplied by albedo
+SH9 IrradianceSH9(SH9 radiance);
+
+v3 EvaluateSH9(const SH9* sh, v3 dir);
+
+bool LoadSH9FromCache(SH9* sh, const wchar_t* filename, u64 key);
+void SaveSH9ToCache(const SH9* sh, const wchar_t* filename, u64 key);
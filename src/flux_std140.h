@@ -4,6 +4,7 @@
 
 #define std140_vec2 alignas(8) v2
 #define std140_vec3 alignas(16) v3
+#define std140_vec4 alignas(16) v4
 #define std140_int alignas(4) i32
 #define std140_float alignas(4) f32
 #define std140_mat4 alignas(16) m4x4
@@ -299,6 +299,7 @@ void DrawEntityInspector(Context* context, Ui* ui, World* world) {
             ImGui::SameLine();
             if (ImGui::Button("Delete")) {
                 ui->selectedEntity = 0;
+                DestroyRenderObject(&context->renderScene, entity->renderObject);
                 DeleteEntity(world, entity->id);
             } else {
                 ImGui::Separator();
@@ -326,6 +327,14 @@ void DrawEntityInspector(Context* context, Ui* ui, World* world) {
                 ImGui::Text("Rotation");
                 ImGui::SliderFloat3("Angles", entity->rotationAngles.data, 0.0f, 360.0f);
 
+                ImGui::Separator();
+                bool dynamic = entity->dynamic;
+                ImGui::Checkbox("Dynamic", &dynamic);
+                entity->dynamic = dynamic;
+                bool occluder = entity->occluder;
+                ImGui::Checkbox("Occluder", &occluder);
+                entity->occluder = occluder;
+
                 ImGui::Separator();
                 ImGui::Text("Mesh");
                 ImGui::PushID("Entity inspector mesh combo");
@@ -1,11 +1,15 @@
 #include "flux_world.h"
 #include "flux_serialize.h"
 
+void UpdateTransform(Entity* entity) {
+    entity->transform = Translate(entity->p) * Scale(entity->scale) * Rotate(entity->rotationAngles.x, entity->rotationAngles.y, entity->rotationAngles.z);
+    entity->invTransform = Inverse(entity->transform);
+}
+
 void Update(World* world) {
     for (Entity& entity : world->entityTable) {
         if (entity.id) {
-            entity.transform = Translate(entity.p) * Scale(entity.scale) * Rotate(entity.rotationAngles.x, entity.rotationAngles.y, entity.rotationAngles.z);
-            entity.invTransform = Inverse(entity.transform);
+            UpdateTransform(&entity);
         }
     }
 }
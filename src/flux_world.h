@@ -115,6 +115,12 @@ struct Entity {
     Material material;
     m4x4 transform;
     m4x4 invTransform;
+    // NOTE: Runtime only. Moving static entity is fine, it just causes cached shadows to be redrawn
+    b32 dynamic;
+    // NOTE: Runtime only. Forces the mesh to be rasterized to the occlusion buffer
+    b32 occluder;
+    // NOTE: Runtime only. Handle in the render scene
+    u32 renderObject;
 };
 
 // TODO: Entity iterators
@@ -134,6 +140,7 @@ struct RaycastResult {
 
 struct Context ;
 
+void UpdateTransform(Entity* entity);
 void Update(World* world);
 Option<RaycastResult> Raycast(Context* context, AssetManager* manager, World* world, v3 ro, v3 rd);
 Entity* AddEntity(World* world);
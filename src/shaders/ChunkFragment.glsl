@@ -4,7 +4,6 @@
 #include ShadowsCommon.glh
 
 layout (location = 3) in vec3 v_ViewPosition;
-layout (location = 4) in vec4 v_LightSpacePos[3];
 layout (location = 7) flat in int v_TileId;
 layout (location = 8) in vec3 v_Normal;
 layout (location = 9) in vec2 v_UV;
@@ -31,9 +30,8 @@ vec3 CalcDirectionalLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffSa
     float Kd = max(dot(normal, lightDir), 0.0);
 
     float viewSpaceDepth = -v_ViewPosition.z;
-    int cascadeIndex = GetShadowCascadeIndex(-v_ViewPosition.z, FrameData.shadowCascadeSplits);
-    vec3 lightSpaceP = v_LightSpacePos[cascadeIndex].xyz / v_LightSpacePos[cascadeIndex].w;
-    lightSpaceP = lightSpaceP * 0.5f + 0.5f;
+    int cascadeIndex = GetShadowCascadeIndex(-v_ViewPosition.z, FrameData.shadowCascadeSplits, FrameData.shadowCascadeCount);
+    vec3 lightSpaceP = GetShadowLightSpacePos(cascadeIndex, v_Position.xyz);
 #if DUMMY_PCF
    vec3 Kshadow = ShadowPCF(u_ShadowMap, cascadeIndex, lightSpaceP, viewSpaceDepth, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries);
 #endif
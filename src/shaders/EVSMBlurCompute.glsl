@@ -0,0 +1,84 @@
+#version 450
+#include Common.glh
+#include ShadowsCommon.glh
+
+// NOTE: Separable box filter of exponential shadow map moments. Horizontal pass converts depth of the cascade
+// to moments, vertical pass writes the result to the cascade layer of the moments array.
+// Must match EVSMBlurShader in flux_shaders.h
+#define GROUP_SIZE 128
+#define MAX_BLUR_RADIUS 8
+
+layout (local_size_x = GROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+layout (location = 0) uniform int Cascade;
+layout (location = 1) uniform int Radius;
+
+#if defined(VERTICAL)
+layout (binding = 0) uniform sampler2D Source;
+layout (binding = 0, rgba16f) uniform writeonly image2DArray Dest;
+#else
+// NOTE: Bound with a sampler that has depth comparison disabled
+layout (binding = 0) uniform sampler2DArray Source;
+layout (binding = 0, rgba16f) uniform writeonly image2D Dest;
+#endif
+
+shared vec4 Samples[GROUP_SIZE + 2 * MAX_BLUR_RADIUS];
+
+#if defined(VERTICAL)
+ivec2 TexelCoord(int along, int line)
+{
+    return ivec2(line, along);
+}
+
+vec4 LoadSample(ivec2 p)
+{
+    return texelFetch(Source, p, 0);
+}
+#else
+ivec2 TexelCoord(int along, int line)
+{
+    return ivec2(along, line);
+}
+
+vec4 LoadSample(ivec2 p)
+{
+    float depth = texelFetch(Source, ivec3(p, Cascade), 0).r;
+    return EVSMMoments(depth, FrameData.evsmExponents);
+}
+#endif
+
+void main()
+{
+#if defined(VERTICAL)
+    int lineLength = imageSize(Dest).y;
+#else
+    int lineLength = imageSize(Dest).x;
+#endif
+    int line = int(gl_WorkGroupID.y);
+    int groupBegin = int(gl_WorkGroupID.x) * GROUP_SIZE - MAX_BLUR_RADIUS;
+
+    for (int i = int(gl_LocalInvocationID.x); i < GROUP_SIZE + 2 * MAX_BLUR_RADIUS; i += GROUP_SIZE)
+    {
+        int along = clamp(groupBegin + i, 0, lineLength - 1);
+        Samples[i] = LoadSample(TexelCoord(along, line));
+    }
+    barrier();
+
+    int along = int(gl_GlobalInvocationID.x);
+    if (along < lineLength)
+    {
+        int radius = clamp(Radius, 0, MAX_BLUR_RADIUS);
+        int center = int(gl_LocalInvocationID.x) + MAX_BLUR_RADIUS;
+        vec4 sum = vec4(0.0f);
+        for (int i = -radius; i <= radius; i++)
+        {
+            sum += Samples[center + i];
+        }
+        vec4 moments = sum / float(2 * radius + 1);
+#if defined(VERTICAL)
+        imageStore(Dest, ivec3(TexelCoord(along, line), Cascade), moments);
+#else
+        imageStore(Dest, TexelCoord(along, line), moments);
+#endif
+    }
+}
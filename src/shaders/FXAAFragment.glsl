@@ -1,17 +1,14 @@
 #version 450
 #include Common.glh
-layout (location = 0) in vec2 UV;
+layout (location = 0) in vec2 ScreenUV;
 
 out vec4 fragColorResult;
 
 layout (binding = 0)uniform sampler2D ColorSourcePerceptual;
+// NOTE: Rendered viewport size relative to the source texture. Sampling only that part upscales it to the screen
+layout (location = 0) uniform vec2 SourceScale;
 
-// TODO: Are these coefficients correct?
-float Luma(vec3 rgb)
-{
-    float result = dot(rgb, vec3(0.299f, 0.587f, 0.114f));
-    return result;
-}
+// NOTE: Luma is precomputed by ResolveTonemapCompute.glsl and stored in alpha
 
 #define EDGE_MIN_THRESHOLD 0.0625f  //0.0312f
 #define EDGE_MAX_THRESHOLD 0.0625f  //0.125f
@@ -23,15 +20,17 @@ float STEPS[6] = float[](1.0f, 1.5f, 2.0f, 2.0f, 2.0f, 8.0f);
 
 void main()
 {
-    vec2 invScreenSize = vec2(1.0f) / FrameData.screenSize;
+    vec2 invScreenSize = SourceScale / FrameData.screenSize;
+    vec2 UV = min(ScreenUV * SourceScale, SourceScale - 0.5f * invScreenSize);
     // STUDY: Dependent texture reads
-    vec3 sampleCenter = texture(ColorSourcePerceptual, UV).xyz;
+    vec4 sampleCenterLuma = texture(ColorSourcePerceptual, UV);
+    vec3 sampleCenter = sampleCenterLuma.xyz;
 
-    float lumaCenter = Luma(sampleCenter);
-    float lumaDown = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(0, -1)).xyz);
-    float lumaUp = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(0, 1)).xyz);
-    float lumaLeft = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(-1, 0)).xyz);
-    float lumaRight = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(1, 0)).xyz);
+    float lumaCenter = sampleCenterLuma.a;
+    float lumaDown = textureOffset(ColorSourcePerceptual, UV, ivec2(0, -1)).a;
+    float lumaUp = textureOffset(ColorSourcePerceptual, UV, ivec2(0, 1)).a;
+    float lumaLeft = textureOffset(ColorSourcePerceptual, UV, ivec2(-1, 0)).a;
+    float lumaRight = textureOffset(ColorSourcePerceptual, UV, ivec2(1, 0)).a;
 
     float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
     float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
@@ -39,10 +38,10 @@ void main()
 
     if (lumaRange >= max(EDGE_MIN_THRESHOLD, lumaMax * EDGE_MAX_THRESHOLD))
     {
-        float lumaDownLeft = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(-1, -1)).xyz);
-        float lumaUpRight = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(1, 1)).xyz);
-        float lumaUpLeft = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(-1, 1)).xyz);
-        float lumaDownRight = Luma(textureOffset(ColorSourcePerceptual, UV, ivec2(1, -1)).xyz);
+        float lumaDownLeft = textureOffset(ColorSourcePerceptual, UV, ivec2(-1, -1)).a;
+        float lumaUpRight = textureOffset(ColorSourcePerceptual, UV, ivec2(1, 1)).a;
+        float lumaUpLeft = textureOffset(ColorSourcePerceptual, UV, ivec2(-1, 1)).a;
+        float lumaDownRight = textureOffset(ColorSourcePerceptual, UV, ivec2(1, -1)).a;
 
         float lumaDownUp = lumaDown + lumaUp;
         float lumaLeftRight = lumaLeft + lumaRight;
@@ -82,8 +81,8 @@ void main()
         vec2 uv1 = currUV - offset;
         vec2 uv2 = currUV + offset;
 
-        float lumaEnd1 = Luma(texture(ColorSourcePerceptual, uv1).xyz);
-        float lumaEnd2 = Luma(texture(ColorSourcePerceptual, uv2).xyz);
+        float lumaEnd1 = texture(ColorSourcePerceptual, uv1).a;
+        float lumaEnd2 = texture(ColorSourcePerceptual, uv2).a;
         lumaEnd1 -= lumaLocalAvg;
         lumaEnd2 -= lumaLocalAvg;
         bool reached1 = abs(lumaEnd1) >= gradScaled;
@@ -98,12 +97,12 @@ void main()
             {
                 if (!reached1)
                 {
-                    lumaEnd1 = Luma(texture(ColorSourcePerceptual, uv1).xyz);
+                    lumaEnd1 = texture(ColorSourcePerceptual, uv1).a;
                     lumaEnd1 -= lumaLocalAvg;
                 }
                 if (!reached2)
                 {
-                    lumaEnd2 = Luma(texture(ColorSourcePerceptual, uv2).xyz);
+                    lumaEnd2 = texture(ColorSourcePerceptual, uv2).a;
                     lumaEnd2 -= lumaLocalAvg;
                 }
                 reached1 = abs(lumaEnd1) >= gradScaled;
@@ -0,0 +1,179 @@
+#version 450
+#include Common.glh
+#include GPUCull.glh
+
+// NOTE: Tests instance bounds against the view frustum and a Hi-Z pyramid. Visible instances are appended to the
+// instance range of their draw command, so the draw can be issued with glMultiDrawElementsIndirect.
+// First phase tests against the pyramid of the previous frame depth and marks instances it rejected. Second phase
+// runs after the survivors are drawn and retests only the marked ones against the pyramid of that depth, so objects
+// revealed since the previous frame are not lost.
+// SHADOW tests against a shadow cascade volume instead and appends to the shadow commands of the instances.
+// Must match GPUCullShader in flux_shaders.h
+#define GROUP_SIZE 64
+
+layout (local_size_x = GROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+layout (std430, binding = 1) buffer DrawCommands
+{
+    DrawCommand Commands[];
+};
+
+layout (std430, binding = 2) writeonly buffer VisibleInstances
+{
+    uint Visible[];
+};
+
+#if !defined(SHADOW)
+layout (std430, binding = 7) buffer OccludedInstances
+{
+    uint Occluded[];
+};
+
+layout (binding = 0) uniform sampler2D HiZ;
+#endif
+
+layout (location = 0) uniform uint InstanceCount;
+// NOTE: Matrix the depth of the pyramid was rendered with
+layout (location = 1) uniform mat4 HiZViewProj;
+layout (location = 2) uniform int HiZEnabled;
+layout (location = 3) uniform int Phase;
+// NOTE: Second phase appends to its own copy of the draw commands
+layout (location = 4) uniform uint CommandOffset;
+// NOTE: Camera or shadow cascade the frustum test is done for
+layout (location = 5) uniform mat4 CullViewProj;
+// NOTE: Shadow only. Must match ShadowCasters in flux_renderer.cpp: 0 all, 1 static, 2 dynamic
+layout (location = 6) uniform int Casters;
+
+vec3 BoxCorner(CullInstance instance, int i)
+{
+    return vec3((i & 1) != 0 ? instance.boundsMax.x : instance.boundsMin.x,
+                (i & 2) != 0 ? instance.boundsMax.y : instance.boundsMin.y,
+                (i & 4) != 0 ? instance.boundsMax.z : instance.boundsMin.z);
+}
+
+bool FrustumVisible(CullInstance instance)
+{
+    mat4 m = CullViewProj * Objects[instance.object].modelMatrix;
+    // NOTE: Box is outside if all of its corners are outside of the same clip plane
+    uint outside = 63u;
+    for (int i = 0; i < 8; i++)
+    {
+        vec4 p = m * vec4(BoxCorner(instance, i), 1.0f);
+        uint code = 0u;
+        code |= p.x < -p.w ? 1u : 0u;
+        code |= p.x > p.w ? 2u : 0u;
+        code |= p.y < -p.w ? 4u : 0u;
+        code |= p.y > p.w ? 8u : 0u;
+#if !defined(SHADOW)
+        // NOTE: Shadow casters in front of the cascade near plane are clamped to it, so only far plane culls
+        code |= p.z < -p.w ? 16u : 0u;
+#endif
+        code |= p.z > p.w ? 32u : 0u;
+        outside &= code;
+    }
+    return outside == 0u;
+}
+
+#if !defined(SHADOW)
+bool HiZVisible(CullInstance instance)
+{
+    mat4 m = HiZViewProj * Objects[instance.object].modelMatrix;
+    vec3 ndcMin = vec3(1.0f);
+    vec3 ndcMax = vec3(-1.0f);
+    for (int i = 0; i < 8; i++)
+    {
+        vec4 p = m * vec4(BoxCorner(instance, i), 1.0f);
+        if (p.w <= 0.00001f || p.z < -p.w)
+        {
+            // NOTE: Crossed near plane of the pyramid camera
+            return true;
+        }
+        vec3 ndc = p.xyz / p.w;
+        ndcMin = min(ndcMin, ndc);
+        ndcMax = max(ndcMax, ndc);
+    }
+
+    vec2 uvMin = ndcMin.xy * 0.5f + 0.5f;
+    vec2 uvMax = ndcMax.xy * 0.5f + 0.5f;
+    if (any(greaterThan(uvMin, vec2(1.0f))) || any(lessThan(uvMax, vec2(0.0f))))
+    {
+        // NOTE: Off screen for the pyramid camera, nothing to test against
+        return true;
+    }
+
+    // NOTE: Footprint in texels of the top level. Level sizes are rounded down and the last texel of an odd row
+    // (column) covers the extra texel of the level below, so texel p of the top level is covered by
+    // min(p >> level, levelSize - 1) on every level. All texels of the footprint are tested
+    ivec2 baseSize = textureSize(HiZ, 0);
+    ivec2 texelMin = clamp(ivec2(floor(uvMin * vec2(baseSize))), ivec2(0), baseSize - 1);
+    ivec2 texelMax = clamp(ivec2(floor(uvMax * vec2(baseSize))), ivec2(0), baseSize - 1);
+
+    // NOTE: Picking the level where the footprint is at most 4x4 texels
+    int levelCount = textureQueryLevels(HiZ);
+    int level = 0;
+    while (level < levelCount - 1 && any(greaterThan((texelMax >> level) - (texelMin >> level), ivec2(3))))
+    {
+        level++;
+    }
+
+    ivec2 levelSize = textureSize(HiZ, level);
+    ivec2 first = min(texelMin >> level, levelSize - 1);
+    ivec2 last = min(texelMax >> level, levelSize - 1);
+    float farthest = 0.0f;
+    for (int y = first.y; y <= last.y; y++)
+    {
+        for (int x = first.x; x <= last.x; x++)
+        {
+            farthest = max(farthest, texelFetch(HiZ, ivec2(x, y), level).r);
+        }
+    }
+
+    float nearest = ndcMin.z * 0.5f + 0.5f;
+    return nearest <= farthest;
+}
+#endif
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= InstanceCount)
+    {
+        return;
+    }
+
+#if defined(SHADOW)
+    CullInstance instance = Instances[index];
+    bool caster = Casters == 0 || (Casters == 1 && instance.dynamic == 0u) || (Casters == 2 && instance.dynamic != 0u);
+    if (caster && FrustumVisible(instance))
+    {
+        uint slot = atomicAdd(Commands[instance.shadowCommand].instanceCount, 1u);
+        Visible[Commands[instance.shadowCommand].baseInstance + slot] = index;
+    }
+#else
+    if (Phase == 2 && Occluded[index] == 0u)
+    {
+        return;
+    }
+
+    CullInstance instance = Instances[index];
+    bool visible = Phase == 2 || FrustumVisible(instance);
+    bool occluded = false;
+    if (visible && HiZEnabled != 0)
+    {
+        visible = HiZVisible(instance);
+        occluded = !visible;
+    }
+
+    if (Phase == 1)
+    {
+        Occluded[index] = occluded ? 1u : 0u;
+    }
+
+    if (visible)
+    {
+        uint command = instance.command + CommandOffset;
+        uint slot = atomicAdd(Commands[command].instanceCount, 1u);
+        Visible[Commands[command].baseInstance + slot] = index;
+    }
+#endif
+}
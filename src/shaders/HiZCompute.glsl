@@ -0,0 +1,50 @@
+#version 450
+
+// NOTE: Builds max depth pyramid from the depth buffer of the previous frame. First pass takes the farthest
+// sample of every pixel of the multisampled depth buffer, next passes reduce the previous level.
+// Must match HiZShader in flux_shaders.h
+#define GROUP_SIZE 8
+
+layout (local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE, local_size_z = 1) in;
+
+layout (binding = 1, r32f) uniform writeonly image2D Dest;
+
+#if defined(DOWNSAMPLE)
+layout (binding = 0, r32f) uniform readonly image2D Source;
+#else
+layout (binding = 0) uniform sampler2DMS Source;
+layout (location = 0) uniform int SampleCount;
+#endif
+
+void main()
+{
+    ivec2 destSize = imageSize(Dest);
+    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+    if (coord.x >= destSize.x || coord.y >= destSize.y)
+    {
+        return;
+    }
+
+    float depth = 0.0f;
+#if defined(DOWNSAMPLE)
+    ivec2 sourceSize = imageSize(Source);
+    ivec2 base = coord * 2;
+    // NOTE: When source size is odd the last texel of the row (column) also covers the extra source texel
+    ivec2 extent = ivec2(2) + ivec2(equal(coord, destSize - 1)) * (sourceSize & 1);
+    for (int y = 0; y < extent.y; y++)
+    {
+        for (int x = 0; x < extent.x; x++)
+        {
+            ivec2 texel = min(base + ivec2(x, y), sourceSize - 1);
+            depth = max(depth, imageLoad(Source, texel).r);
+        }
+    }
+#else
+    for (int i = 0; i < SampleCount; i++)
+    {
+        depth = max(depth, texelFetch(Source, coord, i).r);
+    }
+#endif
+
+    imageStore(Dest, coord, vec4(depth));
+}
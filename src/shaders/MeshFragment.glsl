@@ -10,19 +10,34 @@ layout (location = 3) in VertOut
     vec3 normal;
     vec2 uv;
     vec3 viewPosition;
-    vec4 lightSpacePos[3];
 } fragIn;
 
 layout (binding = 0) uniform sampler2D DiffMap;
 layout (binding = 1) uniform sampler2D SpecMap;
 layout (binding = 2) uniform sampler2DArrayShadow ShadowMap;
+layout (binding = 3) uniform sampler2DArray ShadowMoments;
+
+#if defined(INDIRECT)
+#include GPUCull.glh
+layout (location = 14) flat in uint ObjectIndex;
+#endif
+
+#if defined(INDIRECT)
+// NOTE: Maps bound for the batch. Material of the object may use a map which is still loading
+layout (location = 0) uniform uint MapMask;
+#define DIFFUSE_MAP_BOUND ((MapMask & 1u) != 0u)
+#define SPECULAR_MAP_BOUND ((MapMask & 2u) != 0u)
+#else
+#define DIFFUSE_MAP_BOUND true
+#define SPECULAR_MAP_BOUND true
+#endif
 
 void main()
 {
     vec3 normal = normalize(fragIn.normal);
 
     vec4 diffSample;
-    if (MeshData.phongUseDiffuseMap == 1)
+    if (MeshData.phongUseDiffuseMap == 1 && DIFFUSE_MAP_BOUND)
     {
         diffSample = texture(DiffMap, fragIn.uv);
     }
@@ -32,7 +47,7 @@ void main()
     }
 
     vec4 specSample;
-    if (MeshData.phongUseSpecularMap == 1)
+    if (MeshData.phongUseSpecularMap == 1 && SPECULAR_MAP_BOUND)
     {
         specSample = texture(SpecMap, fragIn.uv);
     }
@@ -48,7 +63,7 @@ void main()
     vec3 rFromLight = reflect(-lightDir, normal);
     float kSpec = pow(max(dot(viewDir, rFromLight), 0.0f), 32.0f);
 
-    vec4 kShadow = vec4(CalcShadow(fragIn.viewPosition, FrameData.shadowCascadeSplits, fragIn.lightSpacePos, ShadowMap, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries), 1.0f);
+    vec4 kShadow = vec4(CalcShadow(fragIn.viewPosition, fragIn.fragPos, FrameData.shadowCascadeSplits, FrameData.shadowCascadeCount, ShadowMap, ShadowMoments, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries), 1.0f);
 
     vec4 ambient = diffSample * vec4(FrameData.dirLight.ambient, 1.0f);
     vec4 diffuse = diffSample * kDiff * vec4(FrameData.dirLight.diffuse, 1.0f) * kShadow;
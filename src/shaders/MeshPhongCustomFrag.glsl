@@ -10,10 +10,10 @@ layout (location = 3) in VertOut
     vec3 normal;
     vec2 uv;
     vec3 viewPosition;
-    vec4 lightSpacePos[3];
 } fragIn;
 
 layout (binding = 0) uniform sampler2DArrayShadow ShadowMap;
+layout (binding = 1) uniform sampler2DArray ShadowMoments;
 
 void main()
 {
@@ -26,7 +26,7 @@ void main()
     vec3 rFromLight = reflect(-lightDir, normal);
     float kSpec = pow(max(dot(viewDir, rFromLight), 0.0f), 32.0f);
 
-    vec4 kShadow = vec4(CalcShadow(fragIn.viewPosition, FrameData.shadowCascadeSplits, fragIn.lightSpacePos, ShadowMap, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries), 1.0f);
+    vec4 kShadow = vec4(CalcShadow(fragIn.viewPosition, fragIn.fragPos, FrameData.shadowCascadeSplits, FrameData.shadowCascadeCount, ShadowMap, ShadowMoments, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries), 1.0f);
 
     vec4 ambient = diffSamle * vec4(FrameData.dirLight.ambient, 1.0f);
     vec4 diffuse = diffSamle * kDiff * vec4(FrameData.dirLight.diffuse, 1.0f) * kShadow;
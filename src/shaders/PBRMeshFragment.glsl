@@ -3,6 +3,7 @@
 #include Common.glh
 #include Pbr.glh
 #include ShadowsCommon.glh
+#include Lights.glh
 
 out vec4 resultColor;
 
@@ -13,25 +14,46 @@ layout (location = 5) in VertOut
     vec2 uv;
     mat3 tbn;
     vec3 viewPosition;
-    vec4 lightSpacePos[3];
 } fragIn;
 
-layout (binding = 0) uniform samplerCube IrradanceMap;
+#if defined(INDIRECT)
+#include GPUCull.glh
+layout (location = 14) flat in uint ObjectIndex;
+#endif
+
 layout (binding = 1) uniform samplerCube EnviromentMap;
 layout (binding = 2) uniform sampler2D BRDFLut;
 
+// NOTE: Material features are compile time permutations (see PbrMesh in flux_shader_config.txt)
+#if defined(ALBEDO_MAP)
 layout (binding = 3) uniform sampler2D AlbedoMap;
+#endif
+#if defined(NORMAL_MAP)
 layout (binding = 4) uniform sampler2D NormalMap;
+#endif
 
+#if defined(ROUGHNESS_MAP)
 layout (binding = 5) uniform sampler2D RoughnessMap;
+#endif
+#if defined(METALLIC_MAP)
 layout (binding = 6) uniform sampler2D MetallicMap;
+#endif
 
+#if defined(SPECULAR_MAP)
 layout (binding = 7) uniform sampler2D SpecularMap;
+#endif
+#if defined(GLOSS_MAP)
 layout (binding = 8) uniform sampler2D GlossMap;
+#endif
+#if defined(AO_MAP)
 layout (binding = 10) uniform sampler2D AOMap;
+#endif
+#if defined(EMISSION_MAP)
 layout (binding = 11) uniform sampler2D EmissionMap;
+#endif
 
 layout (binding = 9) uniform sampler2DArrayShadow ShadowMap;
+layout (binding = 12) uniform sampler2DArray ShadowMoments;
 //uniform sampler2D uAOMap;
 
 void main()
@@ -40,116 +62,74 @@ void main()
 
     PBR context;
 
-    vec3 N;
-    if (MeshData.pbrUseNormalMap == 1)
-    {
-        vec3 n = texture(NormalMap, fragIn.uv).xyz * 2.0f - 1.0f;
-        if (MeshData.normalFormat == 0)
-        {
-            // OpenGL format
-        }
-        else
-        {
-            // NOTE: Flipping y because engine uses LH normal maps (UE4) but OpenGL does it's job in RH space
-            n.y = -n.y;
-        }
-
-        N = normalize(n);
+#if defined(NORMAL_MAP)
+    vec3 N = texture(NormalMap, fragIn.uv).xyz * 2.0f - 1.0f;
+#if defined(NORMAL_MAP_DX)
+    // NOTE: Flipping y because engine uses LH normal maps (UE4) but OpenGL does it's job in RH space
+    N.y = -N.y;
+#endif
 #if 0
-        float roughness = texture(RoughnessMap, fragIn.uv).x;
-        N = mix(N, vec3(0.0, 0.0, 1.0), pow(roughness, 0.5)); // smooth normal based on roughness (to reduce specular aliasing)
-        N.x *= 2.0;
-        N.y *= 2.0;
-#endif
-        N = normalize(N);
-
-        N = normalize(fragIn.tbn * N);
-    }
-    else
-    {
-        N = normalize(fragIn.normal);
-    }
-
-    vec3 albedo;
-    if (MeshData.pbrUseAlbedoMap == 1)
-    {
-        albedo = texture(AlbedoMap, fragIn.uv).xyz;
-    }
-    else
-    {
-        albedo = MeshData.pbrAlbedoValue;
-    }
-
-    float AO;
-    if (MeshData.pbrUseAOMap == 1)
-    {
-        AO = texture(AOMap, fragIn.uv).x;
-    }
-    else
-    {
-        AO = 1.0f;
-    }
+    float roughness = texture(RoughnessMap, fragIn.uv).x;
+    N = mix(N, vec3(0.0, 0.0, 1.0), pow(roughness, 0.5)); // smooth normal based on roughness (to reduce specular aliasing)
+    N.x *= 2.0;
+    N.y *= 2.0;
+#endif
+    N = normalize(N);
+    N = normalize(fragIn.tbn * N);
+#else
+    vec3 N = normalize(fragIn.normal);
+#endif
+
+#if defined(ALBEDO_MAP)
+    vec3 albedo = texture(AlbedoMap, fragIn.uv).xyz;
+#else
+    vec3 albedo = MeshData.pbrAlbedoValue;
+#endif
+
+#if defined(AO_MAP)
+    float AO = texture(AOMap, fragIn.uv).x;
+#else
+    float AO = 1.0f;
+#endif
 
     vec3 emissionColor = vec3(0.0f);
-    if (MeshData.emitsLight == 1)
-    {
-        if (MeshData.pbrUseEmissionMap == 1)
-        {
-            emissionColor = texture(EmissionMap, fragIn.uv).xyz;
-        }
-        else
-        {
-            emissionColor = MeshData.pbrEmissionValue;
-        }
-    }
-
-    if (MeshData.metallicWorkflow == 1)
-    {
-        float roughness;
-        if (MeshData.pbrUseRoughnessMap == 1)
-        {
-            roughness = texture(RoughnessMap, fragIn.uv).x;
-        }
-        else
-        {
-            roughness = MeshData.pbrRoughnessValue;
-        }
-
-        float metallic;
-        if (MeshData.pbrUseMetallicMap == 1)
-        {
-            metallic = texture(MetallicMap, fragIn.uv).x;
-        }
-        else
-        {
-            metallic = MeshData.pbrMetallicValue;
-        }
-
-        context = InitPBRMetallic(V, N, albedo, metallic, roughness, AO);
-    }
-    else // Specular workflow
-    {
-        vec3 specular;
-        if (MeshData.pbrUseSpecularMap == 1)
-        {
-            specular = texture(SpecularMap, fragIn.uv).xyz;
-        }
-        else
-        {
-            specular = MeshData.pbrSpecularValue;
-        }
-
-        float gloss;
-        if (MeshData.pbrUseGlossMap == 1)
-        {
-            gloss = texture(GlossMap, fragIn.uv).x;
-        }
-        else
-        {
-            gloss = MeshData.pbrGlossValue;
-        }
-         context = InitPBRSpecular(V, N, albedo, specular, gloss, AO);
-    }
+#if defined(EMISSION)
+#if defined(EMISSION_MAP)
+    emissionColor = texture(EmissionMap, fragIn.uv).xyz;
+#else
+    emissionColor = MeshData.pbrEmissionValue;
+#endif
+#endif
+
+#if !defined(SPECULAR_WORKFLOW)
+#if defined(ROUGHNESS_MAP)
+    float roughness = texture(RoughnessMap, fragIn.uv).x;
+#else
+    float roughness = MeshData.pbrRoughnessValue;
+#endif
+
+#if defined(METALLIC_MAP)
+    float metallic = texture(MetallicMap, fragIn.uv).x;
+#else
+    float metallic = MeshData.pbrMetallicValue;
+#endif
+
+    context = InitPBRMetallic(V, N, albedo, metallic, roughness, AO);
+#else
+#if defined(SPECULAR_MAP)
+    vec3 specular = texture(SpecularMap, fragIn.uv).xyz;
+#else
+    vec3 specular = MeshData.pbrSpecularValue;
+#endif
+
+#if defined(GLOSS_MAP)
+    float gloss = texture(GlossMap, fragIn.uv).x;
+#else
+    float gloss = MeshData.pbrGlossValue;
+#endif
+
+    context = InitPBRSpecular(V, N, albedo, specular, gloss, AO);
+#endif
 
     vec3 L = normalize(-FrameData.dirLight.dir);
     vec3 H = normalize(V + L);
@@ -157,9 +137,11 @@ void main()
     vec3 dirRadiance = FrameData.dirLight.diffuse;
     dirRadiance = Unreal4DirectionalLight(context, L) * dirRadiance;
 
-    vec3 envRadiance = Unreal4EnviromentLight(context, IrradanceMap, EnviromentMap, BRDFLut);
+    vec3 envRadiance = Unreal4EnviromentLight(context, EnviromentMap, BRDFLut);
+
+    vec3 localRadiance = ClusteredLocalLights(context, fragIn.fragPos, fragIn.viewPosition);
 
-    vec3 kShadow = CalcShadow(fragIn.viewPosition, FrameData.shadowCascadeSplits, fragIn.lightSpacePos, ShadowMap, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries);
+    vec3 kShadow = CalcShadow(fragIn.viewPosition, fragIn.fragPos, FrameData.shadowCascadeSplits, FrameData.shadowCascadeCount, ShadowMap, ShadowMoments, FrameData.shadowFilterSampleScale, FrameData.showShadowCascadeBoundaries);
 
-    resultColor = vec4((envRadiance +  dirRadiance * kShadow + emissionColor), 1.0f);
+    resultColor = vec4((envRadiance +  dirRadiance * kShadow + localRadiance + emissionColor), 1.0f);
 }
@@ -6,6 +6,13 @@ layout (location = 2) in vec2 UV;
 layout (location = 3) in vec3 Tangent;
 layout (location = 4) in vec3 Bitangent;
 
+#if defined(INDIRECT)
+#include GPUCull.glh
+// NOTE: Index of the visible instance. Instanced attribute, fetch is offset by baseInstance of the draw command
+layout (location = 5) in uint InstanceIndex;
+layout (location = 14) flat out uint ObjectIndex;
+#endif
+
 layout (location = 5) out VertOut
 {
     vec3 fragPos;
@@ -13,23 +20,21 @@ layout (location = 5) out VertOut
     vec2 uv;
     mat3 tbn;
     vec3 viewPosition;
-    vec4 lightSpacePos[3];
 } vertOut;
 
 void main()
 {
+#if defined(INDIRECT)
+    ObjectIndex = Instances[InstanceIndex].object;
+#endif
     vec3 n = normalize(MeshData.normalMatrix * Normal);
     vec3 t = normalize(MeshData.normalMatrix * Tangent);
     t = normalize(t - dot(t, n) * n);
-    vec3 b;
-    if (MeshData.hasBitangents == 1)
-    {
-        b = normalize(MeshData.normalMatrix * Bitangent);
-    }
-    else
-    {
-        b = normalize(cross(n, t));
-    }
+#if defined(HAS_BITANGENTS)
+    vec3 b = normalize(MeshData.normalMatrix * Bitangent);
+#else
+    vec3 b = normalize(cross(n, t));
+#endif
     mat3 tbn = mat3(t, b, n);
 
     gl_Position = FrameData.viewProjMatrix * MeshData.modelMatrix * vec4(Pos, 1.0f);
@@ -38,7 +43,4 @@ void main()
     vertOut.normal = n;
     vertOut.tbn = tbn;
     vertOut.viewPosition = (FrameData.viewMatrix * MeshData.modelMatrix * vec4(Pos, 1.0f)).xyz;
-    vertOut.lightSpacePos[0] = FrameData.lightSpaceMatrices[0] * MeshData.modelMatrix * vec4(Pos, 1.0f);
-    vertOut.lightSpacePos[1] = FrameData.lightSpaceMatrices[1] * MeshData.modelMatrix * vec4(Pos, 1.0f);
-    vertOut.lightSpacePos[2] = FrameData.lightSpaceMatrices[2] * MeshData.modelMatrix * vec4(Pos, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#version 450
+#include Common.glh
+#include Tonemapping.glh
+
+// NOTE: Fused MSAA resolve and tonemapping. Every sample is tonemapped before averaging, so bright HDR
+// samples do not dominate edge pixels. Result is gamma encoded with perceptual luma in alpha for FXAA.
+// Must match ResolveTonemapShader in flux_shaders.h
+#define GROUP_SIZE 8
+
+layout (local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE, local_size_z = 1) in;
+
+layout (binding = 0) uniform sampler2DMS ColorSourceLinear;
+layout (binding = 0, rgba8) uniform writeonly image2D Result;
+layout (location = 0) uniform int SampleCount;
+
+float D3DX_FLOAT_to_SRGB(float val)
+{
+    if (val < 0.0031308f)
+    {
+        val *= 12.92f;
+    }
+    else
+    {
+        val = 1.055f * pow(val, 1.0f / FrameData.gamma) - 0.055f;
+    }
+    return val;
+}
+
+vec3 D3DX_RGB_to_SRGB(vec3 rgb)
+{
+    rgb.r = D3DX_FLOAT_to_SRGB(rgb.r);
+    rgb.g = D3DX_FLOAT_to_SRGB(rgb.g);
+    rgb.b = D3DX_FLOAT_to_SRGB(rgb.b);
+    return rgb;
+}
+
+// TODO: Are these coefficients correct?
+float Luma(vec3 rgb)
+{
+    float result = dot(rgb, vec3(0.299f, 0.587f, 0.114f));
+    return result;
+}
+
+void main()
+{
+    ivec2 size = imageSize(Result);
+    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+    if (coord.x >= size.x || coord.y >= size.y)
+    {
+        return;
+    }
+
+    vec3 ldrSum = vec3(0.0f);
+    for (int i = 0; i < SampleCount; i++)
+    {
+        vec3 hdrSample = texelFetch(ColorSourceLinear, coord, i).xyz;
+        ldrSum += ACESFilmApproxTonemap(hdrSample * FrameData.exposure);
+    }
+    vec3 ldrSample = ldrSum / float(SampleCount);
+
+    vec3 resultSample = D3DX_RGB_to_SRGB(ldrSample * FrameData.exposure);
+    imageStore(Result, coord, vec4(resultSample, Luma(saturate(resultSample))));
+}
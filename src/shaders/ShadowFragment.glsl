@@ -5,6 +5,9 @@ out vec4 color;
 
 void main()
 {
+    // NOTE: Pre-pass writes depth only and keeps early depth test
+#if !defined(PRE_PASS)
     gl_FragDepth = gl_FragCoord.z + FrameData.constShadowBias;
     color = vec4(gl_FragCoord.z, gl_FragCoord.z, gl_FragCoord.z, 1.0f);
+#endif
 }
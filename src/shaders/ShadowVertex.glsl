@@ -1,16 +1,48 @@
 #version 450
+#if defined(LAYERED)
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
 #include Common.glh
 
 layout (location = 0) in vec3 Position;
 layout (location = 1) in vec3 Normal;
 
+#if defined(INDIRECT)
+#include GPUCull.glh
+// NOTE: Index of the visible instance. Instanced attribute, fetch is offset by baseInstance of the draw command
+layout (location = 5) in uint InstanceIndex;
+layout (location = 14) flat out uint ObjectIndex;
+#endif
+
 layout (location = 0) uniform int CascadeIndex;
+// NOTE: Layered pass only. Draw is instanced once for every cascade bit in the mask
+layout (location = 1) uniform uint CascadeMask;
 
 void main()
 {
-    mat4 viewProj = FrameData.lightSpaceMatrices[CascadeIndex];
+#if defined(INDIRECT)
+    ObjectIndex = Instances[InstanceIndex].object;
+#endif
+#if defined(PRE_PASS)
+    // NOTE: Main camera depth pre-pass
+    gl_Position = FrameData.viewProjMatrix * MeshData.modelMatrix * vec4(Position, 1.0f);
+#else
+#if defined(LAYERED)
+    // NOTE: Instance N goes to the cascade of N-th set bit
+    uint mask = CascadeMask;
+    for (int i = 0; i < gl_InstanceID; i++)
+    {
+        mask &= mask - 1u;
+    }
+    int cascade = findLSB(mask);
+    gl_Layer = cascade;
+#else
+    int cascade = CascadeIndex;
+#endif
+    mat4 viewProj = FrameData.lightSpaceMatrices[cascade];
     vec3 normal = normalize(MeshData.normalMatrix * normalize(Normal));
     float NdotL = dot(normal, FrameData.dirLight.pos);
     vec3 p = (MeshData.modelMatrix * vec4(Position, 1.0f)).xyz;
     gl_Position = viewProj * vec4(p, 1.0f);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,515 @@
+#define PLATFORM_WINDOWS
+#include <windows.h>
+#include "../Common.h"
+#include "../Intrinsics.h"
+// NOTE: OpenGL.h must be included through Platform.h
+#include "../Platform.h"
+#include "../OpenGLCapture.h"
+
+#include <stdlib.h>
+#include <utility>
+#include <unordered_map>
+
+// NOTE: Replays GL command streams written by the platform with -glcapture. Setup chunks are replayed once, the last of
+// them restores contents of the resources, then the captured frames are replayed the requested number of times and CPU submit and GPU times are reported per frame.
+// Usage: gl_replay <capture file> [iterations]
+
+void Logger(void* data, const char* fmt, va_list* args) {
+    vprintf(fmt, *args);
+}
+
+LoggerFn* GlobalLogger = Logger;
+void* GlobalLoggerData = nullptr;
+
+inline void AssertHandler(void* data, const char* file, const char* func, u32 line, const char* assertStr, const char* fmt, va_list* args) {
+    log_print("[Assertion failed] Expression (%s) result is false\nFile: %s, function: %s, line: %d.\n", assertStr, file, func, (int)line);
+    if (args) {
+        GlobalLogger(GlobalLoggerData, fmt, args);
+    }
+    debug_break();
+}
+
+AssertHandlerFn* GlobalAssertHandler = AssertHandler;
+void* GlobalAssertHandlerData = nullptr;
+
+#undef ERROR
+#define ERROR(...) (printf(__VA_ARGS__), exit(EXIT_FAILURE))
+
+#define WGL_DRAW_TO_WINDOW_ARB            0x2001
+#define WGL_SUPPORT_OPENGL_ARB            0x2010
+#define WGL_DOUBLE_BUFFER_ARB             0x2011
+#define WGL_PIXEL_TYPE_ARB                0x2013
+#define WGL_TYPE_RGBA_ARB                 0x202B
+#define WGL_COLOR_BITS_ARB                0x2014
+#define WGL_DEPTH_BITS_ARB                0x2022
+#define WGL_ACCELERATION_ARB              0x2003
+#define WGL_FULL_ACCELERATION_ARB         0x2027
+#define WGL_FRAMEBUFFER_SRGB_CAPABLE_ARB  0x20A9
+#define WGL_CONTEXT_MAJOR_VERSION_ARB     0x2091
+#define WGL_CONTEXT_MINOR_VERSION_ARB     0x2092
+#define WGL_CONTEXT_PROFILE_MASK_ARB      0x9126
+#define WGL_CONTEXT_CORE_PROFILE_BIT_ARB  0x00000001
+
+typedef BOOL(WINAPI wglChoosePixelFormatARBFn)(HDC hdc, const int *piAttribIList, const FLOAT *pfAttribFList, UINT nMaxFormats, int *piFormats, UINT *nNumFormats);
+typedef HGLRC(WINAPI wglCreateContextAttribsARBFn)(HDC hDC, HGLRC hShareContext, const int *attribList);
+
+constexpr u32 DefaultIterationCount = 10;
+// NOTE: Memory for outputs, replayed names and string arrays of a single call
+constexpr u64 ScratchSize = 64 * 1024 * 1024;
+constexpr u32 MaxMappings = 64;
+
+struct GLReplayMapping {
+    GLuint buffer;
+    u64 offset;
+    byte* pointer;
+};
+
+struct GLReplayNames {
+    const GLuint* captured;
+    GLuint* replayed;
+    u32 count;
+};
+
+struct GLReplay {
+    OpenGL gl;
+
+    byte* at;
+    byte* end;
+
+    byte* scratch;
+    u64 scratchUsed;
+
+    // NOTE: Captured sync handles to the replayed ones. Entries are overwritten when the driver reuses a handle
+    std::unordered_map<u64, u64> syncs;
+    GLReplayMapping mappings[MaxMappings];
+    u32 mappingCount;
+
+    u64 callCount;
+    u64 skippedCallCount;
+    u64 mismatchCount;
+};
+
+static GLReplay GlobalReplay;
+
+static byte* ReadGLReplay(GLReplay* replay, u64 size) {
+    if (replay->at + size > replay->end) {
+        ERROR("Error: capture is truncated\n");
+    }
+    byte* result = replay->at;
+    replay->at += size;
+    return result;
+}
+
+template <typename T>
+static T ReadGLReplay(GLReplay* replay) {
+    T value;
+    memcpy(&value, ReadGLReplay(replay, sizeof(T)), sizeof(T));
+    return value;
+}
+
+static void* GLReplayScratch(GLReplay* replay, u64 size) {
+    size = (size + 15) & ~(u64)15;
+    if (replay->scratchUsed + size > ScratchSize) {
+        ERROR("Error: call needs more than %llu bytes of scratch memory\n", (unsigned long long)ScratchSize);
+    }
+    void* result = replay->scratch + replay->scratchUsed;
+    replay->scratchUsed += size;
+    return result;
+}
+
+static GLReplayMapping* FindGLReplayMapping(GLReplay* replay, GLuint buffer) {
+    GLReplayMapping* result = nullptr;
+    for (u32 i = 0; i < replay->mappingCount; i++) {
+        if (replay->mappings[i].buffer == buffer) {
+            result = replay->mappings + i;
+            break;
+        }
+    }
+    return result;
+}
+
+#define gl_case(func) case opengl_function_index(func)
+
+static void GLReplayAfterCall(GLReplay* replay, u32 function, const u64* slots, GLReplayNames* names, u64 capturedResult, u64 result) {
+    if (names->count && memcmp(names->captured, names->replayed, names->count * sizeof(GLuint)) != 0) {
+        // NOTE: Calls which use the names are replayed anyway, they are likely to fail
+        replay->mismatchCount++;
+    }
+
+    switch (function) {
+    // NOTE: Replayed with the captured values, so they must be the same
+    gl_case(glCreateShader): gl_case(glCreateProgram): gl_case(glGetAttribLocation): gl_case(glGetUniformLocation):
+    gl_case(glGetUniformBlockIndex): gl_case(glGetSubroutineIndex): {
+        if (capturedResult != result) replay->mismatchCount++;
+    } break;
+    gl_case(glFenceSync): {
+        replay->syncs[capturedResult] = result;
+    } break;
+    gl_case(glMapNamedBufferRange): {
+        if (result) {
+            if (replay->mappingCount == MaxMappings) {
+                ERROR("Error: too many mapped buffers\n");
+            }
+            replay->mappings[replay->mappingCount++] = { (GLuint)slots[0], slots[1], (byte*)result };
+        } else {
+            replay->mismatchCount++;
+        }
+    } break;
+    gl_case(glUnmapNamedBuffer): {
+        auto mapping = FindGLReplayMapping(replay, (GLuint)slots[0]);
+        if (mapping) *mapping = replay->mappings[--replay->mappingCount];
+    } break;
+    default: {} break;
+    }
+}
+
+#undef gl_case
+
+template <typename R, typename... Args, size_t... I>
+static u64 GLReplayInvoke(R (KHRONOS_APIENTRY* fn)(Args...), const u64* slots, std::index_sequence<I...>) {
+    if constexpr (GLCaptureIsVoid<R>::Value) {
+        fn(GLCaptureFromSlot<Args>(slots[I])...);
+        return 0;
+    } else {
+        return GLCaptureToSlot(fn(GLCaptureFromSlot<Args>(slots[I])...));
+    }
+}
+
+typedef void(GLReplayFn)(GLReplay* replay);
+
+template <u32 Index, typename Fn> struct GLReplayStub;
+
+template <u32 Index, typename R, typename... Args>
+struct GLReplayStub<Index, R (KHRONOS_APIENTRY*)(Args...)> {
+    static void Replay(GLReplay* replay) {
+        constexpr u32 ArgCount = sizeof...(Args);
+        u64 slots[ArgCount + 1] = {};
+        u8 sizes[ArgCount + 1] = { GLCaptureArgSize<Args>::Value... };
+        bool syncs[ArgCount + 1] = { GLCaptureIsSync<Args>::Value... };
+        GLReplayNames names = {};
+        bool skip = false;
+        replay->scratchUsed = 0;
+
+        for (u32 i = 0; i < ArgCount; i++) {
+            if (sizes[i]) {
+                memcpy(slots + i, ReadGLReplay(replay, sizes[i]), sizes[i]);
+                if (syncs[i] && slots[i]) {
+                    auto entry = replay->syncs.find(slots[i]);
+                    slots[i] = entry != replay->syncs.end() ? entry->second : 0;
+                }
+                continue;
+            }
+            auto kind = ReadGLReplay<GLCapturePointer>(replay);
+            switch (kind) {
+            case GLCapturePointer::Null: {} break;
+            case GLCapturePointer::Input: {
+                u32 size = ReadGLReplay<u32>(replay);
+                slots[i] = (u64)ReadGLReplay(replay, size);
+            } break;
+            case GLCapturePointer::Offset: {
+                slots[i] = ReadGLReplay<u64>(replay);
+            } break;
+            case GLCapturePointer::Output: {
+                u32 size = ReadGLReplay<u32>(replay);
+                slots[i] = (u64)GLReplayScratch(replay, size);
+            } break;
+            case GLCapturePointer::Names: {
+                names.count = ReadGLReplay<u32>(replay);
+                names.captured = (const GLuint*)ReadGLReplay(replay, names.count * sizeof(GLuint));
+                names.replayed = (GLuint*)GLReplayScratch(replay, names.count * sizeof(GLuint));
+                slots[i] = (u64)names.replayed;
+            } break;
+            case GLCapturePointer::StringArray: {
+                u32 count = ReadGLReplay<u32>(replay);
+                auto strings = (const char**)GLReplayScratch(replay, count * sizeof(const char*));
+                for (u32 s = 0; s < count; s++) {
+                    u32 size = ReadGLReplay<u32>(replay);
+                    strings[s] = (const char*)ReadGLReplay(replay, size);
+                }
+                slots[i] = (u64)strings;
+            } break;
+            case GLCapturePointer::Skip: {
+                skip = true;
+            } break;
+            default: {
+                ERROR("Error: invalid pointer kind %d in a call to %s\n", (int)kind, OpenGL::FunctionNames[Index]);
+            } break;
+            }
+        }
+
+        u64 capturedResult = 0;
+        if constexpr (!GLCaptureIsVoid<R>::Value) {
+            memcpy(&capturedResult, ReadGLReplay(replay, sizeof(R)), sizeof(R));
+        }
+
+        if (skip) {
+            replay->skippedCallCount++;
+        } else {
+            auto fn = (R (KHRONOS_APIENTRY*)(Args...))replay->gl.functions.raw[Index];
+            u64 result = GLReplayInvoke(fn, slots, std::index_sequence_for<Args...>{});
+            GLReplayAfterCall(replay, Index, slots, &names, capturedResult, result);
+            replay->callCount++;
+        }
+    }
+};
+
+static GLReplayFn* GLReplayDispatch[OpenGL::FunctionCount];
+
+static void InitGLReplayDispatch() {
+#define gl_replay_install(func) GLReplayDispatch[opengl_function_index(func)] = GLReplayStub<opengl_function_index(func), decltype(OpenGL::Functions::_Functions::func)>::Replay;
+    GL_CAPTURE_FUNCTIONS(gl_replay_install)
+#undef gl_replay_install
+}
+
+static void ReplayGLChunk(GLReplay* replay, GLCaptureChunk* chunk) {
+    replay->at = (byte*)(chunk + 1);
+    replay->end = replay->at + chunk->size;
+    while (replay->at < replay->end) {
+        u16 index = ReadGLReplay<u16>(replay);
+        if (index == GLCaptureMappedWrite) {
+            GLuint buffer = ReadGLReplay<u32>(replay);
+            u64 offset = ReadGLReplay<u64>(replay);
+            u32 size = ReadGLReplay<u32>(replay);
+            byte* data = ReadGLReplay(replay, size);
+            auto mapping = FindGLReplayMapping(replay, buffer);
+            if (mapping) {
+                memcpy(mapping->pointer + (offset - mapping->offset), data, size);
+            } else {
+                replay->mismatchCount++;
+            }
+        } else if (index < OpenGL::FunctionCount && GLReplayDispatch[index]) {
+            GLReplayDispatch[index](replay);
+        } else {
+            ERROR("Error: unknown function index %u in frame %u\n", (u32)index, chunk->frameIndex);
+        }
+    }
+}
+
+static void* GetGLFunction(HMODULE glLibrary, const char* name) {
+    void* result = (void*)wglGetProcAddress(name);
+    if (result == 0 || result == (void*)0x1 || result == (void*)0x2 || result == (void*)0x3 || result == (void*)-1) {
+        result = (void*)GetProcAddress(glLibrary, name);
+    }
+    return result;
+}
+
+static void CreateGLReplayContext(GLReplay* replay, u32 width, u32 height) {
+    auto instance = GetModuleHandle(0);
+
+    WNDCLASSA windowClass = {};
+    windowClass.style = CS_OWNDC;
+    windowClass.lpfnWndProc = DefWindowProcA;
+    windowClass.hInstance = instance;
+    windowClass.lpszClassName = "FluxGLReplay";
+    if (!RegisterClassA(&windowClass)) {
+        ERROR("Error: failed to register window class\n");
+    }
+
+    // NOTE: Fake context is needed to get WGL extensions
+    HWND fakeWindow = CreateWindowExA(0, windowClass.lpszClassName, "Dummy window", WS_OVERLAPPEDWINDOW, 0, 0, 1, 1, 0, 0, instance, 0);
+    HDC fakeDC = GetDC(fakeWindow);
+    PIXELFORMATDESCRIPTOR fakeFormat = {};
+    fakeFormat.nSize = sizeof(PIXELFORMATDESCRIPTOR);
+    fakeFormat.nVersion = 1;
+    fakeFormat.dwFlags = PFD_SUPPORT_OPENGL | PFD_DRAW_TO_WINDOW | PFD_DOUBLEBUFFER;
+    fakeFormat.cColorBits = 32;
+    fakeFormat.cAlphaBits = 8;
+    fakeFormat.cDepthBits = 24;
+    SetPixelFormat(fakeDC, ChoosePixelFormat(fakeDC, &fakeFormat), &fakeFormat);
+    HGLRC fakeGLRC = wglCreateContext(fakeDC);
+    if (!wglMakeCurrent(fakeDC, fakeGLRC)) {
+        ERROR("Error: failed to create OpenGL context\n");
+    }
+
+    auto wglChoosePixelFormatARB = (wglChoosePixelFormatARBFn*)wglGetProcAddress("wglChoosePixelFormatARB");
+    auto wglCreateContextAttribsARB = (wglCreateContextAttribsARBFn*)wglGetProcAddress("wglCreateContextAttribsARB");
+    if (!wglChoosePixelFormatARB || !wglCreateContextAttribsARB) {
+        ERROR("Error: failed to load WGL extensions\n");
+    }
+
+    // NOTE: Window is never shown, captured frames render to the default framebuffer of the captured size
+    HWND window = CreateWindowExA(0, windowClass.lpszClassName, "Flux GL replay", WS_OVERLAPPEDWINDOW, 0, 0, (int)width, (int)height, 0, 0, instance, 0);
+    HDC windowDC = GetDC(window);
+
+    int formatAttribs[] = {
+        WGL_DRAW_TO_WINDOW_ARB, GL_TRUE,
+        WGL_SUPPORT_OPENGL_ARB, GL_TRUE,
+        WGL_DOUBLE_BUFFER_ARB, GL_TRUE,
+        WGL_FRAMEBUFFER_SRGB_CAPABLE_ARB, GL_TRUE,
+        WGL_ACCELERATION_ARB, WGL_FULL_ACCELERATION_ARB,
+        WGL_PIXEL_TYPE_ARB, WGL_TYPE_RGBA_ARB,
+        WGL_COLOR_BITS_ARB, 32,
+        WGL_DEPTH_BITS_ARB, 24,
+        0
+    };
+    int formatID = 0;
+    UINT formatCount = 0;
+    if (!wglChoosePixelFormatARB(windowDC, formatAttribs, 0, 1, &formatID, &formatCount) || !formatCount) {
+        ERROR("Error: failed to choose pixel format\n");
+    }
+    PIXELFORMATDESCRIPTOR format = {};
+    DescribePixelFormat(windowDC, formatID, sizeof(PIXELFORMATDESCRIPTOR), &format);
+    SetPixelFormat(windowDC, formatID, &format);
+
+    // NOTE: Same version as the platform, without the debug flag which would change the timings
+    int contextAttribs[] = {
+        WGL_CONTEXT_MAJOR_VERSION_ARB, 4,
+        WGL_CONTEXT_MINOR_VERSION_ARB, 5,
+        WGL_CONTEXT_PROFILE_MASK_ARB, WGL_CONTEXT_CORE_PROFILE_BIT_ARB,
+        0
+    };
+    HGLRC glrc = wglCreateContextAttribsARB(windowDC, 0, contextAttribs);
+    if (!glrc) {
+        ERROR("Error: failed to create OpenGL 4.5 core context\n");
+    }
+
+    wglMakeCurrent(0, 0);
+    wglDeleteContext(fakeGLRC);
+    ReleaseDC(fakeWindow, fakeDC);
+    DestroyWindow(fakeWindow);
+
+    if (!wglMakeCurrent(windowDC, glrc)) {
+        ERROR("Error: failed to make OpenGL context current\n");
+    }
+
+    HMODULE glLibrary = LoadLibraryA("opengl32.dll");
+    for (u32 i = 0; i < OpenGL::FunctionCount; i++) {
+        replay->gl.functions.raw[i] = GetGLFunction(glLibrary, OpenGL::FunctionNames[i]);
+    }
+#define gl_replay_check(func) if (!replay->gl.functions.fn.func) ERROR("Error: failed to load %s\n", #func);
+    GL_CAPTURE_FUNCTIONS(gl_replay_check)
+    // NOTE: Used for timing only
+    gl_replay_check(glQueryCounter)
+#undef gl_replay_check
+}
+
+static f64 GetMilliseconds(LARGE_INTEGER begin, LARGE_INTEGER end) {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (f64)(end.QuadPart - begin.QuadPart) * 1000.0 / (f64)frequency.QuadPart;
+}
+
+int main(int argCount, char** args) {
+    if (argCount < 2) {
+        printf("Usage: gl_replay <capture file> [iterations]\n");
+        return EXIT_FAILURE;
+    }
+    u32 iterationCount = DefaultIterationCount;
+    if (argCount > 2) {
+        iterationCount = (u32)Max(atoi(args[2]), 1);
+    }
+
+    FILE* file = fopen(args[1], "rb");
+    if (!file) {
+        ERROR("Error: failed to open file %s\n", args[1]);
+    }
+    _fseeki64(file, 0, SEEK_END);
+    u64 fileSize = (u64)_ftelli64(file);
+    _fseeki64(file, 0, SEEK_SET);
+    auto fileData = (byte*)malloc(fileSize);
+    if (!fileData || fread(fileData, 1, fileSize, file) != fileSize) {
+        ERROR("Error: failed to read file %s\n", args[1]);
+    }
+    fclose(file);
+
+    if (fileSize < sizeof(GLCaptureHeader)) {
+        ERROR("Error: %s is not a GL capture\n", args[1]);
+    }
+    auto header = (GLCaptureHeader*)fileData;
+    if (header->magic != GLCaptureHeader::MagicValue) {
+        ERROR("Error: %s is not a GL capture\n", args[1]);
+    }
+    if (header->version != GLCaptureHeader::CurrentVersion || header->functionCount != OpenGL::FunctionCount) {
+        ERROR("Error: capture version %u with %u functions is not supported. Rebuild gl_replay with the same OpenGL.h as the game\n", header->version, header->functionCount);
+    }
+
+    // NOTE: Chunks of the setup frames go first
+    GLCaptureChunk* setupChunks = nullptr;
+    GLCaptureChunk* capturedChunks = nullptr;
+    u32 setupChunkCount = 0;
+    u32 capturedChunkCount = 0;
+    {
+        byte* at = fileData + sizeof(GLCaptureHeader);
+        for (u32 i = 0; i < header->chunkCount; i++) {
+            auto chunk = (GLCaptureChunk*)at;
+            if (at + sizeof(GLCaptureChunk) > fileData + fileSize || at + sizeof(GLCaptureChunk) + chunk->size > fileData + fileSize) {
+                ERROR("Error: capture is truncated\n");
+            }
+            if (chunk->captured) {
+                if (!capturedChunkCount) capturedChunks = chunk;
+                capturedChunkCount++;
+            } else {
+                if (!setupChunkCount) setupChunks = chunk;
+                setupChunkCount++;
+            }
+            at += sizeof(GLCaptureChunk) + chunk->size;
+        }
+    }
+    if (!capturedChunkCount) {
+        ERROR("Error: capture has no captured frames\n");
+    }
+
+    auto replay = &GlobalReplay;
+    replay->scratch = (byte*)malloc(ScratchSize);
+    InitGLReplayDispatch();
+    CreateGLReplayContext(replay, header->windowWidth, header->windowHeight);
+    auto gl = &replay->gl.functions.fn;
+
+    printf("Replaying %s: %u setup frames, %u captured frames, %u iterations\n", args[1], setupChunkCount, capturedChunkCount, iterationCount);
+    printf("Renderer: %s\n", (const char*)gl->glGetString(GL_RENDERER));
+
+    auto chunk = setupChunks;
+    for (u32 i = 0; i < setupChunkCount; i++) {
+        ReplayGLChunk(replay, chunk);
+        chunk = (GLCaptureChunk*)((byte*)(chunk + 1) + chunk->size);
+    }
+    gl->glFinish();
+    u64 setupMismatchCount = replay->mismatchCount;
+
+    // NOTE: Queries are created after the setup, so the names generated during the setup are the captured ones
+    GLuint queries[2];
+    gl->glGenQueries(2, queries);
+
+    f64 cpuMin = DBL_MAX, cpuMax = 0.0, cpuSum = 0.0;
+    f64 gpuMin = DBL_MAX, gpuMax = 0.0, gpuSum = 0.0;
+    u64 callCountBegin = replay->callCount;
+    for (u32 iteration = 0; iteration < iterationCount; iteration++) {
+        LARGE_INTEGER cpuBegin, cpuEnd;
+        QueryPerformanceCounter(&cpuBegin);
+        gl->glQueryCounter(queries[0], GL_TIMESTAMP);
+        chunk = capturedChunks;
+        for (u32 i = 0; i < capturedChunkCount; i++) {
+            ReplayGLChunk(replay, chunk);
+            chunk = (GLCaptureChunk*)((byte*)(chunk + 1) + chunk->size);
+        }
+        gl->glQueryCounter(queries[1], GL_TIMESTAMP);
+        QueryPerformanceCounter(&cpuEnd);
+
+        // NOTE: Waits for the GPU, so iterations do not overlap
+        GLuint64 gpuBegin, gpuEnd;
+        gl->glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &gpuBegin);
+        gl->glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &gpuEnd);
+
+        f64 cpuMs = GetMilliseconds(cpuBegin, cpuEnd) / (f64)capturedChunkCount;
+        f64 gpuMs = (f64)(gpuEnd - gpuBegin) / 1000000.0 / (f64)capturedChunkCount;
+        cpuMin = Min(cpuMin, cpuMs);
+        cpuMax = Max(cpuMax, cpuMs);
+        cpuSum += cpuMs;
+        gpuMin = Min(gpuMin, gpuMs);
+        gpuMax = Max(gpuMax, gpuMs);
+        gpuSum += gpuMs;
+    }
+
+    f64 frames = (f64)iterationCount;
+    printf("GL calls per frame: %llu\n", (unsigned long long)((replay->callCount - callCountBegin) / ((u64)iterationCount * capturedChunkCount)));
+    printf("CPU submit ms per frame: min %8.3f avg %8.3f max %8.3f\n", cpuMin, cpuSum / frames, cpuMax);
+    printf("GPU ms per frame:        min %8.3f avg %8.3f max %8.3f\n", gpuMin, gpuSum / frames, gpuMax);
+    if (replay->skippedCallCount) {
+        printf("Skipped calls: %llu\n", (unsigned long long)replay->skippedCallCount);
+    }
+    if (replay->mismatchCount) {
+        printf("Warning: %llu mismatches with the captured process (%llu during the setup). Results may be unreliable\n",
+               (unsigned long long)replay->mismatchCount, (unsigned long long)setupMismatchCount);
+    }
+    return 0;
+}
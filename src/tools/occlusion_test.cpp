@@ -0,0 +1,144 @@
+#define PLATFORM_WINDOWS
+#include <windows.h>
+#include "../Common.h"
+#include "../Intrinsics.h"
+#include "../Platform.h"
+
+#include <stdlib.h>
+
+// NOTE: Runs the software occlusion test without the engine and GL. Binning and band jobs run on worker threads
+// like on the render queue of the platform. Exits with nonzero code if the test failed.
+// Usage: occlusion_test [runs]
+
+void Logger(void* data, const char* fmt, va_list* args) {
+    vprintf(fmt, *args);
+}
+
+LoggerFn* GlobalLogger = Logger;
+void* GlobalLoggerData = nullptr;
+
+inline void AssertHandler(void* data, const char* file, const char* func, u32 line, const char* assertStr, const char* fmt, va_list* args) {
+    log_print("[Assertion failed] Expression (%s) result is false\nFile: %s, function: %s, line: %d.\n", assertStr, file, func, (int)line);
+    if (args) {
+        GlobalLogger(GlobalLoggerData, fmt, args);
+    }
+    debug_break();
+}
+
+AssertHandlerFn* GlobalAssertHandler = AssertHandler;
+void* GlobalAssertHandlerData = nullptr;
+
+constexpr u32 DefaultRunCount = 16;
+constexpr u32 WorkerThreadCount = 4;
+
+// NOTE: Same single producer queue as the one of the platform
+struct WorkQueueEntry {
+    void* data0;
+    void* data1;
+    void* data2;
+    WorkFn* function;
+};
+
+struct WorkQueue {
+    u32 volatile pendingWorkCount;
+    u32 volatile completedWorkCount;
+    u32 volatile begin;
+    u32 volatile end;
+    WorkQueueEntry queue[128];
+    HANDLE semaphore;
+};
+
+static WorkQueue GlobalQueue;
+
+b32 PushWork(WorkQueue* queue, WorkFn* fn, void* data0, void* data1, void* data2) {
+    bool result = false;
+    auto nextEntry = (queue->end + 1) % array_count(queue->queue);
+    if (nextEntry != queue->begin) {
+        auto entry = queue->queue + queue->end;
+        entry->function = fn;
+        entry->data0 = data0;
+        entry->data1 = data1;
+        entry->data2 = data2;
+        queue->pendingWorkCount++;
+        WriteFence();
+        queue->end = nextEntry;
+        ReleaseSemaphore(queue->semaphore, 1, nullptr);
+        result = true;
+    }
+    return result;
+}
+
+bool DoWork(WorkQueue* queue, u32 threadIndex) {
+    bool result = false;
+    auto oldBegin = queue->begin;
+    auto newBegin = (oldBegin + 1) % array_count(queue->queue);
+    if (oldBegin != queue->end) {
+        u32 index = AtomicCompareExchange(&queue->begin, newBegin, oldBegin);
+        if (index == oldBegin) {
+            auto entry = queue->queue + index;
+            entry->function(entry->data0, entry->data1, entry->data2, threadIndex);
+            AtomicIncrement(&queue->completedWorkCount);
+            result = true;
+        }
+    }
+    return result;
+}
+
+void CompleteAllWork(WorkQueue* queue) {
+    while (queue->pendingWorkCount != queue->completedWorkCount) {
+        DoWork(queue, 0);
+    }
+    queue->pendingWorkCount = 0;
+    queue->completedWorkCount = 0;
+}
+
+DWORD WINAPI WorkerThreadProc(void* param) {
+    auto threadIndex = (u32)(uptr)param;
+    while (true) {
+        if (!DoWork(&GlobalQueue, threadIndex)) {
+            WaitForSingleObjectEx(GlobalQueue.semaphore, INFINITE, FALSE);
+        }
+    }
+}
+
+void* Allocate(uptr size, uptr alignment, void* data) {
+    return calloc(1, size);
+}
+
+void Deallocate(void* ptr, void* data) {
+    free(ptr);
+}
+
+#define PlatformAlloc Allocate
+#define PlatformFree Deallocate
+#define PlatformPushWork PushWork
+#define PlatformCompleteAllWork CompleteAllWork
+#define GlobalRenderWorkQueue (&GlobalQueue)
+
+#include "../flux_occlusion.h"
+#include "../flux_occlusion.cpp"
+#include "../Intrinsics.cpp"
+
+int main(int argCount, char** args) {
+    u32 runCount = DefaultRunCount;
+    if (argCount > 1) {
+        runCount = (u32)Max(atoi(args[1]), 1);
+    }
+
+    GlobalQueue.semaphore = CreateSemaphoreEx(0, 0, WorkerThreadCount, 0, 0, SEMAPHORE_ALL_ACCESS);
+    for (u32 i = 0; i < WorkerThreadCount; i++) {
+        auto thread = CreateThread(0, 0, WorkerThreadProc, (void*)(uptr)(i + 1), 0, nullptr);
+        CloseHandle(thread);
+    }
+
+    // NOTE: Every run schedules the jobs differently, so the test is repeated to catch races
+    u32 failedRunCount = 0;
+    for (u32 i = 0; i < runCount; i++) {
+        if (!RunOcclusionTest()) {
+            failedRunCount++;
+        }
+    }
+
+    printf("[Occlusion] %u of %u runs failed\n", failedRunCount, runCount);
+    return failedRunCount ? EXIT_FAILURE : 0;
+}
@@ -48,13 +48,20 @@ static FILE* OutFile = 0;
 const char* DELIMETERS = " \f\n\r\t\v\n\r";
 const char* EOL_MARKERS = " \n\r";
 
+// NOTE: Every combination of features gets its own permutation slot, so keeping it sane
+constexpr u32 MaxFeatureCount = 16;
+
 struct Program
 {
     std::string name;
     std::string vert;
     std::string frag;
+    // NOTE: Compute programs have a single source file
+    std::string comp;
     std::string vertSource;
     std::string fragSource;
+    std::string compSource;
+    std::vector<std::string> features;
 };
 
 bool OneOf(char c, const char* t)
@@ -104,13 +111,48 @@ std::vector<Program> ParseConfigFile(const char* filename)
         at = EatUntilOneOf(at, "\"");
         prog.vert = std::string(vertBeg, (uptr)at - (uptr)vertBeg);
         at++;
-        at = EatUntilOneOf(at, "\"");
-        at++;
-        auto fragBeg = at;
-        at = EatUntilOneOf(at, "\"");
-        prog.frag = std::string(fragBeg, (uptr)at - (uptr)fragBeg);
-        at++;
         at = EatSpace(at);
+        // NOTE: Program with only one source is a compute program. Example: Name "comp.glsl" [Feature]
+        if (*at == '"')
+        {
+            at++;
+            auto fragBeg = at;
+            at = EatUntilOneOf(at, "\"");
+            prog.frag = std::string(fragBeg, (uptr)at - (uptr)fragBeg);
+            at++;
+            at = EatSpace(at);
+        }
+        else
+        {
+            prog.comp = std::move(prog.vert);
+            prog.vert = "";
+        }
+        // NOTE: Optional feature list. Example: [AlbedoMap NormalMap]
+        if (*at == '[')
+        {
+            at++;
+            while (true)
+            {
+                at = EatSpace(at);
+                if (*at == ']')
+                {
+                    at++;
+                    break;
+                }
+                if (!*at)
+                {
+                    ERROR("Error: Unterminated feature list in program %s\n", prog.name.c_str());
+                }
+                auto featureBeg = at;
+                at = EatUntilOneOf(at, " \f\n\r\t\v]");
+                prog.features.push_back(std::string(featureBeg, (uptr)at - (uptr)featureBeg));
+            }
+            if (prog.features.size() > MaxFeatureCount)
+            {
+                ERROR("Error: Program %s has too many features (max is %lu)\n", prog.name.c_str(), (unsigned long)MaxFeatureCount);
+            }
+            at = EatSpace(at);
+        }
         programs.push_back(std::move(prog));
     }
     return std::move(programs);
@@ -151,6 +193,27 @@ std::string PreprocessShader(const std::string path, const std::string& source)
     return result;
 }
 
+// NOTE: AlbedoMap -> ALBEDO_MAP, AOMap -> AO_MAP, NormalMapDX -> NORMAL_MAP_DX
+std::string FeatureDefineName(const std::string& feature)
+{
+    std::string result = "";
+    for (uptr i = 0; i < feature.size(); i++)
+    {
+        char c = feature[i];
+        if (i > 0 && isupper((unsigned char)c))
+        {
+            bool prevLower = islower((unsigned char)feature[i - 1]) || isdigit((unsigned char)feature[i - 1]);
+            bool nextLower = (i + 1 < feature.size()) && islower((unsigned char)feature[i + 1]);
+            if (prevLower || (isupper((unsigned char)feature[i - 1]) && nextLower))
+            {
+                result += '_';
+            }
+        }
+        result += (char)toupper((unsigned char)c);
+    }
+    return result;
+}
+
 void OutShaderSource(const char* shaderSource)
 {
     auto at = shaderSource;
@@ -188,6 +251,16 @@ int main(int argCount, char** args)
     for (auto& prog : programs)
     {
         u32 size;
+        if (!prog.comp.empty())
+        {
+            char* _comp = ReadEntireFileAsText(prog.comp.c_str(), &size);
+            if (!_comp)
+            {
+                ERROR("Error: Failed to read shader file %s\n", prog.comp.c_str());
+            }
+            prog.compSource = PreprocessShader(prog.comp, std::string(_comp));
+            continue;
+        }
         char* _vert = ReadEntireFileAsText(prog.vert.c_str(), &size);
         char* _frag = ReadEntireFileAsText(prog.frag.c_str(), &size);
         if (!_vert)
@@ -230,6 +303,64 @@ int main(int argCount, char** args)
     IDENT_POP();
     L("};\n");
 
+    L("struct ShaderIndex");
+    L("{");
+    IDENT_PUSH();
+    for (uptr i = 0; i < programs.size(); i++)
+    {
+        L("static constexpr u32 %s = %lu;", programs[i].name.c_str(), (unsigned long)i);
+    }
+    IDENT_POP();
+    L("};\n");
+
+    for (auto& it : programs)
+    {
+        if (!it.features.empty())
+        {
+            L("struct %sFeature", it.name.c_str());
+            L("{");
+            IDENT_PUSH();
+            for (uptr i = 0; i < it.features.size(); i++)
+            {
+                L("static constexpr u32 %s = 1 << %lu;", it.features[i].c_str(), (unsigned long)i);
+            }
+            IDENT_POP();
+            L("};\n");
+
+            L("const char* %sFeatureDefines[] =", it.name.c_str());
+            L("{");
+            IDENT_PUSH();
+            for (auto& feature : it.features)
+            {
+                L("\"%s\",", FeatureDefineName(feature).c_str());
+            }
+            IDENT_POP();
+            L("};\n");
+        }
+    }
+
+    // NOTE: Lookup table of permutation slots. Program with N features owns 2^N slots
+    // starting from firstPermutation, indexed by feature mask
+    u32 permutationCount = 0;
+    L("const ShaderPermutationInfo ShaderPermutations[] =");
+    L("{");
+    IDENT_PUSH();
+    for (auto& it : programs)
+    {
+        if (it.features.empty())
+        {
+            L("{ 0, 0, nullptr },");
+        }
+        else
+        {
+            L("{ %lu, %lu, %sFeatureDefines },", (unsigned long)permutationCount, (unsigned long)it.features.size(), it.name.c_str());
+            permutationCount += 1u << (u32)it.features.size();
+        }
+    }
+    IDENT_POP();
+    L("};\n");
+    L("constexpr u32 ShaderPermutationCount = %lu;\n", (unsigned long)permutationCount);
+
     L("const ShaderProgramSource ShaderSources[] =");
     L("{");
     IDENT_PUSH();
@@ -237,9 +368,18 @@ int main(int argCount, char** args)
     {
         L("{");
         IDENT_PUSH();
-        OutShaderSource(it.vertSource.c_str());
-        A(",\n");
-        OutShaderSource(it.fragSource.c_str());
+        if (!it.compSource.empty())
+        {
+            L("nullptr,");
+            L("nullptr,");
+            OutShaderSource(it.compSource.c_str());
+        }
+        else
+        {
+            OutShaderSource(it.vertSource.c_str());
+            A(",\n");
+            OutShaderSource(it.fragSource.c_str());
+        }
         IDENT_POP();
         L("},");
     }